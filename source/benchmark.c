@@ -0,0 +1,1503 @@
+/*
+ * The Clear BSD License
+ * Copyright (c) 2018 Adesto Technologies Corporation, Inc
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted (subject to the limitations in the disclaimer below) provided
+ *  that the following conditions are met:
+ *
+ * o Redistributions of source code must retain the above copyright notice, this list
+ *   of conditions and the following disclaimer.
+ *
+ * o Redistributions in binary form must reproduce the above copyright notice, this
+ *   list of conditions and the following disclaimer in the documentation and/or
+ *   other materials provided with the distribution.
+ *
+ * o Neither the name of the copyright holder nor the names of its
+ *   contributors may be used to endorse or promote products derived from this
+ *   software without specific prior written permission.
+ *
+ * NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE GRANTED BY THIS LICENSE.
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*!
+ * @ingroup TEST_LAYER
+ */
+/**
+ * @file    benchmark.c
+ * @brief   Definition of benchmark functions.
+ */
+#include "benchmark.h"
+#include "cmd_defs.h"
+#include <string.h>
+#if defined(MONETA_DEVICE)
+#include "moneta.h"
+#elif defined(FUSION_DEVICE)
+#include "fusion.h"
+#elif defined(DATAFLASH_DEVICE)
+#include "dataflash.h"
+#elif defined(STANDARDFLASH_DEVICE)
+#include "standardflash.h"
+#endif
+
+static uint32_t benchmarkRead(uint8_t ioLines, uint8_t *rxBuffer)
+{
+	uint8_t opcode = (ioLines == 4) ? 0x6B : (ioLines == 2) ? 0x3B : 0x03;
+	uint8_t txBuffer[4] = {opcode, 0, 0, 0};
+	SPI_Transfer transfer =
+	{
+		.txBuffer = txBuffer,
+		.txNumBytes = 4,
+		.txSingleNumBytes = 4,
+		.dummyNumBytes = (ioLines == 1) ? 0 : 1,
+		.rxBuffer = rxBuffer,
+		.rxNumBytes = BENCHMARK_NUM_BYTES,
+		.ioLines = ioLines,
+		.dummyIOLines = 1,
+		.clockHz = SPI_CommandClockHz(opcode)
+	};
+	uint32_t start = USER_CONFIG_CycleCount();
+	SPI_Transact(&transfer);
+	return USER_CONFIG_CycleCount() - start;
+}
+
+int benchmarkBitBangEngines()
+{
+	uint8_t pinBuffer[BENCHMARK_NUM_BYTES];
+	uint8_t portBuffer[BENCHMARK_NUM_BYTES];
+	uint8_t modes[3] = {1, 2, 4};
+	enum spiBitBangEngine entryEngine = SPI_GetBitBangEngine();
+	int errors = 0;
+	uint32_t i;
+	uint32_t j;
+
+	printf("Bit-bang engine benchmark, %u bytes per read.\n", BENCHMARK_NUM_BYTES);
+	if(!SPI_SetBitBangEngine(SPI_ENGINE_PORT))
+	{
+		printf("Error with benchmarkBitBangEngines.\n");
+		printf("\t- The pin layout does not allow the port engine.\n");
+		return 1;
+	}
+	printf("lines,pin_cycles,port_cycles,pin_cycles_per_byte,port_cycles_per_byte,speedup_x100,data\n");
+	for(i = 0; i < 3; i++)
+	{
+		SPI_SetBitBangEngine(SPI_ENGINE_PIN);
+		uint32_t pinCycles = benchmarkRead(modes[i], pinBuffer);
+		SPI_SetBitBangEngine(SPI_ENGINE_PORT);
+		uint32_t portCycles = benchmarkRead(modes[i], portBuffer);
+
+		uint32_t mismatches = 0;
+		for(j = 0; j < BENCHMARK_NUM_BYTES; j++)
+		{
+			if(pinBuffer[j] != portBuffer[j])
+				mismatches++;
+		}
+		if(mismatches)
+			errors++;
+		printf("%u,%lu,%lu,%lu,%lu,%lu,%s\n",
+			   modes[i],
+			   (unsigned long) pinCycles,
+			   (unsigned long) portCycles,
+			   (unsigned long) (pinCycles / BENCHMARK_NUM_BYTES),
+			   (unsigned long) (portCycles / BENCHMARK_NUM_BYTES),
+			   (unsigned long) (portCycles ? ((uint64_t) pinCycles * 100) / portCycles : 0),
+			   mismatches ? "mismatch" : "match");
+	}
+	SPI_SetBitBangEngine(entryEngine);
+	return errors;
+}
+
+/******************************************************************************
+ * Benchmark suite
+ *****************************************************************************/
+
+// Mode byte keeping a dual or quad IO read in continuous read mode (M5-4 = 10b).
+#define BENCHMARK_CONTINUOUS_MODE_BYTE 0x20
+
+typedef struct
+{
+	//! Driver function, and mode for those with several.
+	const char *name;
+	//! Opcode, or opcodes, sent by the driver function.
+	const char *opcode;
+	//! Reads 'rxNumBytes' bytes from the linear address 'address'. rxBuffer may be NULL.
+	void (*read)(uint32_t address, uint8_t *rxBuffer, uint32_t rxNumBytes);
+	//! Called before and after the sweep, or NULL.
+	void (*begin)();
+	void (*end)();
+} benchmarkReadVariant;
+
+typedef struct
+{
+	const char *name;
+	const char *opcode;
+	//! Programs up to one page from a page boundary and waits for completion.
+	void (*program)(uint32_t address, uint8_t *txBuffer, uint32_t txNumBytes);
+	void (*begin)();
+	void (*end)();
+} benchmarkProgramVariant;
+
+typedef struct
+{
+	const char *name;
+	const char *opcode;
+	//! Erases the unit starting at 'address' and waits for completion.
+	void (*erase)(uint32_t address);
+	//! Bytes erased per call, 0 for the whole array.
+	uint32_t numBytes;
+} benchmarkEraseVariant;
+
+static benchmarkClock benchmarkClockFunction = NULL;
+static void *benchmarkClockContext = NULL;
+static uint64_t benchmarkCycles;
+static uint32_t benchmarkLastCycleCount;
+
+static uint8_t benchmarkPattern[BENCHMARK_SWEEP_BUFFER_BYTES];
+static uint8_t benchmarkBuffer[BENCHMARK_SWEEP_BUFFER_BYTES];
+
+void benchmarkSetClock(benchmarkClock clock, void *context)
+{
+	benchmarkClockFunction = clock;
+	benchmarkClockContext = context;
+}
+
+static uint64_t benchmarkTimeNs()
+{
+	uint32_t cycleCount;
+	uint32_t hz;
+	if(benchmarkClockFunction != NULL)
+		return benchmarkClockFunction(benchmarkClockContext);
+	// Accumulated in 64 bits, so the 32-bit counter may wrap between two calls.
+	cycleCount = USER_CONFIG_CycleCount();
+	benchmarkCycles += (uint32_t) (cycleCount - benchmarkLastCycleCount);
+	benchmarkLastCycleCount = cycleCount;
+	hz = USER_CONFIG_CycleCountHz();
+	return (benchmarkCycles / hz) * 1000000000ULL + ((benchmarkCycles % hz) * 1000000000ULL) / hz;
+}
+
+/******************************************************************************
+ * Per family commands
+ *****************************************************************************/
+
+#if defined(MONETA_DEVICE)
+
+static uint32_t benchmarkPageSize()
+{
+	return MONETA_PAGE_SIZE;
+}
+
+static void benchmarkSetup()
+{
+}
+
+static void benchmarkMonetaReadArray(uint32_t address, uint8_t *rxBuffer, uint32_t rxNumBytes)
+{
+	monetaReadArray((uint16_t) address, rxBuffer, rxNumBytes);
+}
+
+static void benchmarkMonetaWriteArray(uint32_t address, uint8_t *txBuffer, uint32_t txNumBytes)
+{
+	monetaWriteEnable();
+	monetaWriteArray((uint16_t) address, txBuffer, txNumBytes);
+	monetaWaitOnReady();
+}
+
+static void benchmarkMonetaErase(uint32_t address)
+{
+	monetaErase((uint16_t) address);
+}
+
+static void benchmarkMonetaProgram(uint32_t address, uint8_t *txBuffer, uint32_t txNumBytes)
+{
+	monetaProgram((uint16_t) address, txBuffer, txNumBytes);
+}
+
+static const benchmarkReadVariant benchmarkReads[] =
+{
+	{"monetaReadArray", "0x03", benchmarkMonetaReadArray, NULL, NULL},
+};
+
+static const benchmarkProgramVariant benchmarkPrograms[] =
+{
+	{"monetaWriteArray", "0x02", benchmarkMonetaWriteArray, NULL, NULL},
+};
+
+static const benchmarkEraseVariant benchmarkErases[] =
+{
+	{"monetaErase", "0x02", benchmarkMonetaErase, MONETA_ERASE_SIZE},
+};
+
+#define benchmarkRead benchmarkMonetaReadArray
+#define benchmarkProgram benchmarkMonetaProgram
+#define benchmarkErase benchmarkMonetaErase
+#define BENCHMARK_ERASE_SIZE MONETA_ERASE_SIZE
+
+#elif defined(FUSION_DEVICE)
+
+static uint32_t benchmarkPageSize()
+{
+	return FUSION_PAGE_SIZE;
+}
+
+static void benchmarkSetup()
+{
+#if defined(CMD_FUSION_PROTECT_SECTOR)
+	fusionGlobalUnprotect();
+	fusionWaitOnReady();
+#endif
+}
+
+static void benchmarkFusionProgramArray(uint32_t address, uint8_t *txBuffer, uint32_t txNumBytes)
+{
+	fusionWriteEnable();
+	fusionProgramArray(address, txBuffer, txNumBytes);
+	fusionWaitOnReadyFor(FUSION_TPP_US);
+}
+
+#if defined(CMD_FUSION_DUAL_INPUT_PROGRAM)
+static void benchmarkFusionDualInputProgram(uint32_t address, uint8_t *txBuffer, uint32_t txNumBytes)
+{
+	fusionWriteEnable();
+	fusionDualInputProgram(address, txBuffer, txNumBytes);
+	fusionWaitOnReadyFor(FUSION_TPP_US);
+}
+#endif
+
+static void benchmarkFusionPageErase(uint32_t address)
+{
+	fusionWriteEnable();
+	fusionPageErase(address);
+	fusionWaitOnReadyFor(FUSION_TPE_US);
+}
+
+static void benchmarkFusionBlockErase4K(uint32_t address)
+{
+	fusionWriteEnable();
+	fusionBlockErase4K(address);
+	fusionWaitOnReadyFor(FUSION_TBE_US);
+}
+
+static void benchmarkFusionChipErase(uint32_t address)
+{
+	(void) address;
+	fusionWriteEnable();
+	fusionChipErase();
+	fusionWaitOnReadyFor(FUSION_TCE_US);
+}
+
+static const benchmarkReadVariant benchmarkReads[] =
+{
+	{"fusionReadArrayLF", "0x03", fusionReadArrayLF, NULL, NULL},
+	{"fusionReadArray", "0x0B", fusionReadArray, NULL, NULL},
+	{"fusionDualOutputRead", "0x3B", fusionDualOutputRead, NULL, NULL},
+};
+
+static const benchmarkProgramVariant benchmarkPrograms[] =
+{
+	{"fusionProgramArray", "0x02", benchmarkFusionProgramArray, NULL, NULL},
+#if defined(CMD_FUSION_DUAL_INPUT_PROGRAM)
+	{"fusionDualInputProgram", "0xA2", benchmarkFusionDualInputProgram, NULL, NULL},
+#endif
+};
+
+static const benchmarkEraseVariant benchmarkErases[] =
+{
+	{"fusionPageErase", "0x81", benchmarkFusionPageErase, FUSION_PAGE_SIZE},
+	{"fusionBlockErase4K", "0x20", benchmarkFusionBlockErase4K, 4096},
+	{"fusionChipErase", "0x60", benchmarkFusionChipErase, 0},
+};
+
+#define benchmarkRead fusionRead
+#define benchmarkProgram fusionProgram
+#define benchmarkErase fusionErase
+#define BENCHMARK_ERASE_SIZE FUSION_ERASE_SIZE
+
+#elif defined(DATAFLASH_DEVICE)
+
+// Page size read from the device at the start of the suite.
+static uint32_t benchmarkDataflashPageSize;
+
+static uint32_t benchmarkPageSize()
+{
+	return benchmarkDataflashPageSize;
+}
+
+static void benchmarkSetup()
+{
+	benchmarkDataflashPageSize = dataflashGetPageSize();
+}
+
+static uint32_t benchmarkDataflashAddress(uint32_t address)
+{
+	return dataflashDeviceAddress(address, benchmarkDataflashPageSize);
+}
+
+static void benchmarkDataflashArrayReadLowPower(uint32_t address, uint8_t *rxBuffer, uint32_t rxNumBytes)
+{
+	dataflashArrayReadLowPower(benchmarkDataflashAddress(address), rxBuffer, rxNumBytes);
+}
+
+static void benchmarkDataflashArrayReadLowFreq(uint32_t address, uint8_t *rxBuffer, uint32_t rxNumBytes)
+{
+	dataflashArrayReadLowFreq(benchmarkDataflashAddress(address), rxBuffer, rxNumBytes);
+}
+
+static void benchmarkDataflashArrayReadHighFreq0(uint32_t address, uint8_t *rxBuffer, uint32_t rxNumBytes)
+{
+	dataflashArrayReadHighFreq0(benchmarkDataflashAddress(address), rxBuffer, rxNumBytes);
+}
+
+static void benchmarkDataflashArrayReadHighFreq1(uint32_t address, uint8_t *rxBuffer, uint32_t rxNumBytes)
+{
+	dataflashArrayReadHighFreq1(benchmarkDataflashAddress(address), rxBuffer, rxNumBytes);
+}
+
+static void benchmarkDataflashProgramThruBuffer1WithErase(uint32_t address, uint8_t *txBuffer, uint32_t txNumBytes)
+{
+	dataflashMemoryProgramThruBuffer1WithErase(benchmarkDataflashAddress(address), txBuffer, txNumBytes);
+	dataflashWaitOnReadyFor(DATAFLASH_TEP_US);
+}
+
+static void benchmarkDataflashProgramThruBuffer1WithoutErase(uint32_t address, uint8_t *txBuffer, uint32_t txNumBytes)
+{
+	dataflashMemoryProgramThruBuffer1WithoutErase(benchmarkDataflashAddress(address), txBuffer, txNumBytes);
+	dataflashWaitOnReadyFor(DATAFLASH_TEP_US - DATAFLASH_TPE_US);
+}
+
+static void benchmarkDataflashBuffer1ToMainMemory(uint32_t address, uint8_t *txBuffer, uint32_t txNumBytes)
+{
+	dataflashBuffer1Write(benchmarkDataflashAddress(address), txBuffer, txNumBytes);
+	dataflashBuffer1ToMainMemoryWithErase(benchmarkDataflashAddress(address));
+	dataflashWaitOnReadyFor(DATAFLASH_TEP_US);
+}
+
+static void benchmarkDataflashPageErase(uint32_t address)
+{
+	dataflashPageErase(benchmarkDataflashAddress(address));
+	dataflashWaitOnReadyFor(DATAFLASH_TPE_US);
+}
+
+static void benchmarkDataflashBlockErase(uint32_t address)
+{
+	dataflashBlockErase(benchmarkDataflashAddress(address));
+	dataflashWaitOnReadyFor(DATAFLASH_TBE_US);
+}
+
+static void benchmarkDataflashChipErase(uint32_t address)
+{
+	(void) address;
+	dataflashChipErase();
+	dataflashWaitOnReadyFor(DATAFLASH_TCE_US);
+}
+
+#if defined(CMD_DATAFLASH_DUAL_OUTPUT_READ_ARRAY)
+static void benchmarkDataflashDualOutputRead(uint32_t address, uint8_t *rxBuffer, uint32_t rxNumBytes)
+{
+	dataflashDualOutputRead(benchmarkDataflashAddress(address), rxBuffer, rxNumBytes);
+}
+
+static void benchmarkDataflashQuadOutputRead(uint32_t address, uint8_t *rxBuffer, uint32_t rxNumBytes)
+{
+	dataflashQuadOutputRead(benchmarkDataflashAddress(address), rxBuffer, rxNumBytes);
+}
+
+static void benchmarkDataflashDualInputBuffer1ToMainMemory(uint32_t address, uint8_t *txBuffer, uint32_t txNumBytes)
+{
+	dataflashDualInputBuffer1Write(benchmarkDataflashAddress(address), txBuffer, txNumBytes);
+	dataflashBuffer1ToMainMemoryWithErase(benchmarkDataflashAddress(address));
+	dataflashWaitOnReadyFor(DATAFLASH_TEP_US);
+}
+
+static void benchmarkDataflashQuadInputBuffer1ToMainMemory(uint32_t address, uint8_t *txBuffer, uint32_t txNumBytes)
+{
+	dataflashQuadInputBuffer1Write(benchmarkDataflashAddress(address), txBuffer, txNumBytes);
+	dataflashBuffer1ToMainMemoryWithErase(benchmarkDataflashAddress(address));
+	dataflashWaitOnReadyFor(DATAFLASH_TEP_US);
+}
+
+static void benchmarkDataflashQuadBegin()
+{
+	dataflashQuadEnable();
+	dataflashWaitOnReady();
+}
+
+static void benchmarkDataflashQuadEnd()
+{
+	dataflashQuadDisable();
+	dataflashWaitOnReady();
+}
+#endif
+
+static const benchmarkReadVariant benchmarkReads[] =
+{
+	{"dataflashArrayReadLowPower", "0x01", benchmarkDataflashArrayReadLowPower, NULL, NULL},
+	{"dataflashArrayReadLowFreq", "0x03", benchmarkDataflashArrayReadLowFreq, NULL, NULL},
+	{"dataflashArrayReadHighFreq0", "0x0B", benchmarkDataflashArrayReadHighFreq0, NULL, NULL},
+	{"dataflashArrayReadHighFreq1", "0x1B", benchmarkDataflashArrayReadHighFreq1, NULL, NULL},
+#if defined(CMD_DATAFLASH_DUAL_OUTPUT_READ_ARRAY)
+	{"dataflashDualOutputRead", "0x3B", benchmarkDataflashDualOutputRead, NULL, NULL},
+	{"dataflashQuadOutputRead", "0x6B", benchmarkDataflashQuadOutputRead, benchmarkDataflashQuadBegin, benchmarkDataflashQuadEnd},
+#endif
+};
+
+static const benchmarkProgramVariant benchmarkPrograms[] =
+{
+	{"dataflashMemoryProgramThruBuffer1WithErase", "0x82", benchmarkDataflashProgramThruBuffer1WithErase, NULL, NULL},
+	{"dataflashMemoryProgramThruBuffer1WithoutErase", "0x02", benchmarkDataflashProgramThruBuffer1WithoutErase, NULL, NULL},
+	{"dataflashBuffer1Write+dataflashBuffer1ToMainMemoryWithErase", "0x84+0x83", benchmarkDataflashBuffer1ToMainMemory, NULL, NULL},
+#if defined(CMD_DATAFLASH_DUAL_OUTPUT_READ_ARRAY)
+	{"dataflashDualInputBuffer1Write+dataflashBuffer1ToMainMemoryWithErase", "0x24+0x83", benchmarkDataflashDualInputBuffer1ToMainMemory, NULL, NULL},
+	{"dataflashQuadInputBuffer1Write+dataflashBuffer1ToMainMemoryWithErase", "0x44+0x83", benchmarkDataflashQuadInputBuffer1ToMainMemory, benchmarkDataflashQuadBegin, benchmarkDataflashQuadEnd},
+#endif
+};
+
+static const benchmarkEraseVariant benchmarkErases[] =
+{
+	// Page and block sizes are scaled to the configured page size by benchmarkSuite().
+	{"dataflashPageErase", "0x81", benchmarkDataflashPageErase, 1},
+	{"dataflashBlockErase", "0x50", benchmarkDataflashBlockErase, 8},
+	{"dataflashChipErase", "0xC7", benchmarkDataflashChipErase, 0},
+};
+
+#define benchmarkRead dataflashRead
+#define benchmarkProgram dataflashProgram
+#define benchmarkErase dataflashErase
+#define BENCHMARK_ERASE_SIZE benchmarkDataflashPageSize
+
+#elif defined(STANDARDFLASH_DEVICE)
+
+static uint32_t benchmarkPageSize()
+{
+	return STANDARDFLASH_PAGE_SIZE;
+}
+
+static void benchmarkSetup()
+{
+#if defined(CMD_STANDARDFLASH_PROTECT_SECTOR)
+	// Global unprotect.
+	standardflashWriteEnable();
+	standardflashWriteSRB1(0x00);
+	standardflashWaitOnReady();
+#endif
+}
+
+static void benchmarkStandardflashBytePageProgram(uint32_t address, uint8_t *txBuffer, uint32_t txNumBytes)
+{
+	standardflashWriteEnable();
+	standardflashBytePageProgram(address, txBuffer, txNumBytes);
+	standardflashWaitOnReadyFor(STANDARDFLASH_TPP_US);
+}
+
+static void benchmarkStandardflashBlockErase4K(uint32_t address)
+{
+	standardflashWriteEnable();
+	standardflashBlockErase4K(address);
+	standardflashWaitOnReadyFor(STANDARDFLASH_TBE4K_US);
+}
+
+static void benchmarkStandardflashBlockErase32K(uint32_t address)
+{
+	standardflashWriteEnable();
+	standardflashBlockErase32K(address);
+	standardflashWaitOnReadyFor(STANDARDFLASH_TBE64K_US);
+}
+
+static void benchmarkStandardflashBlockErase64K(uint32_t address)
+{
+	standardflashWriteEnable();
+	standardflashBlockErase64K(address);
+	standardflashWaitOnReadyFor(STANDARDFLASH_TBE64K_US);
+}
+
+static void benchmarkStandardflashChipErase(uint32_t address)
+{
+	(void) address;
+	standardflashWriteEnable();
+	standardflashChipErase1();
+	standardflashWaitOnReadyFor(STANDARDFLASH_TCE_US);
+}
+
+#if defined(CMD_STANDARDFLASH_QUAD_IO_READ)
+static uint8_t benchmarkContinuousByte;
+
+static void benchmarkStandardflashDualIORead(uint32_t address, uint8_t *rxBuffer, uint32_t rxNumBytes)
+{
+	standardflashDualIORead(address, rxBuffer, rxNumBytes, 0, 0);
+}
+
+static void benchmarkStandardflashDualIOContinue(uint32_t address, uint8_t *rxBuffer, uint32_t rxNumBytes)
+{
+	standardflashDualIORead(address, rxBuffer, rxNumBytes, 2, BENCHMARK_CONTINUOUS_MODE_BYTE);
+}
+
+static void benchmarkStandardflashDualIOBegin()
+{
+	standardflashDualIORead(0, &benchmarkContinuousByte, 1, 1, BENCHMARK_CONTINUOUS_MODE_BYTE);
+}
+
+static void benchmarkStandardflashQuadIORead(uint32_t address, uint8_t *rxBuffer, uint32_t rxNumBytes)
+{
+	standardflashQuadIORead(address, rxBuffer, rxNumBytes, 0, 0);
+}
+
+static void benchmarkStandardflashQuadIOContinue(uint32_t address, uint8_t *rxBuffer, uint32_t rxNumBytes)
+{
+	standardflashQuadIORead(address, rxBuffer, rxNumBytes, 2, BENCHMARK_CONTINUOUS_MODE_BYTE);
+}
+
+static void benchmarkStandardflashQuadPageProgram(uint32_t address, uint8_t *txBuffer, uint32_t txNumBytes)
+{
+	standardflashWriteEnable();
+	standardflashQuadPageProgram(address, txBuffer, txNumBytes, 1);
+	standardflashWaitOnReadyFor(STANDARDFLASH_TPP_US);
+}
+
+static void benchmarkStandardflashQuadBegin()
+{
+	standardflashSetQEBit();
+	standardflashWaitOnReady();
+}
+
+static void benchmarkStandardflashQuadEnd()
+{
+	standardflashClearQEBit();
+	standardflashWaitOnReady();
+}
+
+static void benchmarkStandardflashQuadIOBegin()
+{
+	benchmarkStandardflashQuadBegin();
+	standardflashQuadIORead(0, &benchmarkContinuousByte, 1, 1, BENCHMARK_CONTINUOUS_MODE_BYTE);
+}
+
+static void benchmarkStandardflashQuadIOEnd()
+{
+	standardflashContinuousReadModeQuadReset();
+	benchmarkStandardflashQuadEnd();
+}
+#endif
+
+#if defined(CMD_STANDARDFLASH_ENABLE_QPI)
+static void benchmarkStandardflashQPIBegin()
+{
+	benchmarkStandardflashQuadBegin();
+	standardflashEnableQPI();
+}
+
+static void benchmarkStandardflashQPIEnd()
+{
+	standardflashDisableQPI();
+	benchmarkStandardflashQuadEnd();
+}
+#endif
+
+#if defined(CMD_STANDARDFLASH_PROTECT_SECTOR)
+static void benchmarkStandardflashDualInputBytePageProgram(uint32_t address, uint8_t *txBuffer, uint32_t txNumBytes)
+{
+	standardflashWriteEnable();
+	standardflashDualInputBytePageProgram(address, txBuffer, txNumBytes);
+	standardflashWaitOnReadyFor(STANDARDFLASH_TPP_US);
+}
+#endif
+
+static const benchmarkReadVariant benchmarkReads[] =
+{
+	{"standardflashReadArrayLowFreq", "0x03", standardflashReadArrayLowFreq, NULL, NULL},
+	{"standardflashReadArrayHighFreq", "0x0B", standardflashReadArrayHighFreq, NULL, NULL},
+#if defined(CMD_STANDARDFLASH_QUAD_IO_READ)
+	{"standardflashDualOutputRead", "0x3B", standardflashDualOutputRead, NULL, NULL},
+	{"standardflashDualIORead", "0xBB", benchmarkStandardflashDualIORead, NULL, NULL},
+	{"standardflashDualIORead continuous", "0xBB", benchmarkStandardflashDualIOContinue, benchmarkStandardflashDualIOBegin, standardflashContinuousReadModeDualReset},
+	{"standardflashQuadOutputRead", "0x6B", standardflashQuadOutputRead, benchmarkStandardflashQuadBegin, benchmarkStandardflashQuadEnd},
+	{"standardflashQuadIORead", "0xEB", benchmarkStandardflashQuadIORead, benchmarkStandardflashQuadBegin, benchmarkStandardflashQuadEnd},
+	{"standardflashQuadIORead continuous", "0xEB", benchmarkStandardflashQuadIOContinue, benchmarkStandardflashQuadIOBegin, benchmarkStandardflashQuadIOEnd},
+#endif
+#if defined(CMD_STANDARDFLASH_ENABLE_QPI)
+	{"standardflashReadArrayHighFreq QPI", "0x0B", standardflashReadArrayHighFreq, benchmarkStandardflashQPIBegin, benchmarkStandardflashQPIEnd},
+	{"standardflashQuadIORead QPI", "0xEB", benchmarkStandardflashQuadIORead, benchmarkStandardflashQPIBegin, benchmarkStandardflashQPIEnd},
+#endif
+};
+
+static const benchmarkProgramVariant benchmarkPrograms[] =
+{
+	{"standardflashBytePageProgram", "0x02", benchmarkStandardflashBytePageProgram, NULL, NULL},
+#if defined(CMD_STANDARDFLASH_QUAD_IO_READ)
+	{"standardflashQuadPageProgram", "0x33", benchmarkStandardflashQuadPageProgram, benchmarkStandardflashQuadBegin, benchmarkStandardflashQuadEnd},
+#endif
+#if defined(CMD_STANDARDFLASH_ENABLE_QPI)
+	{"standardflashBytePageProgram QPI", "0x02", benchmarkStandardflashBytePageProgram, benchmarkStandardflashQPIBegin, benchmarkStandardflashQPIEnd},
+#endif
+#if defined(CMD_STANDARDFLASH_PROTECT_SECTOR)
+	{"standardflashDualInputBytePageProgram", "0xA2", benchmarkStandardflashDualInputBytePageProgram, NULL, NULL},
+#endif
+};
+
+static const benchmarkEraseVariant benchmarkErases[] =
+{
+	{"standardflashBlockErase4K", "0x20", benchmarkStandardflashBlockErase4K, 4096},
+	{"standardflashBlockErase32K", "0x52", benchmarkStandardflashBlockErase32K, 32768},
+	{"standardflashBlockErase64K", "0xD8", benchmarkStandardflashBlockErase64K, 65536},
+	{"standardflashChipErase1", "0x60", benchmarkStandardflashChipErase, 0},
+};
+
+#define benchmarkRead standardflashRead
+#define benchmarkProgram standardflashProgram
+#define benchmarkErase standardflashErase
+#define BENCHMARK_ERASE_SIZE STANDARDFLASH_ERASE_SIZE
+
+#endif
+
+/******************************************************************************
+ * Sweeps
+ *****************************************************************************/
+
+// Returns the size following 'numBytes' in the sweep, 0 at the end.
+static uint32_t benchmarkNextSize(uint32_t numBytes, uint32_t maxNumBytes)
+{
+	if(numBytes >= maxNumBytes)
+		return 0;
+	if(numBytes > maxNumBytes / BENCHMARK_SWEEP_STEP)
+		return maxNumBytes;
+	return numBytes * BENCHMARK_SWEEP_STEP;
+}
+
+static void benchmarkPrint(const char *operation, const char *name, const char *opcode,
+						   uint32_t numBytes, uint64_t ns, const char *data)
+{
+	printf("%s,%s,%s,%lu,%llu,%llu,%s\n",
+		   operation,
+		   name,
+		   opcode,
+		   (unsigned long) numBytes,
+		   (unsigned long long) ns,
+		   (unsigned long long) (ns ? ((uint64_t) numBytes * 1000000000ULL) / ns : 0),
+		   data);
+}
+
+// Compares the first 'numBytes' bytes read back with 'expected', or with 0xFF if NULL.
+static const char *benchmarkCheck(const uint8_t *expected, uint32_t numBytes, int *errors)
+{
+	if((expected != NULL) ? (compareBytes(benchmarkBuffer, expected, numBytes, NULL) != 0)
+						  : !blankCheck(benchmarkBuffer, numBytes, NULL))
+	{
+		(*errors)++;
+		return "mismatch";
+	}
+	return "match";
+}
+
+// Erases the units holding [0, numBytes) with the family erase; not timed.
+static void benchmarkEraseRange(uint32_t numBytes)
+{
+	uint32_t address;
+	for(address = 0; address < numBytes; address += BENCHMARK_ERASE_SIZE)
+	{
+		benchmarkErase(address);
+	}
+}
+
+static int benchmarkEraseSweep(uint32_t arrayNumBytes)
+{
+	uint32_t numVariants = sizeof(benchmarkErases) / sizeof(benchmarkErases[0]);
+	uint32_t eraseSize;
+	uint32_t size;
+	uint32_t numBytes;
+	uint32_t address;
+	uint32_t checked;
+	uint64_t start;
+	uint64_t ns;
+	int errors = 0;
+	uint32_t i;
+
+	for(i = 0; i < numVariants; i++)
+	{
+		const benchmarkEraseVariant *variant = &benchmarkErases[i];
+		eraseSize = variant->numBytes;
+#if defined(DATAFLASH_DEVICE)
+		eraseSize *= benchmarkPageSize();
+#endif
+		size = (eraseSize == 0) ? arrayNumBytes : eraseSize;
+		for(; (size != 0) && (size <= arrayNumBytes); size = benchmarkNextSize(size, arrayNumBytes))
+		{
+			// Whole erase units only.
+			numBytes = (eraseSize == 0) ? size : size - (size % eraseSize);
+			start = benchmarkTimeNs();
+			address = 0;
+			do
+			{
+				variant->erase(address);
+				address += (eraseSize != 0) ? eraseSize : numBytes;
+			} while(address < numBytes);
+			ns = benchmarkTimeNs() - start;
+			checked = (numBytes < BENCHMARK_SWEEP_BUFFER_BYTES) ? numBytes : BENCHMARK_SWEEP_BUFFER_BYTES;
+			benchmarkRead(0, benchmarkBuffer, checked);
+			benchmarkPrint("erase", variant->name, variant->opcode, numBytes, ns, benchmarkCheck(NULL, checked, &errors));
+		}
+	}
+	return errors;
+}
+
+static int benchmarkProgramSweep(uint32_t arrayNumBytes)
+{
+	uint32_t numVariants = sizeof(benchmarkPrograms) / sizeof(benchmarkPrograms[0]);
+	uint32_t pageSize = benchmarkPageSize();
+	// Whole pages of the pattern, reused for transfers larger than the buffer.
+	uint32_t patternNumBytes = (BENCHMARK_SWEEP_BUFFER_BYTES / pageSize) * pageSize;
+	uint32_t numBytes;
+	uint32_t address;
+	uint32_t chunk;
+	uint64_t start;
+	uint64_t ns;
+	const char *data;
+	int errors = 0;
+	uint32_t i;
+
+	for(i = 0; i < numVariants; i++)
+	{
+		const benchmarkProgramVariant *variant = &benchmarkPrograms[i];
+		if(variant->begin)
+			variant->begin();
+		for(numBytes = 1; numBytes != 0; numBytes = benchmarkNextSize(numBytes, arrayNumBytes))
+		{
+			benchmarkEraseRange(numBytes);
+			start = benchmarkTimeNs();
+			for(address = 0; address < numBytes; address += chunk)
+			{
+				chunk = (numBytes - address < pageSize) ? numBytes - address : pageSize;
+				variant->program(address, &benchmarkPattern[address % patternNumBytes], chunk);
+			}
+			ns = benchmarkTimeNs() - start;
+			data = "unchecked";
+			if(numBytes <= patternNumBytes)
+			{
+				benchmarkRead(0, benchmarkBuffer, numBytes);
+				data = benchmarkCheck(benchmarkPattern, numBytes, &errors);
+			}
+			benchmarkPrint("program", variant->name, variant->opcode, numBytes, ns, data);
+		}
+		if(variant->end)
+			variant->end();
+	}
+	return errors;
+}
+
+static int benchmarkReadSweep(uint32_t arrayNumBytes)
+{
+	uint32_t numVariants = sizeof(benchmarkReads) / sizeof(benchmarkReads[0]);
+	uint32_t patternNumBytes = (arrayNumBytes < BENCHMARK_SWEEP_BUFFER_BYTES) ? arrayNumBytes : BENCHMARK_SWEEP_BUFFER_BYTES;
+	uint32_t numBytes;
+	uint32_t repeats;
+	uint32_t r;
+	uint64_t start;
+	uint64_t ns;
+	uint64_t best;
+	const char *data;
+	int errors = 0;
+	uint32_t i;
+
+	benchmarkEraseRange(patternNumBytes);
+	benchmarkProgram(0, benchmarkPattern, patternNumBytes);
+	for(i = 0; i < numVariants; i++)
+	{
+		const benchmarkReadVariant *variant = &benchmarkReads[i];
+		if(variant->begin)
+			variant->begin();
+		for(numBytes = 1; numBytes != 0; numBytes = benchmarkNextSize(numBytes, arrayNumBytes))
+		{
+			repeats = (numBytes <= patternNumBytes) ? BENCHMARK_SWEEP_REPEATS : 1;
+			best = UINT64_MAX;
+			for(r = 0; r < repeats; r++)
+			{
+				memset(benchmarkBuffer, 0, sizeof(benchmarkBuffer));
+				start = benchmarkTimeNs();
+				variant->read(0, (numBytes <= patternNumBytes) ? benchmarkBuffer : NULL, numBytes);
+				ns = benchmarkTimeNs() - start;
+				if(ns < best)
+					best = ns;
+			}
+			data = (numBytes <= patternNumBytes) ? benchmarkCheck(benchmarkPattern, numBytes, &errors) : "unchecked";
+			benchmarkPrint("read", variant->name, variant->opcode, numBytes, best, data);
+		}
+		if(variant->end)
+			variant->end();
+	}
+	return errors;
+}
+
+int benchmarkSuite(uint32_t arrayNumBytes)
+{
+	int errors = 0;
+	uint32_t i;
+
+	for(i = 0; i < BENCHMARK_SWEEP_BUFFER_BYTES; i++)
+	{
+		benchmarkPattern[i] = (uint8_t) (i ^ (i >> 8) ^ 0x5A);
+	}
+	benchmarkSetup();
+	printf("Benchmark suite, %lu byte array.\n", (unsigned long) arrayNumBytes);
+	printf("operation,variant,opcode,bytes,ns,bytes_per_second,data\n");
+	errors += benchmarkEraseSweep(arrayNumBytes);
+	errors += benchmarkProgramSweep(arrayNumBytes);
+	errors += benchmarkReadSweep(arrayNumBytes);
+	return errors;
+}
+
+/******************************************************************************
+ * Key-value store
+ *****************************************************************************/
+
+static FLASH_Kv benchmarkKvStore;
+// Version of the value stored under each key, 0 if the key is absent.
+static uint8_t benchmarkKvVersion[FLASH_KV_MAX_KEYS];
+
+static uint32_t benchmarkKvKey(uint32_t key, uint8_t *bytes)
+{
+	return (uint32_t) sprintf((char *) bytes, "setting.%lu", (unsigned long) key);
+}
+
+// Value of a key at a version: 4 to 35 bytes of a pattern.
+static uint32_t benchmarkKvValue(uint32_t key, uint8_t version, uint8_t *bytes)
+{
+	uint32_t numBytes = 4 + (key * 7 + version) % 32;
+	uint32_t i;
+	for(i = 0; i < numBytes; i++)
+	{
+		bytes[i] = (uint8_t) (key ^ (version << 4) ^ (i * 29));
+	}
+	return numBytes;
+}
+
+// Key numbers in the same pseudo-random order on every run.
+static uint32_t benchmarkKvRandom(uint32_t *state, uint32_t numKeys)
+{
+	*state = *state * 1664525UL + 1013904223UL;
+	return (*state >> 8) % numKeys;
+}
+
+static void benchmarkKvPrint(const char *operation, uint32_t count, uint64_t ns, const char *data)
+{
+	printf("%s,%lu,%llu,%llu,%llu,%s\n",
+		   operation,
+		   (unsigned long) count,
+		   (unsigned long long) ns,
+		   (unsigned long long) (count ? ns / count : 0),
+		   (unsigned long long) (ns ? ((uint64_t) count * 1000000000ULL) / ns : 0),
+		   data);
+}
+
+// Gets a key and compares the value with the version expected.
+static uint8_t benchmarkKvCheck(uint32_t key, int *errors)
+{
+	uint8_t keyBytes[24];
+	uint32_t keyNumBytes = benchmarkKvKey(key, keyBytes);
+	uint32_t expectedBytes = 0;
+	uint32_t valueBytes = 0;
+	uint8_t found = flashKvGet(&benchmarkKvStore, keyBytes, keyNumBytes, benchmarkBuffer, &valueBytes);
+	if(benchmarkKvVersion[key] != 0)
+	{
+		expectedBytes = benchmarkKvValue(key, benchmarkKvVersion[key], benchmarkPattern);
+	}
+	if((found != (benchmarkKvVersion[key] != 0)) || (valueBytes != expectedBytes) ||
+	   (compareBytes(benchmarkBuffer, benchmarkPattern, valueBytes, NULL) != 0))
+	{
+		(*errors)++;
+		return 0;
+	}
+	return 1;
+}
+
+// Gets every key, timed, and checks the values.
+static int benchmarkKvGetAll(const char *operation, uint32_t numKeys)
+{
+	uint64_t start = benchmarkTimeNs();
+	uint64_t ns;
+	int errors = 0;
+	uint32_t key;
+	for(key = 0; key < numKeys; key++)
+	{
+		benchmarkKvCheck(key, &errors);
+	}
+	ns = benchmarkTimeNs() - start;
+	benchmarkKvPrint(operation, numKeys, ns, errors ? "mismatch" : "match");
+	return errors;
+}
+
+// Mounts the store, timed, and checks every key.
+static int benchmarkKvMount(const char *operation, const FLASH_Device *device, uint32_t address, uint32_t numBytes, uint32_t numKeys)
+{
+	uint64_t start = benchmarkTimeNs();
+	uint64_t ns;
+	int errors = 0;
+	uint32_t key;
+	uint8_t mounted = flashKvMount(&benchmarkKvStore, device, address, numBytes);
+	ns = benchmarkTimeNs() - start;
+	for(key = 0; key < numKeys; key++)
+	{
+		benchmarkKvCheck(key, &errors);
+	}
+	benchmarkKvPrint(operation, benchmarkKvStore.stats.replayed, ns, (!mounted || errors) ? "mismatch" : "match");
+	return errors + !mounted;
+}
+
+int benchmarkKv(const FLASH_Device *device, uint32_t address, uint32_t numBytes, uint32_t numKeys, uint32_t numOperations)
+{
+	uint8_t keyBytes[24];
+	uint32_t keyNumBytes;
+	uint32_t valueNumBytes;
+	uint32_t state = 1;
+	uint32_t damaged;
+	uint32_t erased;
+	uint32_t key;
+	uint32_t i;
+	uint64_t start;
+	uint64_t ns;
+	int errors = 0;
+	int failures;
+
+	if(numKeys > FLASH_KV_MAX_KEYS)
+		numKeys = FLASH_KV_MAX_KEYS;
+	flashDeviceSelect(device);
+	benchmarkSetup();
+	for(erased = 0; erased < numBytes; erased += device->eraseSize)
+	{
+		flashDeviceErase(device, address + erased);
+	}
+	if(!flashKvMount(&benchmarkKvStore, device, address, numBytes))
+		return 1;
+	memset(benchmarkKvVersion, 0, sizeof(benchmarkKvVersion));
+	printf("Key-value store benchmark, %lu blocks of %lu bytes, %lu keys.\n",
+		   (unsigned long) benchmarkKvStore.numBlocks, (unsigned long) benchmarkKvStore.blockSize, (unsigned long) numKeys);
+	printf("operation,count,ns,ns_per_operation,operations_per_second,data\n");
+
+	// Puts of new keys, then updates of keys in random order.
+	failures = 0;
+	start = benchmarkTimeNs();
+	for(key = 0; key < numKeys; key++)
+	{
+		keyNumBytes = benchmarkKvKey(key, keyBytes);
+		valueNumBytes = benchmarkKvValue(key, 1, benchmarkPattern);
+		if(flashKvPut(&benchmarkKvStore, keyBytes, keyNumBytes, benchmarkPattern, valueNumBytes))
+			benchmarkKvVersion[key] = 1;
+		else
+			failures++;
+	}
+	ns = benchmarkTimeNs() - start;
+	benchmarkKvPrint("put new", numKeys, ns, failures ? "failed" : "stored");
+	errors += failures;
+
+	failures = 0;
+	start = benchmarkTimeNs();
+	for(i = 0; i < numOperations; i++)
+	{
+		uint8_t version;
+		key = benchmarkKvRandom(&state, numKeys);
+		version = (uint8_t) ((benchmarkKvVersion[key] == 255) ? 1 : benchmarkKvVersion[key] + 1);
+		keyNumBytes = benchmarkKvKey(key, keyBytes);
+		valueNumBytes = benchmarkKvValue(key, version, benchmarkPattern);
+		if(flashKvPut(&benchmarkKvStore, keyBytes, keyNumBytes, benchmarkPattern, valueNumBytes))
+			benchmarkKvVersion[key] = version;
+		else
+			failures++;
+	}
+	ns = benchmarkTimeNs() - start;
+	benchmarkKvPrint("put update", numOperations, ns, failures ? "failed" : "stored");
+	errors += failures;
+
+	// Gets of keys in random order; each is one read of its record.
+	failures = 0;
+	start = benchmarkTimeNs();
+	for(i = 0; i < numOperations; i++)
+	{
+		benchmarkKvCheck(benchmarkKvRandom(&state, numKeys), &failures);
+	}
+	ns = benchmarkTimeNs() - start;
+	benchmarkKvPrint("get", numOperations, ns, failures ? "mismatch" : "match");
+	errors += failures;
+
+	// Deletes of every other key.
+	failures = 0;
+	start = benchmarkTimeNs();
+	for(key = 0; key < numKeys; key += 2)
+	{
+		keyNumBytes = benchmarkKvKey(key, keyBytes);
+		if(flashKvDelete(&benchmarkKvStore, keyBytes, keyNumBytes))
+			benchmarkKvVersion[key] = 0;
+		else
+			failures++;
+	}
+	ns = benchmarkTimeNs() - start;
+	benchmarkKvPrint("delete", (numKeys + 1) / 2, ns, failures ? "failed" : "deleted");
+	errors += failures;
+	errors += benchmarkKvGetAll("get all", numKeys);
+
+	printf("Writes %lu, moves %lu, compactions %lu, erases %lu, collisions %lu, checkpoints %lu.\n",
+		   (unsigned long) benchmarkKvStore.stats.writes, (unsigned long) benchmarkKvStore.stats.moves,
+		   (unsigned long) benchmarkKvStore.stats.compactions, (unsigned long) benchmarkKvStore.stats.erases,
+		   (unsigned long) benchmarkKvStore.stats.collisions, (unsigned long) benchmarkKvStore.stats.checkpoints);
+
+	// The index rebuilt from flash must give the same values, whether from
+	// the last periodic checkpoint and its journal, from a fresh checkpoint,
+	// or from every record.
+	errors += benchmarkKvMount("mount", device, address, numBytes, numKeys);
+	flashKvCheckpoint(&benchmarkKvStore);
+	damaged = benchmarkKvStore.checkpointAddress + benchmarkKvStore.checkpointArea * benchmarkKvStore.checkpointAreaSize +
+			  benchmarkKvStore.checkpointOffset - 8;
+	errors += benchmarkKvMount("mount after checkpoint", device, address, numBytes, numKeys);
+	// Clearing a bit of the last entry fails the CRC of the checkpoint.
+	flashDeviceRead(device, damaged, benchmarkBuffer, 8);
+	for(i = 0; (i < 7) && (benchmarkBuffer[i] == 0); i++)
+		;
+	benchmarkBuffer[i] = 0;
+	flashDeviceProgram(device, damaged + i, &benchmarkBuffer[i], 1);
+	errors += benchmarkKvMount("mount with damaged checkpoint", device, address, numBytes, numKeys);
+	for(erased = 0; erased < 2 * benchmarkKvStore.checkpointAreaSize; erased += device->eraseSize)
+	{
+		flashDeviceErase(device, benchmarkKvStore.checkpointAddress + erased);
+	}
+	errors += benchmarkKvMount("mount without checkpoint", device, address, numBytes, numKeys);
+	return errors;
+}
+
+/******************************************************************************
+ * Record log
+ *****************************************************************************/
+
+static FLASH_Log benchmarkLogRing;
+
+// Data of the record with a sequence number: 8 to 263 bytes of a pattern.
+static uint32_t benchmarkLogRecord(uint32_t sequence, uint8_t *bytes)
+{
+	uint32_t numBytes = 8 + (sequence * 37) % 256;
+	uint32_t i;
+	for(i = 0; i < numBytes; i++)
+	{
+		bytes[i] = (uint8_t) (sequence ^ (sequence >> 8) ^ (i * 13));
+	}
+	return numBytes;
+}
+
+// Reads records from a cursor until none is left, checking that they follow
+// 'next' in sequence. Returns the number read; 'next' is left after the last.
+static uint32_t benchmarkLogReadOn(FLASH_LogCursor *cursor, uint32_t *next, int *errors)
+{
+	uint32_t count = 0;
+	uint32_t numBytes;
+	uint32_t sequence;
+	while(flashLogReadNext(&benchmarkLogRing, cursor, benchmarkBuffer, &numBytes, &sequence))
+	{
+		uint32_t expectedBytes = benchmarkLogRecord(sequence, benchmarkPattern);
+		// The first record read from the oldest one may follow reclaimed ones.
+		if(((*next != 0xFFFFFFFFU) && (sequence != *next)) || (numBytes != expectedBytes) ||
+		   (compareBytes(benchmarkBuffer, benchmarkPattern, numBytes, NULL) != 0))
+		{
+			(*errors)++;
+		}
+		*next = sequence + 1;
+		count++;
+	}
+	return count;
+}
+
+// Reads the whole log from its oldest record, timed, and checks it ends with
+// the record before 'numRecords'.
+static int benchmarkLogReadAll(const char *operation, uint32_t numRecords)
+{
+	FLASH_LogCursor cursor;
+	uint32_t next = 0xFFFFFFFFU;
+	uint32_t count;
+	uint64_t start = benchmarkTimeNs();
+	uint64_t ns;
+	int errors = 0;
+	flashLogRewind(&benchmarkLogRing, &cursor);
+	count = benchmarkLogReadOn(&cursor, &next, &errors);
+	ns = benchmarkTimeNs() - start;
+	if(next != numRecords)
+		errors++;
+	benchmarkKvPrint(operation, count, ns, errors ? "mismatch" : "match");
+	return errors;
+}
+
+int benchmarkLog(const FLASH_Device *device, uint32_t address, uint32_t numBytes, uint32_t numRecords)
+{
+	FLASH_LogCursor cursor;
+	uint32_t next = 0;
+	uint32_t count = 0;
+	uint32_t headBlock;
+	uint32_t erased;
+	uint32_t i;
+	uint64_t appendNs = 0;
+	uint64_t readNs = 0;
+	uint64_t start;
+	uint64_t ns;
+	uint8_t mounted;
+	int errors = 0;
+	int failures = 0;
+	int readFailures = 0;
+
+	flashDeviceSelect(device);
+	benchmarkSetup();
+	for(erased = 0; erased < numBytes; erased += device->eraseSize)
+	{
+		flashDeviceErase(device, address + erased);
+	}
+	if(!flashLogMount(&benchmarkLogRing, device, address, numBytes))
+		return 1;
+	printf("Record log benchmark, %lu blocks of %lu bytes, %lu records.\n",
+		   (unsigned long) benchmarkLogRing.numBlocks, (unsigned long) benchmarkLogRing.blockSize, (unsigned long) numRecords);
+	printf("operation,count,ns,ns_per_operation,operations_per_second,data\n");
+
+	// Appends in batches, each followed by reads up to the newest record. A
+	// batch also ends with the first record in a new head block.
+	flashLogRewind(&benchmarkLogRing, &cursor);
+	headBlock = benchmarkLogRing.headBlock;
+	for(i = 0; i < numRecords; i++)
+	{
+		uint32_t recordBytes = benchmarkLogRecord(i, benchmarkPattern);
+		start = benchmarkTimeNs();
+		if(!flashLogAppend(&benchmarkLogRing, benchmarkPattern, recordBytes))
+			failures++;
+		appendNs += benchmarkTimeNs() - start;
+		if(((i % 16) == 15) || (i == numRecords - 1) || (benchmarkLogRing.headBlock != headBlock))
+		{
+			headBlock = benchmarkLogRing.headBlock;
+			start = benchmarkTimeNs();
+			count += benchmarkLogReadOn(&cursor, &next, &readFailures);
+			readNs += benchmarkTimeNs() - start;
+			if(next != i + 1)
+				readFailures++;
+		}
+	}
+	benchmarkKvPrint("append", numRecords, appendNs, failures ? "failed" : "stored");
+	benchmarkKvPrint("read behind head", count, readNs, readFailures ? "mismatch" : "match");
+	errors += failures + readFailures;
+
+	flashLogSync(&benchmarkLogRing);
+	errors += benchmarkLogReadAll("read all", numRecords);
+	printf("Programs %lu, erases %lu, blocks reclaimed %lu.\n",
+		   (unsigned long) benchmarkLogRing.stats.programs, (unsigned long) benchmarkLogRing.stats.erases,
+		   (unsigned long) benchmarkLogRing.stats.reclaimed);
+
+	// The log found by a mount must end with the same record.
+	start = benchmarkTimeNs();
+	mounted = flashLogMount(&benchmarkLogRing, device, address, numBytes);
+	ns = benchmarkTimeNs() - start;
+	failures = !mounted || (benchmarkLogRing.nextSequence != numRecords);
+	benchmarkKvPrint("mount", 1, ns, failures ? "mismatch" : "match");
+	errors += failures;
+	if(mounted)
+		errors += benchmarkLogReadAll("read all after mount", numRecords);
+	return errors;
+}
+
+/******************************************************************************
+ * Flash translation layer
+ *****************************************************************************/
+
+static FLASH_Ftl benchmarkFtlMap;
+// Usage counters summed over the mounts, which clear them.
+static FLASH_FtlStats benchmarkFtlTotal;
+// Version of the data of each logical page, 0 if never written.
+static uint8_t benchmarkFtlVersion[FLASH_FTL_MAX_BLOCKS * (FLASH_FTL_MAX_PAGES_PER_BLOCK - 1)];
+
+// Data of a logical page at a version; erased if version 0.
+static void benchmarkFtlPage(uint32_t page, uint8_t version, uint8_t *bytes)
+{
+	uint32_t i;
+	for(i = 0; i < benchmarkFtlMap.pageSize; i++)
+	{
+		bytes[i] = version ? (uint8_t) ((page * 7) ^ (version * 31) ^ (i * 13)) : 0xFF;
+	}
+}
+
+static uint8_t benchmarkFtlNextVersion(uint32_t page)
+{
+	return (uint8_t) ((benchmarkFtlVersion[page] == 255) ? 1 : benchmarkFtlVersion[page] + 1);
+}
+
+// Mounts the FTL, timed, and checks every logical page.
+static int benchmarkFtlMount(const char *operation, const FLASH_Device *device, uint32_t address, uint32_t numBytes)
+{
+	uint64_t start;
+	uint64_t ns;
+	int errors = 0;
+	uint32_t page;
+	uint8_t mounted;
+	benchmarkFtlTotal.hostPages += benchmarkFtlMap.stats.hostPages;
+	benchmarkFtlTotal.flashPages += benchmarkFtlMap.stats.flashPages;
+	benchmarkFtlTotal.moves += benchmarkFtlMap.stats.moves;
+	benchmarkFtlTotal.erases += benchmarkFtlMap.stats.erases;
+	benchmarkFtlTotal.migrations += benchmarkFtlMap.stats.migrations;
+	start = benchmarkTimeNs();
+	mounted = flashFtlMount(&benchmarkFtlMap, device, address, numBytes);
+	ns = benchmarkTimeNs() - start;
+	for(page = 0; mounted && (page < benchmarkFtlMap.numPages); page++)
+	{
+		benchmarkFtlPage(page, benchmarkFtlVersion[page], benchmarkPattern);
+		if(!flashFtlRead(&benchmarkFtlMap, page * benchmarkFtlMap.pageSize, benchmarkBuffer, benchmarkFtlMap.pageSize) ||
+		   (compareBytes(benchmarkBuffer, benchmarkPattern, benchmarkFtlMap.pageSize, NULL) != 0))
+		{
+			errors++;
+		}
+	}
+	benchmarkKvPrint(operation, 1, ns, (!mounted || errors) ? "mismatch" : "match");
+	return errors + !mounted;
+}
+
+int benchmarkFtl(const FLASH_Device *device, uint32_t address, uint32_t numBytes, uint32_t numWrites)
+{
+	uint32_t state = 1;
+	uint32_t pageSize;
+	uint32_t numPages;
+	uint32_t capacity;
+	uint32_t wearMinimum;
+	uint32_t wearMaximum;
+	uint32_t erased;
+	uint32_t page;
+	uint32_t i;
+	uint64_t writeNs = 0;
+	uint64_t collectNs = 0;
+	uint64_t start;
+	int errors = 0;
+	int failures = 0;
+
+	flashDeviceSelect(device);
+	benchmarkSetup();
+	for(erased = 0; erased < numBytes; erased += device->eraseSize)
+	{
+		flashDeviceErase(device, address + erased);
+	}
+	if(!flashFtlMount(&benchmarkFtlMap, device, address, numBytes))
+		return 1;
+	pageSize = benchmarkFtlMap.pageSize;
+	numPages = benchmarkFtlMap.numPages;
+	capacity = flashFtlCapacity(&benchmarkFtlMap);
+	memset(benchmarkFtlVersion, 0, sizeof(benchmarkFtlVersion));
+	memset(&benchmarkFtlTotal, 0, sizeof(benchmarkFtlTotal));
+	printf("FTL benchmark, %lu blocks of %lu bytes, %lu logical pages, %lu writes.\n",
+		   (unsigned long) benchmarkFtlMap.numBlocks, (unsigned long) device->eraseSize,
+		   (unsigned long) numPages, (unsigned long) numWrites);
+	printf("operation,count,ns,ns_per_operation,operations_per_second,data\n");
+
+	// Fills the capacity, so that collection has live pages to move.
+	start = benchmarkTimeNs();
+	for(page = 0; page < numPages; page++)
+	{
+		benchmarkFtlVersion[page] = 1;
+		benchmarkFtlPage(page, 1, benchmarkPattern);
+		if(!flashFtlWrite(&benchmarkFtlMap, page * pageSize, benchmarkPattern, pageSize))
+			failures++;
+	}
+	benchmarkKvPrint("fill", numPages, benchmarkTimeNs() - start, failures ? "failed" : "stored");
+	errors += failures;
+
+	// Random writes to hot and cold pages, with collection in between.
+	failures = 0;
+	for(i = 0; i < numWrites; i++)
+	{
+		uint8_t split = (benchmarkKvRandom(&state, 4) == 0) && (numPages > 1);
+		page = (benchmarkKvRandom(&state, 8) != 0) ? benchmarkKvRandom(&state, (numPages + 7) / 8) : benchmarkKvRandom(&state, numPages);
+		start = benchmarkTimeNs();
+		if(split)
+		{
+			// Two pages written as the start of the first, then the rest.
+			uint32_t first = 1 + benchmarkKvRandom(&state, pageSize - 1);
+			if(page == numPages - 1)
+				page--;
+			benchmarkFtlVersion[page] = benchmarkFtlNextVersion(page);
+			benchmarkFtlVersion[page + 1] = benchmarkFtlNextVersion(page + 1);
+			benchmarkFtlPage(page, benchmarkFtlVersion[page], benchmarkPattern);
+			benchmarkFtlPage(page + 1, benchmarkFtlVersion[page + 1], &benchmarkPattern[pageSize]);
+			if(!flashFtlWrite(&benchmarkFtlMap, page * pageSize, benchmarkPattern, first) ||
+			   !flashFtlWrite(&benchmarkFtlMap, page * pageSize + first, &benchmarkPattern[first], 2 * pageSize - first))
+				failures++;
+		}
+		else
+		{
+			benchmarkFtlVersion[page] = benchmarkFtlNextVersion(page);
+			benchmarkFtlPage(page, benchmarkFtlVersion[page], benchmarkPattern);
+			if(!flashFtlWrite(&benchmarkFtlMap, page * pageSize, benchmarkPattern, pageSize))
+				failures++;
+		}
+		writeNs += benchmarkTimeNs() - start;
+		start = benchmarkTimeNs();
+		flashFtlCollect(&benchmarkFtlMap, 4);
+		collectNs += benchmarkTimeNs() - start;
+		if((numWrites >= 4) && ((i + 1) % (numWrites / 4) == 0))
+		{
+			errors += benchmarkFtlMount("mount", device, address, numBytes);
+		}
+	}
+	benchmarkKvPrint("random write", numWrites, writeNs, failures ? "failed" : "stored");
+	benchmarkKvPrint("collect", numWrites, collectNs, "-");
+	errors += failures;
+	flashFtlWear(&benchmarkFtlMap, &wearMinimum, &wearMaximum);
+	printf("Host pages %lu, flash pages %lu, moves %lu, erases %lu, migrations %lu, erase counts %lu to %lu.\n",
+		   (unsigned long) (benchmarkFtlTotal.hostPages + benchmarkFtlMap.stats.hostPages),
+		   (unsigned long) (benchmarkFtlTotal.flashPages + benchmarkFtlMap.stats.flashPages),
+		   (unsigned long) (benchmarkFtlTotal.moves + benchmarkFtlMap.stats.moves),
+		   (unsigned long) (benchmarkFtlTotal.erases + benchmarkFtlMap.stats.erases),
+		   (unsigned long) (benchmarkFtlTotal.migrations + benchmarkFtlMap.stats.migrations),
+		   (unsigned long) wearMinimum, (unsigned long) wearMaximum);
+
+	// A page programmed without its entry, as by a reset, must be skipped.
+	if(benchmarkFtlMap.activeIndex < benchmarkFtlMap.pagesPerBlock)
+	{
+		benchmarkFtlPage(0, benchmarkFtlNextVersion(0), benchmarkPattern);
+		flashDeviceProgram(device, address + benchmarkFtlMap.activeBlock * device->eraseSize + benchmarkFtlMap.activeIndex * pageSize,
+						   benchmarkPattern, pageSize);
+	}
+	errors += benchmarkFtlMount("mount after reset", device, address, numBytes);
+
+	// Writes beyond the capacity are refused and leave the data alone.
+	failures = flashFtlWrite(&benchmarkFtlMap, capacity - 1, benchmarkPattern, 2) +
+			   flashFtlRead(&benchmarkFtlMap, capacity, benchmarkBuffer, 1) +
+			   flashFtlWrite(&benchmarkFtlMap, 0xFFFFFFFFU, benchmarkPattern, 1);
+	page = numPages - 1;
+	benchmarkFtlVersion[page] = benchmarkFtlNextVersion(page);
+	benchmarkFtlPage(page, benchmarkFtlVersion[page], benchmarkPattern);
+	if(!flashFtlWrite(&benchmarkFtlMap, capacity - pageSize, benchmarkPattern, pageSize))
+		failures++;
+	benchmarkKvPrint("capacity checks", 4, 0, failures ? "mismatch" : "match");
+	errors += failures;
+	errors += benchmarkFtlMount("mount after capacity checks", device, address, numBytes);
+
+	// The first of the same random page writes, each rewriting its erase
+	// unit in place; a few suffice, as each costs the same.
+	if(device->eraseSize <= BENCHMARK_SWEEP_BUFFER_BYTES)
+	{
+		state = 1;
+		start = benchmarkTimeNs();
+		for(i = 0; i < (numWrites + 15) / 16; i++)
+		{
+			uint32_t unit;
+			uint32_t offset;
+			page = (benchmarkKvRandom(&state, 8) != 0) ? benchmarkKvRandom(&state, (numPages + 7) / 8) : benchmarkKvRandom(&state, numPages);
+			unit = address + page * pageSize / device->eraseSize * device->eraseSize;
+			flashDeviceRead(device, unit, benchmarkBuffer, device->eraseSize);
+			benchmarkFtlPage(page, (uint8_t) (i + 1), &benchmarkBuffer[page * pageSize % device->eraseSize]);
+			flashDeviceErase(device, unit);
+			for(offset = 0; offset < device->eraseSize; offset += pageSize)
+			{
+				flashDeviceProgram(device, unit + offset, &benchmarkBuffer[offset], pageSize);
+			}
+		}
+		benchmarkKvPrint("read-modify-write", i, benchmarkTimeNs() - start, "-");
+	}
+	return errors;
+}
+
+/******************************************************************************
+ * Striped devices
+ *****************************************************************************/
+
+static FLASH_Stripe benchmarkStripeChips;
+
+// Data of the chunk of BENCHMARK_SWEEP_BUFFER_BYTES bytes at 'chunk'.
+static void benchmarkStripeChunk(uint32_t chunk, uint8_t *bytes)
+{
+	uint32_t i;
+	for(i = 0; i < BENCHMARK_SWEEP_BUFFER_BYTES; i++)
+	{
+		bytes[i] = (uint8_t) (i ^ (i >> 8) ^ (chunk * 71));
+	}
+}
+
+// Programs [start, end) in chunks through the stripe, or through 'device'
+// if not NULL, timed.
+static void benchmarkStripeProgram(const FLASH_Device *device, const char *operation, uint32_t start, uint32_t end)
+{
+	uint64_t startNs = benchmarkTimeNs();
+	uint32_t address;
+	for(address = start; address < end; )
+	{
+		uint32_t chunk = address / BENCHMARK_SWEEP_BUFFER_BYTES;
+		uint32_t offset = address % BENCHMARK_SWEEP_BUFFER_BYTES;
+		uint32_t numBytes = BENCHMARK_SWEEP_BUFFER_BYTES - offset;
+		if(numBytes > end - address)
+			numBytes = end - address;
+		benchmarkStripeChunk(chunk, benchmarkPattern);
+		if(device == NULL)
+			flashStripeProgram(&benchmarkStripeChips, address, &benchmarkPattern[offset], numBytes);
+		else
+			flashDeviceProgram(device, address, &benchmarkPattern[offset], numBytes);
+		address += numBytes;
+	}
+	benchmarkKvPrint(operation, end - start, benchmarkTimeNs() - startNs, "-");
+}
+
+// Reads [start, end) back in chunks, timed, and checks it.
+static int benchmarkStripeRead(const FLASH_Device *device, const char *operation, uint32_t start, uint32_t end)
+{
+	uint64_t ns = 0;
+	uint32_t address;
+	int errors = 0;
+	for(address = start; address < end; )
+	{
+		uint32_t chunk = address / BENCHMARK_SWEEP_BUFFER_BYTES;
+		uint32_t offset = address % BENCHMARK_SWEEP_BUFFER_BYTES;
+		uint32_t numBytes = BENCHMARK_SWEEP_BUFFER_BYTES - offset;
+		uint64_t startNs;
+		if(numBytes > end - address)
+			numBytes = end - address;
+		startNs = benchmarkTimeNs();
+		if(device == NULL)
+			flashStripeRead(&benchmarkStripeChips, address, benchmarkBuffer, numBytes);
+		else
+			flashDeviceRead(device, address, benchmarkBuffer, numBytes);
+		ns += benchmarkTimeNs() - startNs;
+		benchmarkStripeChunk(chunk, benchmarkPattern);
+		if(compareBytes(benchmarkBuffer, &benchmarkPattern[offset], numBytes, NULL) != 0)
+			errors = 1;
+		address += numBytes;
+	}
+	benchmarkKvPrint(operation, end - start, ns, errors ? "mismatch" : "match");
+	return errors;
+}
+
+int benchmarkStripe(const FLASH_Device *const *devices, uint8_t numDevices, uint32_t numBytes)
+{
+	// Programs start mid-page, so that the first and last pages are partial.
+	uint32_t start = 100;
+	uint32_t address;
+	uint64_t startNs;
+	uint8_t i;
+	int errors = 0;
+
+	if(!flashStripeInit(&benchmarkStripeChips, devices, numDevices) || (numBytes > devices[0]->capacity) || (numBytes <= start))
+		return 1;
+	for(i = 0; i < numDevices; i++)
+	{
+		flashDeviceSelect(devices[i]);
+		benchmarkSetup();
+	}
+	printf("Stripe benchmark, %u chips, %lu byte pages, %lu bytes.\n",
+		   (unsigned) numDevices, (unsigned long) benchmarkStripeChips.pageSize, (unsigned long) numBytes);
+	printf("operation,bytes,ns,ns_per_byte,bytes_per_second,data\n");
+
+	startNs = benchmarkTimeNs();
+	flashStripeErase(&benchmarkStripeChips, 0, numBytes);
+	benchmarkKvPrint("stripe erase", numBytes, benchmarkTimeNs() - startNs, "-");
+	benchmarkStripeProgram(NULL, "stripe program", start, numBytes);
+	errors += benchmarkStripeRead(NULL, "stripe read", start, numBytes);
+
+	startNs = benchmarkTimeNs();
+	for(address = 0; address < numBytes; address += devices[0]->eraseSize)
+	{
+		flashDeviceErase(devices[0], address);
+	}
+	benchmarkKvPrint("single erase", numBytes, benchmarkTimeNs() - startNs, "-");
+	benchmarkStripeProgram(devices[0], "single program", start, numBytes);
+	errors += benchmarkStripeRead(devices[0], "single read", start, numBytes);
+	return errors;
+}
@@ -0,0 +1,241 @@
+/*
+ * The Clear BSD License
+ * Copyright (c) 2018 Adesto Technologies Corporation, Inc
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted (subject to the limitations in the disclaimer below) provided
+ *  that the following conditions are met:
+ *
+ * o Redistributions of source code must retain the above copyright notice, this list
+ *   of conditions and the following disclaimer.
+ *
+ * o Redistributions in binary form must reproduce the above copyright notice, this
+ *   list of conditions and the following disclaimer in the documentation and/or
+ *   other materials provided with the distribution.
+ *
+ * o Neither the name of the copyright holder nor the names of its
+ *   contributors may be used to endorse or promote products derived from this
+ *   software without specific prior written permission.
+ *
+ * NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE GRANTED BY THIS LICENSE.
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*!
+ * @ingroup TEST_LAYER
+ */
+/**
+ * @file    benchmark.h
+ * @brief   Benchmark declarations exist here.
+ */
+#ifndef BENCHMARK_H_
+#define BENCHMARK_H_
+
+#include "spi_driver.h"
+#include "flash_kv.h"
+#include "flash_log.h"
+#include "flash_ftl.h"
+#include "flash_stripe.h"
+
+//! Number of bytes read by each bit-bang engine benchmark run.
+#define BENCHMARK_NUM_BYTES 256
+
+//! Largest transfer of benchmarkSuite() whose data is checked; also the size of its buffers.
+#define BENCHMARK_SWEEP_BUFFER_BYTES 4096
+//! Factor between two consecutive transfer sizes of benchmarkSuite().
+#define BENCHMARK_SWEEP_STEP 4
+//! Number of runs of each read of up to @ref BENCHMARK_SWEEP_BUFFER_BYTES bytes; the fastest is reported.
+#define BENCHMARK_SWEEP_REPEATS 4
+
+/*!
+ * @brief Time source of the benchmarks, returning a time in ns.
+ *
+ * @param context The context given to benchmarkSetClock().
+ */
+typedef uint64_t (*benchmarkClock)(void *context);
+
+/**
+ * @brief Compares the cycle cost of the bit-bang engines. <br>
+ * The same read of @ref BENCHMARK_NUM_BYTES bytes from address 0 is timed
+ * with USER_CONFIG_CycleCount() on SPI_ENGINE_PIN and SPI_ENGINE_PORT, in
+ * single (0x03), dual output (0x3B) and quad output (0x6B) modes. For each
+ * mode the cycle counts, cycles per byte and the speedup are printed, and
+ * the data read by both engines is compared. Modes that the selected part
+ * does not support still give valid timings, but their data is meaningless.
+ *
+ * The engine that was active on entry is restored on exit.
+ *
+ * @retval int Returns the number of modes in which both engines read different data.
+ */
+int benchmarkBitBangEngines();
+
+/**
+ * @brief Selects the time source of benchmarkSuite(). <br>
+ * By default the time is taken from USER_CONFIG_CycleCount(). A transport
+ * with its own notion of time, such as the flash emulator
+ * (SPI_EmulatorTimeNs()), can be used instead.
+ *
+ * @param clock The time source, or NULL for USER_CONFIG_CycleCount().
+ * @param context Passed to 'clock'.
+ *
+ * @retval void
+ */
+void benchmarkSetClock(benchmarkClock clock, void *context);
+
+/**
+ * @brief Measures the throughput and latency of every read, program and
+ * erase command of the selected part. <br>
+ * Each command is timed on transfers from 1 byte up to 'arrayNumBytes',
+ * each @ref BENCHMARK_SWEEP_STEP times larger than the previous one, from
+ * address 0. Reads and programs of more than one page go through the same
+ * driver function as the datasheet command: reads are a single call, programs
+ * one call and one ready wait per page. Erases are swept from their erase
+ * size up, and chip erases are timed once. Quad commands set the QE bit for
+ * their sweep, continuous read modes are entered before and left after
+ * theirs, and the QPI variants run with QPI enabled.
+ *
+ * One line of comma separated values is printed per command and size:
+ * operation, driver function (and mode), opcode, bytes, time in ns (the
+ * fastest of @ref BENCHMARK_SWEEP_REPEATS runs for reads of up to
+ * @ref BENCHMARK_SWEEP_BUFFER_BYTES bytes), bytes per second, and whether the
+ * data matched. Data is checked up to @ref BENCHMARK_SWEEP_BUFFER_BYTES
+ * bytes; larger reads are clocked into no buffer and reported as unchecked.
+ *
+ * @param arrayNumBytes Size of the array in bytes (for DataFlash, the linear
+ * size at the page size the device is configured for). A smaller value
+ * shortens the sweeps.
+ *
+ * @retval int Returns the number of runs whose data did not match.
+ *
+ * @warning The whole array is erased and reprogrammed. Sectors must be
+ * unprotected, which is done here for the parts with global unprotect.
+ */
+int benchmarkSuite(uint32_t arrayNumBytes);
+
+/**
+ * @brief Measures puts, gets and deletes of the key-value store of
+ * flash_kv.h. <br>
+ * The range is erased and a store is mounted on it. 'numKeys' keys of 4 to
+ * 35 byte values are put, then 'numOperations' puts update and
+ * 'numOperations' gets read keys picked at random, and every other key is
+ * deleted. Every key is then read back. The store is then mounted four
+ * times, each followed by a check of every key: from its last periodic
+ * checkpoint and journal, after flashKvCheckpoint(), with a bit of that
+ * checkpoint cleared, and with the checkpoint areas erased. The last two
+ * replay every record.
+ *
+ * One line of comma separated values is printed per phase: operation,
+ * count, time in ns, ns per operation, operations per second, and whether
+ * the data matched. For mounts the count is that of the records replayed.
+ * The usage counters of the store are printed before the mounts.
+ *
+ * @param device The device (see flash_device.h).
+ * @param address Device address of the range, on an erase unit boundary.
+ * @param numBytes Size of the range.
+ * @param numKeys Number of keys, at most @ref FLASH_KV_MAX_KEYS.
+ * @param numOperations Number of updates and of gets.
+ *
+ * @retval int Returns the number of operations that failed or read wrong data.
+ *
+ * @warning The range is erased. Sectors are unprotected as by benchmarkSuite().
+ */
+int benchmarkKv(const FLASH_Device *device, uint32_t address, uint32_t numBytes, uint32_t numKeys, uint32_t numOperations);
+
+/**
+ * @brief Measures appends to and reads of the record log of flash_log.h. <br>
+ * The range is erased and a log is mounted on it. 'numRecords' records of
+ * 8 to 263 bytes are appended in batches of up to 16, and after each batch
+ * a cursor reads on to the newest record. A batch ends early with the first
+ * record of a new head block, so that reads cross into the head block while
+ * its first page is still in the page buffer. When the
+ * records outgrow the range the oldest blocks are reclaimed. The log is then
+ * synchronised, read from its oldest record, and mounted again and read
+ * once more. Every record read is checked against its sequence number and
+ * data, and the newest record must be the last one appended.
+ *
+ * One line of comma separated values is printed per phase: operation,
+ * count, time in ns, ns per operation, operations per second, and whether
+ * the data matched. The usage counters of the log are printed before the
+ * mount.
+ *
+ * @param device The device (see flash_device.h).
+ * @param address Device address of the range, on an erase unit boundary.
+ * @param numBytes Size of the range.
+ * @param numRecords Number of records appended.
+ *
+ * @retval int Returns the number of operations that failed or read wrong data.
+ *
+ * @warning The range is erased. Sectors are unprotected as by benchmarkSuite().
+ */
+int benchmarkLog(const FLASH_Device *device, uint32_t address, uint32_t numBytes, uint32_t numRecords);
+
+/**
+ * @brief Measures random writes through the flash translation layer of
+ * flash_ftl.h against rewriting pages in place. <br>
+ * The range is erased, an FTL is mounted on it and its logical capacity is
+ * written in full. 'numWrites' random writes then follow, seven in eight to
+ * the first eighth of the pages. One in four rewrites two neighbouring pages
+ * in two unaligned parts, so that partly written pages are merged. Each
+ * write is followed by flashFtlCollect(), as if the application were idle.
+ * The FTL is mounted again after every quarter of the writes, after a page
+ * programmed without its header entry as by a reset, and after writes beyond
+ * the capacity, which must be refused. Every page is checked after each
+ * mount. Finally the first sixteenth of the same page writes is done
+ * directly on the device, each reading, erasing and reprogramming the erase
+ * unit of the page.
+ *
+ * One line of comma separated values is printed per phase: operation,
+ * count, time in ns, ns per operation, operations per second, and whether
+ * the data matched. The usage counters of the FTL and the lowest and
+ * highest erase counts of its blocks are printed after the random writes;
+ * the hot pages make the spread grow unless cold data is migrated (build
+ * with a large @ref FLASH_FTL_WEAR_THRESHOLD to compare).
+ *
+ * @param device The device (see flash_device.h).
+ * @param address Device address of the range, on an erase unit boundary.
+ * @param numBytes Size of the range.
+ * @param numWrites Number of random writes.
+ *
+ * @retval int Returns the number of operations that failed or read wrong data.
+ *
+ * @warning The range is erased. Sectors are unprotected as by benchmarkSuite().
+ */
+int benchmarkFtl(const FLASH_Device *device, uint32_t address, uint32_t numBytes, uint32_t numWrites);
+
+/**
+ * @brief Measures erases, programs and reads of a stripe of flash_stripe.h
+ * against the first chip alone. <br>
+ * The stripe erases the first 'numBytes' bytes, programs them from an
+ * address that is not on a page boundary, @ref BENCHMARK_SWEEP_BUFFER_BYTES
+ * bytes per call, and reads them back. The first chip then does the same
+ * through flashDeviceErase(), flashDeviceProgram() and flashDeviceRead(),
+ * one page program at a time.
+ *
+ * One line of comma separated values is printed per phase: operation,
+ * bytes, time in ns, ns per byte, bytes per second, and whether the data
+ * matched. The time is that of the benchmark clock (see benchmarkSetClock()),
+ * which must count the bus transfers of every chip: with emulated chips, the
+ * time of each emulator less the host time they share.
+ *
+ * @param devices The chips, each opened with flashDeviceOpen().
+ * @param numDevices Number of chips, 1 to @ref FLASH_STRIPE_MAX_DEVICES.
+ * @param numBytes Number of bytes, at most the capacity of one chip.
+ *
+ * @retval int Returns the number of phases that failed or read wrong data.
+ *
+ * @warning The range is erased on every chip. Sectors are unprotected as by
+ * benchmarkSuite().
+ */
+int benchmarkStripe(const FLASH_Device *const *devices, uint8_t numDevices, uint32_t numBytes);
+
+#endif /* BENCHMARK_H_ */
@@ -43,8 +43,9 @@
 
 #include "user_config.h"
 
-#define MAXIMUM_TX_BYTES 500
-#define MAXIMUM_RX_BYTES 500
+//! Size of the tx*InternalBuffer arrays. They only hold the opcode, address,
+//! mode and dummy bytes of a command; data is sent from the caller's buffer.
+#define MAXIMUM_HEADER_BYTES 8
 #define MAXIMUM_BUFFER_SIZE 500
 
 #define RM331x 		1
@@ -466,4 +467,132 @@
 #error Part number not defined.
 #endif
 
+/*
+ * Program page sizes in bytes, used by the page splitting program functions
+ * (monetaProgram(), fusionProgram(), dataflashProgram(), standardflashProgram()).
+ * DataFlash pages are DATAFLASH_PAGE_SIZE_P2 bytes in power of 2 mode and
+ * DATAFLASH_PAGE_SIZE_STD bytes in standard mode, in which the byte offset
+ * takes the low DATAFLASH_PAGE_OFFSET_BITS bits of a device address.
+ */
+#define MONETA_PAGE_SIZE			64U
+#define FUSION_PAGE_SIZE			256U
+#define STANDARDFLASH_PAGE_SIZE		256U
+#if (PARTNO == AT45DB161E) 	|| \
+	(PARTNO == AT45DB321E) 	|| \
+	(PARTNO == AT45DQ161)  	|| \
+	(PARTNO == AT45DQ321)  	|| \
+	(PARTNO == AT25PE16)
+#define DATAFLASH_PAGE_SIZE_P2		512U
+#define DATAFLASH_PAGE_OFFSET_BITS	10U
+#else
+#define DATAFLASH_PAGE_SIZE_P2		256U
+#define DATAFLASH_PAGE_OFFSET_BITS	9U
+#endif
+#define DATAFLASH_PAGE_SIZE_STD		(DATAFLASH_PAGE_SIZE_P2 + DATAFLASH_PAGE_SIZE_P2/32)
+
+/*
+ * Erase unit sizes in bytes, used by the erase functions (monetaErase(),
+ * fusionErase(), standardflashErase()). DataFlash erases one page of
+ * dataflashGetPageSize() bytes. Moneta needs no erase; monetaErase() writes
+ * 0xFF over MONETA_ERASE_SIZE bytes so the families behave alike.
+ */
+#define MONETA_ERASE_SIZE			MONETA_PAGE_SIZE
+#define FUSION_ERASE_SIZE			FUSION_PAGE_SIZE
+#define STANDARDFLASH_ERASE_SIZE	4096U
+
+/*
+ * Typical program and erase times in microseconds. They pace the status
+ * sampling of SPI_WaitReady() and are not limits: a slower operation is
+ * simply sampled longer. Each can be overridden before this file is included.
+ * tPP: page program, tEP: page erase and program, tPE: page erase,
+ * tBE: block erase, tCE: chip erase.
+ */
+#ifndef MONETA_TPP_US
+#define MONETA_TPP_US				100U
+#endif
+#ifndef FUSION_TPP_US
+#define FUSION_TPP_US				1500U
+#endif
+#ifndef FUSION_TPE_US
+#define FUSION_TPE_US				8000U
+#endif
+#ifndef FUSION_TBE_US
+#define FUSION_TBE_US				35000U
+#endif
+#ifndef FUSION_TCE_US
+#define FUSION_TCE_US				3000000U
+#endif
+#ifndef DATAFLASH_TEP_US
+#define DATAFLASH_TEP_US			12000U
+#endif
+#ifndef DATAFLASH_TPE_US
+#define DATAFLASH_TPE_US			8000U
+#endif
+#ifndef DATAFLASH_TBE_US
+#define DATAFLASH_TBE_US			25000U
+#endif
+#ifndef DATAFLASH_TCE_US
+#define DATAFLASH_TCE_US			30000000U
+#endif
+#ifndef STANDARDFLASH_TPP_US
+#define STANDARDFLASH_TPP_US		400U
+#endif
+#ifndef STANDARDFLASH_TBE4K_US
+#define STANDARDFLASH_TBE4K_US		60000U
+#endif
+#ifndef STANDARDFLASH_TBE64K_US
+#define STANDARDFLASH_TBE64K_US		300000U
+#endif
+#ifndef STANDARDFLASH_TCE_US
+#define STANDARDFLASH_TCE_US		20000000U
+#endif
+
+/*
+ * SCK limits of the selected family in Hz, used by SPI_CommandClockHz().
+ * FSCK_MAX_HZ applies to every command except the read array low frequency
+ * (0x03) and the DataFlash read array low power (0x01) commands. Any of
+ * them may be overridden in user_config.h to match a specific datasheet.
+ */
+#if defined(MONETA_DEVICE)
+#ifndef FSCK_MAX_HZ
+#define FSCK_MAX_HZ					1600000U
+#endif
+#ifndef FSCK_LOW_FREQUENCY_HZ
+#define FSCK_LOW_FREQUENCY_HZ		1600000U
+#endif
+#ifndef FSCK_LOW_POWER_HZ
+#define FSCK_LOW_POWER_HZ			0U
+#endif
+#elif defined(FUSION_DEVICE)
+#ifndef FSCK_MAX_HZ
+#define FSCK_MAX_HZ					85000000U
+#endif
+#ifndef FSCK_LOW_FREQUENCY_HZ
+#define FSCK_LOW_FREQUENCY_HZ		33000000U
+#endif
+#ifndef FSCK_LOW_POWER_HZ
+#define FSCK_LOW_POWER_HZ			0U
+#endif
+#elif defined(DATAFLASH_DEVICE)
+#ifndef FSCK_MAX_HZ
+#define FSCK_MAX_HZ					85000000U
+#endif
+#ifndef FSCK_LOW_FREQUENCY_HZ
+#define FSCK_LOW_FREQUENCY_HZ		50000000U
+#endif
+#ifndef FSCK_LOW_POWER_HZ
+#define FSCK_LOW_POWER_HZ			15000000U
+#endif
+#elif defined(STANDARDFLASH_DEVICE)
+#ifndef FSCK_MAX_HZ
+#define FSCK_MAX_HZ					104000000U
+#endif
+#ifndef FSCK_LOW_FREQUENCY_HZ
+#define FSCK_LOW_FREQUENCY_HZ		50000000U
+#endif
+#ifndef FSCK_LOW_POWER_HZ
+#define FSCK_LOW_POWER_HZ			0U
+#endif
+#endif
+
 #endif /* CMD_DEFS_H_ */
@@ -40,6 +40,7 @@
  */
 
 #include "dataflash.h"
+#include "flash_context.h"
 
 #if (PARTNO == AT45DB021E) || \
 	(PARTNO == AT45DB041E) || \
@@ -55,380 +56,355 @@
 	(PARTNO == AT25PE16)   || \
 	(ALL == 1)
 
-static bool DISPLAY_OUTPUT = 0;
-
-static void debugOn() {DISPLAY_OUTPUT = 1;};
-static void debugOff() {DISPLAY_OUTPUT = 0;};
-
-uint8_t txDataflashInternalBuffer[MAXIMUM_TX_BYTES];
+static void debugOn() {flashContext->displayOutput = 1;};
+static void debugOff() {flashContext->displayOutput = 0;};
 
 void dataflashWaitOnReady()
 {
-	uint8_t SR[2];
-	do
+	dataflashWaitOnReadyFor(0);
+}
+
+void dataflashWaitOnReadyFor(uint32_t expectedUs)
+{
+	uint8_t SR[SPI_READY_MAX_STATUS_BYTES];
+	const SPI_ReadyPoll *poll = &flashContextPart()->ready;
+	SPI_WaitReady(poll, expectedUs, SR);
+	if(flashContext->displayOutput)
 	{
-		dataflashReadSR(SR);
-		SPI_Delay(10);
+		flashContext->txBuffer[0] = poll->header[0];
+		printSPIExchange(flashContext->txBuffer, 1, SR, poll->numBytes);
 	}
-	while(!(SR[0] & (1<<7)));
+}
+
+uint8_t dataflashIsBusy()
+{
+	uint8_t SR[2];
+	dataflashReadSR(SR);
+	return !(SR[0] & (1<<7));
 }
 
 void dataflashReadMID(uint8_t *rxBuffer)
 {
-	txDataflashInternalBuffer[0] = CMD_DATAFLASH_READ_MID;
-	SPI_Exchange(txDataflashInternalBuffer, 1, rxBuffer, 5, 0);
-	if(DISPLAY_OUTPUT)
+	flashContext->txBuffer[0] = CMD_DATAFLASH_READ_MID;
+	SPI_Exchange(flashContext->txBuffer, 1, rxBuffer, 5, 0);
+	if(flashContext->displayOutput)
 	{
-		printSPIExchange(txDataflashInternalBuffer, 1, rxBuffer, 5);
+		printSPIExchange(flashContext->txBuffer, 1, rxBuffer, 5);
 	}
 }
 
 void dataflashReadSR(uint8_t *rxBuffer)
 {
-	txDataflashInternalBuffer[0] = CMD_DATAFLASH_READ_SR;
-	SPI_Exchange(txDataflashInternalBuffer, 1, rxBuffer, 2, 0);
-	if(DISPLAY_OUTPUT)
+	flashContext->txBuffer[0] = CMD_DATAFLASH_READ_SR;
+	SPI_Exchange(flashContext->txBuffer, 1, rxBuffer, 2, 0);
+	if(flashContext->displayOutput)
 	{
-		printSPIExchange(txDataflashInternalBuffer, 1, rxBuffer, 2);
+		printSPIExchange(flashContext->txBuffer, 1, rxBuffer, 2);
 	}
 }
 
 void dataflashMemoryPageRead(uint32_t address, uint8_t *rxBuffer, uint32_t rxNumBytes)
 {
-	load4BytesToTxBuffer(txDataflashInternalBuffer, CMD_DATAFLASH_MEM_PAGE_READ, address);
-	SPI_Exchange(txDataflashInternalBuffer, 4, rxBuffer, rxNumBytes, 4);
-	if(DISPLAY_OUTPUT)
+	load4BytesToTxBuffer(flashContext->txBuffer, CMD_DATAFLASH_MEM_PAGE_READ, address);
+	SPI_Exchange(flashContext->txBuffer, 4, rxBuffer, rxNumBytes, 4);
+	if(flashContext->displayOutput)
 	{
-		printSPIExchange(txDataflashInternalBuffer, 4, rxBuffer, rxNumBytes);
+		printSPIExchange(flashContext->txBuffer, 4, rxBuffer, rxNumBytes);
 	}
 }
 
 void dataflashArrayReadLowPower(uint32_t address, uint8_t *rxBuffer, uint32_t rxNumBytes)
 {
-	load4BytesToTxBuffer(txDataflashInternalBuffer, CMD_DATAFLASH_ARRAY_READ_LP, address);
-	SPI_Exchange(txDataflashInternalBuffer, 4, rxBuffer, rxNumBytes, 0);
-	if(DISPLAY_OUTPUT)
+	load4BytesToTxBuffer(flashContext->txBuffer, CMD_DATAFLASH_ARRAY_READ_LP, address);
+	SPI_Exchange(flashContext->txBuffer, 4, rxBuffer, rxNumBytes, 0);
+	if(flashContext->displayOutput)
 	{
-		printSPIExchange(txDataflashInternalBuffer, 4, rxBuffer, rxNumBytes);
+		printSPIExchange(flashContext->txBuffer, 4, rxBuffer, rxNumBytes);
 	}
 }
 
 void dataflashArrayReadLowFreq(uint32_t address, uint8_t *rxBuffer, uint32_t rxNumBytes)
 {
-	load4BytesToTxBuffer(txDataflashInternalBuffer, CMD_DATAFLASH_ARRAY_READ_LF, address);
-	SPI_Exchange(txDataflashInternalBuffer, 4, rxBuffer, rxNumBytes, 0);
-	if(DISPLAY_OUTPUT)
+	load4BytesToTxBuffer(flashContext->txBuffer, CMD_DATAFLASH_ARRAY_READ_LF, address);
+	SPI_Exchange(flashContext->txBuffer, 4, rxBuffer, rxNumBytes, 0);
+	if(flashContext->displayOutput)
 	{
-		printSPIExchange(txDataflashInternalBuffer, 4, rxBuffer, rxNumBytes);
+		printSPIExchange(flashContext->txBuffer, 4, rxBuffer, rxNumBytes);
 	}
 }
 
 void dataflashArrayReadHighFreq0(uint32_t address, uint8_t *rxBuffer, uint32_t rxNumBytes)
 {
-	load4BytesToTxBuffer(txDataflashInternalBuffer, CMD_DATAFLASH_ARRAY_READ_HF0, address);
-	SPI_Exchange(txDataflashInternalBuffer, 4, rxBuffer, rxNumBytes, 1);
-	if(DISPLAY_OUTPUT)
+	load4BytesToTxBuffer(flashContext->txBuffer, CMD_DATAFLASH_ARRAY_READ_HF0, address);
+	SPI_Exchange(flashContext->txBuffer, 4, rxBuffer, rxNumBytes, 1);
+	if(flashContext->displayOutput)
 	{
-		printSPIExchange(txDataflashInternalBuffer, 4, rxBuffer, rxNumBytes);
+		printSPIExchange(flashContext->txBuffer, 4, rxBuffer, rxNumBytes);
 	}
 }
 
 void dataflashArrayReadHighFreq1(uint32_t address, uint8_t *rxBuffer, uint32_t rxNumBytes)
 {
-	load4BytesToTxBuffer(txDataflashInternalBuffer, CMD_DATAFLASH_ARRAY_READ_HF1, address);
-	SPI_Exchange(txDataflashInternalBuffer, 4, rxBuffer, rxNumBytes, 2);
-	if(DISPLAY_OUTPUT)
+	load4BytesToTxBuffer(flashContext->txBuffer, CMD_DATAFLASH_ARRAY_READ_HF1, address);
+	SPI_Exchange(flashContext->txBuffer, 4, rxBuffer, rxNumBytes, 2);
+	if(flashContext->displayOutput)
 	{
-		printSPIExchange(txDataflashInternalBuffer, 4, rxBuffer, rxNumBytes);
+		printSPIExchange(flashContext->txBuffer, 4, rxBuffer, rxNumBytes);
 	}
 }
 
 void dataflashArrayReadLegacy(uint32_t address, uint8_t *rxBuffer, uint32_t rxNumBytes)
 {
-	load4BytesToTxBuffer(txDataflashInternalBuffer, CMD_DATAFLASH_ARRAY_READ_LEG, address);
-	SPI_Exchange(txDataflashInternalBuffer, 4, rxBuffer, rxNumBytes, 4);
-	if(DISPLAY_OUTPUT)
+	load4BytesToTxBuffer(flashContext->txBuffer, CMD_DATAFLASH_ARRAY_READ_LEG, address);
+	SPI_Exchange(flashContext->txBuffer, 4, rxBuffer, rxNumBytes, 4);
+	if(flashContext->displayOutput)
 	{
-		printSPIExchange(txDataflashInternalBuffer, 4, rxBuffer, rxNumBytes);
+		printSPIExchange(flashContext->txBuffer, 4, rxBuffer, rxNumBytes);
 	}
 }
 
 void dataflashBuffer1ReadLowFreq(uint32_t address, uint8_t *rxBuffer, uint32_t rxNumBytes)
 {
-	load4BytesToTxBuffer(txDataflashInternalBuffer, CMD_DATAFLASH_BUFFER1_READ_LF, address);
-	SPI_Exchange(txDataflashInternalBuffer, 4, rxBuffer, rxNumBytes, 0);
-	if(DISPLAY_OUTPUT)
+	load4BytesToTxBuffer(flashContext->txBuffer, CMD_DATAFLASH_BUFFER1_READ_LF, address);
+	SPI_Exchange(flashContext->txBuffer, 4, rxBuffer, rxNumBytes, 0);
+	if(flashContext->displayOutput)
 	{
-		printSPIExchange(txDataflashInternalBuffer, 4, rxBuffer, rxNumBytes);
+		printSPIExchange(flashContext->txBuffer, 4, rxBuffer, rxNumBytes);
 	}
 }
 
 void dataflashBuffer1ReadHighFreq(uint32_t address, uint8_t *rxBuffer, uint32_t rxNumBytes)
 {
-	load4BytesToTxBuffer(txDataflashInternalBuffer, CMD_DATAFLASH_BUFFER1_READ_HF, address);
-	SPI_Exchange(txDataflashInternalBuffer, 4, rxBuffer, rxNumBytes, 1);
-	if(DISPLAY_OUTPUT)
+	load4BytesToTxBuffer(flashContext->txBuffer, CMD_DATAFLASH_BUFFER1_READ_HF, address);
+	SPI_Exchange(flashContext->txBuffer, 4, rxBuffer, rxNumBytes, 1);
+	if(flashContext->displayOutput)
 	{
-		printSPIExchange(txDataflashInternalBuffer, 4, rxBuffer, rxNumBytes);
+		printSPIExchange(flashContext->txBuffer, 4, rxBuffer, rxNumBytes);
 	}
 }
 
 void dataflashBuffer1Write(uint32_t address, uint8_t *txBuffer, uint32_t txNumBytes)
 {
-	load4BytesToTxBuffer(txDataflashInternalBuffer, CMD_DATAFLASH_BUFFER1_WRITE, address);
-	// Offset the data bytes by 4; opcode+address takes up the first 4 bytes of a transmission.
-	uint32_t totalBytes = txNumBytes + 4;
-
-	for(uint32_t j = 0; j < txNumBytes; j++)
+	load4BytesToTxBuffer(flashContext->txBuffer, CMD_DATAFLASH_BUFFER1_WRITE, address);
+	SPI_GatherExchange(1, 4, flashContext->txBuffer, 4, txBuffer, txNumBytes);
+	if(flashContext->displayOutput)
 	{
-		txDataflashInternalBuffer[j+4] = txBuffer[j];
-	}
-	SPI_Exchange(txDataflashInternalBuffer, totalBytes, NULL, 0, 0);
-	if(DISPLAY_OUTPUT)
-	{
-		printSPIExchange(txDataflashInternalBuffer, totalBytes, NULL, 0);
+		printSPIWrite(flashContext->txBuffer, 4, txBuffer, txNumBytes);
 	}
 }
 
 void dataflashBuffer1ToMainMemoryWithErase(uint32_t address)
 {
-	load4BytesToTxBuffer(txDataflashInternalBuffer, CMD_DATAFLASH_BUF1_2MEM_W_ERASE, address);
-	SPI_Exchange(txDataflashInternalBuffer, 4, NULL, 0, 0);
-	if(DISPLAY_OUTPUT)
+	load4BytesToTxBuffer(flashContext->txBuffer, CMD_DATAFLASH_BUF1_2MEM_W_ERASE, address);
+	SPI_Exchange(flashContext->txBuffer, 4, NULL, 0, 0);
+	if(flashContext->displayOutput)
 	{
-		printSPIExchange(txDataflashInternalBuffer, 4, NULL, 0);
+		printSPIExchange(flashContext->txBuffer, 4, NULL, 0);
 	}
 }
 
 void dataflashBuffer1ToMainMemoryWithoutErase(uint32_t address)
 {
-	load4BytesToTxBuffer(txDataflashInternalBuffer, CMD_DATAFLASH_BUF1_2MEM_WO_ERASE, address);
-	SPI_Exchange(txDataflashInternalBuffer, 4, NULL, 0, 0);
-	if(DISPLAY_OUTPUT)
+	load4BytesToTxBuffer(flashContext->txBuffer, CMD_DATAFLASH_BUF1_2MEM_WO_ERASE, address);
+	SPI_Exchange(flashContext->txBuffer, 4, NULL, 0, 0);
+	if(flashContext->displayOutput)
 	{
-		printSPIExchange(txDataflashInternalBuffer, 4, NULL, 0);
+		printSPIExchange(flashContext->txBuffer, 4, NULL, 0);
 	}
 }
 
 void dataflashMemoryProgramThruBuffer1WithErase(uint32_t address, uint8_t *txBuffer, uint32_t txNumBytes)
 {
-	load4BytesToTxBuffer(txDataflashInternalBuffer, CMD_DATAFLASH_MEM_PRGM_BUF1_W_ERASE, address);
-	// Offset the data bytes by 4; opcode+address takes up the first 4 bytes of a transmission.
-	uint32_t totalBytes = txNumBytes + 4;
-
-	for(uint32_t j = 0; j < txNumBytes; j++)
+	load4BytesToTxBuffer(flashContext->txBuffer, CMD_DATAFLASH_MEM_PRGM_BUF1_W_ERASE, address);
+	SPI_GatherExchange(1, 4, flashContext->txBuffer, 4, txBuffer, txNumBytes);
+	if(flashContext->displayOutput)
 	{
-		txDataflashInternalBuffer[j+4] = txBuffer[j];
-	}
-	SPI_Exchange(txDataflashInternalBuffer, totalBytes, NULL, 0, 0);
-	if(DISPLAY_OUTPUT)
-	{
-		printSPIExchange(txDataflashInternalBuffer, totalBytes, NULL, 0);
+		printSPIWrite(flashContext->txBuffer, 4, txBuffer, txNumBytes);
 	}
 }
 
 void dataflashMemoryProgramThruBuffer1WithoutErase(uint32_t address, uint8_t *txBuffer, uint32_t txNumBytes)
 {
-	load4BytesToTxBuffer(txDataflashInternalBuffer, CMD_DATAFLASH_MEM_PRGM_BUF1_WO_ERASE, address);
-	// Offset the data bytes by 4; opcode+address takes up the first 4 bytes of a transmission.
-	uint32_t totalBytes = txNumBytes + 4;
-
-	for(uint32_t j = 0; j < txNumBytes; j++)
+	load4BytesToTxBuffer(flashContext->txBuffer, CMD_DATAFLASH_MEM_PRGM_BUF1_WO_ERASE, address);
+	SPI_GatherExchange(1, 4, flashContext->txBuffer, 4, txBuffer, txNumBytes);
+	if(flashContext->displayOutput)
 	{
-		txDataflashInternalBuffer[j+4] = txBuffer[j];
-	}
-	SPI_Exchange(txDataflashInternalBuffer, totalBytes, NULL, 0, 0);
-	if(DISPLAY_OUTPUT)
-	{
-		printSPIExchange(txDataflashInternalBuffer, totalBytes, NULL, 0);
+		printSPIWrite(flashContext->txBuffer, 4, txBuffer, txNumBytes);
 	}
 }
 
 void dataflashPageErase(uint32_t address)
 {
-	load4BytesToTxBuffer(txDataflashInternalBuffer, CMD_DATAFLASH_PAGE_ERASE, address);
-	SPI_Exchange(txDataflashInternalBuffer, 4, NULL, 0, 0);
-	if(DISPLAY_OUTPUT)
+	load4BytesToTxBuffer(flashContext->txBuffer, CMD_DATAFLASH_PAGE_ERASE, address);
+	SPI_Exchange(flashContext->txBuffer, 4, NULL, 0, 0);
+	if(flashContext->displayOutput)
 	{
-		printSPIExchange(txDataflashInternalBuffer, 4, NULL, 0);
+		printSPIExchange(flashContext->txBuffer, 4, NULL, 0);
 	}
 }
 
 void dataflashBlockErase(uint32_t address)
 {
-	load4BytesToTxBuffer(txDataflashInternalBuffer, CMD_DATAFLASH_BLOCK_ERASE, address);
-	SPI_Exchange(txDataflashInternalBuffer, 4, NULL, 0, 0);
-	if(DISPLAY_OUTPUT)
+	load4BytesToTxBuffer(flashContext->txBuffer, CMD_DATAFLASH_BLOCK_ERASE, address);
+	SPI_Exchange(flashContext->txBuffer, 4, NULL, 0, 0);
+	if(flashContext->displayOutput)
 	{
-		printSPIExchange(txDataflashInternalBuffer, 4, NULL, 0);
+		printSPIExchange(flashContext->txBuffer, 4, NULL, 0);
 	}
 }
 
 void dataflashSectorErase(uint32_t address)
 {
-	load4BytesToTxBuffer(txDataflashInternalBuffer, CMD_DATAFLASH_SECTOR_ERASE, address);
-	SPI_Exchange(txDataflashInternalBuffer, 4, NULL, 0, 0);
-	if(DISPLAY_OUTPUT)
+	load4BytesToTxBuffer(flashContext->txBuffer, CMD_DATAFLASH_SECTOR_ERASE, address);
+	SPI_Exchange(flashContext->txBuffer, 4, NULL, 0, 0);
+	if(flashContext->displayOutput)
 	{
-		printSPIExchange(txDataflashInternalBuffer, 4, NULL, 0);
+		printSPIExchange(flashContext->txBuffer, 4, NULL, 0);
 	}
 }
 
 void dataflashChipErase()
 {
-	txDataflashInternalBuffer[0] = CMD_DATAFLASH_CHIP_ERASE >> 24;
-	txDataflashInternalBuffer[1] = (uint8_t) (CMD_DATAFLASH_CHIP_ERASE >> 16);
-	txDataflashInternalBuffer[2] = (uint8_t) (CMD_DATAFLASH_CHIP_ERASE >> 8);
-	txDataflashInternalBuffer[3] = (uint8_t) (CMD_DATAFLASH_CHIP_ERASE);
-	SPI_Exchange(txDataflashInternalBuffer, 4, NULL, 0, 0);
-	if(DISPLAY_OUTPUT)
+	flashContext->txBuffer[0] = CMD_DATAFLASH_CHIP_ERASE >> 24;
+	flashContext->txBuffer[1] = (uint8_t) (CMD_DATAFLASH_CHIP_ERASE >> 16);
+	flashContext->txBuffer[2] = (uint8_t) (CMD_DATAFLASH_CHIP_ERASE >> 8);
+	flashContext->txBuffer[3] = (uint8_t) (CMD_DATAFLASH_CHIP_ERASE);
+	SPI_Exchange(flashContext->txBuffer, 4, NULL, 0, 0);
+	if(flashContext->displayOutput)
 	{
-		printSPIExchange(txDataflashInternalBuffer, 4, NULL, 0);
+		printSPIExchange(flashContext->txBuffer, 4, NULL, 0);
 	}
 }
 
 void dataflashRMWThruBuffer1(uint32_t address, uint8_t *txBuffer, uint32_t txNumBytes)
 {
-	load4BytesToTxBuffer(txDataflashInternalBuffer, CMD_DATAFLASH_RD_MOD_WR_THRU_BUF1, address);
-	// Offset the data bytes by 4; opcode+address takes up the first 4 bytes of a transmission.
-	uint32_t totalBytes = txNumBytes + 4;
-
-	for(uint32_t j = 0; j < txNumBytes; j++)
-	{
-		txDataflashInternalBuffer[j+4] = txBuffer[j];
-	}
-	SPI_Exchange(txDataflashInternalBuffer, totalBytes, NULL, 0, 0);
-	if(DISPLAY_OUTPUT)
+	load4BytesToTxBuffer(flashContext->txBuffer, CMD_DATAFLASH_RD_MOD_WR_THRU_BUF1, address);
+	SPI_GatherExchange(1, 4, flashContext->txBuffer, 4, txBuffer, txNumBytes);
+	if(flashContext->displayOutput)
 	{
-		printSPIExchange(txDataflashInternalBuffer, totalBytes, NULL, 0);
+		printSPIWrite(flashContext->txBuffer, 4, txBuffer, txNumBytes);
 	}
 }
 
 void dataflashEnableSectorProtection()
 {
-	txDataflashInternalBuffer[0] = CMD_DATAFLASH_ENABLE_SECT_PROTECTION >> 24;
-	txDataflashInternalBuffer[1] = (uint8_t) (CMD_DATAFLASH_ENABLE_SECT_PROTECTION >> 16);
-	txDataflashInternalBuffer[2] = (uint8_t) (CMD_DATAFLASH_ENABLE_SECT_PROTECTION >> 8);
-	txDataflashInternalBuffer[3] = (uint8_t) (CMD_DATAFLASH_ENABLE_SECT_PROTECTION);
-	SPI_Exchange(txDataflashInternalBuffer, 4, NULL, 0, 0);
-	if(DISPLAY_OUTPUT)
+	flashContext->txBuffer[0] = CMD_DATAFLASH_ENABLE_SECT_PROTECTION >> 24;
+	flashContext->txBuffer[1] = (uint8_t) (CMD_DATAFLASH_ENABLE_SECT_PROTECTION >> 16);
+	flashContext->txBuffer[2] = (uint8_t) (CMD_DATAFLASH_ENABLE_SECT_PROTECTION >> 8);
+	flashContext->txBuffer[3] = (uint8_t) (CMD_DATAFLASH_ENABLE_SECT_PROTECTION);
+	SPI_Exchange(flashContext->txBuffer, 4, NULL, 0, 0);
+	if(flashContext->displayOutput)
 	{
-		printSPIExchange(txDataflashInternalBuffer, 4, NULL, 0);
+		printSPIExchange(flashContext->txBuffer, 4, NULL, 0);
 	}
 }
 
 void dataflashDisableSectorProtection()
 {
-	txDataflashInternalBuffer[0] = CMD_DATAFLASH_DISABLE_SECT_PROTECTION >> 24;
-	txDataflashInternalBuffer[1] = (uint8_t) (CMD_DATAFLASH_DISABLE_SECT_PROTECTION >> 16);
-	txDataflashInternalBuffer[2] = (uint8_t) (CMD_DATAFLASH_DISABLE_SECT_PROTECTION >> 8);
-	txDataflashInternalBuffer[3] = (uint8_t) (CMD_DATAFLASH_DISABLE_SECT_PROTECTION);
-	SPI_Exchange(txDataflashInternalBuffer, 4, NULL, 0, 0);
-	if(DISPLAY_OUTPUT)
+	flashContext->txBuffer[0] = CMD_DATAFLASH_DISABLE_SECT_PROTECTION >> 24;
+	flashContext->txBuffer[1] = (uint8_t) (CMD_DATAFLASH_DISABLE_SECT_PROTECTION >> 16);
+	flashContext->txBuffer[2] = (uint8_t) (CMD_DATAFLASH_DISABLE_SECT_PROTECTION >> 8);
+	flashContext->txBuffer[3] = (uint8_t) (CMD_DATAFLASH_DISABLE_SECT_PROTECTION);
+	SPI_Exchange(flashContext->txBuffer, 4, NULL, 0, 0);
+	if(flashContext->displayOutput)
 	{
-		printSPIExchange(txDataflashInternalBuffer, 4, NULL, 0);
+		printSPIExchange(flashContext->txBuffer, 4, NULL, 0);
 	}
 }
 
 void dataflashEraseSectorProtectionReg()
 {
-	txDataflashInternalBuffer[0] = CMD_DATAFLASH_ERASE_SECT_PROT_REG >> 24;
-	txDataflashInternalBuffer[1] = (uint8_t) (CMD_DATAFLASH_ERASE_SECT_PROT_REG >> 16);
-	txDataflashInternalBuffer[2] = (uint8_t) (CMD_DATAFLASH_ERASE_SECT_PROT_REG >> 8);
-	txDataflashInternalBuffer[3] = (uint8_t) (CMD_DATAFLASH_ERASE_SECT_PROT_REG);
-	SPI_Exchange(txDataflashInternalBuffer, 4, NULL, 0, 0);
-	if(DISPLAY_OUTPUT)
+	flashContext->txBuffer[0] = CMD_DATAFLASH_ERASE_SECT_PROT_REG >> 24;
+	flashContext->txBuffer[1] = (uint8_t) (CMD_DATAFLASH_ERASE_SECT_PROT_REG >> 16);
+	flashContext->txBuffer[2] = (uint8_t) (CMD_DATAFLASH_ERASE_SECT_PROT_REG >> 8);
+	flashContext->txBuffer[3] = (uint8_t) (CMD_DATAFLASH_ERASE_SECT_PROT_REG);
+	SPI_Exchange(flashContext->txBuffer, 4, NULL, 0, 0);
+	if(flashContext->displayOutput)
 	{
-		printSPIExchange(txDataflashInternalBuffer, 4, NULL, 0);
+		printSPIExchange(flashContext->txBuffer, 4, NULL, 0);
 	}
 }
 
 void dataflashProgSectorProtectionReg(uint8_t *txBuffer, uint32_t txNumBytes)
 {
-	txDataflashInternalBuffer[0] = CMD_DATAFLASH_PROGRAM_SECT_PROT_REG >> 24;
-	txDataflashInternalBuffer[1] = (uint8_t) (CMD_DATAFLASH_PROGRAM_SECT_PROT_REG >> 16);
-	txDataflashInternalBuffer[2] = (uint8_t) (CMD_DATAFLASH_PROGRAM_SECT_PROT_REG >> 8);
-	txDataflashInternalBuffer[3] = (uint8_t) (CMD_DATAFLASH_PROGRAM_SECT_PROT_REG);
-	uint32_t totalBytes = txNumBytes + 4;
-
-	for(uint32_t j = 0; j < txNumBytes; j++)
-	{
-		txDataflashInternalBuffer[j+4] = txBuffer[j];
-	}
-	SPI_Exchange(txDataflashInternalBuffer, totalBytes, NULL, 0, 0);
-	if(DISPLAY_OUTPUT)
+	flashContext->txBuffer[0] = CMD_DATAFLASH_PROGRAM_SECT_PROT_REG >> 24;
+	flashContext->txBuffer[1] = (uint8_t) (CMD_DATAFLASH_PROGRAM_SECT_PROT_REG >> 16);
+	flashContext->txBuffer[2] = (uint8_t) (CMD_DATAFLASH_PROGRAM_SECT_PROT_REG >> 8);
+	flashContext->txBuffer[3] = (uint8_t) (CMD_DATAFLASH_PROGRAM_SECT_PROT_REG);
+	SPI_GatherExchange(1, 4, flashContext->txBuffer, 4, txBuffer, txNumBytes);
+	if(flashContext->displayOutput)
 	{
-		printSPIExchange(txDataflashInternalBuffer, totalBytes, NULL, 0);
+		printSPIWrite(flashContext->txBuffer, 4, txBuffer, txNumBytes);
 	}
 }
 
 void dataflashReadSectorProtectionReg(uint8_t *rxBuffer, uint32_t rxNumBytes)
 {
-	txDataflashInternalBuffer[0] = CMD_DATAFLASH_READ_SECT_PROT_REG;
-	SPI_Exchange(txDataflashInternalBuffer, 1, rxBuffer, rxNumBytes, 3);
-	if(DISPLAY_OUTPUT)
+	flashContext->txBuffer[0] = CMD_DATAFLASH_READ_SECT_PROT_REG;
+	SPI_Exchange(flashContext->txBuffer, 1, rxBuffer, rxNumBytes, 3);
+	if(flashContext->displayOutput)
 	{
-		printSPIExchange(txDataflashInternalBuffer, 1, rxBuffer, rxNumBytes);
+		printSPIExchange(flashContext->txBuffer, 1, rxBuffer, rxNumBytes);
 	}
 }
 
 void dataflashReadSecurityReg(uint8_t *rxBuffer, uint32_t rxNumBytes)
 {
-	txDataflashInternalBuffer[0] = CMD_DATAFLASH_READ_SECURITY_REG;
-	SPI_Exchange(txDataflashInternalBuffer, 1, rxBuffer, rxNumBytes, 3);
-	if(DISPLAY_OUTPUT)
+	flashContext->txBuffer[0] = CMD_DATAFLASH_READ_SECURITY_REG;
+	SPI_Exchange(flashContext->txBuffer, 1, rxBuffer, rxNumBytes, 3);
+	if(flashContext->displayOutput)
 	{
-		printSPIExchange(txDataflashInternalBuffer, 1, rxBuffer, rxNumBytes);
+		printSPIExchange(flashContext->txBuffer, 1, rxBuffer, rxNumBytes);
 	}
 }
 
 void dataflashMemtoBuffer1Transfer(uint32_t address)
 {
-	load4BytesToTxBuffer(txDataflashInternalBuffer, CMD_DATAFLASH_MEM_BUF1_TRANSFER, address);
-	SPI_Exchange(txDataflashInternalBuffer, 4, NULL, 0, 0);
-	if(DISPLAY_OUTPUT)
+	load4BytesToTxBuffer(flashContext->txBuffer, CMD_DATAFLASH_MEM_BUF1_TRANSFER, address);
+	SPI_Exchange(flashContext->txBuffer, 4, NULL, 0, 0);
+	if(flashContext->displayOutput)
 	{
-		printSPIExchange(txDataflashInternalBuffer, 4, NULL, 0);
+		printSPIExchange(flashContext->txBuffer, 4, NULL, 0);
 	}
 }
 
 void dataflashMemtoBuffer1Compare(uint32_t address)
 {
-	load4BytesToTxBuffer(txDataflashInternalBuffer, CMD_DATAFLASH_MEM_BUF1_COMPARE, address);
-	SPI_Exchange(txDataflashInternalBuffer, 4, NULL, 0, 0);
-	if(DISPLAY_OUTPUT)
+	load4BytesToTxBuffer(flashContext->txBuffer, CMD_DATAFLASH_MEM_BUF1_COMPARE, address);
+	SPI_Exchange(flashContext->txBuffer, 4, NULL, 0, 0);
+	if(flashContext->displayOutput)
 	{
-		printSPIExchange(txDataflashInternalBuffer, 4, NULL, 0);
+		printSPIExchange(flashContext->txBuffer, 4, NULL, 0);
 	}
 }
 
 void dataflashAutoPageRewrite1(uint32_t address)
 {
-	load4BytesToTxBuffer(txDataflashInternalBuffer, CMD_DATAFLASH_AUTO_PAGE_REWRITE1, address);
-	SPI_Exchange(txDataflashInternalBuffer, 4, NULL, 0, 0);
-	if(DISPLAY_OUTPUT)
+	load4BytesToTxBuffer(flashContext->txBuffer, CMD_DATAFLASH_AUTO_PAGE_REWRITE1, address);
+	SPI_Exchange(flashContext->txBuffer, 4, NULL, 0, 0);
+	if(flashContext->displayOutput)
 	{
-		printSPIExchange(txDataflashInternalBuffer, 4, NULL, 0);
+		printSPIExchange(flashContext->txBuffer, 4, NULL, 0);
 	}
 }
 
 void dataflashDPD()
 {
-	txDataflashInternalBuffer[0] = CMD_DATAFLASH_DEEP_POWER_DOWN;
-	SPI_Exchange(txDataflashInternalBuffer, 1, NULL, 0, 0);
-	if(DISPLAY_OUTPUT)
+	flashContext->txBuffer[0] = CMD_DATAFLASH_DEEP_POWER_DOWN;
+	SPI_Exchange(flashContext->txBuffer, 1, NULL, 0, 0);
+	if(flashContext->displayOutput)
 	{
-		printSPIExchange(txDataflashInternalBuffer, 1, NULL, 0);
+		printSPIExchange(flashContext->txBuffer, 1, NULL, 0);
 	}
 }
 
 void dataflashUDPDMode()
 {
-	txDataflashInternalBuffer[0] = CMD_DATAFLASH_UDPD_MODE;
-	SPI_Exchange(txDataflashInternalBuffer, 1, NULL, 0, 0);
-	if(DISPLAY_OUTPUT)
+	flashContext->txBuffer[0] = CMD_DATAFLASH_UDPD_MODE;
+	SPI_Exchange(flashContext->txBuffer, 1, NULL, 0, 0);
+	if(flashContext->displayOutput)
 	{
-		printSPIExchange(txDataflashInternalBuffer, 1, NULL, 0);
+		printSPIExchange(flashContext->txBuffer, 1, NULL, 0);
 	}
 }
 
@@ -439,208 +415,275 @@ void dataflashHardwareReset()
 
 void dataflashResumeFromDPD()
 {
-	txDataflashInternalBuffer[0] = CMD_DATAFLASH_RESUME_FROM_DPD;
-	SPI_Exchange(txDataflashInternalBuffer, 1, NULL, 0, 0);
-	if(DISPLAY_OUTPUT)
+	flashContext->txBuffer[0] = CMD_DATAFLASH_RESUME_FROM_DPD;
+	SPI_Exchange(flashContext->txBuffer, 1, NULL, 0, 0);
+	if(flashContext->displayOutput)
 	{
-		printSPIExchange(txDataflashInternalBuffer, 1, NULL, 0);
+		printSPIExchange(flashContext->txBuffer, 1, NULL, 0);
 	}
 }
 
 void dataflashConfigurePower2PageSize()
 {
-	txDataflashInternalBuffer[0] = CMD_DATAFLASH_CONFIGURE_P2_PG_SIZE >> 24;
-	txDataflashInternalBuffer[1] = (uint8_t) (CMD_DATAFLASH_CONFIGURE_P2_PG_SIZE >> 16);
-	txDataflashInternalBuffer[2] = (uint8_t) (CMD_DATAFLASH_CONFIGURE_P2_PG_SIZE >> 8);
-	txDataflashInternalBuffer[3] = (uint8_t) (CMD_DATAFLASH_CONFIGURE_P2_PG_SIZE);
-	SPI_Exchange(txDataflashInternalBuffer, 4, NULL, 0, 0);
-	if(DISPLAY_OUTPUT)
+	// Read the page size again when it is next needed.
+	flashContext->pageSize = 0;
+	flashContext->txBuffer[0] = CMD_DATAFLASH_CONFIGURE_P2_PG_SIZE >> 24;
+	flashContext->txBuffer[1] = (uint8_t) (CMD_DATAFLASH_CONFIGURE_P2_PG_SIZE >> 16);
+	flashContext->txBuffer[2] = (uint8_t) (CMD_DATAFLASH_CONFIGURE_P2_PG_SIZE >> 8);
+	flashContext->txBuffer[3] = (uint8_t) (CMD_DATAFLASH_CONFIGURE_P2_PG_SIZE);
+	SPI_Exchange(flashContext->txBuffer, 4, NULL, 0, 0);
+	if(flashContext->displayOutput)
 	{
-		printSPIExchange(txDataflashInternalBuffer, 4, NULL, 0);
+		printSPIExchange(flashContext->txBuffer, 4, NULL, 0);
 	}
 }
 
 void dataflashConfigureStandardPageSize()
 {
-	txDataflashInternalBuffer[0] = CMD_DATAFLASH_CONFIGURE_STD_PG_SIZE >> 24;
-	txDataflashInternalBuffer[1] = (uint8_t) (CMD_DATAFLASH_CONFIGURE_STD_PG_SIZE >> 16);
-	txDataflashInternalBuffer[2] = (uint8_t) (CMD_DATAFLASH_CONFIGURE_STD_PG_SIZE >> 8);
-	txDataflashInternalBuffer[3] = (uint8_t) (CMD_DATAFLASH_CONFIGURE_STD_PG_SIZE);
-	SPI_Exchange(txDataflashInternalBuffer, 4, NULL, 0, 0);
-	if(DISPLAY_OUTPUT)
+	// Read the page size again when it is next needed.
+	flashContext->pageSize = 0;
+	flashContext->txBuffer[0] = CMD_DATAFLASH_CONFIGURE_STD_PG_SIZE >> 24;
+	flashContext->txBuffer[1] = (uint8_t) (CMD_DATAFLASH_CONFIGURE_STD_PG_SIZE >> 16);
+	flashContext->txBuffer[2] = (uint8_t) (CMD_DATAFLASH_CONFIGURE_STD_PG_SIZE >> 8);
+	flashContext->txBuffer[3] = (uint8_t) (CMD_DATAFLASH_CONFIGURE_STD_PG_SIZE);
+	SPI_Exchange(flashContext->txBuffer, 4, NULL, 0, 0);
+	if(flashContext->displayOutput)
 	{
-		printSPIExchange(txDataflashInternalBuffer, 4, NULL, 0);
+		printSPIExchange(flashContext->txBuffer, 4, NULL, 0);
 	}
 }
 
 void dataflashSoftwareReset()
 {
-	txDataflashInternalBuffer[0] = CMD_DATAFLASH_SOFTWARE_RESET >> 24;
-	txDataflashInternalBuffer[1] = (uint8_t) (CMD_DATAFLASH_SOFTWARE_RESET >> 16);
-	txDataflashInternalBuffer[2] = (uint8_t) (CMD_DATAFLASH_SOFTWARE_RESET >> 8);
-	txDataflashInternalBuffer[3] = (uint8_t) (CMD_DATAFLASH_SOFTWARE_RESET);
-	SPI_Exchange(txDataflashInternalBuffer, 4, NULL, 0, 0);
-	if(DISPLAY_OUTPUT)
+	flashContext->txBuffer[0] = CMD_DATAFLASH_SOFTWARE_RESET >> 24;
+	flashContext->txBuffer[1] = (uint8_t) (CMD_DATAFLASH_SOFTWARE_RESET >> 16);
+	flashContext->txBuffer[2] = (uint8_t) (CMD_DATAFLASH_SOFTWARE_RESET >> 8);
+	flashContext->txBuffer[3] = (uint8_t) (CMD_DATAFLASH_SOFTWARE_RESET);
+	SPI_Exchange(flashContext->txBuffer, 4, NULL, 0, 0);
+	if(flashContext->displayOutput)
 	{
-		printSPIExchange(txDataflashInternalBuffer, 4, NULL, 0);
+		printSPIExchange(flashContext->txBuffer, 4, NULL, 0);
 	}
 }
 
 void dataflashBuffer1ReadLegacy(uint8_t address, uint8_t *rxBuffer, uint32_t rxNumBytes)
 {
-	load4BytesToTxBuffer(txDataflashInternalBuffer, CMD_DATAFLASH_BUF1_READ_LEG, address);
-	SPI_Exchange(txDataflashInternalBuffer, 4, rxBuffer, rxNumBytes, 0);
-	if(DISPLAY_OUTPUT)
+	load4BytesToTxBuffer(flashContext->txBuffer, CMD_DATAFLASH_BUF1_READ_LEG, address);
+	SPI_Exchange(flashContext->txBuffer, 4, rxBuffer, rxNumBytes, 0);
+	if(flashContext->displayOutput)
 	{
-		printSPIExchange(txDataflashInternalBuffer, 4, rxBuffer, rxNumBytes);
+		printSPIExchange(flashContext->txBuffer, 4, rxBuffer, rxNumBytes);
 	}
 }
 
 void dataflashMemPageReadLegacy(uint8_t address, uint8_t *rxBuffer, uint32_t rxNumBytes)
 {
-	load4BytesToTxBuffer(txDataflashInternalBuffer, CMD_DATAFLASH_MEM_PAGE_READ_LEG, address);
-	SPI_Exchange(txDataflashInternalBuffer, 4, rxBuffer, rxNumBytes, 0);
-	if(DISPLAY_OUTPUT)
+	load4BytesToTxBuffer(flashContext->txBuffer, CMD_DATAFLASH_MEM_PAGE_READ_LEG, address);
+	SPI_Exchange(flashContext->txBuffer, 4, rxBuffer, rxNumBytes, 0);
+	if(flashContext->displayOutput)
 	{
-		printSPIExchange(txDataflashInternalBuffer, 4, rxBuffer, rxNumBytes);
+		printSPIExchange(flashContext->txBuffer, 4, rxBuffer, rxNumBytes);
 	}
 }
 
 void dataflashContinuousArrayReadLegacy(uint8_t address, uint8_t *rxBuffer, uint32_t rxNumBytes)
 {
-	load4BytesToTxBuffer(txDataflashInternalBuffer, CMD_DATAFLASH_CONTINUOUS_ARRAY_READ_LEG, address);
-	SPI_Exchange(txDataflashInternalBuffer, 4, rxBuffer, rxNumBytes, 0);
-	if(DISPLAY_OUTPUT)
+	load4BytesToTxBuffer(flashContext->txBuffer, CMD_DATAFLASH_CONTINUOUS_ARRAY_READ_LEG, address);
+	SPI_Exchange(flashContext->txBuffer, 4, rxBuffer, rxNumBytes, 0);
+	if(flashContext->displayOutput)
 	{
-		printSPIExchange(txDataflashInternalBuffer, 4, rxBuffer, rxNumBytes);
+		printSPIExchange(flashContext->txBuffer, 4, rxBuffer, rxNumBytes);
 	}
 }
 
 void dataflashReadSRLegacy(uint8_t *rxBuffer)
 {
-	txDataflashInternalBuffer[0] = CMD_DATAFLASH_SR_READ_LEG;
-	SPI_Exchange(txDataflashInternalBuffer, 1, rxBuffer, 2, 0);
-	if(DISPLAY_OUTPUT)
+	flashContext->txBuffer[0] = CMD_DATAFLASH_SR_READ_LEG;
+	SPI_Exchange(flashContext->txBuffer, 1, rxBuffer, 2, 0);
+	if(flashContext->displayOutput)
 	{
-		printSPIExchange(txDataflashInternalBuffer, 1, rxBuffer, 2);
+		printSPIExchange(flashContext->txBuffer, 1, rxBuffer, 2);
 	}
 }
-#if (PARTNO == AT45DQ161) || \
-	(PARTNO == AT45DQ321) || \
-	(ALL == 1)
-void dataflashDualOutputRead(uint32_t address, uint8_t *rxBuffer, uint32_t rxNumBytes)
+
+uint32_t dataflashGetPageSize()
 {
-	load4BytesToTxBuffer(txDataflashInternalBuffer, CMD_DATAFLASH_DUAL_OUTPUT_READ_ARRAY, address);
-	SPI_DualExchange(4, txDataflashInternalBuffer, 4, rxBuffer, rxNumBytes, 1);
-	if(DISPLAY_OUTPUT)
-	{
-		printSPIExchange(txDataflashInternalBuffer, 4, rxBuffer, rxNumBytes);
-	}
+	uint8_t SR[2];
+	dataflashReadSR(SR);
+	return (SR[0] & (1<<0)) ? DATAFLASH_PAGE_SIZE_P2 : DATAFLASH_PAGE_SIZE_STD;
 }
 
-void dataflashQuadOutputRead(uint32_t address, uint8_t *rxBuffer, uint32_t rxNumBytes)
+// Page size used by the any-length functions, read from the status register
+// only once per configuration.
+static uint32_t dataflashPageSize()
 {
-	load4BytesToTxBuffer(txDataflashInternalBuffer, CMD_DATAFLASH_QUAD_OUTPUT_READ_ARRAY, address);
-	SPI_QuadExchange(4, txDataflashInternalBuffer, 4, rxBuffer, rxNumBytes, 1);
-	if(DISPLAY_OUTPUT)
+	if(flashContext->pageSize == 0)
 	{
-		printSPIExchange(txDataflashInternalBuffer, 4, rxBuffer, rxNumBytes);
+		flashContext->pageSize = dataflashGetPageSize();
 	}
+	return flashContext->pageSize;
 }
 
-void dataflashDualInputBuffer1Write(uint32_t address, uint8_t *txBuffer, uint32_t txNumBytes)
+uint32_t dataflashDeviceAddress(uint32_t address, uint32_t pageSize)
+{
+	if(pageSize == DATAFLASH_PAGE_SIZE_P2)
+		return address;
+	return ((address / pageSize) << DATAFLASH_PAGE_OFFSET_BITS) | (address % pageSize);
+}
+
+// Starts writing one page or part of it; a whole page needs no read-modify-write.
+static void dataflashStartPage(uint32_t address, uint8_t *txBuffer, uint32_t txNumBytes, uint32_t pageSize)
 {
-	load4BytesToTxBuffer(txDataflashInternalBuffer, CMD_DATAFLASH_DUAL_INPUT_BUFFER1_WRITE, address);
-	for(uint32_t j = 0; j < txNumBytes; j++)
+	if(txNumBytes == pageSize)
+		dataflashMemoryProgramThruBuffer1WithErase(dataflashDeviceAddress(address, pageSize), txBuffer, txNumBytes);
+	else
+		dataflashRMWThruBuffer1(dataflashDeviceAddress(address, pageSize), txBuffer, txNumBytes);
+}
+
+void dataflashProgram(uint32_t address, uint8_t *txBuffer, uint32_t txNumBytes)
+{
+	uint32_t pageSize = dataflashPageSize();
+	while(txNumBytes > 0)
 	{
-		txDataflashInternalBuffer[j+4] = txBuffer[j];
+		uint32_t chunk = pageSize - (address % pageSize);
+		if(chunk > txNumBytes)
+			chunk = txNumBytes;
+		dataflashStartPage(address, txBuffer, chunk, pageSize);
+		dataflashWaitOnReadyFor(DATAFLASH_TEP_US);
+		address += chunk;
+		txBuffer += chunk;
+		txNumBytes -= chunk;
 	}
+}
+
+void dataflashRead(uint32_t address, uint8_t *rxBuffer, uint32_t rxNumBytes)
+{
+	dataflashArrayReadHighFreq0(dataflashDeviceAddress(address, dataflashPageSize()), rxBuffer, rxNumBytes);
+}
+
+void dataflashProgramPageStart(uint32_t address, uint8_t *txBuffer, uint32_t txNumBytes)
+{
+	dataflashStartPage(address, txBuffer, txNumBytes, dataflashPageSize());
+}
+
+void dataflashEraseStart(uint32_t address)
+{
+	uint32_t pageSize = dataflashPageSize();
+	dataflashPageErase(dataflashDeviceAddress(address - (address % pageSize), pageSize));
+}
+
+void dataflashErase(uint32_t address)
+{
+	dataflashEraseStart(address);
+	dataflashWaitOnReadyFor(DATAFLASH_TPE_US);
+}
 
-	SPI_DualExchange(4, txDataflashInternalBuffer, 4, NULL, 0, 0);
-	if(DISPLAY_OUTPUT)
+void dataflashOpenReadStream(SPI_Stream *stream, uint32_t address)
+{
+	uint32_t deviceAddress = dataflashDeviceAddress(address, dataflashPageSize());
+	load4BytesToTxBuffer(flashContext->txBuffer, CMD_DATAFLASH_ARRAY_READ_HF0, deviceAddress);
+	SPI_StreamOpen(stream, 1, 4, flashContext->txBuffer, 4, 1);
+	if(flashContext->displayOutput)
 	{
-		printSPIExchange(txDataflashInternalBuffer, 4, NULL, txNumBytes);
+		printSPIExchange(flashContext->txBuffer, 4, NULL, 0);
 	}
 }
-
-void dataflashDualInputBuffer2Write(uint32_t address, uint8_t *txBuffer, uint32_t txNumBytes)
+#if (PARTNO == AT45DQ161) || \
+	(PARTNO == AT45DQ321) || \
+	(ALL == 1)
+void dataflashDualOutputRead(uint32_t address, uint8_t *rxBuffer, uint32_t rxNumBytes)
 {
-	load4BytesToTxBuffer(txDataflashInternalBuffer, CMD_DATAFLASH_DUAL_INPUT_BUFFER2_WRITE, address);
-	for(uint32_t j = 0; j < txNumBytes; j++)
+	load4BytesToTxBuffer(flashContext->txBuffer, CMD_DATAFLASH_DUAL_OUTPUT_READ_ARRAY, address);
+	SPI_DualExchange(4, flashContext->txBuffer, 4, rxBuffer, rxNumBytes, 1);
+	if(flashContext->displayOutput)
 	{
-		txDataflashInternalBuffer[j+4] = txBuffer[j];
+		printSPIExchange(flashContext->txBuffer, 4, rxBuffer, rxNumBytes);
 	}
+}
 
-	SPI_DualExchange(4, txDataflashInternalBuffer, 4, NULL, 0, 0);
-	if(DISPLAY_OUTPUT)
+void dataflashQuadOutputRead(uint32_t address, uint8_t *rxBuffer, uint32_t rxNumBytes)
+{
+	load4BytesToTxBuffer(flashContext->txBuffer, CMD_DATAFLASH_QUAD_OUTPUT_READ_ARRAY, address);
+	SPI_QuadExchange(4, flashContext->txBuffer, 4, rxBuffer, rxNumBytes, 1);
+	if(flashContext->displayOutput)
 	{
-		printSPIExchange(txDataflashInternalBuffer, 4, NULL, txNumBytes);
+		printSPIExchange(flashContext->txBuffer, 4, rxBuffer, rxNumBytes);
 	}
 }
 
-void dataflashQuadInputBuffer1Write(uint32_t address, uint8_t *txBuffer, uint32_t txNumBytes)
+void dataflashDualInputBuffer1Write(uint32_t address, uint8_t *txBuffer, uint32_t txNumBytes)
 {
-	load4BytesToTxBuffer(txDataflashInternalBuffer, CMD_DATAFLASH_QUAD_INPUT_BUFFER1_WRITE, address);
-	for(uint32_t j = 0; j < txNumBytes; j++)
+	load4BytesToTxBuffer(flashContext->txBuffer, CMD_DATAFLASH_DUAL_INPUT_BUFFER1_WRITE, address);
+	SPI_GatherExchange(2, 4, flashContext->txBuffer, 4, txBuffer, txNumBytes);
+	if(flashContext->displayOutput)
 	{
-		txDataflashInternalBuffer[j+4] = txBuffer[j];
+		printSPIWrite(flashContext->txBuffer, 4, txBuffer, txNumBytes);
 	}
+}
 
-	SPI_QuadExchange(4, txDataflashInternalBuffer, 4, NULL, 0, 0);
-	if(DISPLAY_OUTPUT)
+void dataflashDualInputBuffer2Write(uint32_t address, uint8_t *txBuffer, uint32_t txNumBytes)
+{
+	load4BytesToTxBuffer(flashContext->txBuffer, CMD_DATAFLASH_DUAL_INPUT_BUFFER2_WRITE, address);
+	SPI_GatherExchange(2, 4, flashContext->txBuffer, 4, txBuffer, txNumBytes);
+	if(flashContext->displayOutput)
 	{
-		printSPIExchange(txDataflashInternalBuffer, 4, NULL, txNumBytes);
+		printSPIWrite(flashContext->txBuffer, 4, txBuffer, txNumBytes);
 	}
 }
 
-void dataflashQuadInputBuffer2Write(uint32_t address, uint8_t *txBuffer, uint32_t txNumBytes)
+void dataflashQuadInputBuffer1Write(uint32_t address, uint8_t *txBuffer, uint32_t txNumBytes)
 {
-	load4BytesToTxBuffer(txDataflashInternalBuffer, CMD_DATAFLASH_QUAD_INPUT_BUFFER2_WRITE, address);
-	for(uint32_t j = 0; j < txNumBytes; j++)
+	load4BytesToTxBuffer(flashContext->txBuffer, CMD_DATAFLASH_QUAD_INPUT_BUFFER1_WRITE, address);
+	SPI_GatherExchange(4, 4, flashContext->txBuffer, 4, txBuffer, txNumBytes);
+	if(flashContext->displayOutput)
 	{
-		txDataflashInternalBuffer[j+4] = txBuffer[j];
+		printSPIWrite(flashContext->txBuffer, 4, txBuffer, txNumBytes);
 	}
+}
 
-	SPI_QuadExchange(4, txDataflashInternalBuffer, 4, NULL, 0, 0);
-	if(DISPLAY_OUTPUT)
+void dataflashQuadInputBuffer2Write(uint32_t address, uint8_t *txBuffer, uint32_t txNumBytes)
+{
+	load4BytesToTxBuffer(flashContext->txBuffer, CMD_DATAFLASH_QUAD_INPUT_BUFFER2_WRITE, address);
+	SPI_GatherExchange(4, 4, flashContext->txBuffer, 4, txBuffer, txNumBytes);
+	if(flashContext->displayOutput)
 	{
-		printSPIExchange(txDataflashInternalBuffer, 4, NULL, txNumBytes);
+		printSPIWrite(flashContext->txBuffer, 4, txBuffer, txNumBytes);
 	}
 }
 
 void dataflashReadConfigRegister(uint8_t *rxBuffer)
 {
-	txDataflashInternalBuffer[0] = CMD_DATAFLASH_READ_CONFIG_REGISTER;
-	SPI_Exchange(txDataflashInternalBuffer, 1, rxBuffer, 1, 0);
-	if(DISPLAY_OUTPUT)
+	flashContext->txBuffer[0] = CMD_DATAFLASH_READ_CONFIG_REGISTER;
+	SPI_Exchange(flashContext->txBuffer, 1, rxBuffer, 1, 0);
+	if(flashContext->displayOutput)
 	{
-		printSPIExchange(txDataflashInternalBuffer, 1, rxBuffer, 1);
+		printSPIExchange(flashContext->txBuffer, 1, rxBuffer, 1);
 	}
 }
 
 void dataflashQuadEnable()
 {
-	txDataflashInternalBuffer[0] = CMD_DATAFLASH_QUAD_ENABLE >> 24;
-	txDataflashInternalBuffer[1] = (uint8_t) (CMD_DATAFLASH_QUAD_ENABLE >> 16);
-	txDataflashInternalBuffer[2] = (uint8_t) (CMD_DATAFLASH_QUAD_ENABLE >> 8);
-	txDataflashInternalBuffer[3] = (uint8_t) (CMD_DATAFLASH_QUAD_ENABLE);
-	SPI_Exchange(txDataflashInternalBuffer, 4, NULL, 0, 0);
-	if(DISPLAY_OUTPUT)
+	flashContext->txBuffer[0] = CMD_DATAFLASH_QUAD_ENABLE >> 24;
+	flashContext->txBuffer[1] = (uint8_t) (CMD_DATAFLASH_QUAD_ENABLE >> 16);
+	flashContext->txBuffer[2] = (uint8_t) (CMD_DATAFLASH_QUAD_ENABLE >> 8);
+	flashContext->txBuffer[3] = (uint8_t) (CMD_DATAFLASH_QUAD_ENABLE);
+	SPI_Exchange(flashContext->txBuffer, 4, NULL, 0, 0);
+	if(flashContext->displayOutput)
 	{
-		printSPIExchange(txDataflashInternalBuffer, 4, NULL, 0);
+		printSPIExchange(flashContext->txBuffer, 4, NULL, 0);
 	}
 }
 
 void dataflashQuadDisable()
 {
-	txDataflashInternalBuffer[0] = CMD_DATAFLASH_QUAD_DISABLE >> 24;
-	txDataflashInternalBuffer[1] = (uint8_t) (CMD_DATAFLASH_QUAD_DISABLE >> 16);
-	txDataflashInternalBuffer[2] = (uint8_t) (CMD_DATAFLASH_QUAD_DISABLE >> 8);
-	txDataflashInternalBuffer[3] = (uint8_t) (CMD_DATAFLASH_QUAD_DISABLE);
-	SPI_Exchange(txDataflashInternalBuffer, 4, NULL, 0, 0);
-	if(DISPLAY_OUTPUT)
+	flashContext->txBuffer[0] = CMD_DATAFLASH_QUAD_DISABLE >> 24;
+	flashContext->txBuffer[1] = (uint8_t) (CMD_DATAFLASH_QUAD_DISABLE >> 16);
+	flashContext->txBuffer[2] = (uint8_t) (CMD_DATAFLASH_QUAD_DISABLE >> 8);
+	flashContext->txBuffer[3] = (uint8_t) (CMD_DATAFLASH_QUAD_DISABLE);
+	SPI_Exchange(flashContext->txBuffer, 4, NULL, 0, 0);
+	if(flashContext->displayOutput)
 	{
-		printSPIExchange(txDataflashInternalBuffer, 4, NULL, 0);
+		printSPIExchange(flashContext->txBuffer, 4, NULL, 0);
 	}
 }
 
@@ -656,79 +699,73 @@ void dataflashQuadDisable()
 	(ALL == 1)
 void dataflashProgramEraseSuspend()
 {
-	txDataflashInternalBuffer[3] = CMD_DATAFLASH_PROGRAM_ERASE_SUSPEND;
-	SPI_Exchange(txDataflashInternalBuffer, 1, NULL, 0, 0);
-	if(DISPLAY_OUTPUT)
+	flashContext->txBuffer[0] = CMD_DATAFLASH_PROGRAM_ERASE_SUSPEND;
+	SPI_Exchange(flashContext->txBuffer, 1, NULL, 0, 0);
+	if(flashContext->displayOutput)
 	{
-		printSPIExchange(txDataflashInternalBuffer, 1, NULL, 0);
+		printSPIExchange(flashContext->txBuffer, 1, NULL, 0);
 	}
 }
 
 void dataflashProgramEraseResume()
 {
-	txDataflashInternalBuffer[3] = CMD_DATAFLASH_PROGRAM_ERASE_RESUME;
-	SPI_Exchange(txDataflashInternalBuffer, 1, NULL, 0, 0);
-	if(DISPLAY_OUTPUT)
+	flashContext->txBuffer[0] = CMD_DATAFLASH_PROGRAM_ERASE_RESUME;
+	SPI_Exchange(flashContext->txBuffer, 1, NULL, 0, 0);
+	if(flashContext->displayOutput)
 	{
-		printSPIExchange(txDataflashInternalBuffer, 1, NULL, 0);
+		printSPIExchange(flashContext->txBuffer, 1, NULL, 0);
 	}
 }
 
 void dataflashSectorLockdown(uint32_t address)
 {
-	txDataflashInternalBuffer[0] = CMD_DATAFLASH_SECTOR_LOCKDOWN >> 24;
-	txDataflashInternalBuffer[1] = (uint8_t) (CMD_DATAFLASH_SECTOR_LOCKDOWN >> 16);
-	txDataflashInternalBuffer[2] = (uint8_t) (CMD_DATAFLASH_SECTOR_LOCKDOWN >> 8);
-	txDataflashInternalBuffer[3] = (uint8_t) (CMD_DATAFLASH_SECTOR_LOCKDOWN);
-	txDataflashInternalBuffer[4] = address >> 16;
-	txDataflashInternalBuffer[5] = address >> 8;
-	txDataflashInternalBuffer[6] = address;
-	SPI_Exchange(txDataflashInternalBuffer, 4, NULL, 0, 0);
-	if(DISPLAY_OUTPUT)
+	flashContext->txBuffer[0] = CMD_DATAFLASH_SECTOR_LOCKDOWN >> 24;
+	flashContext->txBuffer[1] = (uint8_t) (CMD_DATAFLASH_SECTOR_LOCKDOWN >> 16);
+	flashContext->txBuffer[2] = (uint8_t) (CMD_DATAFLASH_SECTOR_LOCKDOWN >> 8);
+	flashContext->txBuffer[3] = (uint8_t) (CMD_DATAFLASH_SECTOR_LOCKDOWN);
+	flashContext->txBuffer[4] = address >> 16;
+	flashContext->txBuffer[5] = address >> 8;
+	flashContext->txBuffer[6] = address;
+	SPI_Exchange(flashContext->txBuffer, 4, NULL, 0, 0);
+	if(flashContext->displayOutput)
 	{
-		printSPIExchange(txDataflashInternalBuffer, 4, NULL, 0);
+		printSPIExchange(flashContext->txBuffer, 4, NULL, 0);
 	}
 }
 
 void dataflashReadSectorLockdownReg(uint8_t *rxBuffer, uint32_t rxNumBytes)
 {
-	txDataflashInternalBuffer[0] = CMD_DATAFLASH_READ_SECT_LOCK_REG;
-	SPI_Exchange(txDataflashInternalBuffer, 1, rxBuffer, rxNumBytes, 3);
-	if(DISPLAY_OUTPUT)
+	flashContext->txBuffer[0] = CMD_DATAFLASH_READ_SECT_LOCK_REG;
+	SPI_Exchange(flashContext->txBuffer, 1, rxBuffer, rxNumBytes, 3);
+	if(flashContext->displayOutput)
 	{
-		printSPIExchange(txDataflashInternalBuffer, 1, rxBuffer, rxNumBytes);
+		printSPIExchange(flashContext->txBuffer, 1, rxBuffer, rxNumBytes);
 	}
 }
 
 void dataflashFreezeSectorLockdown()
 {
-	txDataflashInternalBuffer[0] = CMD_DATAFLASH_FREEZE_SECTOR_LOCKDOWN >> 24;
-	txDataflashInternalBuffer[1] = (uint8_t) (CMD_DATAFLASH_FREEZE_SECTOR_LOCKDOWN >> 16);
-	txDataflashInternalBuffer[2] = (uint8_t) (CMD_DATAFLASH_FREEZE_SECTOR_LOCKDOWN >> 8);
-	txDataflashInternalBuffer[3] = (uint8_t) (CMD_DATAFLASH_FREEZE_SECTOR_LOCKDOWN);
-	SPI_Exchange(txDataflashInternalBuffer, 4, NULL, 0, 0);
-	if(DISPLAY_OUTPUT)
+	flashContext->txBuffer[0] = CMD_DATAFLASH_FREEZE_SECTOR_LOCKDOWN >> 24;
+	flashContext->txBuffer[1] = (uint8_t) (CMD_DATAFLASH_FREEZE_SECTOR_LOCKDOWN >> 16);
+	flashContext->txBuffer[2] = (uint8_t) (CMD_DATAFLASH_FREEZE_SECTOR_LOCKDOWN >> 8);
+	flashContext->txBuffer[3] = (uint8_t) (CMD_DATAFLASH_FREEZE_SECTOR_LOCKDOWN);
+	SPI_Exchange(flashContext->txBuffer, 4, NULL, 0, 0);
+	if(flashContext->displayOutput)
 	{
-		printSPIExchange(txDataflashInternalBuffer, 4, NULL, 0);
+		printSPIExchange(flashContext->txBuffer, 4, NULL, 0);
 	}
 }
 
 void dataflashProgSecurityReg(uint8_t *txBuffer, uint32_t txNumBytes)
 {
-	txDataflashInternalBuffer[0] = CMD_DATAFLASH_PROGRAM_SECURITY_REG >> 24;
-	txDataflashInternalBuffer[1] = (uint8_t) (CMD_DATAFLASH_PROGRAM_SECURITY_REG >> 16);
-	txDataflashInternalBuffer[2] = (uint8_t) (CMD_DATAFLASH_PROGRAM_SECURITY_REG >> 8);
-	txDataflashInternalBuffer[3] = (uint8_t) (CMD_DATAFLASH_PROGRAM_SECURITY_REG);
-	uint32_t totalBytes = txNumBytes + 4;
-
-	for(uint32_t j = 0; j < txNumBytes; j++)
+	flashContext->txBuffer[0] = CMD_DATAFLASH_PROGRAM_SECURITY_REG >> 24;
+	flashContext->txBuffer[1] = (uint8_t) (CMD_DATAFLASH_PROGRAM_SECURITY_REG >> 16);
+	flashContext->txBuffer[2] = (uint8_t) (CMD_DATAFLASH_PROGRAM_SECURITY_REG >> 8);
+	flashContext->txBuffer[3] = (uint8_t) (CMD_DATAFLASH_PROGRAM_SECURITY_REG);
+	SPI_GatherExchange(1, 4, flashContext->txBuffer, 4, txBuffer, txNumBytes);
+	if(flashContext->displayOutput)
 	{
-		txDataflashInternalBuffer[j+4] = txBuffer[j];
-	}
-	SPI_Exchange(txDataflashInternalBuffer, totalBytes, NULL, 0, 0);
-	if(DISPLAY_OUTPUT)
-	{
-		printSPIExchange(txDataflashInternalBuffer, totalBytes, NULL, 0);
+		printSPIWrite(flashContext->txBuffer, 4, txBuffer, txNumBytes);
 	}
 }
 #endif
@@ -746,132 +783,111 @@ void dataflashProgSecurityReg(uint8_t *txBuffer, uint32_t txNumBytes)
 	(ALL == 1)
 void dataflashBuffer2ReadLowFreq(uint32_t address, uint8_t *rxBuffer, uint32_t rxNumBytes)
 {
-	load4BytesToTxBuffer(txDataflashInternalBuffer, CMD_DATAFLASH_BUFFER2_READ_LF, address);
-	SPI_Exchange(txDataflashInternalBuffer, 4, rxBuffer, rxNumBytes, 0);
-	if(DISPLAY_OUTPUT)
+	load4BytesToTxBuffer(flashContext->txBuffer, CMD_DATAFLASH_BUFFER2_READ_LF, address);
+	SPI_Exchange(flashContext->txBuffer, 4, rxBuffer, rxNumBytes, 0);
+	if(flashContext->displayOutput)
 	{
-		printSPIExchange(txDataflashInternalBuffer, 4, rxBuffer, rxNumBytes);
+		printSPIExchange(flashContext->txBuffer, 4, rxBuffer, rxNumBytes);
 	}
 }
 
 void dataflashBuffer2ReadHighFreq(uint32_t address, uint8_t *rxBuffer, uint32_t rxNumBytes)
 {
-	load4BytesToTxBuffer(txDataflashInternalBuffer, CMD_DATAFLASH_BUFFER2_READ_HF, address);
-	SPI_Exchange(txDataflashInternalBuffer, 4, rxBuffer, rxNumBytes, 1);
-	if(DISPLAY_OUTPUT)
+	load4BytesToTxBuffer(flashContext->txBuffer, CMD_DATAFLASH_BUFFER2_READ_HF, address);
+	SPI_Exchange(flashContext->txBuffer, 4, rxBuffer, rxNumBytes, 1);
+	if(flashContext->displayOutput)
 	{
-		printSPIExchange(txDataflashInternalBuffer, 4, rxBuffer, rxNumBytes);
+		printSPIExchange(flashContext->txBuffer, 4, rxBuffer, rxNumBytes);
 	}
 }
 
 void dataflashBuffer2Write(uint32_t address, uint8_t *txBuffer, uint32_t txNumBytes)
 {
-	load4BytesToTxBuffer(txDataflashInternalBuffer, CMD_DATAFLASH_BUFFER2_WRITE, address);
-	// Offset the data bytes by 4; opcode+address takes up the first 4 bytes of a transmission.
-	uint32_t totalBytes = txNumBytes + 4;
-
-	for(uint32_t j = 0; j < txNumBytes; j++)
+	load4BytesToTxBuffer(flashContext->txBuffer, CMD_DATAFLASH_BUFFER2_WRITE, address);
+	SPI_GatherExchange(1, 4, flashContext->txBuffer, 4, txBuffer, txNumBytes);
+	if(flashContext->displayOutput)
 	{
-		txDataflashInternalBuffer[j+4] = txBuffer[j];
-	}
-	SPI_Exchange(txDataflashInternalBuffer, totalBytes, NULL, 0, 0);
-	if(DISPLAY_OUTPUT)
-	{
-		printSPIExchange(txDataflashInternalBuffer, totalBytes, NULL, 0);
+		printSPIWrite(flashContext->txBuffer, 4, txBuffer, txNumBytes);
 	}
 }
 
 void dataflashBuffer2ToMainMemoryWithErase(uint32_t address)
 {
-	load4BytesToTxBuffer(txDataflashInternalBuffer, CMD_DATAFLASH_BUF2_2MEM_W_ERASE, address);
-	SPI_Exchange(txDataflashInternalBuffer, 4, NULL, 0, 0);
-	if(DISPLAY_OUTPUT)
+	load4BytesToTxBuffer(flashContext->txBuffer, CMD_DATAFLASH_BUF2_2MEM_W_ERASE, address);
+	SPI_Exchange(flashContext->txBuffer, 4, NULL, 0, 0);
+	if(flashContext->displayOutput)
 	{
-		printSPIExchange(txDataflashInternalBuffer, 4, NULL, 0);
+		printSPIExchange(flashContext->txBuffer, 4, NULL, 0);
 	}
 }
 
 void dataflashBuffer2ToMainMemoryWithoutErase(uint32_t address)
 {
-	load4BytesToTxBuffer(txDataflashInternalBuffer, CMD_DATAFLASH_BUF2_2MEM_WO_ERASE, address);
-	SPI_Exchange(txDataflashInternalBuffer, 4, NULL, 0, 0);
-	if(DISPLAY_OUTPUT)
+	load4BytesToTxBuffer(flashContext->txBuffer, CMD_DATAFLASH_BUF2_2MEM_WO_ERASE, address);
+	SPI_Exchange(flashContext->txBuffer, 4, NULL, 0, 0);
+	if(flashContext->displayOutput)
 	{
-		printSPIExchange(txDataflashInternalBuffer, 4, NULL, 0);
+		printSPIExchange(flashContext->txBuffer, 4, NULL, 0);
 	}
 }
 
 void dataflashMemoryProgramThruBuffer2WithErase(uint32_t address, uint8_t *txBuffer, uint32_t txNumBytes)
 {
-	load4BytesToTxBuffer(txDataflashInternalBuffer, CMD_DATAFLASH_MEM_PRGM_BUF2_W_ERASE, address);
-	// Offset the data bytes by 4; opcode+address takes up the first 4 bytes of a transmission.
-	uint32_t totalBytes = txNumBytes + 4;
-
-	for(uint32_t j = 0; j < txNumBytes; j++)
+	load4BytesToTxBuffer(flashContext->txBuffer, CMD_DATAFLASH_MEM_PRGM_BUF2_W_ERASE, address);
+	SPI_GatherExchange(1, 4, flashContext->txBuffer, 4, txBuffer, txNumBytes);
+	if(flashContext->displayOutput)
 	{
-		txDataflashInternalBuffer[j+4] = txBuffer[j];
-	}
-	SPI_Exchange(txDataflashInternalBuffer, totalBytes, NULL, 0, 0);
-	if(DISPLAY_OUTPUT)
-	{
-		printSPIExchange(txDataflashInternalBuffer, totalBytes, NULL, 0);
+		printSPIWrite(flashContext->txBuffer, 4, txBuffer, txNumBytes);
 	}
 }
 
 void dataflashRMWThruBuffer2(uint32_t address, uint8_t *txBuffer, uint32_t txNumBytes)
 {
-	load4BytesToTxBuffer(txDataflashInternalBuffer, CMD_DATAFLASH_RD_MOD_WR_THRU_BUF2, address);
-	// Offset the data bytes by 4; opcode+address takes up the first 4 bytes of a transmission.
-	uint32_t totalBytes = txNumBytes + 4;
-
-	for(uint32_t j = 0; j < txNumBytes; j++)
-	{
-		txDataflashInternalBuffer[j+4] = txBuffer[j];
-	}
-	SPI_Exchange(txDataflashInternalBuffer, totalBytes, NULL, 0, 0);
-	if(DISPLAY_OUTPUT)
+	load4BytesToTxBuffer(flashContext->txBuffer, CMD_DATAFLASH_RD_MOD_WR_THRU_BUF2, address);
+	SPI_GatherExchange(1, 4, flashContext->txBuffer, 4, txBuffer, txNumBytes);
+	if(flashContext->displayOutput)
 	{
-		printSPIExchange(txDataflashInternalBuffer, totalBytes, NULL, 0);
+		printSPIWrite(flashContext->txBuffer, 4, txBuffer, txNumBytes);
 	}
 }
 
 void dataflashMemtoBuffer2Transfer(uint32_t address)
 {
-	load4BytesToTxBuffer(txDataflashInternalBuffer, CMD_DATAFLASH_MEM_BUF2_TRANSFER, address);
-	SPI_Exchange(txDataflashInternalBuffer, 4, NULL, 0, 0);
-	if(DISPLAY_OUTPUT)
+	load4BytesToTxBuffer(flashContext->txBuffer, CMD_DATAFLASH_MEM_BUF2_TRANSFER, address);
+	SPI_Exchange(flashContext->txBuffer, 4, NULL, 0, 0);
+	if(flashContext->displayOutput)
 	{
-		printSPIExchange(txDataflashInternalBuffer, 4, NULL, 0);
+		printSPIExchange(flashContext->txBuffer, 4, NULL, 0);
 	}
 }
 
 void dataflashMemtoBuffer2Compare(uint32_t address)
 {
-	load4BytesToTxBuffer(txDataflashInternalBuffer, CMD_DATAFLASH_MEM_BUF2_COMPARE, address);
-	SPI_Exchange(txDataflashInternalBuffer, 4, NULL, 0, 0);
-	if(DISPLAY_OUTPUT)
+	load4BytesToTxBuffer(flashContext->txBuffer, CMD_DATAFLASH_MEM_BUF2_COMPARE, address);
+	SPI_Exchange(flashContext->txBuffer, 4, NULL, 0, 0);
+	if(flashContext->displayOutput)
 	{
-		printSPIExchange(txDataflashInternalBuffer, 4, NULL, 0);
+		printSPIExchange(flashContext->txBuffer, 4, NULL, 0);
 	}
 }
 
 void dataflashAutoPageRewrite2(uint32_t address)
 {
-	load4BytesToTxBuffer(txDataflashInternalBuffer, CMD_DATAFLASH_AUTO_PAGE_REWRITE2, address);
-	SPI_Exchange(txDataflashInternalBuffer, 4, NULL, 0, 0);
-	if(DISPLAY_OUTPUT)
+	load4BytesToTxBuffer(flashContext->txBuffer, CMD_DATAFLASH_AUTO_PAGE_REWRITE2, address);
+	SPI_Exchange(flashContext->txBuffer, 4, NULL, 0, 0);
+	if(flashContext->displayOutput)
 	{
-		printSPIExchange(txDataflashInternalBuffer, 4, NULL, 0);
+		printSPIExchange(flashContext->txBuffer, 4, NULL, 0);
 	}
 }
 
 void dataflashBuffer2ReadLegacy(uint8_t address, uint8_t *rxBuffer, uint32_t rxNumBytes)
 {
-	load4BytesToTxBuffer(txDataflashInternalBuffer, CMD_DATAFLASH_BUF2_READ_LEG, address);
-	SPI_Exchange(txDataflashInternalBuffer, 4, rxBuffer, rxNumBytes, 0);
-	if(DISPLAY_OUTPUT)
+	load4BytesToTxBuffer(flashContext->txBuffer, CMD_DATAFLASH_BUF2_READ_LEG, address);
+	SPI_Exchange(flashContext->txBuffer, 4, rxBuffer, rxNumBytes, 0);
+	if(flashContext->displayOutput)
 	{
-		printSPIExchange(txDataflashInternalBuffer, 4, rxBuffer, rxNumBytes);
+		printSPIExchange(flashContext->txBuffer, 4, rxBuffer, rxNumBytes);
 	}
 }
 #endif
@@ -62,8 +62,6 @@
 	(PARTNO == AT25PE16)   || \
 	(ALL == 1)
 
-extern uint8_t txDataflashInternalBuffer[MAXIMUM_TX_BYTES];
-
 /******************************************
  *
  *
@@ -73,11 +71,33 @@ extern uint8_t txDataflashInternalBuffer[MAXIMUM_TX_BYTES];
  ******************************************/
 /*!
  * @brief: Wait while Read/Busy Status bit in SRB is 1 (device is busy).
+ * Same as dataflashWaitOnReadyFor(0): the first sample is taken right away, for
+ * use when the duration of the last command is not known.
  *
  * @retval void
  */
 void dataflashWaitOnReady();
 
+/*!
+ * @brief: Wait while Read/Busy Status bit in SRB is 1 (device is busy). The
+ * status register is output continuously while CSb is held low (SPI_WaitReady()),
+ * so the opcode is sent once for the whole wait.
+ *
+ * @param expectedUs Typical duration of the operation being waited on, for
+ * example @ref DATAFLASH_TPE_US after a page erase.
+ *
+ * @retval void
+ */
+void dataflashWaitOnReadyFor(uint32_t expectedUs);
+
+/*!
+ * @brief Returns the inverted RDY/BUSY bit of status register byte 1 without waiting.
+ *
+ * @retval 1 The device is busy with a program or erase.
+ * @retval 0 The device is ready.
+ */
+uint8_t dataflashIsBusy();
+
 /*!
  * @brief OPCODE: 0x9F <br>
  * Reads the manufacturer ID and stores the data in rxBuffer.
@@ -580,6 +600,107 @@ void dataflashContinuousArrayReadLegacy(uint8_t address, uint8_t *rxBuffer, uint
  * @retval void
  */
 void dataflashReadSRLegacy(uint8_t *rxBuffer);
+
+/*!
+ * @brief Returns the page size the device is currently configured for, read
+ * from bit 0 of status register byte 1.
+ *
+ * @retval uint32_t @ref DATAFLASH_PAGE_SIZE_P2 or @ref DATAFLASH_PAGE_SIZE_STD.
+ */
+uint32_t dataflashGetPageSize();
+
+/*!
+ * @brief Converts the linear byte address 'address', where page n starts at
+ * n * pageSize, to the page and byte address taken by the array, buffer to
+ * main memory and erase commands.
+ *
+ * @param address Linear byte address.
+ * @param pageSize The page size the device is configured for (see dataflashGetPageSize()).
+ *
+ * @retval uint32_t The device address.
+ */
+uint32_t dataflashDeviceAddress(uint32_t address, uint32_t pageSize);
+
+/*!
+ * @brief Programs 'txNumBytes' bytes of any length starting at the linear
+ * byte address 'address', where page n starts at n * dataflashGetPageSize().
+ * The data is split on page boundaries. Whole pages are written with
+ * dataflashMemoryProgramThruBuffer1WithErase(), partial pages with
+ * dataflashRMWThruBuffer1() so the rest of the page is kept, and
+ * dataflashWaitOnReady() is called after each page. No prior erase is needed.
+ *
+ * @param address Linear byte address of the first location to be written to.
+ * @param txBuffer Pointer to the tx bytes that will be stored in memory. Must
+ * have a minimum of txNumBytes elements.
+ * @param txNumBytes Number of bytes to be written to the device.
+ *
+ * @retval void
+ *
+ * @warning Buffer 1 is overwritten.
+ */
+void dataflashProgram(uint32_t address, uint8_t *txBuffer, uint32_t txNumBytes);
+
+/*!
+ * @brief Reads 'rxNumBytes' bytes of any length starting at the linear byte
+ * address 'address' in a single continuous read (dataflashArrayReadHighFreq0()).
+ *
+ * @param address Linear byte address starting from which the data in memory will be read.
+ * @param rxBuffer Pointer to the byte array in which the read data will be stored.
+ * Must have at least rxNumBytes elements.
+ * @param rxNumBytes Number of bytes to be read from the memory.
+ *
+ * @retval void
+ */
+void dataflashRead(uint32_t address, uint8_t *rxBuffer, uint32_t rxNumBytes);
+
+/*!
+ * @brief OPCODE: 0x0B <br>
+ * Opens a read stream starting at the linear byte address 'address' (see
+ * dataflashProgram()). The data is then read in any number of pieces with
+ * SPI_StreamRead() while CSb stays low, continuing across page boundaries,
+ * and the read ends with SPI_StreamClose().
+ *
+ * @param stream The stream to open.
+ * @param address Linear byte address starting from which the data in memory will be read.
+ *
+ * @retval void
+ */
+void dataflashOpenReadStream(SPI_Stream *stream, uint32_t address);
+
+/*!
+ * @brief Erases the page containing the linear byte address 'address' (see
+ * dataflashProgram()) with dataflashPageErase(), then calls dataflashWaitOnReady().
+ *
+ * @param address Any linear byte address inside the page to be erased.
+ *
+ * @retval void
+ */
+void dataflashErase(uint32_t address);
+
+/*!
+ * @brief Starts writing 'txNumBytes' bytes within one page at the linear
+ * byte address 'address', as dataflashProgram() does for each page, without
+ * waiting for the program to complete (see dataflashIsBusy()).
+ *
+ * @param address Linear byte address of the first location to be written to.
+ * @param txBuffer Pointer to the tx bytes that will be stored in memory.
+ * @param txNumBytes Number of bytes to be written. Must not cross a page boundary.
+ *
+ * @retval void
+ *
+ * @warning Buffer 1 is overwritten.
+ */
+void dataflashProgramPageStart(uint32_t address, uint8_t *txBuffer, uint32_t txNumBytes);
+
+/*!
+ * @brief Starts erasing the page containing the linear byte address 'address',
+ * without waiting for the erase to complete (see dataflashIsBusy()).
+ *
+ * @param address Any linear byte address inside the page to be erased.
+ *
+ * @retval void
+ */
+void dataflashEraseStart(uint32_t address);
 #if (PARTNO == AT45DQ161) || \
 	(PARTNO == AT45DQ321) || \
 	(ALL == 1)
@@ -0,0 +1,76 @@
+/*
+ * The Clear BSD License
+ * Copyright (c) 2018 Adesto Technologies Corporation, Inc
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted (subject to the limitations in the disclaimer below) provided
+ *  that the following conditions are met:
+ *
+ * o Redistributions of source code must retain the above copyright notice, this list
+ *   of conditions and the following disclaimer.
+ *
+ * o Redistributions in binary form must reproduce the above copyright notice, this
+ *   list of conditions and the following disclaimer in the documentation and/or
+ *   other materials provided with the distribution.
+ *
+ * o Neither the name of the copyright holder nor the names of its
+ *   contributors may be used to endorse or promote products derived from this
+ *   software without specific prior written permission.
+ *
+ * NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE GRANTED BY THIS LICENSE.
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*!
+ * @ingroup ADESTO_LAYER
+ */
+/**
+ * @file    flash_context.c
+ * @brief   Definition of the per-device driver state.
+ */
+#include "flash_context.h"
+#include <string.h>
+
+static FLASH_Context defaultContext = {.name = "default"};
+
+FLASH_Context *flashContext = &defaultContext;
+
+void flashContextInit(FLASH_Context *context, const char *name, const SPI_Transport *transport, const FLASH_Part *part)
+{
+	memset(context, 0, sizeof(*context));
+	context->name = name;
+	context->transport = transport;
+	context->part = part;
+}
+
+void flashContextSelect(FLASH_Context *context)
+{
+	if(context == NULL)
+	{
+		context = &defaultContext;
+	}
+	if(context == flashContext)
+	{
+		return;
+	}
+	flashContext = context;
+	if((context->transport != NULL) && (context->transport != SPI_GetTransport()))
+	{
+		SPI_SetTransport(context->transport);
+	}
+}
+
+const FLASH_Part *flashContextPart()
+{
+	return (flashContext->part != NULL) ? flashContext->part : FLASH_PART;
+}
@@ -0,0 +1,140 @@
+/*
+ * The Clear BSD License
+ * Copyright (c) 2018 Adesto Technologies Corporation, Inc
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted (subject to the limitations in the disclaimer below) provided
+ *  that the following conditions are met:
+ *
+ * o Redistributions of source code must retain the above copyright notice, this list
+ *   of conditions and the following disclaimer.
+ *
+ * o Redistributions in binary form must reproduce the above copyright notice, this
+ *   list of conditions and the following disclaimer in the documentation and/or
+ *   other materials provided with the distribution.
+ *
+ * o Neither the name of the copyright holder nor the names of its
+ *   contributors may be used to endorse or promote products derived from this
+ *   software without specific prior written permission.
+ *
+ * NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE GRANTED BY THIS LICENSE.
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*!
+ * @ingroup ADESTO_LAYER
+ */
+/**
+ * @file    flash_context.h
+ * @brief   Declarations of the per-device driver state.
+ *
+ * A FLASH_Context holds everything the family drivers keep between
+ * commands for one flash chip: the transport that reaches it (and with it
+ * the chip select, see SPI_BitBangOpen()), its part descriptor, the SPI/QPI
+ * mode of standard flash parts, the debug output flag, the command scratch
+ * buffer and usage counters. The drivers work on the selected context, in
+ * the same way the SPI layer works on the selected transport, so boards
+ * with several chips give each chip a context and call flashContextSelect()
+ * (or go through the FLASH_Device functions, which do so) before talking to
+ * it. Commands to different chips can then be interleaved freely.
+ *
+ * Until a context is selected the drivers use a default one that keeps the
+ * active transport and the part selected with PARTNO, so single chip code
+ * needs no change.
+ */
+#ifndef FLASH_CONTEXT_H_
+#define FLASH_CONTEXT_H_
+
+#include "flash_parts.h"
+#include "spi_transport.h"
+
+/*!
+ * @brief Usage counters of one chip, maintained by the FLASH_Device functions.
+ */
+typedef struct
+{
+	//! Number of reads.
+	uint32_t reads;
+	//! Bytes read.
+	uint64_t readBytes;
+	//! Number of programs, whole or started page by page.
+	uint32_t programs;
+	//! Bytes programmed.
+	uint64_t programBytes;
+	//! Number of erases.
+	uint32_t erases;
+	//! Number of suspensions of a program or erase.
+	uint32_t suspends;
+} FLASH_ContextStats;
+
+/*!
+ * @brief The driver state of one chip.
+ */
+typedef struct
+{
+	//! Name of the chip, for messages.
+	const char *name;
+	//! Transport reaching the chip, NULL to keep the active one.
+	const SPI_Transport *transport;
+	//! Descriptor of the part, NULL for the part selected with PARTNO.
+	const FLASH_Part *part;
+	//! Standard flash: 0 in SPI mode, 1 in QPI mode (see standardflashEnableQPI()).
+	uint8_t spiMode;
+	//! DataFlash: page size the device is configured for, 0 until the drivers
+	//! next read it from the status register.
+	uint32_t pageSize;
+	//! 1 to print every command sent by the drivers.
+	uint8_t displayOutput;
+	//! Scratch buffer the drivers build command headers in.
+	uint8_t txBuffer[MAXIMUM_HEADER_BYTES];
+	//! Usage counters.
+	FLASH_ContextStats stats;
+} FLASH_Context;
+
+/*!
+ * @brief The context the drivers work on. Never NULL.
+ */
+extern FLASH_Context *flashContext;
+
+/*!
+ * @brief Prepares a context for a chip.
+ *
+ * @param context The context.
+ * @param name Name of the chip, for messages.
+ * @param transport Transport reaching the chip, NULL to keep the active one.
+ * @param part Descriptor of the part, NULL for the part selected with PARTNO.
+ *
+ * @retval void
+ */
+void flashContextInit(FLASH_Context *context, const char *name, const SPI_Transport *transport, const FLASH_Part *part);
+
+/*!
+ * @brief Makes the drivers work on a chip. Its transport, if any, is made
+ * the active one with SPI_SetTransport().
+ *
+ * @param context The context, NULL for the default one.
+ *
+ * @retval void
+ *
+ * @warning Not allowed while a read stream is open (see SPI_StreamOpen()).
+ */
+void flashContextSelect(FLASH_Context *context);
+
+/*!
+ * @brief Returns the descriptor of the part behind the selected context.
+ *
+ * @retval const FLASH_Part* The descriptor.
+ */
+const FLASH_Part *flashContextPart();
+
+#endif /* FLASH_CONTEXT_H_ */
@@ -0,0 +1,559 @@
+/*
+ * The Clear BSD License
+ * Copyright (c) 2018 Adesto Technologies Corporation, Inc
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted (subject to the limitations in the disclaimer below) provided
+ *  that the following conditions are met:
+ *
+ * o Redistributions of source code must retain the above copyright notice, this list
+ *   of conditions and the following disclaimer.
+ *
+ * o Redistributions in binary form must reproduce the above copyright notice, this
+ *   list of conditions and the following disclaimer in the documentation and/or
+ *   other materials provided with the distribution.
+ *
+ * o Neither the name of the copyright holder nor the names of its
+ *   contributors may be used to endorse or promote products derived from this
+ *   software without specific prior written permission.
+ *
+ * NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE GRANTED BY THIS LICENSE.
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*!
+ * @ingroup ADESTO_LAYER
+ */
+/**
+ * @file    flash_detect.c
+ * @brief   Definition of the run time part detection.
+ */
+#include "flash_detect.h"
+#include "flash_context.h"
+#include <stdio.h>
+
+// JEDEC commands understood by every part that has them.
+#define DETECT_READ_MID			0x9F
+#define DETECT_READ_SFDP		0x5A
+#define DETECT_WRITE_ENABLE		0x06
+#define DETECT_WRITE_SR			0x01
+#define DETECT_WRITE_SR2		0x31
+#define DETECT_READ_SR1			0x05
+#define DETECT_READ_SR2			0x35
+#define DETECT_ENTER_4BYTE		0xB7
+#define DETECT_DATAFLASH_READ_SR	0xD7
+
+// "SFDP", little endian.
+#define SFDP_SIGNATURE			0x50444653U
+// Basic Flash Parameter Table, DWORDs parsed.
+#define SFDP_BASIC_DWORDS		16U
+// Parameter headers looked at for the basic table.
+#define SFDP_MAX_HEADERS		8U
+// Status register write time allowed when setting QE.
+#define DETECT_TW_US			5000U
+
+// Status poll used before the part is known.
+static const SPI_ReadyPoll detectReadyPoll =
+{
+	.header = {DETECT_READ_SR1},
+	.headerNumBytes = 1,
+	.ioLines = 1,
+	.numBytes = 1,
+	.byteIndex = 0,
+	.busyMask = 1,
+	.busyValue = 1
+};
+
+static uint32_t loadLE32(const uint8_t *bytes)
+{
+	return (uint32_t) bytes[0] | ((uint32_t) bytes[1] << 8) |
+		   ((uint32_t) bytes[2] << 16) | ((uint32_t) bytes[3] << 24);
+}
+
+static void setReadMethod(FLASH_ReadMethod *method, enum flashReadMode mode, uint8_t opcode,
+						  uint8_t modeNumBytes, uint8_t dummyNumBytes)
+{
+	static const uint8_t addressLines[] = {1, 1, 1, 2, 1, 4};
+	static const uint8_t dataLines[] = {1, 1, 2, 2, 4, 4};
+	method->mode = mode;
+	method->opcode = opcode;
+	method->addressLines = addressLines[mode];
+	method->dataLines = dataLines[mode];
+	method->modeNumBytes = modeNumBytes;
+	method->dummyNumBytes = dummyNumBytes;
+}
+
+/*
+ * Converts the mode and dummy clock counts of an SFDP read entry into the
+ * bytes sent by the SPI layer; returns 0 if they cannot be sent as whole bytes.
+ */
+static uint8_t sfdpReadMethod(FLASH_ReadMethod *method, enum flashReadMode mode, uint32_t entry)
+{
+	uint32_t dummyClocks = entry & 0x1F;
+	uint32_t modeClocks = (entry >> 5) & 0x7;
+	uint8_t opcode = (uint8_t) (entry >> 8);
+	uint32_t modeBits;
+	uint32_t dummyBits;
+
+	setReadMethod(method, mode, opcode, 0, 0);
+	modeBits = modeClocks * method->addressLines;
+	dummyBits = dummyClocks * ((method->addressLines == 4) ? 4 : 1);
+	if((opcode == 0) || (modeBits % 8) || (dummyBits % 8))
+	{
+		return 0;
+	}
+	method->modeNumBytes = (uint8_t) (modeBits / 8);
+	method->dummyNumBytes = (uint8_t) (dummyBits / 8);
+	return 1;
+}
+
+static void sortErases(FLASH_PartErase *erases)
+{
+	uint32_t i;
+	uint32_t j;
+	for(i = 1; i < FLASH_PART_ERASE_TYPES; i++)
+	{
+		for(j = i; (j > 0) && (erases[j].numBytes != 0) &&
+			((erases[j - 1].numBytes == 0) || (erases[j - 1].numBytes > erases[j].numBytes)); j--)
+		{
+			FLASH_PartErase swap = erases[j - 1];
+			erases[j - 1] = erases[j];
+			erases[j] = swap;
+		}
+	}
+}
+
+// Copies the erase times of the descriptor to the erases with the same opcode.
+static void eraseTimes(FLASH_Detected *detected)
+{
+	uint32_t i;
+	uint32_t j;
+	if(detected->part == NULL)
+	{
+		return;
+	}
+	for(i = 0; i < FLASH_PART_ERASE_TYPES; i++)
+	{
+		for(j = 0; j < FLASH_PART_ERASE_TYPES; j++)
+		{
+			if((detected->erases[i].numBytes != 0) &&
+			   (detected->part->erases[j].opcode == detected->erases[i].opcode))
+			{
+				detected->erases[i].time = detected->part->erases[j].time;
+			}
+		}
+	}
+}
+
+/*
+ * Parses the Basic Flash Parameter Table. Fills in the geometry and the
+ * fastest read the part offers within ioLines, and returns 1 if the table
+ * was found.
+ */
+static uint8_t parseSFDP(FLASH_Detected *detected, uint8_t ioLines)
+{
+	uint8_t header[8];
+	uint8_t table[SFDP_BASIC_DWORDS * 4];
+	uint32_t dwords[SFDP_BASIC_DWORDS];
+	uint32_t numHeaders;
+	uint32_t numDwords = 0;
+	uint32_t pointer = 0;
+	uint32_t i;
+	FLASH_ReadMethod method;
+
+	flashReadSFDP(0, header, 8);
+	if(loadLE32(header) != SFDP_SIGNATURE)
+	{
+		return 0;
+	}
+	numHeaders = (uint32_t) header[6] + 1;
+	if(numHeaders > SFDP_MAX_HEADERS)
+	{
+		numHeaders = SFDP_MAX_HEADERS;
+	}
+	for(i = 0; i < numHeaders; i++)
+	{
+		flashReadSFDP(8 + 8 * i, header, 8);
+		// JEDEC Basic Flash Parameter Table: ID 0xFF00, major revision 1.
+		if((header[0] == 0x00) && (header[7] == 0xFF) && (header[2] == 0x01) && (header[3] >= 9))
+		{
+			numDwords = (header[3] < SFDP_BASIC_DWORDS) ? header[3] : SFDP_BASIC_DWORDS;
+			pointer = (uint32_t) header[4] | ((uint32_t) header[5] << 8) | ((uint32_t) header[6] << 16);
+			break;
+		}
+	}
+	if(numDwords == 0)
+	{
+		return 0;
+	}
+	flashReadSFDP(pointer, table, numDwords * 4);
+	for(i = 0; i < SFDP_BASIC_DWORDS; i++)
+	{
+		dwords[i] = (i < numDwords) ? loadLE32(&table[4 * i]) : 0;
+	}
+
+	// DWORD 2: density in bits, as N - 1 or, with bit 31 set, as log2.
+	if(dwords[1] & 0x80000000U)
+	{
+		uint32_t log2Bits = dwords[1] & 0x7FFFFFFFU;
+		if(log2Bits < 3)
+		{
+			return 0;
+		}
+		detected->capacity = (log2Bits >= 35) ? 0xFFFFFFFFU : (1U << (log2Bits - 3));
+	}
+	else
+	{
+		detected->capacity = (uint32_t) (((uint64_t) dwords[1] + 1) >> 3);
+	}
+	if(detected->capacity == 0)
+	{
+		return 0;
+	}
+	// DWORD 1 bits 18:17: 0 for 3 byte, 1 for 3 or 4 byte, 2 for 4 byte addresses.
+	switch((dwords[0] >> 17) & 0x3)
+	{
+		case 1:
+			if(detected->capacity > 0x1000000U)
+			{
+				flashContext->txBuffer[0] = DETECT_ENTER_4BYTE;
+				SPI_Exchange(flashContext->txBuffer, 1, NULL, 0, 0);
+				detected->addressBytes = 4;
+			}
+			else
+			{
+				detected->addressBytes = 3;
+			}
+			break;
+		case 2:
+			detected->addressBytes = 4;
+			break;
+		default:
+			detected->addressBytes = 3;
+			break;
+	}
+	// DWORD 11 bits 7:4: log2 of the page size. Tables before JESD216 rev A
+	// stop at DWORD 9; bit 2 of DWORD 1 then gives 64 bytes or more.
+	detected->pageSize = (numDwords >= 11) ? (1U << ((dwords[10] >> 4) & 0xF)) :
+						 ((dwords[0] & 0x4) ? 256U : 1U);
+	// DWORDs 8 and 9: up to four erase types as log2 of the size and opcode.
+	for(i = 0; i < FLASH_PART_ERASE_TYPES; i++)
+	{
+		uint32_t type = (dwords[7 + i / 2] >> (16 * (i % 2))) & 0xFFFF;
+		uint8_t log2Size = (uint8_t) type;
+		detected->erases[i].opcode = (uint8_t) (type >> 8);
+		detected->erases[i].numBytes = ((log2Size != 0) && (log2Size < 32)) ? (1U << log2Size) : 0;
+		detected->erases[i].time.typicalUs = 0;
+		detected->erases[i].time.maxUs = 0;
+	}
+	if((detected->erases[0].numBytes == 0) && ((dwords[0] & 0x3) == 0x1))
+	{
+		// Only the 4 KB erase of DWORD 1.
+		detected->erases[0].opcode = (uint8_t) (dwords[0] >> 8);
+		detected->erases[0].numBytes = 4096U;
+	}
+	sortErases(detected->erases);
+	eraseTimes(detected);
+
+	// DWORD 15 bits 22:20: quad enable requirements (JESD216 rev A and later).
+	detected->quadEnable = FLASH_QE_UNKNOWN;
+	if(numDwords >= 15)
+	{
+		switch((dwords[14] >> 20) & 0x7)
+		{
+			case 0:
+				detected->quadEnable = FLASH_QE_NONE;
+				break;
+			case 1:
+			case 4:
+			case 5:
+				detected->quadEnable = FLASH_QE_SR2_BIT1;
+				break;
+			case 2:
+				detected->quadEnable = FLASH_QE_SR1_BIT6;
+				break;
+			case 6:
+				detected->quadEnable = FLASH_QE_SR2_BIT1_0x31;
+				break;
+			default:
+				break;
+		}
+	}
+	else if((detected->part != NULL) && (detected->part->family == FLASH_FAMILY_STANDARDFLASH))
+	{
+		detected->quadEnable = FLASH_QE_SR2_BIT1;
+	}
+
+	// DWORDs 1, 3 and 4: the fast reads supported, fastest last.
+	setReadMethod(&detected->read, FLASH_READ_1_1_1, 0x0B, 0, 1);
+	if(ioLines >= 2)
+	{
+		if((dwords[0] & (1U << 16)) && sfdpReadMethod(&method, FLASH_READ_1_1_2, dwords[3]))
+			detected->read = method;
+		if((dwords[0] & (1U << 20)) && sfdpReadMethod(&method, FLASH_READ_1_2_2, dwords[3] >> 16))
+			detected->read = method;
+	}
+	if((ioLines >= 4) && (detected->quadEnable != FLASH_QE_UNKNOWN))
+	{
+		if((dwords[0] & (1U << 22)) && sfdpReadMethod(&method, FLASH_READ_1_1_4, dwords[2] >> 16))
+			detected->read = method;
+		if((dwords[0] & (1U << 21)) && sfdpReadMethod(&method, FLASH_READ_1_4_4, dwords[2]))
+			detected->read = method;
+	}
+	return 1;
+}
+
+/*
+ * Fills in the geometry and the fastest read of a part from its descriptor,
+ * for parts without an SFDP table.
+ */
+static void fromDescriptor(FLASH_Detected *detected, uint8_t ioLines)
+{
+	const FLASH_Part *part = detected->part;
+	uint32_t i;
+
+	detected->capacity = part->capacity;
+	detected->pageSize = part->pageSize;
+	detected->addressBytes = part->addressBytes;
+	for(i = 0; i < FLASH_PART_ERASE_TYPES; i++)
+	{
+		detected->erases[i] = part->erases[i];
+	}
+	if(part->family == FLASH_FAMILY_DATAFLASH)
+	{
+		// Bit 0 of the status register is set in power of 2 page size mode.
+		uint8_t status[2];
+		flashContext->txBuffer[0] = DETECT_DATAFLASH_READ_SR;
+		SPI_Exchange(flashContext->txBuffer, 1, status, 2, 0);
+		if(!(status[0] & 0x01))
+		{
+			uint32_t numPages = part->capacity / part->pageSize;
+			detected->pageSize = part->pageSize + part->pageSize / 32;
+			detected->capacity = numPages * detected->pageSize;
+			for(detected->pageShift = 1; (1U << detected->pageShift) <= part->pageSize; detected->pageShift++);
+			for(i = 0; i < FLASH_PART_ERASE_TYPES; i++)
+			{
+				detected->erases[i].numBytes = (detected->erases[i].numBytes / part->pageSize) * detected->pageSize;
+			}
+		}
+		detected->quadEnable = FLASH_QE_DATAFLASH;
+	}
+	else if(part->family == FLASH_FAMILY_STANDARDFLASH)
+	{
+		detected->quadEnable = FLASH_QE_SR2_BIT1;
+	}
+	else
+	{
+		detected->quadEnable = FLASH_QE_NONE;
+	}
+
+	if(part->family == FLASH_FAMILY_MONETA)
+	{
+		setReadMethod(&detected->read, FLASH_READ_1_1_1_LF, 0x03, 0, 0);
+		return;
+	}
+	setReadMethod(&detected->read, FLASH_READ_1_1_1, 0x0B, 0, 1);
+	if(ioLines >= 2)
+	{
+		if(part->flags & FLASH_PART_DUAL_OUTPUT_READ)
+			setReadMethod(&detected->read, FLASH_READ_1_1_2, 0x3B, 0, 1);
+		if(part->flags & FLASH_PART_DUAL_IO_READ)
+			setReadMethod(&detected->read, FLASH_READ_1_2_2, 0xBB, 1, 0);
+	}
+	if(ioLines >= 4)
+	{
+		if(part->flags & FLASH_PART_QUAD_OUTPUT_READ)
+			setReadMethod(&detected->read, FLASH_READ_1_1_4, 0x6B, 0, 1);
+		if(part->flags & FLASH_PART_QUAD_IO_READ)
+			setReadMethod(&detected->read, FLASH_READ_1_4_4, 0xEB, 1, 2);
+	}
+}
+
+static void waitReady(const FLASH_Detected *detected)
+{
+	uint8_t status[SPI_READY_MAX_STATUS_BYTES];
+	SPI_WaitReady((detected->part != NULL) ? &detected->part->ready : &detectReadyPoll, DETECT_TW_US, status);
+}
+
+// Sets the QE bit so that the quad read chosen can be used.
+static void quadEnable(const FLASH_Detected *detected)
+{
+	uint8_t status[2];
+
+	switch(detected->quadEnable)
+	{
+		case FLASH_QE_SR2_BIT1:
+		case FLASH_QE_SR2_BIT1_0x31:
+			flashContext->txBuffer[0] = DETECT_READ_SR2;
+			SPI_Exchange(flashContext->txBuffer, 1, &status[1], 1, 0);
+			if(status[1] & 0x02)
+				return;
+			flashContext->txBuffer[0] = DETECT_READ_SR1;
+			SPI_Exchange(flashContext->txBuffer, 1, &status[0], 1, 0);
+			flashContext->txBuffer[0] = DETECT_WRITE_ENABLE;
+			SPI_Exchange(flashContext->txBuffer, 1, NULL, 0, 0);
+			if(detected->quadEnable == FLASH_QE_SR2_BIT1)
+			{
+				flashContext->txBuffer[0] = DETECT_WRITE_SR;
+				flashContext->txBuffer[1] = status[0];
+				flashContext->txBuffer[2] = status[1] | 0x02;
+				SPI_Exchange(flashContext->txBuffer, 3, NULL, 0, 0);
+			}
+			else
+			{
+				flashContext->txBuffer[0] = DETECT_WRITE_SR2;
+				flashContext->txBuffer[1] = status[1] | 0x02;
+				SPI_Exchange(flashContext->txBuffer, 2, NULL, 0, 0);
+			}
+			break;
+		case FLASH_QE_SR1_BIT6:
+			flashContext->txBuffer[0] = DETECT_READ_SR1;
+			SPI_Exchange(flashContext->txBuffer, 1, &status[0], 1, 0);
+			if(status[0] & 0x40)
+				return;
+			flashContext->txBuffer[0] = DETECT_WRITE_ENABLE;
+			SPI_Exchange(flashContext->txBuffer, 1, NULL, 0, 0);
+			flashContext->txBuffer[0] = DETECT_WRITE_SR;
+			flashContext->txBuffer[1] = status[0] | 0x40;
+			SPI_Exchange(flashContext->txBuffer, 2, NULL, 0, 0);
+			break;
+		case FLASH_QE_DATAFLASH:
+			flashContext->txBuffer[0] = 0x3D;
+			flashContext->txBuffer[1] = 0x2A;
+			flashContext->txBuffer[2] = 0x81;
+			flashContext->txBuffer[3] = 0x66;
+			SPI_Exchange(flashContext->txBuffer, 4, NULL, 0, 0);
+			break;
+		default:
+			return;
+	}
+	waitReady(detected);
+}
+
+uint8_t flashDetect(FLASH_Detected *detected, uint8_t ioLines)
+{
+	uint32_t i;
+	uint8_t found;
+
+	for(i = 0; i < sizeof(*detected); i++)
+	{
+		((uint8_t *) detected)[i] = 0;
+	}
+	flashContext->txBuffer[0] = DETECT_READ_MID;
+	SPI_Exchange(flashContext->txBuffer, 1, detected->id, FLASH_PART_ID_BYTES, 0);
+	// Parts sharing an ID with the one expected resolve to that one.
+	if(flashPartMatchesID(flashContextPart(), detected->id, FLASH_PART_ID_BYTES))
+		detected->part = flashContextPart();
+	else
+		detected->part = flashPartFindByID(detected->id, FLASH_PART_ID_BYTES);
+
+	// Parts known not to have the table are not sent the command.
+	if((detected->part == NULL) || (detected->part->flags & FLASH_PART_SFDP))
+	{
+		detected->sfdp = parseSFDP(detected, ioLines);
+	}
+	if(!detected->sfdp && (detected->part != NULL))
+	{
+		fromDescriptor(detected, ioLines);
+	}
+	found = detected->sfdp || (detected->part != NULL);
+	if(!found)
+	{
+		detected->addressBytes = 3;
+		detected->pageSize = 1;
+		setReadMethod(&detected->read, FLASH_READ_1_1_1_LF, 0x03, 0, 0);
+		return 0;
+	}
+	if(detected->read.dataLines == 4)
+	{
+		quadEnable(detected);
+	}
+	if(detected->part != NULL)
+	{
+		flashContext->part = detected->part;
+#if (ALL == 1)
+		flashPartSelected = detected->part;
+#endif
+	}
+	return 1;
+}
+
+void flashDetectRead(const FLASH_Detected *detected, uint32_t address, uint8_t *rxBuffer, uint32_t rxNumBytes)
+{
+	const FLASH_ReadMethod *read = &detected->read;
+	uint32_t numBytes = 0;
+	uint32_t i;
+
+	if(detected->pageShift != 0)
+	{
+		address = ((address / detected->pageSize) << detected->pageShift) | (address % detected->pageSize);
+	}
+	flashContext->txBuffer[numBytes++] = read->opcode;
+	for(i = detected->addressBytes; i > 0; i--)
+	{
+		flashContext->txBuffer[numBytes++] = (uint8_t) (address >> (8 * (i - 1)));
+	}
+	for(i = 0; i < read->modeNumBytes; i++)
+	{
+		flashContext->txBuffer[numBytes++] = 0x00;
+	}
+	switch(read->dataLines)
+	{
+		case 2:
+			SPI_DualExchange((read->addressLines == 1) ? numBytes : 1, flashContext->txBuffer, numBytes,
+							 rxBuffer, rxNumBytes, read->dummyNumBytes);
+			break;
+		case 4:
+			SPI_QuadExchange((read->addressLines == 1) ? numBytes : 1, flashContext->txBuffer, numBytes,
+							 rxBuffer, rxNumBytes, read->dummyNumBytes);
+			break;
+		default:
+			SPI_Exchange(flashContext->txBuffer, numBytes, rxBuffer, rxNumBytes, read->dummyNumBytes);
+			break;
+	}
+}
+
+void flashReadSFDP(uint32_t address, uint8_t *rxBuffer, uint32_t rxNumBytes)
+{
+	flashContext->txBuffer[0] = DETECT_READ_SFDP;
+	flashContext->txBuffer[1] = (uint8_t) (address >> 16);
+	flashContext->txBuffer[2] = (uint8_t) (address >> 8);
+	flashContext->txBuffer[3] = (uint8_t) address;
+	SPI_Exchange(flashContext->txBuffer, 4, rxBuffer, rxNumBytes, 1);
+}
+
+void flashDetectPrint(const FLASH_Detected *detected)
+{
+	static const char *const modes[] = {"1-1-1 (0x03)", "1-1-1", "1-1-2", "1-2-2", "1-1-4", "1-4-4"};
+	uint32_t i;
+
+	printf("Part:       %s\n", (detected->part != NULL) ? detected->part->name : "unknown");
+	printf("ID:        ");
+	for(i = 0; i < FLASH_PART_ID_BYTES; i++)
+	{
+		printf(" %02X", detected->id[i]);
+	}
+	printf("\n");
+	printf("Source:     %s\n", detected->sfdp ? "SFDP" : "descriptor");
+	printf("Capacity:   %lu bytes\n", (unsigned long) detected->capacity);
+	printf("Page size:  %lu bytes\n", (unsigned long) detected->pageSize);
+	printf("Address:    %u bytes\n", detected->addressBytes);
+	printf("Erases:    ");
+	for(i = 0; (i < FLASH_PART_ERASE_TYPES) && (detected->erases[i].numBytes != 0); i++)
+	{
+		printf(" %lu (0x%02X)", (unsigned long) detected->erases[i].numBytes, detected->erases[i].opcode);
+	}
+	printf("\n");
+	printf("Read:       %s, opcode 0x%02X, %u mode and %u dummy bytes\n", modes[detected->read.mode],
+		   detected->read.opcode, detected->read.modeNumBytes, detected->read.dummyNumBytes);
+}
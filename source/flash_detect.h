@@ -0,0 +1,190 @@
+/*
+ * The Clear BSD License
+ * Copyright (c) 2018 Adesto Technologies Corporation, Inc
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted (subject to the limitations in the disclaimer below) provided
+ *  that the following conditions are met:
+ *
+ * o Redistributions of source code must retain the above copyright notice, this list
+ *   of conditions and the following disclaimer.
+ *
+ * o Redistributions in binary form must reproduce the above copyright notice, this
+ *   list of conditions and the following disclaimer in the documentation and/or
+ *   other materials provided with the distribution.
+ *
+ * o Neither the name of the copyright holder nor the names of its
+ *   contributors may be used to endorse or promote products derived from this
+ *   software without specific prior written permission.
+ *
+ * NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE GRANTED BY THIS LICENSE.
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*!
+ * @ingroup ADESTO_LAYER
+ */
+/**
+ * @file    flash_detect.h
+ * @brief   Declarations of the run time part detection.
+ *
+ * flashDetect() identifies the attached part from the manufacturer and
+ * device ID (0x9F, the command behind monetaReadMID(), fusionReadMID(),
+ * dataflashReadMID() and standardflashReadMID()) and, on parts that have
+ * one, the JEDEC SFDP table (JESD216). The result gives the capacity, page
+ * size, erase sizes, number of address bytes and the fastest read command
+ * the part and the board support. flashDetectRead() then reads with that
+ * command, so one image can read any supported part at its best rate.
+ *
+ * The ID selects the descriptor in flash_parts.h; where parts share an ID
+ * (such as the AT45DB321E and AT45DQ321), the part expected by the selected
+ * context is preferred, else the first in part number order. Where the SFDP
+ * table is present it takes precedence for geometry and read commands, which
+ * also covers parts missing from the table. A detected part is stored in the
+ * selected context (see flash_context.h) and, when every driver is built
+ * (ALL == 1), becomes flashPartSelected, so the drivers follow the part found.
+ *
+ * QPI (4-4-4) reads are not selected, since QPI mode changes how every
+ * other command is sent; see standardflashEnableQPI().
+ */
+#ifndef FLASH_DETECT_H_
+#define FLASH_DETECT_H_
+
+#include "flash_parts.h"
+
+/*!
+ * @brief Read commands, slowest first. The digits give the IOs used for the
+ * opcode, the address and the data.
+ */
+enum flashReadMode
+{
+	FLASH_READ_1_1_1_LF,	//!< 0x03, no dummy clocks, limited clock.
+	FLASH_READ_1_1_1,		//!< Fast read, 0x0B.
+	FLASH_READ_1_1_2,		//!< Dual output read.
+	FLASH_READ_1_2_2,		//!< Dual I/O read.
+	FLASH_READ_1_1_4,		//!< Quad output read.
+	FLASH_READ_1_4_4		//!< Quad I/O read.
+};
+
+/*!
+ * @brief How the quad enable (QE) bit is set before a quad read, following
+ * the QER field of JESD216.
+ */
+enum flashQuadEnable
+{
+	FLASH_QE_NONE,			//!< Quad reads need no enable.
+	FLASH_QE_SR2_BIT1,		//!< Bit 1 of status register 2 (0x35), written with 0x01 and two bytes.
+	FLASH_QE_SR1_BIT6,		//!< Bit 6 of status register 1, written with 0x01 and one byte.
+	FLASH_QE_SR2_BIT1_0x31,	//!< Bit 1 of status register 2, written with 0x31.
+	FLASH_QE_DATAFLASH,		//!< DataFlash configuration register, set with 0x3D2A8166.
+	FLASH_QE_UNKNOWN		//!< Not known; quad reads are not selected.
+};
+
+/*!
+ * @brief A read command and its framing, as sent by flashDetectRead().
+ */
+typedef struct
+{
+	//! The read command.
+	enum flashReadMode mode;
+	//! Its opcode.
+	uint8_t opcode;
+	//! IOs used for the address, mode and dummy bytes.
+	uint8_t addressLines;
+	//! IOs used for the data.
+	uint8_t dataLines;
+	//! Mode bytes sent after the address, as 0x00 (no continuous read).
+	uint8_t modeNumBytes;
+	//! Dummy bytes, clocked on 4 IOs after a quad address and on 1 IO
+	//! otherwise (see SPI_DualExchange() and SPI_QuadExchange()).
+	uint8_t dummyNumBytes;
+} FLASH_ReadMethod;
+
+/*!
+ * @brief What flashDetect() found.
+ */
+typedef struct
+{
+	//! Descriptor of the part, NULL if the ID matched none.
+	const FLASH_Part *part;
+	//! Bytes returned by the manufacturer and device ID read.
+	uint8_t id[FLASH_PART_ID_BYTES];
+	//! 1 if the geometry and read commands came from an SFDP table.
+	uint8_t sfdp;
+	//! Array size in bytes.
+	uint32_t capacity;
+	//! Program page size in bytes.
+	uint32_t pageSize;
+	//! DataFlash in standard page size mode: bits of the byte offset in an
+	//! address, which is then page << pageShift | offset. 0 for linear addresses.
+	uint8_t pageShift;
+	//! Number of address bytes of array commands.
+	uint8_t addressBytes;
+	//! Erase sizes, smallest first. Unused entries have numBytes 0. Times
+	//! are those of the descriptor, 0 if the part is not in the table.
+	FLASH_PartErase erases[FLASH_PART_ERASE_TYPES];
+	//! How quad reads are enabled.
+	enum flashQuadEnable quadEnable;
+	//! The fastest read supported by the part and the board.
+	FLASH_ReadMethod read;
+} FLASH_Detected;
+
+/*!
+ * @brief Identifies the attached part and picks its fastest read command.
+ * If that is a quad read, the QE bit is set on the part.
+ *
+ * @param detected Receives the result.
+ * @param ioLines 1, 2 or 4. The number of IOs wired between the MCU and the
+ * part, which limits the read commands considered.
+ *
+ * @retval uint8_t 1 if the part was identified from its ID or its SFDP
+ * table, 0 if neither was recognized (detected then describes a minimal
+ * 3 byte address part read with 0x03).
+ *
+ * @warning The part must not be in (ultra) deep power down.
+ */
+uint8_t flashDetect(FLASH_Detected *detected, uint8_t ioLines);
+
+/*!
+ * @brief Reads from the part with the read command chosen by flashDetect().
+ *
+ * @param detected The result of flashDetect().
+ * @param address The linear byte address to start from.
+ * @param *rxBuffer Receives the data.
+ * @param rxNumBytes The number of bytes to read.
+ *
+ * @retval void
+ */
+void flashDetectRead(const FLASH_Detected *detected, uint32_t address, uint8_t *rxBuffer, uint32_t rxNumBytes);
+
+/*!
+ * @brief Reads bytes of the SFDP table.
+ *
+ * @param address The byte offset in the table.
+ * @param *rxBuffer Receives the data.
+ * @param rxNumBytes The number of bytes to read.
+ *
+ * @retval void
+ */
+void flashReadSFDP(uint32_t address, uint8_t *rxBuffer, uint32_t rxNumBytes);
+
+/*!
+ * @brief Prints the result of flashDetect().
+ *
+ * @param detected The result of flashDetect().
+ *
+ * @retval void
+ */
+void flashDetectPrint(const FLASH_Detected *detected);
+
+#endif /* FLASH_DETECT_H_ */
@@ -0,0 +1,272 @@
+/*
+ * The Clear BSD License
+ * Copyright (c) 2018 Adesto Technologies Corporation, Inc
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted (subject to the limitations in the disclaimer below) provided
+ *  that the following conditions are met:
+ *
+ * o Redistributions of source code must retain the above copyright notice, this list
+ *   of conditions and the following disclaimer.
+ *
+ * o Redistributions in binary form must reproduce the above copyright notice, this
+ *   list of conditions and the following disclaimer in the documentation and/or
+ *   other materials provided with the distribution.
+ *
+ * o Neither the name of the copyright holder nor the names of its
+ *   contributors may be used to endorse or promote products derived from this
+ *   software without specific prior written permission.
+ *
+ * NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE GRANTED BY THIS LICENSE.
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*!
+ * @ingroup ADESTO_LAYER
+ */
+/**
+ * @file    flash_device.c
+ * @brief   Definition of the family independent device description.
+ */
+#include "flash_device.h"
+
+#if defined(MONETA_DEVICE)
+#include "moneta.h"
+
+// Moneta addresses are 16 bits wide.
+static void monetaDeviceRead(uint32_t address, uint8_t *rxBuffer, uint32_t rxNumBytes)
+{
+	monetaRead((uint16_t) address, rxBuffer, rxNumBytes);
+}
+
+static void monetaDeviceProgram(uint32_t address, uint8_t *txBuffer, uint32_t txNumBytes)
+{
+	monetaProgram((uint16_t) address, txBuffer, txNumBytes);
+}
+
+static void monetaDeviceErase(uint32_t address)
+{
+	monetaErase((uint16_t) address);
+}
+
+static void monetaDeviceOpenReadStream(SPI_Stream *stream, uint32_t address)
+{
+	monetaOpenReadStream(stream, (uint16_t) address);
+}
+
+void flashDeviceInit(FLASH_Device *device)
+{
+	const FLASH_Part *part = flashContextPart();
+	device->context = NULL;
+	device->name = "Moneta";
+	device->part = part;
+	device->capacity = part->capacity;
+	device->pageSize = part->pageSize;
+	// No erase command; monetaErase() rewrites one page with 0xFF.
+	device->eraseSize = MONETA_ERASE_SIZE;
+	device->read = monetaDeviceRead;
+	device->program = monetaDeviceProgram;
+	device->erase = monetaDeviceErase;
+	device->openReadStream = monetaDeviceOpenReadStream;
+	// Writes complete within microseconds; nothing is run in the background.
+	device->programPageStart = NULL;
+	device->eraseStart = NULL;
+	device->isBusy = NULL;
+	device->waitOnReadyFor = monetaWaitOnReadyFor;
+	device->suspend = NULL;
+	device->resume = NULL;
+}
+
+#elif defined(FUSION_DEVICE)
+#include "fusion.h"
+
+void flashDeviceInit(FLASH_Device *device)
+{
+	const FLASH_Part *part = flashContextPart();
+	device->context = NULL;
+	device->name = "Fusion";
+	device->part = part;
+	device->capacity = part->capacity;
+	device->pageSize = part->pageSize;
+	device->eraseSize = flashPartSmallestErase(part)->numBytes;
+	device->read = fusionRead;
+	device->program = fusionProgram;
+	device->erase = fusionErase;
+	device->openReadStream = fusionOpenReadStream;
+	device->programPageStart = fusionProgramPageStart;
+	device->eraseStart = fusionEraseStart;
+	device->isBusy = fusionIsBusy;
+	device->waitOnReadyFor = fusionWaitOnReadyFor;
+	device->suspend = NULL;
+	device->resume = NULL;
+}
+
+#elif defined(DATAFLASH_DEVICE)
+#include "dataflash.h"
+
+void flashDeviceInit(FLASH_Device *device)
+{
+	const FLASH_Part *part = flashContextPart();
+	uint32_t pageSize = dataflashGetPageSize();
+	// Also refreshes the page size cached for dataflashRead() and the like.
+	flashContext->pageSize = pageSize;
+	device->context = NULL;
+	device->name = "DataFlash";
+	device->part = part;
+	// The descriptor counts power of 2 pages; standard pages add 1/32.
+	device->capacity = (part->capacity / part->pageSize) * pageSize;
+	device->pageSize = pageSize;
+	device->eraseSize = pageSize;
+	device->read = dataflashRead;
+	device->program = dataflashProgram;
+	device->erase = dataflashErase;
+	device->openReadStream = dataflashOpenReadStream;
+	device->programPageStart = dataflashProgramPageStart;
+	device->eraseStart = dataflashEraseStart;
+	device->isBusy = dataflashIsBusy;
+	device->waitOnReadyFor = dataflashWaitOnReadyFor;
+#if defined(CMD_DATAFLASH_PROGRAM_ERASE_SUSPEND)
+	device->suspend = dataflashProgramEraseSuspend;
+	device->resume = dataflashProgramEraseResume;
+#else
+	device->suspend = NULL;
+	device->resume = NULL;
+#endif
+}
+
+#elif defined(STANDARDFLASH_DEVICE)
+#include "standardflash.h"
+
+void flashDeviceInit(FLASH_Device *device)
+{
+	const FLASH_Part *part = flashContextPart();
+	device->context = NULL;
+	device->name = "Standard Flash";
+	device->part = part;
+	device->capacity = part->capacity;
+	device->pageSize = part->pageSize;
+	device->eraseSize = flashPartSmallestErase(part)->numBytes;
+	device->read = standardflashRead;
+	device->program = standardflashProgram;
+	device->erase = standardflashErase;
+	device->openReadStream = standardflashOpenReadStream;
+	device->programPageStart = standardflashProgramPageStart;
+	device->eraseStart = standardflashEraseStart;
+	device->isBusy = standardflashIsBusy;
+	device->waitOnReadyFor = standardflashWaitOnReadyFor;
+#if defined(CMD_STANDARDFLASH_ERASE_PROGRAM_SUSPEND)
+	device->suspend = standardflashEraseProgramSuspend;
+	device->resume = standardflashEraseProgramResume;
+#elif defined(CMD_STANDARDFLASH_PROGRAM_ERASE_SUSPEND)
+	device->suspend = standardflashProgramEraseSuspend;
+	device->resume = standardflashProgramEraseResume;
+#else
+	device->suspend = NULL;
+	device->resume = NULL;
+#endif
+}
+
+#endif
+
+void flashDeviceOpen(FLASH_Device *device, FLASH_Context *context)
+{
+	flashContextSelect(context);
+	flashDeviceInit(device);
+	device->context = context;
+}
+
+void flashDeviceSelect(const FLASH_Device *device)
+{
+	if(device->context != NULL)
+	{
+		flashContextSelect(device->context);
+	}
+}
+
+void flashDeviceRead(const FLASH_Device *device, uint32_t address, uint8_t *rxBuffer, uint32_t rxNumBytes)
+{
+	flashDeviceSelect(device);
+	flashContext->stats.reads++;
+	flashContext->stats.readBytes += rxNumBytes;
+	device->read(address, rxBuffer, rxNumBytes);
+}
+
+void flashDeviceProgram(const FLASH_Device *device, uint32_t address, uint8_t *txBuffer, uint32_t txNumBytes)
+{
+	flashDeviceSelect(device);
+	flashContext->stats.programs++;
+	flashContext->stats.programBytes += txNumBytes;
+	device->program(address, txBuffer, txNumBytes);
+}
+
+void flashDeviceProgramPageStart(const FLASH_Device *device, uint32_t address, uint8_t *txBuffer, uint32_t txNumBytes)
+{
+	flashDeviceSelect(device);
+	flashContext->stats.programs++;
+	flashContext->stats.programBytes += txNumBytes;
+	device->programPageStart(address, txBuffer, txNumBytes);
+}
+
+void flashDeviceErase(const FLASH_Device *device, uint32_t address)
+{
+	flashDeviceSelect(device);
+	flashContext->stats.erases++;
+	device->erase(address);
+}
+
+void flashDeviceEraseStart(const FLASH_Device *device, uint32_t address)
+{
+	flashDeviceSelect(device);
+	flashContext->stats.erases++;
+	device->eraseStart(address);
+}
+
+void flashDeviceOpenReadStream(const FLASH_Device *device, SPI_Stream *stream, uint32_t address)
+{
+	flashDeviceSelect(device);
+	flashContext->stats.reads++;
+	device->openReadStream(stream, address);
+}
+
+uint8_t flashDeviceIsBusy(const FLASH_Device *device)
+{
+	flashDeviceSelect(device);
+	return device->isBusy();
+}
+
+void flashDeviceWaitOnReady(const FLASH_Device *device, uint32_t expectedUs)
+{
+	flashDeviceSelect(device);
+	device->waitOnReadyFor(expectedUs);
+}
+
+void flashDeviceWaitOnReadySince(const FLASH_Device *device, uint64_t startCycles, uint32_t expectedUs)
+{
+	uint64_t cycles = USER_CONFIG_CycleCount64() - startCycles;
+	uint32_t hz = USER_CONFIG_CycleCountHz();
+	uint64_t elapsedUs = (cycles / hz) * 1000000U + ((cycles % hz) * 1000000U) / hz;
+	flashDeviceWaitOnReady(device, (elapsedUs < expectedUs) ? (uint32_t) (expectedUs - elapsedUs) : 0);
+}
+
+void flashDeviceSuspend(const FLASH_Device *device)
+{
+	flashDeviceSelect(device);
+	flashContext->stats.suspends++;
+	device->suspend();
+}
+
+void flashDeviceResume(const FLASH_Device *device)
+{
+	flashDeviceSelect(device);
+	device->resume();
+}
@@ -0,0 +1,258 @@
+/*
+ * The Clear BSD License
+ * Copyright (c) 2018 Adesto Technologies Corporation, Inc
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted (subject to the limitations in the disclaimer below) provided
+ *  that the following conditions are met:
+ *
+ * o Redistributions of source code must retain the above copyright notice, this list
+ *   of conditions and the following disclaimer.
+ *
+ * o Redistributions in binary form must reproduce the above copyright notice, this
+ *   list of conditions and the following disclaimer in the documentation and/or
+ *   other materials provided with the distribution.
+ *
+ * o Neither the name of the copyright holder nor the names of its
+ *   contributors may be used to endorse or promote products derived from this
+ *   software without specific prior written permission.
+ *
+ * NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE GRANTED BY THIS LICENSE.
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*!
+ * @ingroup ADESTO_LAYER
+ */
+/**
+ * @file    flash_device.h
+ * @brief   Family independent description of the selected device.
+ *
+ * FLASH_Device collects the read, program and erase functions of the family
+ * selected by PARTNO together with its page and erase unit sizes, so that
+ * code layered on top of the drivers (such as the command queue in
+ * flash_queue.h) works the same for Moneta, Fusion, DataFlash and
+ * standard flash parts. Addresses are linear byte addresses.
+ *
+ * With several chips, open one FLASH_Device per chip with flashDeviceOpen()
+ * and go through flashDeviceRead(), flashDeviceProgram() and the other
+ * flashDevice functions below: they select the chip's context (see
+ * flash_context.h) before each command and count its usage, so the
+ * devices may be used in any order.
+ */
+#ifndef FLASH_DEVICE_H_
+#define FLASH_DEVICE_H_
+
+#include "cmd_defs.h"
+#include "spi_driver.h"
+#include "flash_context.h"
+
+/*!
+ * @brief Operations and geometry of a device.
+ */
+typedef struct FLASH_Device
+{
+	//! Name of the family, for messages.
+	const char *name;
+	//! Context of the chip, NULL for the selected one (see flashDeviceOpen()).
+	FLASH_Context *context;
+	//! Descriptor of the part (see flash_parts.h).
+	const FLASH_Part *part;
+	//! Array size in bytes.
+	uint32_t capacity;
+	//! Program page size in bytes. Programs within one page take one command.
+	uint32_t pageSize;
+	//! Erase unit size in bytes.
+	uint32_t eraseSize;
+	//! Reads any number of bytes in one continuous read.
+	void (*read)(uint32_t address, uint8_t *rxBuffer, uint32_t rxNumBytes);
+	//! Programs any number of bytes, splitting on page boundaries and
+	//! waiting for each page to complete.
+	void (*program)(uint32_t address, uint8_t *txBuffer, uint32_t txNumBytes);
+	//! Erases the erase unit containing 'address' and waits for it to complete.
+	void (*erase)(uint32_t address);
+	//! Opens a continuous read stream (see SPI_StreamRead()).
+	void (*openReadStream)(SPI_Stream *stream, uint32_t address);
+	//! Starts programming within one page without waiting. NULL if the family
+	//! only programs synchronously.
+	void (*programPageStart)(uint32_t address, uint8_t *txBuffer, uint32_t txNumBytes);
+	//! Starts erasing the erase unit containing 'address' without waiting.
+	//! NULL if the family only erases synchronously.
+	void (*eraseStart)(uint32_t address);
+	//! Returns 1 while a program or erase is in progress.
+	uint8_t (*isBusy)(void);
+	//! Waits for the program or erase in progress, expected to take
+	//! 'expectedUs' microseconds (see SPI_WaitReady()).
+	void (*waitOnReadyFor)(uint32_t expectedUs);
+	//! Suspends the program or erase in progress. NULL if the part cannot.
+	void (*suspend)(void);
+	//! Resumes the suspended program or erase.
+	void (*resume)(void);
+} FLASH_Device;
+
+/*!
+ * @brief Fills in 'device' for the family of the selected PARTNO. For
+ * DataFlash the page size is read from the device, so call this again after
+ * changing it with dataflashConfigurePower2PageSize() or
+ * dataflashConfigureStandardPageSize().
+ *
+ * @param device The structure to fill in.
+ *
+ * @retval void
+ */
+void flashDeviceInit(FLASH_Device *device);
+
+/*!
+ * @brief Fills in 'device' for the chip behind 'context'. The context is
+ * selected while the device is described, so the geometry is that of its
+ * part, and is selected again by every flashDevice function below.
+ *
+ * @param device The structure to fill in.
+ * @param context Context of the chip (see flashContextInit()).
+ *
+ * @retval void
+ */
+void flashDeviceOpen(FLASH_Device *device, FLASH_Context *context);
+
+/*!
+ * @brief Makes the drivers work on the chip of a device. Called by the
+ * functions below; call it before using the family functions directly.
+ *
+ * @param device The device.
+ *
+ * @retval void
+ */
+void flashDeviceSelect(const FLASH_Device *device);
+
+/*!
+ * @brief Selects the device and calls its read().
+ *
+ * @param device The device.
+ * @param address Address of the first byte.
+ * @param rxBuffer Receives the data.
+ * @param rxNumBytes Number of bytes to read.
+ *
+ * @retval void
+ */
+void flashDeviceRead(const FLASH_Device *device, uint32_t address, uint8_t *rxBuffer, uint32_t rxNumBytes);
+
+/*!
+ * @brief Selects the device and calls its program().
+ *
+ * @param device The device.
+ * @param address Address of the first byte.
+ * @param txBuffer The data.
+ * @param txNumBytes Number of bytes to program.
+ *
+ * @retval void
+ */
+void flashDeviceProgram(const FLASH_Device *device, uint32_t address, uint8_t *txBuffer, uint32_t txNumBytes);
+
+/*!
+ * @brief Selects the device and calls its programPageStart().
+ *
+ * @param device The device.
+ * @param address Address of the first byte.
+ * @param txBuffer The data, within one page.
+ * @param txNumBytes Number of bytes to program.
+ *
+ * @retval void
+ */
+void flashDeviceProgramPageStart(const FLASH_Device *device, uint32_t address, uint8_t *txBuffer, uint32_t txNumBytes);
+
+/*!
+ * @brief Selects the device and calls its erase().
+ *
+ * @param device The device.
+ * @param address Any address within the erase unit.
+ *
+ * @retval void
+ */
+void flashDeviceErase(const FLASH_Device *device, uint32_t address);
+
+/*!
+ * @brief Selects the device and calls its eraseStart().
+ *
+ * @param device The device.
+ * @param address Any address within the erase unit.
+ *
+ * @retval void
+ */
+void flashDeviceEraseStart(const FLASH_Device *device, uint32_t address);
+
+/*!
+ * @brief Selects the device and calls its openReadStream().
+ *
+ * @param device The device.
+ * @param stream The stream to open.
+ * @param address Address of the first byte.
+ *
+ * @retval void
+ *
+ * @warning Close the stream before using another device.
+ */
+void flashDeviceOpenReadStream(const FLASH_Device *device, SPI_Stream *stream, uint32_t address);
+
+/*!
+ * @brief Selects the device and calls its isBusy().
+ *
+ * @param device The device.
+ *
+ * @retval 1 While a program or erase is in progress.
+ * @retval 0 Otherwise.
+ */
+uint8_t flashDeviceIsBusy(const FLASH_Device *device);
+
+/*!
+ * @brief Selects the device and calls its waitOnReadyFor().
+ *
+ * @param device The device.
+ * @param expectedUs Expected remaining time of the operation in microseconds.
+ *
+ * @retval void
+ */
+void flashDeviceWaitOnReady(const FLASH_Device *device, uint32_t expectedUs);
+
+/*!
+ * @brief Waits for an operation that was started at 'startCycles' and
+ * typically takes 'expectedUs'. The time already elapsed is deducted, so a
+ * program or erase left running in the background while the caller did other
+ * work is only sampled for what remains of it.
+ *
+ * @param device The device.
+ * @param startCycles USER_CONFIG_CycleCount64() when the operation was started.
+ * @param expectedUs Typical duration of the operation in microseconds.
+ *
+ * @retval void
+ */
+void flashDeviceWaitOnReadySince(const FLASH_Device *device, uint64_t startCycles, uint32_t expectedUs);
+
+/*!
+ * @brief Selects the device and calls its suspend().
+ *
+ * @param device The device.
+ *
+ * @retval void
+ */
+void flashDeviceSuspend(const FLASH_Device *device);
+
+/*!
+ * @brief Selects the device and calls its resume().
+ *
+ * @param device The device.
+ *
+ * @retval void
+ */
+void flashDeviceResume(const FLASH_Device *device);
+
+#endif /* FLASH_DEVICE_H_ */
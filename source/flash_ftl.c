@@ -0,0 +1,660 @@
+/*
+ * The Clear BSD License
+ * Copyright (c) 2018 Adesto Technologies Corporation, Inc
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted (subject to the limitations in the disclaimer below) provided
+ *  that the following conditions are met:
+ *
+ * o Redistributions of source code must retain the above copyright notice, this list
+ *   of conditions and the following disclaimer.
+ *
+ * o Redistributions in binary form must reproduce the above copyright notice, this
+ *   list of conditions and the following disclaimer in the documentation and/or
+ *   other materials provided with the distribution.
+ *
+ * o Neither the name of the copyright holder nor the names of its
+ *   contributors may be used to endorse or promote products derived from this
+ *   software without specific prior written permission.
+ *
+ * NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE GRANTED BY THIS LICENSE.
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*!
+ * @ingroup ADESTO_LAYER
+ */
+/**
+ * @file    flash_ftl.c
+ * @brief   Definition of the page-mapped flash translation layer.
+ */
+#include "flash_ftl.h"
+#include "helper_functions.h"
+#include <string.h>
+
+static uint32_t ftlBlockAddress(const FLASH_Ftl *ftl, uint16_t block)
+{
+	return ftl->baseAddress + (uint32_t) block * ftl->device->eraseSize;
+}
+
+static uint32_t ftlPageAddress(const FLASH_Ftl *ftl, uint16_t physical)
+{
+	return ftlBlockAddress(ftl, physical / ftl->pagesPerBlock) + (physical % ftl->pagesPerBlock) * ftl->pageSize;
+}
+
+static uint32_t ftlGet32(const uint8_t *bytes)
+{
+	return (uint32_t) bytes[0] | ((uint32_t) bytes[1] << 8) | ((uint32_t) bytes[2] << 16) | ((uint32_t) bytes[3] << 24);
+}
+
+static void ftlPut32(uint8_t *bytes, uint32_t value)
+{
+	bytes[0] = (uint8_t) value;
+	bytes[1] = (uint8_t) (value >> 8);
+	bytes[2] = (uint8_t) (value >> 16);
+	bytes[3] = (uint8_t) (value >> 24);
+}
+
+// Reads the entries of a block header into pageBuffer.
+static void ftlReadHeader(FLASH_Ftl *ftl, uint16_t block)
+{
+	flashDeviceRead(ftl->device, ftlBlockAddress(ftl, block), ftl->pageBuffer,
+					FLASH_FTL_HEADER_BYTES + 2 * (ftl->pagesPerBlock - 1));
+}
+
+static uint16_t ftlHeaderEntry(const FLASH_Ftl *ftl, uint8_t index)
+{
+	const uint8_t *entry = &ftl->pageBuffer[FLASH_FTL_HEADER_BYTES + 2 * (index - 1)];
+	return (uint16_t) (entry[0] | (entry[1] << 8));
+}
+
+static void ftlWriteEntry(FLASH_Ftl *ftl, uint16_t block, uint8_t index, uint16_t logical)
+{
+	uint8_t entry[2];
+	entry[0] = (uint8_t) logical;
+	entry[1] = (uint8_t) (logical >> 8);
+	flashDeviceProgram(ftl->device, ftlBlockAddress(ftl, block) + FLASH_FTL_HEADER_BYTES + 2 * (index - 1), entry, 2);
+}
+
+// Writes the magic number and erase count into a freshly erased block.
+static void ftlFormatBlock(FLASH_Ftl *ftl, uint16_t block)
+{
+	uint8_t header[8];
+	ftlPut32(&header[0], FLASH_FTL_MAGIC);
+	ftlPut32(&header[4], ftl->eraseCount[block]);
+	flashDeviceProgram(ftl->device, ftlBlockAddress(ftl, block), header, sizeof(header));
+	ftl->state[block] = FLASH_FTL_BLOCK_ERASED;
+}
+
+// Waits for the background erase, if any.
+static void ftlFinishErase(FLASH_Ftl *ftl)
+{
+	uint16_t block;
+	if(ftl->erasingBlock == ftl->numBlocks)
+	{
+		return;
+	}
+	flashDeviceWaitOnReadySince(ftl->device, ftl->eraseStart, flashPartSmallestErase(ftl->device->part)->time.typicalUs);
+	block = ftl->erasingBlock;
+	ftl->erasingBlock = ftl->numBlocks;
+	ftlFormatBlock(ftl, block);
+}
+
+// Erases a dirty block, in the background if 'wait' is 0 and the family can.
+static void ftlEraseBlock(FLASH_Ftl *ftl, uint16_t block, uint8_t wait)
+{
+	ftlFinishErase(ftl);
+	ftl->eraseCount[block]++;
+	if(!wait && (ftl->device->eraseStart != NULL))
+	{
+		flashDeviceEraseStart(ftl->device, ftlBlockAddress(ftl, block));
+		ftl->erasingBlock = block;
+		ftl->eraseStart = USER_CONFIG_CycleCount64();
+	}
+	else
+	{
+		flashDeviceErase(ftl->device, ftlBlockAddress(ftl, block));
+		ftlFormatBlock(ftl, block);
+	}
+	ftl->stats.erases++;
+}
+
+// The free block in 'state' with the fewest erases, or with the most if
+// 'mostWorn' is set.
+static uint16_t ftlPickFree(const FLASH_Ftl *ftl, uint8_t state, uint8_t mostWorn)
+{
+	uint16_t found = ftl->numBlocks;
+	uint16_t block;
+	for(block = 0; block < ftl->numBlocks; block++)
+	{
+		if((ftl->state[block] == state) &&
+		   ((found == ftl->numBlocks) ||
+			(mostWorn ? (ftl->eraseCount[block] > ftl->eraseCount[found]) : (ftl->eraseCount[block] < ftl->eraseCount[found]))))
+		{
+			found = block;
+		}
+	}
+	return found;
+}
+
+// Makes a free block the active one, or the cold one if 'cold' is set, and
+// writes its sequence number. New data goes to the least worn block; cold
+// data being migrated goes to the most worn one, where it will stay for a
+// long time.
+static uint8_t ftlOpenBlock(FLASH_Ftl *ftl, uint8_t cold)
+{
+	uint8_t sequence[4];
+	uint16_t block = ftlPickFree(ftl, FLASH_FTL_BLOCK_ERASED, cold);
+	if(block == ftl->numBlocks)
+	{
+		// No erased block: erase a dirty one now.
+		block = ftlPickFree(ftl, FLASH_FTL_BLOCK_DIRTY, cold);
+		if(block == ftl->numBlocks)
+		{
+			printf("FTL out of blocks.\n");
+			return 0;
+		}
+		if(block != ftl->erasingBlock)
+		{
+			ftlEraseBlock(ftl, block, 1);
+		}
+	}
+	ftlFinishErase(ftl);
+
+	ftlPut32(sequence, ftl->nextSequence);
+	flashDeviceProgram(ftl->device, ftlBlockAddress(ftl, block) + 8, sequence, sizeof(sequence));
+	ftl->state[block] = FLASH_FTL_BLOCK_USED;
+	ftl->valid[block] = 0;
+	ftl->sequence[block] = ftl->nextSequence++;
+	ftl->freeBlocks--;
+	if(cold)
+	{
+		ftl->coldBlock = block;
+		ftl->coldIndex = 1;
+	}
+	else
+	{
+		ftl->activeBlock = block;
+		ftl->activeIndex = 1;
+	}
+	return 1;
+}
+
+// Closes the active block if the current copy of a logical page is in a
+// block opened after it, the cold one: the new copy must go to a later
+// block to be found by the next mount.
+static void ftlKeepOrder(FLASH_Ftl *ftl, uint16_t logical)
+{
+	uint16_t current = ftl->map[logical];
+	if((ftl->activeBlock != ftl->numBlocks) && (current != FLASH_FTL_UNMAPPED) &&
+	   (ftl->sequence[current / ftl->pagesPerBlock] > ftl->sequence[ftl->activeBlock]))
+	{
+		ftl->activeIndex = ftl->pagesPerBlock;
+	}
+}
+
+// Drops the current copy of a logical page.
+static void ftlUnmap(FLASH_Ftl *ftl, uint16_t logical)
+{
+	uint16_t block;
+	if(ftl->map[logical] == FLASH_FTL_UNMAPPED)
+	{
+		return;
+	}
+	block = ftl->map[logical] / ftl->pagesPerBlock;
+	ftl->map[logical] = FLASH_FTL_UNMAPPED;
+	// A block whose pages are all stale needs no copying, only erasing.
+	if((--ftl->valid[block] == 0) && (block != ftl->activeBlock) && (block != ftl->gcBlock) && (block != ftl->coldBlock))
+	{
+		ftl->state[block] = FLASH_FTL_BLOCK_DIRTY;
+		ftl->freeBlocks++;
+	}
+}
+
+// Writes a logical page to the next page of the active block, or of the
+// cold block if 'cold' is set.
+static uint8_t ftlProgram(FLASH_Ftl *ftl, uint16_t logical, uint8_t *data, uint8_t cold)
+{
+	uint16_t *block = cold ? &ftl->coldBlock : &ftl->activeBlock;
+	uint8_t *index = cold ? &ftl->coldIndex : &ftl->activeIndex;
+	uint16_t physical;
+	if(!cold)
+	{
+		ftlKeepOrder(ftl, logical);
+	}
+	if((*block == ftl->numBlocks) || (*index == ftl->pagesPerBlock))
+	{
+		if(!ftlOpenBlock(ftl, cold))
+		{
+			return 0;
+		}
+	}
+	ftlFinishErase(ftl);
+	physical = *block * ftl->pagesPerBlock + *index;
+	// Data first, then the entry: a reset in between leaves the old copy valid.
+	flashDeviceProgram(ftl->device, ftlPageAddress(ftl, physical), data, ftl->pageSize);
+	ftlWriteEntry(ftl, *block, *index, logical);
+	ftlUnmap(ftl, logical);
+	ftl->map[logical] = physical;
+	ftl->valid[*block]++;
+	(*index)++;
+	ftl->stats.flashPages++;
+	return 1;
+}
+
+// The used block with the fewest live pages, if it has any stale ones.
+static uint16_t ftlPickVictim(const FLASH_Ftl *ftl)
+{
+	uint16_t victim = ftl->numBlocks;
+	uint8_t fewest = ftl->pagesPerBlock - 1;
+	uint16_t block;
+	for(block = 0; block < ftl->numBlocks; block++)
+	{
+		if((ftl->state[block] == FLASH_FTL_BLOCK_USED) &&
+		   !((block == ftl->activeBlock) && (ftl->activeIndex < ftl->pagesPerBlock)) &&
+		   (block != ftl->coldBlock) && (ftl->valid[block] < fewest))
+		{
+			victim = block;
+			fewest = ftl->valid[block];
+		}
+	}
+	return victim;
+}
+
+// The used block with the fewest erases, if the spread of erase counts
+// exceeds FLASH_FTL_WEAR_THRESHOLD. Its data has not been rewritten for
+// the longest time.
+static uint16_t ftlPickCold(const FLASH_Ftl *ftl)
+{
+	uint16_t cold = ftl->numBlocks;
+	uint32_t maximum = 0;
+	uint16_t block;
+	for(block = 0; block < ftl->numBlocks; block++)
+	{
+		if(ftl->eraseCount[block] > maximum)
+		{
+			maximum = ftl->eraseCount[block];
+		}
+		if((ftl->state[block] == FLASH_FTL_BLOCK_USED) &&
+		   !((block == ftl->activeBlock) && (ftl->activeIndex < ftl->pagesPerBlock)) &&
+		   (block != ftl->coldBlock) && ((cold == ftl->numBlocks) || (ftl->eraseCount[block] < ftl->eraseCount[cold])))
+		{
+			cold = block;
+		}
+	}
+	if((cold == ftl->numBlocks) || (maximum - ftl->eraseCount[cold] <= FLASH_FTL_WEAR_THRESHOLD))
+	{
+		return ftl->numBlocks;
+	}
+	return cold;
+}
+
+// Makes 'block' the one being emptied.
+static void ftlStartCollect(FLASH_Ftl *ftl, uint16_t block, uint8_t cold)
+{
+	uint8_t index;
+	ftl->gcBlock = block;
+	ftl->gcCold = cold;
+	ftlFinishErase(ftl);
+	ftlReadHeader(ftl, block);
+	for(index = 1; index < ftl->pagesPerBlock; index++)
+	{
+		ftl->gcEntries[index - 1] = ftlHeaderEntry(ftl, index);
+	}
+	ftl->gcIndex = 1;
+}
+
+// Moves one live page out of the victim block, choosing a victim first if
+// needed, or retires the victim once it is empty. Returns 0 if there is no
+// block worth collecting.
+static uint8_t ftlCollectStep(FLASH_Ftl *ftl)
+{
+	uint16_t victim;
+	if(ftl->gcBlock == ftl->numBlocks)
+	{
+		victim = ftlPickVictim(ftl);
+		if(victim == ftl->numBlocks)
+		{
+			return 0;
+		}
+		ftlStartCollect(ftl, victim, 0);
+	}
+	while(ftl->gcIndex < ftl->pagesPerBlock)
+	{
+		uint8_t index = ftl->gcIndex++;
+		uint16_t logical = ftl->gcEntries[index - 1];
+		uint16_t physical = ftl->gcBlock * ftl->pagesPerBlock + index;
+		if((logical < ftl->numPages) && (ftl->map[logical] == physical))
+		{
+			ftlFinishErase(ftl);
+			flashDeviceRead(ftl->device, ftlPageAddress(ftl, physical), ftl->pageBuffer, ftl->pageSize);
+			ftl->stats.moves++;
+			return ftlProgram(ftl, logical, ftl->pageBuffer, ftl->gcCold);
+		}
+	}
+	victim = ftl->gcBlock;
+	ftl->gcBlock = ftl->numBlocks;
+	// The cold block holds the pages of one block at most; it is closed so
+	// that no later migration puts pages behind newer blocks.
+	ftl->gcCold = 0;
+	ftl->coldBlock = ftl->numBlocks;
+	ftl->state[victim] = FLASH_FTL_BLOCK_DIRTY;
+	ftl->freeBlocks++;
+	return 1;
+}
+
+// Before a write that needs a new block, collects until one block is left
+// over for garbage collection itself.
+static void ftlMakeRoom(FLASH_Ftl *ftl)
+{
+	if((ftl->activeBlock != ftl->numBlocks) && (ftl->activeIndex < ftl->pagesPerBlock))
+	{
+		return;
+	}
+	while((ftl->freeBlocks < 2) && ftlCollectStep(ftl))
+	{
+	}
+}
+
+uint8_t flashFtlMount(FLASH_Ftl *ftl, const FLASH_Device *device, uint32_t address, uint32_t numBytes)
+{
+	uint32_t highest = 0;
+	uint64_t knownCount = 0;
+	uint32_t numKnown = 0;
+	uint16_t block;
+	uint8_t index;
+
+	ftl->device = device;
+	ftl->baseAddress = address;
+	ftl->pageSize = device->pageSize;
+	ftl->pagesPerBlock = (uint8_t) (device->eraseSize / device->pageSize);
+	ftl->numBlocks = (uint16_t) (numBytes / device->eraseSize);
+	if((ftl->pageSize > FLASH_FTL_PAGE_BUFFER_SIZE) ||
+	   (ftl->pagesPerBlock < 2) || (ftl->pagesPerBlock > FLASH_FTL_MAX_PAGES_PER_BLOCK) ||
+	   (FLASH_FTL_HEADER_BYTES + 2 * (ftl->pagesPerBlock - 1) > ftl->pageSize) ||
+	   (address % device->eraseSize) ||
+	   (ftl->numBlocks <= FLASH_FTL_SPARE_BLOCKS) || (ftl->numBlocks > FLASH_FTL_MAX_BLOCKS))
+	{
+		printf("FTL geometry not supported: %u byte pages, %u byte blocks, %u blocks.\n",
+			   (unsigned) device->pageSize, (unsigned) device->eraseSize, ftl->numBlocks);
+		return 0;
+	}
+	ftl->numPages = (ftl->numBlocks - FLASH_FTL_SPARE_BLOCKS) * (ftl->pagesPerBlock - 1);
+	// An erase started before a remount may still be running.
+	flashDeviceWaitOnReady(device, 0);
+	memset(ftl->map, 0xFF, sizeof(ftl->map));
+	memset(&ftl->stats, 0, sizeof(ftl->stats));
+	ftl->nextSequence = 0;
+	ftl->activeBlock = ftl->numBlocks;
+	ftl->activeIndex = 0;
+	ftl->freeBlocks = 0;
+	ftl->gcBlock = ftl->numBlocks;
+	ftl->gcCold = 0;
+	ftl->coldBlock = ftl->numBlocks;
+	ftl->wearCheck = 0;
+	ftl->erasingBlock = ftl->numBlocks;
+
+	for(block = 0; block < ftl->numBlocks; block++)
+	{
+		ftl->valid[block] = 0;
+		ftlReadHeader(ftl, block);
+		if(ftlGet32(&ftl->pageBuffer[0]) != FLASH_FTL_MAGIC)
+		{
+			// Not ours, or an erase was cut short: usable as is only if the
+			// whole block is blank. Its erase count is estimated below.
+			uint32_t offset;
+			ftl->eraseCount[block] = FLASH_FTL_SEQUENCE_NONE;
+			ftl->state[block] = FLASH_FTL_BLOCK_ERASED;
+			for(offset = 0; (offset < device->eraseSize) && (ftl->state[block] == FLASH_FTL_BLOCK_ERASED); offset += ftl->pageSize)
+			{
+				flashDeviceRead(device, ftlBlockAddress(ftl, block) + offset, ftl->pageBuffer, ftl->pageSize);
+				if(!blankCheck(ftl->pageBuffer, ftl->pageSize, NULL))
+				{
+					ftl->state[block] = FLASH_FTL_BLOCK_DIRTY;
+				}
+			}
+			ftl->freeBlocks++;
+			continue;
+		}
+		ftl->eraseCount[block] = ftlGet32(&ftl->pageBuffer[4]);
+		knownCount += ftl->eraseCount[block];
+		numKnown++;
+		ftl->sequence[block] = ftlGet32(&ftl->pageBuffer[8]);
+		if(ftl->sequence[block] == FLASH_FTL_SEQUENCE_NONE)
+		{
+			ftl->state[block] = FLASH_FTL_BLOCK_ERASED;
+			ftl->freeBlocks++;
+			continue;
+		}
+		ftl->state[block] = FLASH_FTL_BLOCK_USED;
+		if((ftl->activeBlock == ftl->numBlocks) || (ftl->sequence[block] >= highest))
+		{
+			highest = ftl->sequence[block];
+			ftl->activeBlock = block;
+		}
+		for(index = 1; index < ftl->pagesPerBlock; index++)
+		{
+			uint16_t logical = ftlHeaderEntry(ftl, index);
+			uint16_t physical = block * ftl->pagesPerBlock + index;
+			uint16_t current;
+			if(logical == FLASH_FTL_ENTRY_FREE)
+			{
+				break;
+			}
+			if(logical >= ftl->numPages)
+			{
+				continue;
+			}
+			// Keep the later copy: higher block sequence, or further into the block.
+			current = ftl->map[logical];
+			if((current != FLASH_FTL_UNMAPPED) &&
+			   (ftl->sequence[current / ftl->pagesPerBlock] > ftl->sequence[block]))
+			{
+				continue;
+			}
+			if(current != FLASH_FTL_UNMAPPED)
+			{
+				ftl->valid[current / ftl->pagesPerBlock]--;
+			}
+			ftl->map[logical] = physical;
+			ftl->valid[block]++;
+		}
+	}
+	ftl->nextSequence = highest + 1;
+
+	// Blocks that lost their header get the average erase count.
+	for(block = 0; block < ftl->numBlocks; block++)
+	{
+		if(ftl->eraseCount[block] == FLASH_FTL_SEQUENCE_NONE)
+		{
+			ftl->eraseCount[block] = numKnown ? (uint32_t) (knownCount / numKnown) : 0;
+			if(ftl->state[block] == FLASH_FTL_BLOCK_ERASED)
+			{
+				ftlFormatBlock(ftl, block);
+			}
+		}
+	}
+
+	// Resume writing the most recent block after its last recorded page,
+	// skipping a page programmed without its entry.
+	if(ftl->activeBlock != ftl->numBlocks)
+	{
+		ftlReadHeader(ftl, ftl->activeBlock);
+		for(index = 1; (index < ftl->pagesPerBlock) && (ftlHeaderEntry(ftl, index) != FLASH_FTL_ENTRY_FREE); index++)
+		{
+		}
+		ftl->activeIndex = index;
+		while(ftl->activeIndex < ftl->pagesPerBlock)
+		{
+			flashDeviceRead(device, ftlPageAddress(ftl, ftl->activeBlock * ftl->pagesPerBlock + ftl->activeIndex), ftl->pageBuffer, ftl->pageSize);
+			if(blankCheck(ftl->pageBuffer, ftl->pageSize, NULL))
+			{
+				break;
+			}
+			ftlWriteEntry(ftl, ftl->activeBlock, ftl->activeIndex, FLASH_FTL_ENTRY_DEAD);
+			ftl->activeIndex++;
+		}
+	}
+
+	// Blocks left with no live pages only need erasing.
+	for(block = 0; block < ftl->numBlocks; block++)
+	{
+		if((ftl->state[block] == FLASH_FTL_BLOCK_USED) && (ftl->valid[block] == 0) && (block != ftl->activeBlock))
+		{
+			ftl->state[block] = FLASH_FTL_BLOCK_DIRTY;
+			ftl->freeBlocks++;
+		}
+	}
+	return 1;
+}
+
+uint8_t flashFtlRead(FLASH_Ftl *ftl, uint32_t address, uint8_t *rxBuffer, uint32_t rxNumBytes)
+{
+	uint32_t capacity = flashFtlCapacity(ftl);
+	if((address > capacity) || (rxNumBytes > capacity - address))
+	{
+		return 0;
+	}
+	ftlFinishErase(ftl);
+	while(rxNumBytes > 0)
+	{
+		uint16_t physical = ftl->map[address / ftl->pageSize];
+		uint32_t offset = address % ftl->pageSize;
+		uint32_t chunk = ftl->pageSize - offset;
+		if(chunk > rxNumBytes)
+			chunk = rxNumBytes;
+		if(physical == FLASH_FTL_UNMAPPED)
+		{
+			memset(rxBuffer, 0xFF, chunk);
+		}
+		else
+		{
+			flashDeviceRead(ftl->device, ftlPageAddress(ftl, physical) + offset, rxBuffer, chunk);
+		}
+		address += chunk;
+		rxBuffer += chunk;
+		rxNumBytes -= chunk;
+	}
+	return 1;
+}
+
+uint8_t flashFtlWrite(FLASH_Ftl *ftl, uint32_t address, uint8_t *txBuffer, uint32_t txNumBytes)
+{
+	uint32_t capacity = flashFtlCapacity(ftl);
+	if((address > capacity) || (txNumBytes > capacity - address))
+	{
+		return 0;
+	}
+	while(txNumBytes > 0)
+	{
+		uint16_t logical = (uint16_t) (address / ftl->pageSize);
+		uint32_t offset = address % ftl->pageSize;
+		uint32_t chunk = ftl->pageSize - offset;
+		uint8_t *data = txBuffer;
+		if(chunk > txNumBytes)
+			chunk = txNumBytes;
+		// Collect first: it uses pageBuffer.
+		ftlKeepOrder(ftl, logical);
+		ftlMakeRoom(ftl);
+		if(chunk < ftl->pageSize)
+		{
+			flashFtlRead(ftl, logical * ftl->pageSize, ftl->pageBuffer, ftl->pageSize);
+			memcpy(&ftl->pageBuffer[offset], txBuffer, chunk);
+			data = ftl->pageBuffer;
+		}
+		if(!ftlProgram(ftl, logical, data, 0))
+		{
+			return 0;
+		}
+		ftl->stats.hostPages++;
+		address += chunk;
+		txBuffer += chunk;
+		txNumBytes -= chunk;
+	}
+	return 1;
+}
+
+uint8_t flashFtlCollect(FLASH_Ftl *ftl, uint32_t maxMoves)
+{
+	uint32_t moves = 0;
+	uint16_t block;
+	for(;;)
+	{
+		if(ftl->erasingBlock != ftl->numBlocks)
+		{
+			if((ftl->device->isBusy != NULL) && flashDeviceIsBusy(ftl->device))
+			{
+				return 1;
+			}
+			ftlFinishErase(ftl);
+		}
+		for(block = 0; block < ftl->numBlocks; block++)
+		{
+			if(ftl->state[block] == FLASH_FTL_BLOCK_DIRTY)
+			{
+				break;
+			}
+		}
+		if(block < ftl->numBlocks)
+		{
+			ftlEraseBlock(ftl, block, 0);
+			continue;
+		}
+		// At most one cold block is migrated per FLASH_FTL_WEAR_INTERVAL erases.
+		if((ftl->gcBlock == ftl->numBlocks) && (ftl->stats.erases - ftl->wearCheck >= FLASH_FTL_WEAR_INTERVAL))
+		{
+			ftl->wearCheck = ftl->stats.erases;
+			block = ftlPickCold(ftl);
+			if(block != ftl->numBlocks)
+			{
+				ftlStartCollect(ftl, block, 1);
+				ftl->stats.migrations++;
+			}
+		}
+		if((ftl->freeBlocks >= FLASH_FTL_FREE_TARGET) && (ftl->gcBlock == ftl->numBlocks))
+		{
+			return 0;
+		}
+		// Never pause with no free block: the writes in between could then
+		// leave no room to finish the victim.
+		if((moves >= maxMoves) && (ftl->freeBlocks > 0))
+		{
+			return 1;
+		}
+		moves -= ftl->stats.moves;
+		if(!ftlCollectStep(ftl))
+		{
+			return 0;
+		}
+		moves += ftl->stats.moves;
+	}
+}
+
+void flashFtlWear(const FLASH_Ftl *ftl, uint32_t *minimum, uint32_t *maximum)
+{
+	uint16_t block;
+	*minimum = ftl->eraseCount[0];
+	*maximum = ftl->eraseCount[0];
+	for(block = 1; block < ftl->numBlocks; block++)
+	{
+		if(ftl->eraseCount[block] < *minimum)
+			*minimum = ftl->eraseCount[block];
+		if(ftl->eraseCount[block] > *maximum)
+			*maximum = ftl->eraseCount[block];
+	}
+}
+
+uint32_t flashFtlCapacity(const FLASH_Ftl *ftl)
+{
+	return ftl->numPages * ftl->pageSize;
+}
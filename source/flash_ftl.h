@@ -0,0 +1,314 @@
+/*
+ * The Clear BSD License
+ * Copyright (c) 2018 Adesto Technologies Corporation, Inc
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted (subject to the limitations in the disclaimer below) provided
+ *  that the following conditions are met:
+ *
+ * o Redistributions of source code must retain the above copyright notice, this list
+ *   of conditions and the following disclaimer.
+ *
+ * o Redistributions in binary form must reproduce the above copyright notice, this
+ *   list of conditions and the following disclaimer in the documentation and/or
+ *   other materials provided with the distribution.
+ *
+ * o Neither the name of the copyright holder nor the names of its
+ *   contributors may be used to endorse or promote products derived from this
+ *   software without specific prior written permission.
+ *
+ * NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE GRANTED BY THIS LICENSE.
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*!
+ * @ingroup ADESTO_LAYER
+ */
+/**
+ * @file    flash_ftl.h
+ * @brief   Declarations of the page-mapped flash translation layer.
+ *
+ * The FTL presents a range of the array as logical pages that can be
+ * rewritten at will, as needed by small random writes. Rewriting a page in
+ * place would mean reading, erasing and reprogramming its whole erase unit
+ * (4 KB on standard flash). Instead every write goes to the next erased
+ * page, a RAM table maps each logical page to the physical page that holds
+ * its latest copy, and the copies left behind are reclaimed later by
+ * copying the live pages out of a block and erasing it. flashFtlCollect()
+ * does this in small steps and is meant to be called while the application
+ * is idle, so writes seldom wait for an erase.
+ *
+ * A block is one erase unit of the device. Its first page is a header: a
+ * magic number and the erase count of the block, written as soon as it is
+ * erased, the sequence number of the block, written when it is opened, and
+ * one 16 bit entry per data page holding the logical page stored there. The
+ * entry is programmed into the erased header after the data, so
+ * flashFtlMount() rebuilds the table from the headers alone, and a write cut
+ * short by a reset leaves the previous copy of the page in force. Of two
+ * copies of a logical page, the one in the block with the higher sequence
+ * number, or further into the same block, is the latest.
+ *
+ * Wear is levelled in two ways. New data goes to the erased block with the
+ * fewest erases (dynamic levelling), which alone leaves blocks holding data
+ * that never changes at a low count. So every @ref FLASH_FTL_WEAR_INTERVAL
+ * erases, flashFtlCollect() also empties the least worn used block if its
+ * count trails the most worn by more than @ref FLASH_FTL_WEAR_THRESHOLD
+ * (static levelling). That data is moved to the most worn erased block,
+ * which receives nothing else, and the young block returns to the pool. The
+ * migration only runs from flashFtlCollect() and within its page budget, so
+ * it does not delay writes. A page rewritten while its latest copy is in a
+ * block opened after the one receiving writes goes to a new block, so that
+ * the later copy is still found by the rule above.
+ *
+ * @ref FLASH_FTL_SPARE_BLOCKS blocks are held back from the logical capacity
+ * so that a block with stale pages can always be found.
+ *
+ * The erase unit must span several pages, as the 4 KB block of standard
+ * flash does. Parts that erase single pages (DataFlash, and Fusion through
+ * FLASH_Device) can rewrite a page in place and do not need the FTL.
+ */
+#ifndef FLASH_FTL_H_
+#define FLASH_FTL_H_
+
+#include "flash_device.h"
+
+//! Largest number of blocks managed. Sizes the RAM tables.
+#ifndef FLASH_FTL_MAX_BLOCKS
+#define FLASH_FTL_MAX_BLOCKS 256U
+#endif
+
+//! Largest number of pages in a block, header page included.
+#ifndef FLASH_FTL_MAX_PAGES_PER_BLOCK
+#define FLASH_FTL_MAX_PAGES_PER_BLOCK 16U
+#endif
+
+//! Largest page size supported.
+#ifndef FLASH_FTL_PAGE_BUFFER_SIZE
+#define FLASH_FTL_PAGE_BUFFER_SIZE 256U
+#endif
+
+//! Blocks not counted in the logical capacity, at least 2. More spare blocks
+//! mean fewer live pages to move per block reclaimed.
+#ifndef FLASH_FTL_SPARE_BLOCKS
+#define FLASH_FTL_SPARE_BLOCKS 16U
+#endif
+
+//! flashFtlCollect() stops once this many blocks are erased or waiting to be.
+#ifndef FLASH_FTL_FREE_TARGET
+#define FLASH_FTL_FREE_TARGET 3U
+#endif
+
+//! Erases between checks for cold data to migrate.
+#ifndef FLASH_FTL_WEAR_INTERVAL
+#define FLASH_FTL_WEAR_INTERVAL 32U
+#endif
+
+//! Largest spread of erase counts tolerated before cold data is migrated.
+#ifndef FLASH_FTL_WEAR_THRESHOLD
+#define FLASH_FTL_WEAR_THRESHOLD 16U
+#endif
+
+//! Header magic number, "FTL2".
+#define FLASH_FTL_MAGIC 0x324C5446UL
+
+//! Header sequence number of a block erased but not yet opened.
+#define FLASH_FTL_SEQUENCE_NONE 0xFFFFFFFFUL
+
+//! Map entry of a logical page never written.
+#define FLASH_FTL_UNMAPPED 0xFFFFU
+
+//! Header entry of a data page not yet written.
+#define FLASH_FTL_ENTRY_FREE 0xFFFFU
+
+//! Header entry of a data page that was written but not recorded (cut short
+//! by a reset); it is skipped.
+#define FLASH_FTL_ENTRY_DEAD 0xFFFEU
+
+//! Bytes of the header before the entries: magic number, erase count and
+//! sequence number.
+#define FLASH_FTL_HEADER_BYTES 12U
+
+#if (FLASH_FTL_SPARE_BLOCKS < 2)
+#error FLASH_FTL_SPARE_BLOCKS must be at least 2.
+#endif
+
+#if (FLASH_FTL_MAX_BLOCKS * FLASH_FTL_MAX_PAGES_PER_BLOCK > FLASH_FTL_ENTRY_DEAD)
+#error Physical page numbers must fit in 16 bits.
+#endif
+
+/*!
+ * @brief States of a block.
+ */
+enum flashFtlBlockState
+{
+	FLASH_FTL_BLOCK_ERASED,	//!< Erased, ready to be written.
+	FLASH_FTL_BLOCK_DIRTY,	//!< No live pages, to be erased.
+	FLASH_FTL_BLOCK_USED	//!< Holds a header and data pages.
+};
+
+/*!
+ * @brief Usage counters of an FTL.
+ */
+typedef struct
+{
+	//! Pages written by flashFtlWrite().
+	uint32_t hostPages;
+	//! Pages programmed, including those moved by garbage collection.
+	uint32_t flashPages;
+	//! Live pages moved by garbage collection.
+	uint32_t moves;
+	//! Blocks erased.
+	uint32_t erases;
+	//! Blocks of cold data migrated to level wear.
+	uint32_t migrations;
+} FLASH_FtlStats;
+
+/*!
+ * @brief A mounted FTL.
+ */
+typedef struct
+{
+	//! The device holding the blocks.
+	const FLASH_Device *device;
+	//! Device address of block 0.
+	uint32_t baseAddress;
+	//! Number of blocks.
+	uint16_t numBlocks;
+	//! Pages per block, header page included.
+	uint8_t pagesPerBlock;
+	//! Page size in bytes, the device page size.
+	uint32_t pageSize;
+	//! Number of logical pages.
+	uint32_t numPages;
+	//! Physical page (block * pagesPerBlock + index) of each logical page,
+	//! or @ref FLASH_FTL_UNMAPPED.
+	uint16_t map[FLASH_FTL_MAX_BLOCKS * (FLASH_FTL_MAX_PAGES_PER_BLOCK - 1)];
+	//! flashFtlBlockState of each block.
+	uint8_t state[FLASH_FTL_MAX_BLOCKS];
+	//! Live pages in each block.
+	uint8_t valid[FLASH_FTL_MAX_BLOCKS];
+	//! Sequence number of each used block.
+	uint32_t sequence[FLASH_FTL_MAX_BLOCKS];
+	//! Times each block has been erased.
+	uint32_t eraseCount[FLASH_FTL_MAX_BLOCKS];
+	//! Sequence number of the next block opened.
+	uint32_t nextSequence;
+	//! Block receiving writes, or numBlocks if none.
+	uint16_t activeBlock;
+	//! Next page of the active block to be written.
+	uint8_t activeIndex;
+	//! Number of blocks erased or dirty.
+	uint16_t freeBlocks;
+	//! Block being emptied by garbage collection, or numBlocks if none.
+	uint16_t gcBlock;
+	//! Next page of that block to be looked at.
+	uint8_t gcIndex;
+	//! 1 if that block is being emptied to level wear.
+	uint8_t gcCold;
+	//! Block receiving the pages of that block, or numBlocks if none.
+	uint16_t coldBlock;
+	//! Next page of the cold block to be written.
+	uint8_t coldIndex;
+	//! stats.erases when cold data was last looked for.
+	uint32_t wearCheck;
+	//! Logical page of each data page of that block, from its header.
+	uint16_t gcEntries[FLASH_FTL_MAX_PAGES_PER_BLOCK - 1];
+	//! Block being erased in the background, or numBlocks if none.
+	uint16_t erasingBlock;
+	//! USER_CONFIG_CycleCount64() when that erase started.
+	uint64_t eraseStart;
+	//! Holds pages being moved or partially written.
+	uint8_t pageBuffer[FLASH_FTL_PAGE_BUFFER_SIZE];
+	//! Usage counters.
+	FLASH_FtlStats stats;
+} FLASH_Ftl;
+
+/*!
+ * @brief Mounts the FTL kept in a range of the device, rebuilding its tables
+ * from the block headers. Blocks without a header that are not blank are
+ * queued for erasing, so a blank or foreign range becomes an empty FTL.
+ *
+ * @param ftl The FTL.
+ * @param device The device. Must stay valid while the FTL is used.
+ * @param address Device address of the range, on an erase unit boundary.
+ * @param numBytes Size of the range; whole erase units are used.
+ *
+ * @retval 1 The FTL is mounted.
+ * @retval 0 The geometry of the device or the range is not supported.
+ */
+uint8_t flashFtlMount(FLASH_Ftl *ftl, const FLASH_Device *device, uint32_t address, uint32_t numBytes);
+
+/*!
+ * @brief Reads logical bytes. Pages never written read as 0xFF.
+ *
+ * @param ftl The FTL.
+ * @param address Logical address of the first byte.
+ * @param rxBuffer Receives the data.
+ * @param rxNumBytes Number of bytes to read.
+ *
+ * @retval 1 Done.
+ * @retval 0 The range exceeds the logical capacity.
+ */
+uint8_t flashFtlRead(FLASH_Ftl *ftl, uint32_t address, uint8_t *rxBuffer, uint32_t rxNumBytes);
+
+/*!
+ * @brief Writes logical bytes. Each logical page touched is written to a new
+ * physical page; partially written pages are merged with their old contents.
+ * Garbage collection runs first if no more than one block is free.
+ *
+ * @param ftl The FTL.
+ * @param address Logical address of the first byte.
+ * @param txBuffer The data.
+ * @param txNumBytes Number of bytes to write.
+ *
+ * @retval 1 Done.
+ * @retval 0 The range exceeds the logical capacity.
+ */
+uint8_t flashFtlWrite(FLASH_Ftl *ftl, uint32_t address, uint8_t *txBuffer, uint32_t txNumBytes);
+
+/*!
+ * @brief Does a bounded amount of background work: moves up to 'maxMoves'
+ * live pages out of the block with the fewest live pages and erases emptied
+ * blocks, until @ref FLASH_FTL_FREE_TARGET blocks are free, and migrates
+ * cold data to level wear. Erases are
+ * started without waiting where the family allows.
+ *
+ * @param ftl The FTL.
+ * @param maxMoves Largest number of pages to move.
+ *
+ * @retval 1 More work remains.
+ * @retval 0 Nothing left to do.
+ */
+uint8_t flashFtlCollect(FLASH_Ftl *ftl, uint32_t maxMoves);
+
+/*!
+ * @brief Returns the lowest and highest erase counts of the blocks.
+ *
+ * @param ftl The FTL.
+ * @param minimum Receives the lowest count.
+ * @param maximum Receives the highest count.
+ *
+ * @retval void
+ */
+void flashFtlWear(const FLASH_Ftl *ftl, uint32_t *minimum, uint32_t *maximum);
+
+/*!
+ * @brief Returns the logical capacity in bytes.
+ *
+ * @param ftl The FTL.
+ *
+ * @retval uint32_t The capacity.
+ */
+uint32_t flashFtlCapacity(const FLASH_Ftl *ftl);
+
+#endif /* FLASH_FTL_H_ */
@@ -0,0 +1,861 @@
+/*
+ * The Clear BSD License
+ * Copyright (c) 2018 Adesto Technologies Corporation, Inc
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted (subject to the limitations in the disclaimer below) provided
+ *  that the following conditions are met:
+ *
+ * o Redistributions of source code must retain the above copyright notice, this list
+ *   of conditions and the following disclaimer.
+ *
+ * o Redistributions in binary form must reproduce the above copyright notice, this
+ *   list of conditions and the following disclaimer in the documentation and/or
+ *   other materials provided with the distribution.
+ *
+ * o Neither the name of the copyright holder nor the names of its
+ *   contributors may be used to endorse or promote products derived from this
+ *   software without specific prior written permission.
+ *
+ * NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE GRANTED BY THIS LICENSE.
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*!
+ * @ingroup ADESTO_LAYER
+ */
+/**
+ * @file    flash_kv.c
+ * @brief   Definition of the key-value store.
+ */
+#include "flash_kv.h"
+#include "helper_functions.h"
+#include <string.h>
+
+static uint32_t kvGet32(const uint8_t *bytes)
+{
+	return (uint32_t) bytes[0] | ((uint32_t) bytes[1] << 8) | ((uint32_t) bytes[2] << 16) | ((uint32_t) bytes[3] << 24);
+}
+
+static void kvPut32(uint8_t *bytes, uint32_t value)
+{
+	bytes[0] = (uint8_t) value;
+	bytes[1] = (uint8_t) (value >> 8);
+	bytes[2] = (uint8_t) (value >> 16);
+	bytes[3] = (uint8_t) (value >> 24);
+}
+
+// FNV-1a, folded to 16 bits.
+static uint16_t kvHash(const uint8_t *key, uint32_t keyBytes)
+{
+	uint32_t hash = 2166136261UL;
+	uint32_t i;
+	for(i = 0; i < keyBytes; i++)
+	{
+		hash = (hash ^ key[i]) * 16777619UL;
+	}
+	return (uint16_t) (hash ^ (hash >> 16));
+}
+
+static uint32_t kvSlot(uint16_t hash)
+{
+	return hash & (FLASH_KV_INDEX_SIZE - 1U);
+}
+
+// Waits for the erase running in the background, if any.
+static void kvWaitDevice(FLASH_Kv *kv)
+{
+	if(!kv->busy)
+	{
+		return;
+	}
+	flashDeviceWaitOnReadySince(kv->device, kv->busyStart, flashPartSmallestErase(kv->device->part)->time.typicalUs);
+	kv->busy = 0;
+}
+
+// Erases a range from its start on, leaving the last erase unit running in
+// the background where the family allows.
+static void kvErase(FLASH_Kv *kv, uint32_t address, uint32_t numBytes)
+{
+	uint32_t end = address + numBytes;
+	for(; address < end; address += kv->device->eraseSize)
+	{
+		kvWaitDevice(kv);
+		if(kv->device->eraseStart != NULL)
+		{
+			flashDeviceEraseStart(kv->device, address);
+			kv->busy = 1;
+			kv->busyStart = USER_CONFIG_CycleCount64();
+		}
+		else
+		{
+			flashDeviceErase(kv->device, address);
+		}
+		kv->stats.erases++;
+	}
+}
+
+// Erases a block from its header on, so that a reset part way leaves no
+// header behind.
+static void kvEraseBlock(FLASH_Kv *kv, uint32_t block)
+{
+	kvErase(kv, kv->baseAddress + block * kv->blockSize, kv->blockSize);
+	kv->erased[block] = 1;
+	kv->windowBytes = 0;
+}
+
+// Starts the head at 'block', which must be erased, with its header.
+static void kvOpenBlock(FLASH_Kv *kv, uint32_t block)
+{
+	uint8_t header[FLASH_KV_BLOCK_HEADER_BYTES];
+	kvPut32(&header[0], FLASH_KV_MAGIC);
+	kvPut32(&header[4], kv->blockSequence);
+	kvWaitDevice(kv);
+	flashDeviceProgram(kv->device, kv->baseAddress + block * kv->blockSize, header, sizeof(header));
+	kv->erased[block] = 0;
+	kv->headBlock = block;
+	kv->headOffset = FLASH_KV_BLOCK_HEADER_BYTES;
+}
+
+// Moves the head to the next block, which must be free.
+static void kvAdvance(FLASH_Kv *kv)
+{
+	uint32_t block = (kv->headBlock + 1) % kv->numBlocks;
+	if(!kv->erased[block])
+	{
+		kvEraseBlock(kv, block);
+	}
+	kv->blockSequence++;
+	kvOpenBlock(kv, block);
+	kv->checkpointBlocks++;
+}
+
+// Returns the length of a record from its header.
+static uint32_t kvRecordBytes(const uint8_t *record)
+{
+	uint32_t valueBytes = record[6] | (record[7] << 8);
+	return FLASH_KV_RECORD_HEADER_BYTES + record[4] + ((valueBytes == FLASH_KV_DELETED) ? 0 : valueBytes);
+}
+
+// Checks a record of at most 'numBytes' bytes. Returns its length, or 1 if
+// it is damaged.
+static uint32_t kvCheckRecord(const uint8_t *record, uint32_t numBytes)
+{
+	uint32_t keyBytes = record[4];
+	uint32_t valueBytes = record[6] | (record[7] << 8);
+	uint32_t length = kvRecordBytes(record);
+	if(((keyBytes ^ record[5]) != 0xFFU) || (keyBytes == 0) || (keyBytes > FLASH_KV_MAX_KEY_BYTES) ||
+	   ((valueBytes != FLASH_KV_DELETED) && (valueBytes > FLASH_KV_MAX_VALUE_BYTES)))
+	{
+		return 1;
+	}
+	if((length > numBytes) || (crc32(0, &record[4], length - 4) != kvGet32(record)))
+	{
+		return 1;
+	}
+	return length;
+}
+
+// Finds the record at 'offset' of the store, which is left at 'record'.
+// Reads as much of the block as the record buffer holds, so that a run of
+// small records takes one read. Returns the length of the record, 0 if the
+// block has no record there and 1 if the record is damaged.
+static uint32_t kvReadRecord(FLASH_Kv *kv, uint32_t offset, uint8_t **record)
+{
+	uint32_t numBytes = (offset / kv->blockSize + 1) * kv->blockSize - offset;
+	uint32_t held = 0;
+	if(numBytes < FLASH_KV_RECORD_HEADER_BYTES)
+	{
+		return 0;
+	}
+	if(numBytes > FLASH_KV_MAX_RECORD_BYTES)
+	{
+		numBytes = FLASH_KV_MAX_RECORD_BYTES;
+	}
+	if((offset >= kv->windowOffset) && (offset < kv->windowOffset + kv->windowBytes))
+	{
+		held = kv->windowOffset + kv->windowBytes - offset;
+	}
+	// Read on from 'offset' unless the whole record has been read already.
+	if((held < FLASH_KV_RECORD_HEADER_BYTES) ||
+	   ((held < numBytes) && (held < kvRecordBytes(&kv->recordBuffer[offset - kv->windowOffset]))))
+	{
+		kvWaitDevice(kv);
+		flashDeviceRead(kv->device, kv->baseAddress + offset, kv->recordBuffer, numBytes);
+		kv->windowOffset = offset;
+		kv->windowBytes = numBytes;
+	}
+	*record = &kv->recordBuffer[offset - kv->windowOffset];
+	if(blankCheck(*record, FLASH_KV_RECORD_HEADER_BYTES, NULL))
+	{
+		return 0;
+	}
+	return kvCheckRecord(*record, numBytes);
+}
+
+// Looks a key up in the index. Returns the slot holding it, or else the free
+// slot where it goes with 'found' cleared. Keys are compared by reading the
+// header and key of each record whose hash matches; with 'whole' the whole
+// record is read into the record buffer instead.
+static uint32_t kvFind(FLASH_Kv *kv, const uint8_t *key, uint32_t keyBytes, uint16_t hash, uint8_t whole, uint8_t *found)
+{
+	uint8_t stored[FLASH_KV_RECORD_HEADER_BYTES + FLASH_KV_MAX_KEY_BYTES];
+	uint8_t *record = whole ? kv->recordBuffer : stored;
+	uint32_t slot;
+	for(slot = kvSlot(hash); kv->index[slot].offset != FLASH_KV_EMPTY; slot = (slot + 1) & (FLASH_KV_INDEX_SIZE - 1U))
+	{
+		const FLASH_KvEntry *entry = &kv->index[slot];
+		if((entry->hash != hash) || (entry->numBytes < FLASH_KV_RECORD_HEADER_BYTES + keyBytes))
+		{
+			continue;
+		}
+		if(whole)
+		{
+			kv->windowBytes = 0;
+		}
+		flashDeviceRead(kv->device, kv->baseAddress + entry->offset, record,
+						whole ? entry->numBytes : FLASH_KV_RECORD_HEADER_BYTES + keyBytes);
+		if((record[4] == keyBytes) && !memcmp(&record[FLASH_KV_RECORD_HEADER_BYTES], key, keyBytes))
+		{
+			*found = 1;
+			return slot;
+		}
+		kv->stats.collisions++;
+	}
+	*found = 0;
+	return slot;
+}
+
+// Points a slot at a record.
+static void kvSet(FLASH_Kv *kv, uint32_t slot, uint8_t found, uint16_t hash, uint32_t offset, uint32_t numBytes)
+{
+	FLASH_KvEntry *entry = &kv->index[slot];
+	if(found)
+	{
+		kv->live[entry->offset / kv->blockSize] -= entry->numBytes;
+	}
+	else
+	{
+		kv->numKeys++;
+	}
+	entry->offset = offset;
+	entry->hash = hash;
+	entry->numBytes = (uint16_t) numBytes;
+	kv->live[offset / kv->blockSize] += numBytes;
+}
+
+// Empties a slot, moving back the entries after it that would no longer be
+// found past the hole.
+static void kvUnset(FLASH_Kv *kv, uint32_t slot)
+{
+	const uint32_t mask = FLASH_KV_INDEX_SIZE - 1U;
+	uint32_t next = slot;
+	kv->live[kv->index[slot].offset / kv->blockSize] -= kv->index[slot].numBytes;
+	kv->numKeys--;
+	for(;;)
+	{
+		uint32_t home;
+		kv->index[slot].offset = FLASH_KV_EMPTY;
+		do
+		{
+			next = (next + 1) & mask;
+			if(kv->index[next].offset == FLASH_KV_EMPTY)
+			{
+				return;
+			}
+			home = kvSlot(kv->index[next].hash);
+		} while(((next - home) & mask) < ((next - slot) & mask));
+		kv->index[slot] = kv->index[next];
+		slot = next;
+	}
+}
+
+static void kvClearIndex(FLASH_Kv *kv)
+{
+	uint32_t slot;
+	for(slot = 0; slot < FLASH_KV_INDEX_SIZE; slot++)
+	{
+		kv->index[slot].offset = FLASH_KV_EMPTY;
+	}
+	memset(kv->live, 0, sizeof(kv->live));
+	kv->numKeys = 0;
+}
+
+// Appends a record to the head, which must have room for it. Returns its offset.
+static uint32_t kvProgramRecord(FLASH_Kv *kv, uint8_t *record, uint32_t numBytes)
+{
+	uint32_t offset = kv->headBlock * kv->blockSize + kv->headOffset;
+	kvWaitDevice(kv);
+	flashDeviceProgram(kv->device, kv->baseAddress + offset, record, numBytes);
+	kv->headOffset += numBytes;
+	return offset;
+}
+
+// Copies the live records of the oldest block to the head and erases it.
+// Returns 0 if the head ran out of room first, which a reset part way
+// through an earlier compaction can cause.
+static uint8_t kvCompactTail(FLASH_Kv *kv)
+{
+	uint32_t block = kv->tailBlock;
+	uint32_t offset = block * kv->blockSize + FLASH_KV_BLOCK_HEADER_BYTES;
+	uint8_t *record;
+	while(kv->live[block] > 0)
+	{
+		uint32_t length = kvReadRecord(kv, offset, &record);
+		uint32_t slot;
+		if(length <= 1)
+		{
+			break;
+		}
+		if((record[6] | (record[7] << 8)) != FLASH_KV_DELETED)
+		{
+			// The record is live if the index points at it.
+			slot = kvSlot(kvHash(&record[FLASH_KV_RECORD_HEADER_BYTES], record[4]));
+			while((kv->index[slot].offset != FLASH_KV_EMPTY) && (kv->index[slot].offset != offset))
+			{
+				slot = (slot + 1) & (FLASH_KV_INDEX_SIZE - 1U);
+			}
+			if(kv->index[slot].offset == offset)
+			{
+				if(kv->headOffset + length > kv->blockSize)
+				{
+					if(flashKvFreeBlocks(kv) == 0)
+					{
+						return 0;
+					}
+					kvAdvance(kv);
+				}
+				kvSet(kv, slot, 1, kv->index[slot].hash, kvProgramRecord(kv, record, length), length);
+				kv->stats.moves++;
+			}
+		}
+		offset += length;
+	}
+	kv->live[block] = 0;
+	kv->tailBlock = (block + 1) % kv->numBlocks;
+	kvEraseBlock(kv, block);
+	kv->stats.compactions++;
+	return 1;
+}
+
+// Makes room at the head for a record of 'numBytes' bytes, compacting while
+// fewer than 2 blocks are free so that one is always left for compaction.
+static uint8_t kvMakeRoom(FLASH_Kv *kv, uint32_t numBytes)
+{
+	uint32_t rounds = 0;
+	while(kv->headOffset + numBytes > kv->blockSize)
+	{
+		if(flashKvFreeBlocks(kv) >= 2)
+		{
+			kvAdvance(kv);
+		}
+		else if((rounds++ == kv->numBlocks) || !kvCompactTail(kv))
+		{
+			return 0;
+		}
+	}
+	return 1;
+}
+
+// Returns 1 if live records of 'numBytes' bytes in all leave compaction room
+// to work: packed into blocks, each of which may waste the room of almost one
+// record at its end, they must leave 2 blocks free.
+static uint8_t kvFits(const FLASH_Kv *kv, uint32_t numBytes)
+{
+	uint32_t block;
+	for(block = 0; block < kv->numBlocks; block++)
+	{
+		numBytes += kv->live[block];
+	}
+	return numBytes <= (kv->numBlocks - 2) * (kv->blockSize - FLASH_KV_BLOCK_HEADER_BYTES - FLASH_KV_MAX_RECORD_BYTES);
+}
+
+// Replays the records of a block from 'offset' on into the index. Returns the
+// offset after the last record, or the block size if a damaged record ends
+// the block.
+static uint32_t kvReplayBlock(FLASH_Kv *kv, uint32_t block, uint32_t offset)
+{
+	uint8_t *record;
+	for(;;)
+	{
+		uint32_t start = block * kv->blockSize + offset;
+		uint32_t length = kvReadRecord(kv, start, &record);
+		uint32_t slot;
+		uint16_t hash;
+		uint8_t found;
+		if(length == 0)
+		{
+			return offset;
+		}
+		if(length == 1)
+		{
+			return kv->blockSize;
+		}
+		hash = kvHash(&record[FLASH_KV_RECORD_HEADER_BYTES], record[4]);
+		slot = kvFind(kv, &record[FLASH_KV_RECORD_HEADER_BYTES], record[4], hash, 0, &found);
+		if((record[6] | (record[7] << 8)) == FLASH_KV_DELETED)
+		{
+			if(found)
+			{
+				kvUnset(kv, slot);
+			}
+		}
+		else if(found || (kv->numKeys < FLASH_KV_MAX_KEYS))
+		{
+			kvSet(kv, slot, found, hash, start, length);
+		}
+		kv->stats.replayed++;
+		offset += length;
+	}
+}
+
+static uint8_t kvReadBlockHeader(FLASH_Kv *kv, uint32_t block, uint32_t *blockSequence)
+{
+	uint8_t header[FLASH_KV_BLOCK_HEADER_BYTES];
+	flashDeviceRead(kv->device, kv->baseAddress + block * kv->blockSize, header, sizeof(header));
+	*blockSequence = kvGet32(&header[4]);
+	return kvGet32(&header[0]) == FLASH_KV_MAGIC;
+}
+
+// Writes a checkpoint after the last one if it fits, else at the start of
+// the other area, which is erased first. The header is programmed last, so
+// a checkpoint cut short by a reset is not found.
+static void kvWriteCheckpoint(FLASH_Kv *kv)
+{
+	uint32_t numBytes = FLASH_KV_CHECKPOINT_HEADER_BYTES + FLASH_KV_CHECKPOINT_STATE_BYTES + kv->numKeys * 8U;
+	uint8_t header[FLASH_KV_CHECKPOINT_HEADER_BYTES];
+	uint8_t *buffer = kv->recordBuffer;
+	uint32_t address;
+	uint32_t fill = FLASH_KV_CHECKPOINT_STATE_BYTES;
+	uint32_t crc = 0;
+	uint32_t block;
+	uint32_t slot;
+
+	if(kv->checkpointOffset + numBytes > kv->checkpointAreaSize)
+	{
+		kv->checkpointArea ^= 1;
+		kv->checkpointOffset = 0;
+		kvErase(kv, kv->checkpointAddress + kv->checkpointArea * kv->checkpointAreaSize, kv->checkpointAreaSize);
+	}
+	address = kv->checkpointAddress + kv->checkpointArea * kv->checkpointAreaSize + kv->checkpointOffset;
+	kv->windowBytes = 0;
+	memset(buffer, 0, FLASH_KV_CHECKPOINT_STATE_BYTES);
+	kvPut32(&buffer[0], kv->tailBlock);
+	kvPut32(&buffer[4], kv->headBlock);
+	kvPut32(&buffer[8], kv->headOffset);
+	kvPut32(&buffer[12], kv->blockSequence);
+	for(block = 0; block < kv->numBlocks; block++)
+	{
+		buffer[16 + block / 8] |= (uint8_t) (kv->erased[block] << (block % 8));
+	}
+
+	// The entries are programmed through the record buffer, a page at a time.
+	address += FLASH_KV_CHECKPOINT_HEADER_BYTES;
+	for(slot = 0; ; slot++)
+	{
+		if((slot == FLASH_KV_INDEX_SIZE) || ((address + fill) % kv->device->pageSize == 0) ||
+		   (fill + 8U > FLASH_KV_MAX_RECORD_BYTES))
+		{
+			if(fill > 0)
+			{
+				crc = crc32(crc, buffer, fill);
+				kvWaitDevice(kv);
+				flashDeviceProgram(kv->device, address, buffer, fill);
+				address += fill;
+				fill = 0;
+			}
+			if(slot == FLASH_KV_INDEX_SIZE)
+			{
+				break;
+			}
+		}
+		if(kv->index[slot].offset != FLASH_KV_EMPTY)
+		{
+			kvPut32(&buffer[fill], kv->index[slot].offset);
+			buffer[fill + 4] = (uint8_t) kv->index[slot].hash;
+			buffer[fill + 5] = (uint8_t) (kv->index[slot].hash >> 8);
+			buffer[fill + 6] = (uint8_t) kv->index[slot].numBytes;
+			buffer[fill + 7] = (uint8_t) (kv->index[slot].numBytes >> 8);
+			fill += 8U;
+		}
+	}
+
+	kvPut32(&header[0], FLASH_KV_CHECKPOINT_MAGIC);
+	kvPut32(&header[4], numBytes);
+	kvPut32(&header[8], kv->checkpointSequence);
+	kvPut32(&header[12], crc);
+	flashDeviceProgram(kv->device, address - numBytes, header, sizeof(header));
+	kv->checkpointOffset += numBytes;
+	kv->checkpointSequence++;
+	kv->checkpointBlocks = 0;
+	kv->stats.checkpoints++;
+}
+
+// Writes a checkpoint once FLASH_KV_CHECKPOINT_INTERVAL blocks have been
+// opened. Called at the end of the operations, when the record buffer is free.
+static void kvCheckpointDue(FLASH_Kv *kv)
+{
+	if(kv->checkpointBlocks >= FLASH_KV_CHECKPOINT_INTERVAL)
+	{
+		kvWriteCheckpoint(kv);
+	}
+}
+
+// Finds the newest checkpoint and returns 1 with its device address, length
+// and CRC, or 0 if there is none. The next checkpoint is set to go to the
+// other area.
+static uint8_t kvFindCheckpoint(FLASH_Kv *kv, uint32_t *newest, uint32_t *numBytes, uint32_t *crc)
+{
+	uint8_t header[FLASH_KV_CHECKPOINT_HEADER_BYTES];
+	uint8_t found = 0;
+	uint32_t area;
+	uint32_t offset;
+	uint32_t length;
+	uint32_t sequence;
+	kv->checkpointArea = 1;
+	kv->checkpointOffset = kv->checkpointAreaSize;
+	kv->checkpointSequence = 0;
+	for(area = 0; area < 2; area++)
+	{
+		uint32_t address = kv->checkpointAddress + area * kv->checkpointAreaSize;
+		for(offset = 0; offset + FLASH_KV_CHECKPOINT_HEADER_BYTES <= kv->checkpointAreaSize; offset += length)
+		{
+			flashDeviceRead(kv->device, address + offset, header, sizeof(header));
+			length = kvGet32(&header[4]);
+			sequence = kvGet32(&header[8]);
+			if((kvGet32(&header[0]) != FLASH_KV_CHECKPOINT_MAGIC) ||
+			   (length < FLASH_KV_CHECKPOINT_HEADER_BYTES + FLASH_KV_CHECKPOINT_STATE_BYTES) ||
+			   (length > kv->checkpointAreaSize - offset) || (length % 8U))
+			{
+				break;
+			}
+			if(!found || ((int32_t) (sequence - kv->checkpointSequence) >= 0))
+			{
+				found = 1;
+				*newest = address + offset;
+				*numBytes = length;
+				*crc = kvGet32(&header[12]);
+				kv->checkpointArea = area;
+				kv->checkpointSequence = sequence + 1;
+			}
+		}
+	}
+	return found;
+}
+
+// Restores the index from the newest checkpoint. The ring is found from the
+// checkpoint's, reading only the headers of the blocks opened and compacted
+// since. Returns 1 with the position of the journal in 'block' and 'offset',
+// or 0 if there is no usable checkpoint.
+static uint8_t kvLoadCheckpoint(FLASH_Kv *kv, uint32_t *block, uint32_t *offset)
+{
+	uint8_t *buffer = kv->recordBuffer;
+	uint32_t address = 0;
+	uint32_t numBytes = 0;
+	uint32_t expectedCrc = 0;
+	uint32_t n = kv->numBlocks;
+	uint32_t tailBlock;
+	uint32_t headBlock;
+	uint32_t headOffset;
+	uint32_t headSequence;
+	uint32_t sequence;
+	uint32_t done;
+	uint32_t crc;
+	uint32_t i;
+
+	if(!kvFindCheckpoint(kv, &address, &numBytes, &expectedCrc))
+	{
+		return 0;
+	}
+	flashDeviceRead(kv->device, address + FLASH_KV_CHECKPOINT_HEADER_BYTES, buffer, FLASH_KV_CHECKPOINT_STATE_BYTES);
+	crc = crc32(0, buffer, FLASH_KV_CHECKPOINT_STATE_BYTES);
+	tailBlock = kvGet32(&buffer[0]);
+	headBlock = kvGet32(&buffer[4]);
+	headOffset = kvGet32(&buffer[8]);
+	headSequence = kvGet32(&buffer[12]);
+	if((tailBlock >= n) || (headBlock >= n) || (headOffset > kv->blockSize) ||
+	   !kvReadBlockHeader(kv, headBlock, &sequence) || (sequence != headSequence))
+	{
+		// The head of the checkpoint has been compacted since.
+		return 0;
+	}
+
+	// The head is the last of the blocks opened since.
+	kv->headBlock = headBlock;
+	kv->blockSequence = headSequence;
+	while(kvReadBlockHeader(kv, (kv->headBlock + 1) % n, &sequence) && (sequence == kv->blockSequence + 1))
+	{
+		kv->headBlock = (kv->headBlock + 1) % n;
+		kv->blockSequence = sequence;
+	}
+	// The oldest block is the first one compaction has left alone.
+	kv->tailBlock = tailBlock;
+	while((kv->tailBlock != headBlock) &&
+		  (!kvReadBlockHeader(kv, kv->tailBlock, &sequence) ||
+		   (sequence != headSequence - (headBlock + n - kv->tailBlock) % n)))
+	{
+		kv->tailBlock = (kv->tailBlock + 1) % n;
+	}
+	// Free blocks the head has not reached since are still erased.
+	for(i = 0; i < n; i++)
+	{
+		kv->erased[i] = (uint8_t) (((buffer[16 + i / 8] >> (i % 8)) & 1U) &&
+								   ((i + n - headBlock) % n > kv->blockSequence - headSequence) &&
+								   ((i + n - kv->tailBlock) % n > (kv->headBlock + n - kv->tailBlock) % n));
+	}
+
+	// Entries of compacted blocks are dropped; compaction copied their live
+	// records into the journal.
+	for(done = FLASH_KV_CHECKPOINT_HEADER_BYTES + FLASH_KV_CHECKPOINT_STATE_BYTES; done < numBytes; )
+	{
+		uint32_t chunk = numBytes - done;
+		if(chunk > FLASH_KV_MAX_RECORD_BYTES / 8U * 8U)
+		{
+			chunk = FLASH_KV_MAX_RECORD_BYTES / 8U * 8U;
+		}
+		flashDeviceRead(kv->device, address + done, buffer, chunk);
+		crc = crc32(crc, buffer, chunk);
+		for(i = 0; i < chunk; i += 8U)
+		{
+			uint32_t entryOffset = kvGet32(&buffer[i]);
+			uint32_t entryBlock = entryOffset / kv->blockSize;
+			uint32_t slot;
+			if((entryBlock >= n) || ((entryBlock + n - kv->tailBlock) % n > (headBlock + n - kv->tailBlock) % n) ||
+			   (kv->numKeys == FLASH_KV_MAX_KEYS))
+			{
+				continue;
+			}
+			slot = kvSlot((uint16_t) (buffer[i + 4] | (buffer[i + 5] << 8)));
+			while(kv->index[slot].offset != FLASH_KV_EMPTY)
+			{
+				slot = (slot + 1) & (FLASH_KV_INDEX_SIZE - 1U);
+			}
+			kv->index[slot].offset = entryOffset;
+			kv->index[slot].hash = (uint16_t) (buffer[i + 4] | (buffer[i + 5] << 8));
+			kv->index[slot].numBytes = (uint16_t) (buffer[i + 6] | (buffer[i + 7] << 8));
+			kv->live[entryBlock] += kv->index[slot].numBytes;
+			kv->numKeys++;
+		}
+		done += chunk;
+	}
+	kv->windowBytes = 0;
+	if(crc != expectedCrc)
+	{
+		printf("Checkpoint damaged, replaying every record.\n");
+		kvClearIndex(kv);
+		// The bitmap is no more trustworthy than the entries.
+		memset(kv->erased, 0, sizeof(kv->erased));
+		return 0;
+	}
+	*block = headBlock;
+	*offset = headOffset;
+	return 1;
+}
+
+uint8_t flashKvMount(FLASH_Kv *kv, const FLASH_Device *device, uint32_t address, uint32_t numBytes)
+{
+	uint32_t unitsPerBlock = (FLASH_KV_BLOCK_SIZE + device->eraseSize - 1) / device->eraseSize;
+	uint32_t areaSize = (FLASH_KV_CHECKPOINT_MAX_BYTES + device->eraseSize - 1) / device->eraseSize * device->eraseSize;
+	uint32_t blockSequence;
+	uint32_t tailSequence;
+	uint32_t block;
+	uint32_t offset = FLASH_KV_BLOCK_HEADER_BYTES;
+	uint8_t found = 0;
+
+	kv->device = device;
+	kv->checkpointAddress = address;
+	kv->checkpointAreaSize = areaSize;
+	kv->baseAddress = address + 2 * areaSize;
+	kv->blockSize = unitsPerBlock * device->eraseSize;
+	kv->numBlocks = (numBytes > 2 * areaSize) ? (numBytes - 2 * areaSize) / kv->blockSize : 0;
+	if((kv->numBlocks < 3) || (kv->numBlocks > FLASH_KV_MAX_BLOCKS) || (address % device->eraseSize))
+	{
+		printf("Store geometry not supported: %u blocks of %u bytes.\n", (unsigned) kv->numBlocks, (unsigned) kv->blockSize);
+		return 0;
+	}
+	memset(&kv->stats, 0, sizeof(kv->stats));
+	memset(kv->erased, 0, sizeof(kv->erased));
+	kvClearIndex(kv);
+	kv->busy = 0;
+	kv->windowBytes = 0;
+	kv->checkpointBlocks = 0;
+	// An erase started before a remount may still be running.
+	flashDeviceWaitOnReady(device, 0);
+
+	if(kvLoadCheckpoint(kv, &block, &offset))
+	{
+		found = 1;
+	}
+	else
+	{
+		// The newest block has the highest sequence number.
+		for(block = 0; block < kv->numBlocks; block++)
+		{
+			if(kvReadBlockHeader(kv, block, &blockSequence) &&
+			   (!found || ((int32_t) (blockSequence - kv->blockSequence) > 0)))
+			{
+				found = 1;
+				kv->headBlock = block;
+				kv->blockSequence = blockSequence;
+			}
+		}
+		if(!found)
+		{
+			// No store here yet: start one in block 0.
+			kvErase(kv, address, 2 * areaSize);
+			kv->checkpointArea = 0;
+			kv->checkpointOffset = 0;
+			kv->tailBlock = 0;
+			kv->blockSequence = 0;
+			kvEraseBlock(kv, 0);
+			kvOpenBlock(kv, 0);
+			return 1;
+		}
+
+		// The oldest block ends the run of consecutive sequence numbers.
+		kv->tailBlock = kv->headBlock;
+		tailSequence = kv->blockSequence;
+		for(;;)
+		{
+			uint32_t previous = (kv->tailBlock + kv->numBlocks - 1) % kv->numBlocks;
+			if((previous == kv->headBlock) ||
+			   !kvReadBlockHeader(kv, previous, &blockSequence) ||
+			   (blockSequence != tailSequence - 1))
+			{
+				break;
+			}
+			kv->tailBlock = previous;
+			tailSequence = blockSequence;
+		}
+		block = kv->tailBlock;
+	}
+
+	// Replay the journal, or every record without a checkpoint; later
+	// records replace earlier ones.
+	for(; block != kv->headBlock; block = (block + 1) % kv->numBlocks)
+	{
+		kvReplayBlock(kv, block, offset);
+		offset = FLASH_KV_BLOCK_HEADER_BYTES;
+	}
+	kv->headOffset = kvReplayBlock(kv, kv->headBlock, offset);
+	kv->windowBytes = 0;
+	return 1;
+}
+
+uint8_t flashKvPut(FLASH_Kv *kv, const uint8_t *key, uint32_t keyBytes, const uint8_t *value, uint32_t valueBytes)
+{
+	uint32_t numBytes = FLASH_KV_RECORD_HEADER_BYTES + keyBytes + valueBytes;
+	uint8_t *record = kv->recordBuffer;
+	uint32_t slot;
+	uint16_t hash;
+	uint8_t found;
+	if((keyBytes == 0) || (keyBytes > FLASH_KV_MAX_KEY_BYTES) || (valueBytes > FLASH_KV_MAX_VALUE_BYTES))
+	{
+		return 0;
+	}
+	hash = kvHash(key, keyBytes);
+	kvWaitDevice(kv);
+	slot = kvFind(kv, key, keyBytes, hash, 0, &found);
+	if(!found && (kv->numKeys == FLASH_KV_MAX_KEYS))
+	{
+		return 0;
+	}
+	if(!kvFits(kv, numBytes - (found ? kv->index[slot].numBytes : 0)) || !kvMakeRoom(kv, numBytes))
+	{
+		return 0;
+	}
+	// Compaction moves records but leaves the slots where they are.
+	kv->windowBytes = 0;
+	record[4] = (uint8_t) keyBytes;
+	record[5] = (uint8_t) ~keyBytes;
+	record[6] = (uint8_t) valueBytes;
+	record[7] = (uint8_t) (valueBytes >> 8);
+	memcpy(&record[FLASH_KV_RECORD_HEADER_BYTES], key, keyBytes);
+	memcpy(&record[FLASH_KV_RECORD_HEADER_BYTES + keyBytes], value, valueBytes);
+	kvPut32(&record[0], crc32(0, &record[4], numBytes - 4));
+	kvSet(kv, slot, found, hash, kvProgramRecord(kv, record, numBytes), numBytes);
+	kv->stats.writes++;
+	kvCheckpointDue(kv);
+	return 1;
+}
+
+uint8_t flashKvGet(FLASH_Kv *kv, const uint8_t *key, uint32_t keyBytes, uint8_t *value, uint32_t *valueBytes)
+{
+	const FLASH_KvEntry *entry;
+	uint8_t found;
+	if((keyBytes == 0) || (keyBytes > FLASH_KV_MAX_KEY_BYTES))
+	{
+		return 0;
+	}
+	kvWaitDevice(kv);
+	entry = &kv->index[kvFind(kv, key, keyBytes, kvHash(key, keyBytes), 1, &found)];
+	if(!found || (kvCheckRecord(kv->recordBuffer, entry->numBytes) != entry->numBytes))
+	{
+		return 0;
+	}
+	*valueBytes = entry->numBytes - FLASH_KV_RECORD_HEADER_BYTES - keyBytes;
+	memcpy(value, &kv->recordBuffer[FLASH_KV_RECORD_HEADER_BYTES + keyBytes], *valueBytes);
+	return 1;
+}
+
+uint8_t flashKvDelete(FLASH_Kv *kv, const uint8_t *key, uint32_t keyBytes)
+{
+	uint32_t numBytes = FLASH_KV_RECORD_HEADER_BYTES + keyBytes;
+	uint8_t *record = kv->recordBuffer;
+	uint32_t slot;
+	uint8_t found;
+	if((keyBytes == 0) || (keyBytes > FLASH_KV_MAX_KEY_BYTES))
+	{
+		return 0;
+	}
+	kvWaitDevice(kv);
+	slot = kvFind(kv, key, keyBytes, kvHash(key, keyBytes), 0, &found);
+	if(!found || !kvMakeRoom(kv, numBytes))
+	{
+		return 0;
+	}
+	kv->windowBytes = 0;
+	record[4] = (uint8_t) keyBytes;
+	record[5] = (uint8_t) ~keyBytes;
+	record[6] = (uint8_t) FLASH_KV_DELETED;
+	record[7] = (uint8_t) (FLASH_KV_DELETED >> 8);
+	memcpy(&record[FLASH_KV_RECORD_HEADER_BYTES], key, keyBytes);
+	kvPut32(&record[0], crc32(0, &record[4], numBytes - 4));
+	kvProgramRecord(kv, record, numBytes);
+	kvUnset(kv, slot);
+	kv->stats.writes++;
+	kvCheckpointDue(kv);
+	return 1;
+}
+
+uint8_t flashKvCompact(FLASH_Kv *kv)
+{
+	uint8_t compacted;
+	if(kv->tailBlock == kv->headBlock)
+	{
+		return 0;
+	}
+	compacted = kvCompactTail(kv);
+	kvCheckpointDue(kv);
+	return compacted;
+}
+
+void flashKvCheckpoint(FLASH_Kv *kv)
+{
+	kvWriteCheckpoint(kv);
+}
+
+uint32_t flashKvFreeBlocks(const FLASH_Kv *kv)
+{
+	return kv->numBlocks - 1 - (kv->headBlock + kv->numBlocks - kv->tailBlock) % kv->numBlocks;
+}
@@ -0,0 +1,349 @@
+/*
+ * The Clear BSD License
+ * Copyright (c) 2018 Adesto Technologies Corporation, Inc
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted (subject to the limitations in the disclaimer below) provided
+ *  that the following conditions are met:
+ *
+ * o Redistributions of source code must retain the above copyright notice, this list
+ *   of conditions and the following disclaimer.
+ *
+ * o Redistributions in binary form must reproduce the above copyright notice, this
+ *   list of conditions and the following disclaimer in the documentation and/or
+ *   other materials provided with the distribution.
+ *
+ * o Neither the name of the copyright holder nor the names of its
+ *   contributors may be used to endorse or promote products derived from this
+ *   software without specific prior written permission.
+ *
+ * NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE GRANTED BY THIS LICENSE.
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*!
+ * @ingroup ADESTO_LAYER
+ */
+/**
+ * @file    flash_kv.h
+ * @brief   Declarations of the key-value store.
+ *
+ * The store keeps small values, such as settings, under keys of up to
+ * @ref FLASH_KV_MAX_KEY_BYTES bytes. Flash is never rewritten in place:
+ * every put or delete appends a record to the block being written, like
+ * the log of flash_log.h, and the record it replaces becomes stale. A RAM
+ * hash index maps each key to the address and length of its latest record,
+ * so a get is one read command of exactly that record.
+ *
+ * Each index entry holds 16 bits of the hash of its key beside the address,
+ * 8 bytes in all; the key itself stays in flash. An entry whose hash matches
+ * that of the key looked up is confirmed by comparing the key read from
+ * flash, so two keys with the same 16 bits cost an extra read, nothing more.
+ *
+ * Blocks are @ref FLASH_KV_BLOCK_SIZE bytes rounded up to whole erase units
+ * and form a ring. Stale records are reclaimed by compaction, one block at
+ * a time, always the oldest: its live records (those the index points at)
+ * are copied to the block being written and the block is erased. As the
+ * oldest block holds no record older than itself, deletion records found
+ * there are dropped. Puts compact when fewer than two blocks are free;
+ * calling flashKvCompact() while idle keeps compaction off the put path.
+ *
+ * A block starts with a magic number and its sequence number. A record has
+ * an 8 byte header: a CRC-32 over the rest of the record, the key length
+ * stored twice and the value length, 0xFFFF for a deletion. A record cut
+ * short by a reset fails its CRC and is ignored, leaving the previous value
+ * of its key in force.
+ *
+ * Rebuilding the index from every record would make mounting take time in
+ * proportion to the size of the store. Instead, every
+ * @ref FLASH_KV_CHECKPOINT_INTERVAL blocks the index entries, the ends of the
+ * ring and the bitmap of erased blocks are written as a checkpoint to one of
+ * two areas in front of the blocks. Checkpoints follow one another in an
+ * area until it is full; then the other area is erased and used. The records
+ * appended since the checkpoint form its journal. flashKvMount() loads the
+ * newest checkpoint, reads the headers of the blocks opened and compacted
+ * since, drops the entries of compacted blocks (compaction copied their live
+ * records into the journal) and replays the journal, so mounting takes time
+ * in proportion to the activity since the checkpoint. Without a usable
+ * checkpoint, every block header is read and every record replayed.
+ */
+#ifndef FLASH_KV_H_
+#define FLASH_KV_H_
+
+#include "flash_device.h"
+
+//! Smallest size of a block in bytes; rounded up to whole erase units.
+#ifndef FLASH_KV_BLOCK_SIZE
+#define FLASH_KV_BLOCK_SIZE 4096U
+#endif
+
+//! Largest number of blocks managed.
+#ifndef FLASH_KV_MAX_BLOCKS
+#define FLASH_KV_MAX_BLOCKS 64U
+#endif
+
+//! Slots of the RAM index, a power of 2 of at most 32768. Up to 3/4 of them
+//! hold keys (see @ref FLASH_KV_MAX_KEYS).
+#ifndef FLASH_KV_INDEX_SIZE
+#define FLASH_KV_INDEX_SIZE 512U
+#endif
+
+//! Longest key in bytes.
+#ifndef FLASH_KV_MAX_KEY_BYTES
+#define FLASH_KV_MAX_KEY_BYTES 32U
+#endif
+
+//! Longest value in bytes.
+#ifndef FLASH_KV_MAX_VALUE_BYTES
+#define FLASH_KV_MAX_VALUE_BYTES 256U
+#endif
+
+//! Blocks opened between two checkpoints. Fewer mean shorter journals to
+//! replay at mount but more checkpoint writes.
+#ifndef FLASH_KV_CHECKPOINT_INTERVAL
+#define FLASH_KV_CHECKPOINT_INTERVAL 2U
+#endif
+
+//! Largest number of keys stored.
+#define FLASH_KV_MAX_KEYS (FLASH_KV_INDEX_SIZE / 4U * 3U)
+
+//! Block header magic number, "FKV2".
+#define FLASH_KV_MAGIC 0x32564B46UL
+
+//! Checkpoint header magic number, "FKVC".
+#define FLASH_KV_CHECKPOINT_MAGIC 0x43564B46UL
+
+//! Bytes of the block header.
+#define FLASH_KV_BLOCK_HEADER_BYTES 8U
+
+//! Bytes of the record header.
+#define FLASH_KV_RECORD_HEADER_BYTES 8U
+
+//! Value length of a deletion record.
+#define FLASH_KV_DELETED 0xFFFFU
+
+//! Largest record in bytes.
+#define FLASH_KV_MAX_RECORD_BYTES (FLASH_KV_RECORD_HEADER_BYTES + FLASH_KV_MAX_KEY_BYTES + FLASH_KV_MAX_VALUE_BYTES)
+
+//! Bytes of the checkpoint header: magic number, length, sequence number and
+//! CRC-32 of the rest.
+#define FLASH_KV_CHECKPOINT_HEADER_BYTES 16U
+
+//! Bytes of the state saved by a checkpoint before the index entries: the
+//! oldest block, the head block, the offset and sequence number of the head
+//! and the bitmap of erased blocks, padded to 8 bytes.
+#define FLASH_KV_CHECKPOINT_STATE_BYTES (16U + (FLASH_KV_MAX_BLOCKS + 63U) / 64U * 8U)
+
+//! Largest checkpoint in bytes. Each checkpoint area is this size rounded up
+//! to whole erase units.
+#define FLASH_KV_CHECKPOINT_MAX_BYTES (FLASH_KV_CHECKPOINT_HEADER_BYTES + FLASH_KV_CHECKPOINT_STATE_BYTES + FLASH_KV_MAX_KEYS * 8U)
+
+//! Index entry of an empty slot.
+#define FLASH_KV_EMPTY 0xFFFFFFFFUL
+
+#if (FLASH_KV_INDEX_SIZE & (FLASH_KV_INDEX_SIZE - 1U)) || (FLASH_KV_INDEX_SIZE > 32768U)
+#error FLASH_KV_INDEX_SIZE must be a power of 2 of at most 32768.
+#endif
+
+#if (FLASH_KV_MAX_KEY_BYTES > 254U) || (FLASH_KV_MAX_VALUE_BYTES >= FLASH_KV_DELETED) || \
+	(FLASH_KV_MAX_RECORD_BYTES > FLASH_KV_BLOCK_SIZE - FLASH_KV_BLOCK_HEADER_BYTES)
+#error Keys or values too long for the block size.
+#endif
+
+#if (FLASH_KV_CHECKPOINT_STATE_BYTES > FLASH_KV_MAX_RECORD_BYTES)
+#error FLASH_KV_MAX_BLOCKS too large for the record buffer.
+#endif
+
+/*!
+ * @brief Slot of the RAM index.
+ */
+typedef struct
+{
+	//! Offset of the record from the start of the store, @ref FLASH_KV_EMPTY if the slot is free.
+	uint32_t offset;
+	//! 16 bits of the hash of the key; the low bits give the slot it belongs in.
+	uint16_t hash;
+	//! Bytes of the record, header included.
+	uint16_t numBytes;
+} FLASH_KvEntry;
+
+/*!
+ * @brief Usage counters of a store.
+ */
+typedef struct
+{
+	//! Puts and deletes that appended a record.
+	uint32_t writes;
+	//! Records copied by compaction.
+	uint32_t moves;
+	//! Blocks compacted.
+	uint32_t compactions;
+	//! Erase units erased.
+	uint32_t erases;
+	//! Reads issued to compare a key whose hash matched another.
+	uint32_t collisions;
+	//! Checkpoints written.
+	uint32_t checkpoints;
+	//! Records replayed by the last mount.
+	uint32_t replayed;
+} FLASH_KvStats;
+
+/*!
+ * @brief A mounted store.
+ */
+typedef struct
+{
+	//! The device holding the store.
+	const FLASH_Device *device;
+	//! Device address of block 0.
+	uint32_t baseAddress;
+	//! Device address of the first checkpoint area.
+	uint32_t checkpointAddress;
+	//! Bytes per checkpoint area.
+	uint32_t checkpointAreaSize;
+	//! Area of the last checkpoint written.
+	uint32_t checkpointArea;
+	//! Offset in that area where the next checkpoint goes.
+	uint32_t checkpointOffset;
+	//! Sequence number of the next checkpoint.
+	uint32_t checkpointSequence;
+	//! Blocks opened since the last checkpoint.
+	uint32_t checkpointBlocks;
+	//! Bytes per block.
+	uint32_t blockSize;
+	//! Number of blocks.
+	uint32_t numBlocks;
+	//! Oldest block holding records.
+	uint32_t tailBlock;
+	//! Block being appended to.
+	uint32_t headBlock;
+	//! Offset in the head block where the next record goes.
+	uint32_t headOffset;
+	//! Sequence number of the head block.
+	uint32_t blockSequence;
+	//! Keys stored.
+	uint32_t numKeys;
+	//! Bytes of live records per block.
+	uint32_t live[FLASH_KV_MAX_BLOCKS];
+	//! 1 for each free block known to be erased.
+	uint8_t erased[FLASH_KV_MAX_BLOCKS];
+	//! 1 while an erase runs in the background.
+	uint8_t busy;
+	//! USER_CONFIG_CycleCount64() when it started.
+	uint64_t busyStart;
+	//! The RAM index.
+	FLASH_KvEntry index[FLASH_KV_INDEX_SIZE];
+	//! The records being read or written.
+	uint8_t recordBuffer[FLASH_KV_MAX_RECORD_BYTES];
+	//! Offset from the start of the store of the bytes read into recordBuffer.
+	uint32_t windowOffset;
+	//! Number of them, 0 if recordBuffer holds none.
+	uint32_t windowBytes;
+	//! Usage counters.
+	FLASH_KvStats stats;
+} FLASH_Kv;
+
+/*!
+ * @brief Mounts the store kept in a range of the device, rebuilding the
+ * index from the newest checkpoint and the records appended since. In a
+ * range holding no store, the checkpoint areas and the first block are
+ * erased; the other blocks are erased as they are used.
+ *
+ * @param kv The store.
+ * @param device The device. Must stay valid while the store is used.
+ * @param address Device address of the range, on an erase unit boundary.
+ * @param numBytes Size of the range. It starts with the two checkpoint
+ * areas; whole blocks of the rest are used.
+ *
+ * @retval 1 The store is mounted.
+ * @retval 0 The range holds fewer than 3 or more than
+ * @ref FLASH_KV_MAX_BLOCKS blocks.
+ */
+uint8_t flashKvMount(FLASH_Kv *kv, const FLASH_Device *device, uint32_t address, uint32_t numBytes);
+
+/*!
+ * @brief Stores a value under a key, replacing any previous value. The
+ * record is programmed before returning.
+ *
+ * @param kv The store.
+ * @param key The key.
+ * @param keyBytes Its length, 1 to @ref FLASH_KV_MAX_KEY_BYTES.
+ * @param value The value.
+ * @param valueBytes Its length, at most @ref FLASH_KV_MAX_VALUE_BYTES.
+ *
+ * @retval 1 The value is stored.
+ * @retval 0 A length is out of range, @ref FLASH_KV_MAX_KEYS keys are
+ * stored already, or the live records would fill the store. They may take up
+ * to (blocks - 2) * (block size - @ref FLASH_KV_BLOCK_HEADER_BYTES -
+ * @ref FLASH_KV_MAX_RECORD_BYTES) bytes, headers included.
+ */
+uint8_t flashKvPut(FLASH_Kv *kv, const uint8_t *key, uint32_t keyBytes, const uint8_t *value, uint32_t valueBytes);
+
+/*!
+ * @brief Reads the value stored under a key.
+ *
+ * @param kv The store.
+ * @param key The key.
+ * @param keyBytes Its length.
+ * @param value Receives the value, at least @ref FLASH_KV_MAX_VALUE_BYTES bytes.
+ * @param valueBytes Receives its length.
+ *
+ * @retval 1 The value was read.
+ * @retval 0 The key is not stored, or its record fails its CRC.
+ */
+uint8_t flashKvGet(FLASH_Kv *kv, const uint8_t *key, uint32_t keyBytes, uint8_t *value, uint32_t *valueBytes);
+
+/*!
+ * @brief Removes a key.
+ *
+ * @param kv The store.
+ * @param key The key.
+ * @param keyBytes Its length.
+ *
+ * @retval 1 The key is removed.
+ * @retval 0 The key is not stored.
+ */
+uint8_t flashKvDelete(FLASH_Kv *kv, const uint8_t *key, uint32_t keyBytes);
+
+/*!
+ * @brief Compacts the oldest block, leaving its erase running in the
+ * background where the family allows. Call it while the application is idle.
+ *
+ * @param kv The store.
+ *
+ * @retval 1 A block was compacted.
+ * @retval 0 Every block is free but the one being written.
+ */
+uint8_t flashKvCompact(FLASH_Kv *kv);
+
+/*!
+ * @brief Writes a checkpoint, so that the next mount replays no records.
+ * Checkpoints are otherwise written every @ref FLASH_KV_CHECKPOINT_INTERVAL
+ * blocks; call this before powering down to shorten the next mount.
+ *
+ * @param kv The store.
+ *
+ * @retval void
+ */
+void flashKvCheckpoint(FLASH_Kv *kv);
+
+/*!
+ * @brief Returns the number of blocks that are free.
+ *
+ * @param kv The store.
+ *
+ * @retval uint32_t Blocks holding no records.
+ */
+uint32_t flashKvFreeBlocks(const FLASH_Kv *kv);
+
+#endif /* FLASH_KV_H_ */
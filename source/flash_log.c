@@ -0,0 +1,493 @@
+/*
+ * The Clear BSD License
+ * Copyright (c) 2018 Adesto Technologies Corporation, Inc
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted (subject to the limitations in the disclaimer below) provided
+ *  that the following conditions are met:
+ *
+ * o Redistributions of source code must retain the above copyright notice, this list
+ *   of conditions and the following disclaimer.
+ *
+ * o Redistributions in binary form must reproduce the above copyright notice, this
+ *   list of conditions and the following disclaimer in the documentation and/or
+ *   other materials provided with the distribution.
+ *
+ * o Neither the name of the copyright holder nor the names of its
+ *   contributors may be used to endorse or promote products derived from this
+ *   software without specific prior written permission.
+ *
+ * NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE GRANTED BY THIS LICENSE.
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*!
+ * @ingroup ADESTO_LAYER
+ */
+/**
+ * @file    flash_log.c
+ * @brief   Definition of the append-only record log.
+ */
+#include "flash_log.h"
+#include "helper_functions.h"
+#include <string.h>
+
+static uint32_t logGet32(const uint8_t *bytes)
+{
+	return (uint32_t) bytes[0] | ((uint32_t) bytes[1] << 8) | ((uint32_t) bytes[2] << 16) | ((uint32_t) bytes[3] << 24);
+}
+
+static void logPut32(uint8_t *bytes, uint32_t value)
+{
+	bytes[0] = (uint8_t) value;
+	bytes[1] = (uint8_t) (value >> 8);
+	bytes[2] = (uint8_t) (value >> 16);
+	bytes[3] = (uint8_t) (value >> 24);
+}
+
+static uint32_t logBlockAddress(const FLASH_Log *log, uint32_t block)
+{
+	return log->baseAddress + block * log->blockSize;
+}
+
+// Waits for the program or erase running in the background, if any.
+static void logWaitDevice(FLASH_Log *log)
+{
+	if(!log->busy)
+	{
+		return;
+	}
+	flashDeviceWaitOnReadySince(log->device, log->busyStart, log->busyUs);
+	log->busy = 0;
+	if(log->busyErasing)
+	{
+		log->busyErasing = 0;
+		if(++log->eraseUnit == log->blockSize / log->device->eraseSize)
+		{
+			log->eraseUnit = 0;
+			log->readyBlocks++;
+		}
+	}
+}
+
+// Erases erase units of the blocks ahead of the head until 'numBlocks'
+// blocks are erased. Without 'wait', returns 1 as soon as the device is busy.
+static uint8_t logEraseAhead(FLASH_Log *log, uint32_t numBlocks, uint8_t wait)
+{
+	while(log->readyBlocks < numBlocks)
+	{
+		uint32_t target;
+		uint32_t address;
+		if(log->busy)
+		{
+			if(!wait && (log->device->isBusy != NULL) && flashDeviceIsBusy(log->device))
+			{
+				return 1;
+			}
+			logWaitDevice(log);
+			continue;
+		}
+		target = (log->headBlock + log->readyBlocks + 1) % log->numBlocks;
+		// The ring is full: the oldest records make room.
+		if((log->eraseUnit == 0) && (target == log->tailBlock))
+		{
+			log->tailBlock = (log->tailBlock + 1) % log->numBlocks;
+			log->stats.reclaimed++;
+		}
+		address = logBlockAddress(log, target) + log->eraseUnit * log->device->eraseSize;
+		log->stats.erases++;
+		if(log->device->eraseStart != NULL)
+		{
+			flashDeviceEraseStart(log->device, address);
+			log->busy = 1;
+			log->busyErasing = 1;
+			log->busyStart = USER_CONFIG_CycleCount64();
+			log->busyUs = flashPartSmallestErase(log->device->part)->time.typicalUs;
+		}
+		else
+		{
+			flashDeviceErase(log->device, address);
+			if(++log->eraseUnit == log->blockSize / log->device->eraseSize)
+			{
+				log->eraseUnit = 0;
+				log->readyBlocks++;
+			}
+		}
+	}
+	return 0;
+}
+
+// Programs the bytes of the page buffer up to 'end' that are not yet
+// programmed, without waiting where the family allows.
+static void logProgram(FLASH_Log *log, uint32_t end)
+{
+	uint32_t address = logBlockAddress(log, log->headBlock) + log->bufferPage + log->bufferFlushed;
+	uint32_t numBytes;
+	if(end <= log->bufferFlushed)
+	{
+		return;
+	}
+	numBytes = end - log->bufferFlushed;
+	logWaitDevice(log);
+	if(log->device->programPageStart != NULL)
+	{
+		flashDeviceProgramPageStart(log->device, address, &log->pageBuffer[log->bufferFlushed], numBytes);
+		log->busy = 1;
+		log->busyStart = USER_CONFIG_CycleCount64();
+		log->busyUs = log->device->part->program.typicalUs;
+	}
+	else
+	{
+		flashDeviceProgram(log->device, address, &log->pageBuffer[log->bufferFlushed], numBytes);
+	}
+	log->bufferFlushed = end;
+	log->stats.programs++;
+}
+
+// Copies bytes to the head, programming each page as it fills.
+static void logWrite(FLASH_Log *log, const uint8_t *data, uint32_t numBytes)
+{
+	while(numBytes > 0)
+	{
+		uint32_t position = log->headOffset - log->bufferPage;
+		uint32_t chunk = log->pageSize - position;
+		if(chunk > numBytes)
+			chunk = numBytes;
+		memcpy(&log->pageBuffer[position], data, chunk);
+		log->headOffset += chunk;
+		data += chunk;
+		numBytes -= chunk;
+		if(position + chunk == log->pageSize)
+		{
+			logProgram(log, log->pageSize);
+			log->bufferPage += log->pageSize;
+			log->bufferFlushed = 0;
+			memset(log->pageBuffer, 0xFF, log->pageSize);
+		}
+	}
+}
+
+// Starts the head block at 'block', which must be erased, with its header.
+static void logOpenHead(FLASH_Log *log, uint32_t block)
+{
+	uint8_t header[FLASH_LOG_BLOCK_HEADER_BYTES];
+	log->headBlock = block;
+	log->headOffset = 0;
+	log->bufferPage = 0;
+	log->bufferFlushed = 0;
+	memset(log->pageBuffer, 0xFF, log->pageSize);
+	logPut32(&header[0], FLASH_LOG_MAGIC);
+	logPut32(&header[4], log->blockSequence);
+	logPut32(&header[8], log->nextSequence);
+	logWrite(log, header, sizeof(header));
+}
+
+// Moves the head to the next block, erasing it first if it is not ready.
+static void logAdvance(FLASH_Log *log)
+{
+	logProgram(log, log->headOffset - log->bufferPage);
+	logEraseAhead(log, 1, 1);
+	log->readyBlocks--;
+	log->blockSequence++;
+	logOpenHead(log, (log->headBlock + 1) % log->numBlocks);
+	logEraseAhead(log, FLASH_LOG_ERASE_AHEAD, 0);
+}
+
+// Reads a block header. Returns 1 if it is one.
+static uint8_t logReadBlockHeader(FLASH_Log *log, uint32_t block, uint32_t *blockSequence, uint32_t *firstSequence)
+{
+	uint8_t header[FLASH_LOG_BLOCK_HEADER_BYTES];
+	flashDeviceRead(log->device, logBlockAddress(log, block), header, sizeof(header));
+	*blockSequence = logGet32(&header[4]);
+	*firstSequence = logGet32(&header[8]);
+	return logGet32(&header[0]) == FLASH_LOG_MAGIC;
+}
+
+// Checks the record at 'offset' of 'block'. Returns its length, 0xFFFFFFFF if
+// the block has no record there and 0xFFFFFFFE if the record is damaged or
+// out of sequence. The data is read into 'record' if not NULL, else through
+// the page buffer.
+static uint32_t logCheckRecord(FLASH_Log *log, uint32_t block, uint32_t offset, uint32_t sequence, uint8_t *record)
+{
+	uint8_t header[FLASH_LOG_RECORD_HEADER_BYTES];
+	uint32_t address = logBlockAddress(log, block) + offset;
+	uint32_t length;
+	uint32_t crc;
+	uint32_t done;
+	if(offset + FLASH_LOG_RECORD_HEADER_BYTES > log->blockSize)
+	{
+		return 0xFFFFFFFFU;
+	}
+	flashDeviceRead(log->device, address, header, sizeof(header));
+	if(blankCheck(header, sizeof(header), NULL))
+	{
+		return 0xFFFFFFFFU;
+	}
+	length = header[4] | (header[5] << 8);
+	if(((length ^ (header[6] | (header[7] << 8))) != 0xFFFFU) ||
+	   (length > FLASH_LOG_MAX_RECORD_BYTES) ||
+	   (offset + FLASH_LOG_RECORD_HEADER_BYTES + length > log->blockSize) ||
+	   (logGet32(&header[0]) != sequence))
+	{
+		return 0xFFFFFFFEU;
+	}
+	crc = crc32(0, header, 8);
+	address += FLASH_LOG_RECORD_HEADER_BYTES;
+	if(record != NULL)
+	{
+		flashDeviceRead(log->device, address, record, length);
+		crc = crc32(crc, record, length);
+	}
+	else
+	{
+		for(done = 0; done < length; )
+		{
+			uint32_t chunk = (length - done < log->pageSize) ? (length - done) : log->pageSize;
+			flashDeviceRead(log->device, address + done, log->pageBuffer, chunk);
+			crc = crc32(crc, log->pageBuffer, chunk);
+			done += chunk;
+		}
+	}
+	return (crc == logGet32(&header[8])) ? length : 0xFFFFFFFEU;
+}
+
+static uint8_t logBlockBlank(FLASH_Log *log, uint32_t block)
+{
+	uint32_t offset;
+	for(offset = 0; offset < log->blockSize; offset += log->pageSize)
+	{
+		flashDeviceRead(log->device, logBlockAddress(log, block) + offset, log->pageBuffer, log->pageSize);
+		if(!blankCheck(log->pageBuffer, log->pageSize, NULL))
+		{
+			return 0;
+		}
+	}
+	return 1;
+}
+
+uint8_t flashLogMount(FLASH_Log *log, const FLASH_Device *device, uint32_t address, uint32_t numBytes)
+{
+	uint32_t unitsPerBlock = (FLASH_LOG_BLOCK_SIZE + device->eraseSize - 1) / device->eraseSize;
+	uint32_t blockSequence;
+	uint32_t firstSequence;
+	uint32_t tailSequence;
+	uint32_t block;
+	uint8_t found = 0;
+
+	log->device = device;
+	log->baseAddress = address;
+	log->pageSize = device->pageSize;
+	log->blockSize = unitsPerBlock * device->eraseSize;
+	log->numBlocks = numBytes / log->blockSize;
+	if((log->pageSize > FLASH_LOG_PAGE_BUFFER_SIZE) || (log->blockSize % log->pageSize) ||
+	   (address % device->eraseSize) || (log->numBlocks < FLASH_LOG_ERASE_AHEAD + 2))
+	{
+		printf("Log geometry not supported: %u byte pages, %u byte blocks, %u blocks.\n",
+			   (unsigned) log->pageSize, (unsigned) log->blockSize, (unsigned) log->numBlocks);
+		return 0;
+	}
+	memset(&log->stats, 0, sizeof(log->stats));
+	log->readyBlocks = 0;
+	log->eraseUnit = 0;
+	log->busy = 0;
+	log->busyErasing = 0;
+	// An erase or program started before a remount may still be running.
+	flashDeviceWaitOnReady(device, 0);
+
+	// The newest block has the highest block sequence number.
+	for(block = 0; block < log->numBlocks; block++)
+	{
+		if(logReadBlockHeader(log, block, &blockSequence, &firstSequence) &&
+		   (!found || ((int32_t) (blockSequence - log->blockSequence) > 0)))
+		{
+			found = 1;
+			log->headBlock = block;
+			log->blockSequence = blockSequence;
+			log->nextSequence = firstSequence;
+		}
+	}
+	if(!found)
+	{
+		// No log here yet: start one in block 0.
+		log->tailBlock = 0;
+		log->blockSequence = 0;
+		log->nextSequence = 0;
+		if(!logBlockBlank(log, 0))
+		{
+			for(block = 0; block < unitsPerBlock; block++)
+			{
+				flashDeviceErase(device, address + block * device->eraseSize);
+				log->stats.erases++;
+			}
+		}
+		logOpenHead(log, 0);
+		return 1;
+	}
+
+	// The oldest block ends the run of consecutive sequence numbers.
+	log->tailBlock = log->headBlock;
+	tailSequence = log->blockSequence;
+	for(;;)
+	{
+		uint32_t previous = (log->tailBlock + log->numBlocks - 1) % log->numBlocks;
+		if((previous == log->headBlock) ||
+		   !logReadBlockHeader(log, previous, &blockSequence, &firstSequence) ||
+		   (blockSequence != tailSequence - 1))
+		{
+			break;
+		}
+		log->tailBlock = previous;
+		tailSequence = blockSequence;
+	}
+
+	// Find the end of the records in the newest block.
+	log->headOffset = FLASH_LOG_BLOCK_HEADER_BYTES;
+	for(;;)
+	{
+		uint32_t length = logCheckRecord(log, log->headBlock, log->headOffset, log->nextSequence, NULL);
+		if(length == 0xFFFFFFFFU)
+		{
+			break;
+		}
+		if(length == 0xFFFFFFFEU)
+		{
+			// Cut short by a reset: leave the rest of the block alone.
+			log->headOffset = log->blockSize;
+			break;
+		}
+		log->headOffset += FLASH_LOG_RECORD_HEADER_BYTES + length;
+		log->nextSequence++;
+	}
+	log->bufferPage = log->headOffset - (log->headOffset % log->pageSize);
+	log->bufferFlushed = log->headOffset - log->bufferPage;
+	memset(log->pageBuffer, 0xFF, log->pageSize);
+
+	// Blocks erased ahead before the reset.
+	while(log->readyBlocks < FLASH_LOG_ERASE_AHEAD)
+	{
+		block = (log->headBlock + log->readyBlocks + 1) % log->numBlocks;
+		if((block == log->tailBlock) || !logBlockBlank(log, block))
+		{
+			break;
+		}
+		log->readyBlocks++;
+	}
+	return 1;
+}
+
+uint8_t flashLogAppend(FLASH_Log *log, const uint8_t *record, uint32_t numBytes)
+{
+	uint8_t header[FLASH_LOG_RECORD_HEADER_BYTES];
+	uint32_t crc;
+	if(numBytes > FLASH_LOG_MAX_RECORD_BYTES)
+	{
+		return 0;
+	}
+	if(log->headOffset + FLASH_LOG_RECORD_HEADER_BYTES + numBytes > log->blockSize)
+	{
+		logAdvance(log);
+	}
+	logPut32(&header[0], log->nextSequence);
+	header[4] = (uint8_t) numBytes;
+	header[5] = (uint8_t) (numBytes >> 8);
+	header[6] = (uint8_t) ~header[4];
+	header[7] = (uint8_t) ~header[5];
+	crc = crc32(crc32(0, header, 8), record, numBytes);
+	logPut32(&header[8], crc);
+	logWrite(log, header, sizeof(header));
+	logWrite(log, record, numBytes);
+	log->nextSequence++;
+	log->stats.records++;
+	log->stats.bytes += numBytes;
+	return 1;
+}
+
+void flashLogSync(FLASH_Log *log)
+{
+	logProgram(log, log->headOffset - log->bufferPage);
+	logWaitDevice(log);
+}
+
+uint8_t flashLogIdle(FLASH_Log *log)
+{
+	return logEraseAhead(log, FLASH_LOG_ERASE_AHEAD, 0);
+}
+
+void flashLogRewind(FLASH_Log *log, FLASH_LogCursor *cursor)
+{
+	if(log->tailBlock == log->headBlock)
+	{
+		flashLogSync(log);
+	}
+	else
+	{
+		logWaitDevice(log);
+	}
+	cursor->block = log->tailBlock;
+	cursor->offset = FLASH_LOG_BLOCK_HEADER_BYTES;
+	logReadBlockHeader(log, cursor->block, &cursor->blockSequence, &cursor->sequence);
+}
+
+uint8_t flashLogReadNext(FLASH_Log *log, FLASH_LogCursor *cursor, uint8_t *record, uint32_t *numBytes, uint32_t *sequence)
+{
+	if(cursor->block == log->headBlock)
+	{
+		flashLogSync(log);
+	}
+	else
+	{
+		logWaitDevice(log);
+	}
+	for(;;)
+	{
+		uint32_t length;
+		uint32_t blockSequence;
+		uint32_t firstSequence;
+		if((cursor->block == log->headBlock) && (cursor->offset >= log->headOffset))
+		{
+			return 0;
+		}
+		length = logCheckRecord(log, cursor->block, cursor->offset, cursor->sequence, record);
+		if(length < 0xFFFFFFFEU)
+		{
+			*numBytes = length;
+			if(sequence != NULL)
+			{
+				*sequence = cursor->sequence;
+			}
+			cursor->offset += FLASH_LOG_RECORD_HEADER_BYTES + length;
+			cursor->sequence++;
+			return 1;
+		}
+		// End of the block, or a record cut short by a reset: go on with the
+		// next block, unless it has been reclaimed meanwhile.
+		if(cursor->block == log->headBlock)
+		{
+			return 0;
+		}
+		cursor->block = (cursor->block + 1) % log->numBlocks;
+		cursor->offset = FLASH_LOG_BLOCK_HEADER_BYTES;
+		// Even the header of the head block may still be in the page buffer.
+		if(cursor->block == log->headBlock)
+		{
+			flashLogSync(log);
+		}
+		if(!logReadBlockHeader(log, cursor->block, &blockSequence, &firstSequence) ||
+		   (blockSequence != cursor->blockSequence + 1))
+		{
+			return 0;
+		}
+		cursor->blockSequence = blockSequence;
+		cursor->sequence = firstSequence;
+	}
+}
@@ -0,0 +1,255 @@
+/*
+ * The Clear BSD License
+ * Copyright (c) 2018 Adesto Technologies Corporation, Inc
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted (subject to the limitations in the disclaimer below) provided
+ *  that the following conditions are met:
+ *
+ * o Redistributions of source code must retain the above copyright notice, this list
+ *   of conditions and the following disclaimer.
+ *
+ * o Redistributions in binary form must reproduce the above copyright notice, this
+ *   list of conditions and the following disclaimer in the documentation and/or
+ *   other materials provided with the distribution.
+ *
+ * o Neither the name of the copyright holder nor the names of its
+ *   contributors may be used to endorse or promote products derived from this
+ *   software without specific prior written permission.
+ *
+ * NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE GRANTED BY THIS LICENSE.
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*!
+ * @ingroup ADESTO_LAYER
+ */
+/**
+ * @file    flash_log.h
+ * @brief   Declarations of the append-only record log.
+ *
+ * The log stores variable length records, such as telemetry samples, one
+ * after the other in a ring of blocks. Records are collected in a page
+ * buffer and programmed a full page at a time, started without waiting
+ * where the family allows, so appending costs little more than the page
+ * programs themselves. Erasing is kept off the append path as far as
+ * possible: @ref FLASH_LOG_ERASE_AHEAD blocks ahead of the one being
+ * written are erased in advance, in the background from flashLogIdle().
+ * When the ring is full the oldest block is reclaimed to make room.
+ *
+ * A block is @ref FLASH_LOG_BLOCK_SIZE bytes rounded up to whole erase
+ * units. It starts with a header holding a magic number, the sequence number
+ * of the block and that of its first record. Each record has a header with
+ * its sequence number, its length (stored twice) and a CRC-32 over both and
+ * the data; a record never spans two blocks. flashLogMount() reads only the
+ * block headers to find the newest and oldest blocks, then scans the records
+ * of the newest block, so mounting takes time in proportion to one block
+ * rather than the whole log. A record cut short by a reset fails its CRC;
+ * the block it is in is closed and appending goes on in the next one.
+ *
+ * Appended records are durable once their page has been programmed; call
+ * flashLogSync() to program a partly filled page.
+ */
+#ifndef FLASH_LOG_H_
+#define FLASH_LOG_H_
+
+#include "flash_device.h"
+
+//! Smallest size of a block in bytes; rounded up to whole erase units.
+#ifndef FLASH_LOG_BLOCK_SIZE
+#define FLASH_LOG_BLOCK_SIZE 4096U
+#endif
+
+//! Number of erased blocks kept ahead of the block being written.
+#ifndef FLASH_LOG_ERASE_AHEAD
+#define FLASH_LOG_ERASE_AHEAD 2U
+#endif
+
+//! Largest page size supported.
+#ifndef FLASH_LOG_PAGE_BUFFER_SIZE
+#define FLASH_LOG_PAGE_BUFFER_SIZE 528U
+#endif
+
+//! Block header magic number, "FLOG".
+#define FLASH_LOG_MAGIC 0x474F4C46UL
+
+//! Bytes of the block header.
+#define FLASH_LOG_BLOCK_HEADER_BYTES 12U
+
+//! Bytes of the record header.
+#define FLASH_LOG_RECORD_HEADER_BYTES 12U
+
+//! Largest record in bytes.
+#define FLASH_LOG_MAX_RECORD_BYTES (FLASH_LOG_BLOCK_SIZE - FLASH_LOG_BLOCK_HEADER_BYTES - FLASH_LOG_RECORD_HEADER_BYTES)
+
+#if (FLASH_LOG_MAX_RECORD_BYTES > 0xFFFEU)
+#error Records longer than 65534 bytes are not supported.
+#endif
+
+/*!
+ * @brief Usage counters of a log.
+ */
+typedef struct
+{
+	//! Records appended.
+	uint32_t records;
+	//! Record bytes appended, headers not included.
+	uint64_t bytes;
+	//! Program commands issued.
+	uint32_t programs;
+	//! Erase units erased.
+	uint32_t erases;
+	//! Blocks of old records reclaimed.
+	uint32_t reclaimed;
+} FLASH_LogStats;
+
+/*!
+ * @brief A mounted log.
+ */
+typedef struct
+{
+	//! The device holding the log.
+	const FLASH_Device *device;
+	//! Device address of block 0.
+	uint32_t baseAddress;
+	//! Bytes per block.
+	uint32_t blockSize;
+	//! Number of blocks.
+	uint32_t numBlocks;
+	//! Page size of the device.
+	uint32_t pageSize;
+	//! Oldest block holding records.
+	uint32_t tailBlock;
+	//! Block being appended to.
+	uint32_t headBlock;
+	//! Offset in the head block where the next record goes.
+	uint32_t headOffset;
+	//! Sequence number of the head block.
+	uint32_t blockSequence;
+	//! Sequence number of the next record.
+	uint32_t nextSequence;
+	//! Erased blocks following the head block.
+	uint32_t readyBlocks;
+	//! Next erase unit to erase in the block after them.
+	uint32_t eraseUnit;
+	//! 1 while a program or erase runs in the background.
+	uint8_t busy;
+	//! 1 if that is an erase.
+	uint8_t busyErasing;
+	//! USER_CONFIG_CycleCount64() when it started.
+	uint64_t busyStart;
+	//! Its typical duration in microseconds.
+	uint32_t busyUs;
+	//! Offset in the head block of the page held in pageBuffer.
+	uint32_t bufferPage;
+	//! Bytes of pageBuffer already programmed.
+	uint32_t bufferFlushed;
+	//! The page being filled.
+	uint8_t pageBuffer[FLASH_LOG_PAGE_BUFFER_SIZE];
+	//! Usage counters.
+	FLASH_LogStats stats;
+} FLASH_Log;
+
+/*!
+ * @brief Position of a reader in the log.
+ */
+typedef struct
+{
+	//! Block of the next record.
+	uint32_t block;
+	//! Offset of the next record in the block.
+	uint32_t offset;
+	//! Sequence number of the block.
+	uint32_t blockSequence;
+	//! Expected sequence number of the next record.
+	uint32_t sequence;
+} FLASH_LogCursor;
+
+/*!
+ * @brief Mounts the log kept in a range of the device, finding the newest
+ * record from the block headers and the records of the newest block. A
+ * range holding no log is erased block by block as it is used.
+ *
+ * @param log The log.
+ * @param device The device. Must stay valid while the log is used.
+ * @param address Device address of the range, on an erase unit boundary.
+ * @param numBytes Size of the range; whole blocks are used.
+ *
+ * @retval 1 The log is mounted.
+ * @retval 0 The geometry is not supported or the range holds fewer than
+ * @ref FLASH_LOG_ERASE_AHEAD + 2 blocks.
+ */
+uint8_t flashLogMount(FLASH_Log *log, const FLASH_Device *device, uint32_t address, uint32_t numBytes);
+
+/*!
+ * @brief Appends a record. Its sequence number is one more than that of the
+ * previous record.
+ *
+ * @param log The log.
+ * @param record The data.
+ * @param numBytes Its length, at most @ref FLASH_LOG_MAX_RECORD_BYTES.
+ *
+ * @retval 1 The record is appended.
+ * @retval 0 The record is too long.
+ */
+uint8_t flashLogAppend(FLASH_Log *log, const uint8_t *record, uint32_t numBytes);
+
+/*!
+ * @brief Programs the records still held in the page buffer and waits for
+ * the program to complete.
+ *
+ * @param log The log.
+ *
+ * @retval void
+ */
+void flashLogSync(FLASH_Log *log);
+
+/*!
+ * @brief Erases blocks ahead of the head without waiting, one erase unit per
+ * call. Call it while the application is idle.
+ *
+ * @param log The log.
+ *
+ * @retval 1 More blocks remain to be erased.
+ * @retval 0 @ref FLASH_LOG_ERASE_AHEAD blocks are erased.
+ */
+uint8_t flashLogIdle(FLASH_Log *log);
+
+/*!
+ * @brief Places a cursor on the oldest record. While the log has a single
+ * block, records still in the page buffer are programmed first.
+ *
+ * @param log The log.
+ * @param cursor The cursor.
+ *
+ * @retval void
+ */
+void flashLogRewind(FLASH_Log *log, FLASH_LogCursor *cursor);
+
+/*!
+ * @brief Reads the record at a cursor and moves the cursor past it. Records
+ * still in the page buffer are programmed first (see flashLogSync()).
+ *
+ * @param log The log.
+ * @param cursor The cursor.
+ * @param record Receives the data, at least @ref FLASH_LOG_MAX_RECORD_BYTES bytes.
+ * @param numBytes Receives the length.
+ * @param sequence Receives the sequence number. May be NULL.
+ *
+ * @retval 1 A record was read.
+ * @retval 0 There are no more records, or the records at the cursor have
+ * been reclaimed.
+ */
+uint8_t flashLogReadNext(FLASH_Log *log, FLASH_LogCursor *cursor, uint8_t *record, uint32_t *numBytes, uint32_t *sequence);
+
+#endif /* FLASH_LOG_H_ */
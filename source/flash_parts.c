@@ -0,0 +1,217 @@
+/*
+ * The Clear BSD License
+ * Copyright (c) 2018 Adesto Technologies Corporation, Inc
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted (subject to the limitations in the disclaimer below) provided
+ *  that the following conditions are met:
+ *
+ * o Redistributions of source code must retain the above copyright notice, this list
+ *   of conditions and the following disclaimer.
+ *
+ * o Redistributions in binary form must reproduce the above copyright notice, this
+ *   list of conditions and the following disclaimer in the documentation and/or
+ *   other materials provided with the distribution.
+ *
+ * o Neither the name of the copyright holder nor the names of its
+ *   contributors may be used to endorse or promote products derived from this
+ *   software without specific prior written permission.
+ *
+ * NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE GRANTED BY THIS LICENSE.
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*!
+ * @ingroup ADESTO_LAYER
+ */
+/**
+ * @file    flash_parts.c
+ * @brief   Definition of the part descriptor table.
+ */
+#include "flash_parts.h"
+
+/*
+ * Status polls. Moneta, Fusion and standard flash report RDY/BSY in bit 0 of
+ * the first status byte (1 = busy), DataFlash in bit 7 (0 = busy). The
+ * AT25DL/AT25DF081A group returns it in the second byte of a 0x05 read.
+ * Fusion parts with the Active Status Interrupt command hold SO low while
+ * busy, so the bit-bang transport can watch the pin instead of clocking.
+ */
+#define READY_STATUS(opcode, bytes, index, mask, value) \
+	{.header = {(opcode)}, .headerNumBytes = 1, .ioLines = 1, .numBytes = (bytes), \
+	 .byteIndex = (index), .busyMask = (mask), .busyValue = (value)}
+#define READY_ACTIVE_STATUS_INTERRUPT \
+	{.header = {0x25, 0x00}, .headerNumBytes = 2, .ioLines = 1, .numBytes = 1, \
+	 .byteIndex = 0, .busyMask = 0xFF, .busyValue = 0x00, .sampleLine = 1}
+
+#define MONETA_PART(part, bytes) \
+	{.name = #part, .partno = (part), .family = FLASH_FAMILY_MONETA, \
+	 .id = {0x7F, 0x7F, 0x7F, 0x7F, 0x7F, 0x7F, 0x7F, 0x43}, .idNumBytes = 8, \
+	 .capacity = (bytes), .pageSize = MONETA_PAGE_SIZE, .addressBytes = 2, \
+	 .program = {MONETA_TPP_US, 200U}, \
+	 .maxClockHz = 1600000U, .lowFrequencyClockHz = 1600000U, \
+	 .ready = READY_STATUS(0x05, 2, 0, 0x01, 0x01), \
+	 .flags = FLASH_PART_NO_ERASE}
+
+#define FUSION_ERASES \
+	{{0x81, 256U, {FUSION_TPE_US, 25000U}}, \
+	 {0x20, 4096U, {FUSION_TBE_US, 200000U}}, \
+	 {0x52, 32768U, {250000U, 600000U}}}
+#define FUSION_READY	READY_STATUS(0x05, 2, 0, 0x01, 0x01)
+// Parts with dual input program, sector protection and the Active Status Interrupt.
+#define FUSION_EXTENDED		(FLASH_PART_DUAL_OUTPUT_READ | FLASH_PART_DUAL_PROGRAM | FLASH_PART_SECTOR_PROTECT)
+
+#define FUSION_PART(part, id1, id2, bytes, readyPoll, extraFlags) \
+	{.name = #part, .partno = (part), .family = FLASH_FAMILY_FUSION, \
+	 .id = {0x1F, (id1), (id2)}, .idNumBytes = 3, \
+	 .capacity = (bytes), .pageSize = FUSION_PAGE_SIZE, .addressBytes = 3, \
+	 .erases = FUSION_ERASES, \
+	 .program = {FUSION_TPP_US, 3000U}, .chipErase = {FUSION_TCE_US, 6000000U}, \
+	 .maxClockHz = 85000000U, .lowFrequencyClockHz = 33000000U, \
+	 .ready = readyPoll, \
+	 .flags = FLASH_PART_DUAL_OUTPUT_READ | (extraFlags)}
+
+#define DATAFLASH_PART(part, id1, id2, pages, pageBytes, sectorPages, extraFlags) \
+	{.name = #part, .partno = (part), .family = FLASH_FAMILY_DATAFLASH, \
+	 .id = {0x1F, (id1), (id2)}, .idNumBytes = 3, \
+	 .capacity = (pages) * (pageBytes), .pageSize = (pageBytes), .addressBytes = 3, \
+	 .erases = {{0x81, (pageBytes), {DATAFLASH_TPE_US, 35000U}}, \
+				{0x50, 8U * (pageBytes), {DATAFLASH_TBE_US, 50000U}}, \
+				{0x7C, (sectorPages) * (pageBytes), {700000U, 1300000U}}}, \
+	 .program = {DATAFLASH_TEP_US, 35000U}, .chipErase = {DATAFLASH_TCE_US, 80000000U}, \
+	 .maxClockHz = 85000000U, .lowFrequencyClockHz = 50000000U, \
+	 .ready = READY_STATUS(0xD7, 2, 0, 0x80, 0x00), \
+	 .flags = (extraFlags)}
+#define DATAFLASH_AT45		(FLASH_PART_BUFFER2 | FLASH_PART_SUSPEND | FLASH_PART_SECTOR_PROTECT)
+#define DATAFLASH_AT45DQ	(DATAFLASH_AT45 | FLASH_PART_DUAL_OUTPUT_READ | FLASH_PART_QUAD_OUTPUT_READ | \
+							 FLASH_PART_DUAL_PROGRAM | FLASH_PART_QUAD_PROGRAM)
+
+#define STANDARDFLASH_ERASES \
+	{{0x20, 4096U, {STANDARDFLASH_TBE4K_US, 300000U}}, \
+	 {0x52, 32768U, {150000U, 1300000U}}, \
+	 {0xD8, 65536U, {STANDARDFLASH_TBE64K_US, 1600000U}}}
+#define STANDARDFLASH_PART(part, id1, id2, bytes, readyPoll, partFlags) \
+	{.name = #part, .partno = (part), .family = FLASH_FAMILY_STANDARDFLASH, \
+	 .id = {0x1F, (id1), (id2)}, .idNumBytes = 3, \
+	 .capacity = (bytes), .pageSize = STANDARDFLASH_PAGE_SIZE, .addressBytes = 3, \
+	 .erases = STANDARDFLASH_ERASES, \
+	 .program = {STANDARDFLASH_TPP_US, 3000U}, .chipErase = {STANDARDFLASH_TCE_US, 80000000U}, \
+	 .maxClockHz = 104000000U, .lowFrequencyClockHz = 50000000U, \
+	 .ready = readyPoll, \
+	 .flags = (partFlags)}
+#define STANDARDFLASH_READY			READY_STATUS(0x05, 1, 0, 0x01, 0x01)
+#define STANDARDFLASH_READY_DL		READY_STATUS(0x05, 2, 1, 0x01, 0x01)
+// AT25SF041 and AT25SF081.
+#define STANDARDFLASH_SF	(FLASH_PART_DUAL_OUTPUT_READ | FLASH_PART_DUAL_IO_READ | \
+							 FLASH_PART_QUAD_OUTPUT_READ | FLASH_PART_QUAD_IO_READ | FLASH_PART_QUAD_PROGRAM | \
+							 FLASH_PART_SFDP)
+// AT25SF161 and AT25SF321.
+#define STANDARDFLASH_SF_SUSPEND	(STANDARDFLASH_SF | FLASH_PART_SUSPEND)
+// AT25SF641, AT25SL, AT25QL and AT25QF parts.
+#define STANDARDFLASH_QPI	(STANDARDFLASH_SF_SUSPEND | FLASH_PART_QPI)
+// AT25DL and AT25DF081A/321A/641A parts.
+#define STANDARDFLASH_DL	(FLASH_PART_DUAL_PROGRAM | FLASH_PART_SUSPEND | FLASH_PART_SECTOR_PROTECT)
+
+const FLASH_Part flashParts[FLASH_NUM_PARTS] =
+{
+	MONETA_PART(RM331x, 0x10000U),
+	FUSION_PART(AT25XE512C, 0x65, 0x01, 0x10000U, FUSION_READY, 0),
+	FUSION_PART(AT25XE011, 0x42, 0x00, 0x20000U, FUSION_READY, 0),
+	FUSION_PART(AT25XE021A, 0x43, 0x01, 0x40000U, READY_ACTIVE_STATUS_INTERRUPT, FUSION_EXTENDED),
+	FUSION_PART(AT25XE041B, 0x44, 0x02, 0x80000U, READY_ACTIVE_STATUS_INTERRUPT, FUSION_EXTENDED),
+	FUSION_PART(AT25DN256, 0x40, 0x00, 0x8000U, FUSION_READY, 0),
+	FUSION_PART(AT25DN512C, 0x65, 0x01, 0x10000U, FUSION_READY, 0),
+	FUSION_PART(AT25DN011, 0x42, 0x00, 0x20000U, FUSION_READY, 0),
+	FUSION_PART(AT25DF256, 0x40, 0x00, 0x8000U, FUSION_READY, 0),
+	FUSION_PART(AT25DF512C, 0x64, 0x01, 0x10000U, FUSION_READY, 0),
+	FUSION_PART(AT25DF011, 0x42, 0x00, 0x20000U, FUSION_READY, 0),
+	FUSION_PART(AT25DF021A, 0x43, 0x01, 0x40000U, READY_ACTIVE_STATUS_INTERRUPT, FUSION_EXTENDED),
+	FUSION_PART(AT25DF041B, 0x44, 0x02, 0x80000U, READY_ACTIVE_STATUS_INTERRUPT, FUSION_EXTENDED),
+	FUSION_PART(AT25XV021A, 0x43, 0x01, 0x40000U, READY_ACTIVE_STATUS_INTERRUPT, FUSION_EXTENDED),
+	FUSION_PART(AT25XV041B, 0x44, 0x02, 0x80000U, READY_ACTIVE_STATUS_INTERRUPT, FUSION_EXTENDED),
+	DATAFLASH_PART(AT45DB021E, 0x23, 0x00, 1024U, 256U, 128U, DATAFLASH_AT45),
+	DATAFLASH_PART(AT45DB041E, 0x24, 0x00, 2048U, 256U, 256U, DATAFLASH_AT45),
+	DATAFLASH_PART(AT45DB081E, 0x25, 0x00, 4096U, 256U, 256U, DATAFLASH_AT45),
+	DATAFLASH_PART(AT45DB161E, 0x26, 0x00, 4096U, 512U, 256U, DATAFLASH_AT45),
+	DATAFLASH_PART(AT45DB321E, 0x27, 0x01, 8192U, 512U, 128U, DATAFLASH_AT45),
+	DATAFLASH_PART(AT45DB641E, 0x28, 0x00, 32768U, 256U, 1024U, DATAFLASH_AT45),
+	DATAFLASH_PART(AT45DQ161, 0x26, 0x00, 4096U, 512U, 256U, DATAFLASH_AT45DQ),
+	DATAFLASH_PART(AT45DQ321, 0x27, 0x01, 8192U, 512U, 128U, DATAFLASH_AT45DQ),
+	DATAFLASH_PART(AT25PE20, 0x23, 0x00, 1024U, 256U, 128U, 0),
+	DATAFLASH_PART(AT25PE40, 0x24, 0x00, 2048U, 256U, 256U, FLASH_PART_BUFFER2),
+	DATAFLASH_PART(AT25PE80, 0x25, 0x00, 4096U, 256U, 256U, FLASH_PART_BUFFER2),
+	DATAFLASH_PART(AT25PE16, 0x26, 0x00, 4096U, 512U, 256U, FLASH_PART_BUFFER2),
+	STANDARDFLASH_PART(AT25SF041, 0x84, 0x01, 0x80000U, STANDARDFLASH_READY, STANDARDFLASH_SF),
+	STANDARDFLASH_PART(AT25SF081, 0x85, 0x01, 0x100000U, STANDARDFLASH_READY, STANDARDFLASH_SF),
+	STANDARDFLASH_PART(AT25SF161, 0x86, 0x01, 0x200000U, STANDARDFLASH_READY, STANDARDFLASH_SF_SUSPEND),
+	STANDARDFLASH_PART(AT25SF321, 0x87, 0x01, 0x400000U, STANDARDFLASH_READY, STANDARDFLASH_SF_SUSPEND),
+	STANDARDFLASH_PART(AT25SF641, 0x32, 0x17, 0x800000U, STANDARDFLASH_READY, STANDARDFLASH_QPI),
+	STANDARDFLASH_PART(AT25SL321, 0x42, 0x16, 0x400000U, STANDARDFLASH_READY, STANDARDFLASH_QPI),
+	STANDARDFLASH_PART(AT25SL641, 0x43, 0x17, 0x800000U, STANDARDFLASH_READY, STANDARDFLASH_QPI),
+	STANDARDFLASH_PART(AT25SL128A, 0x42, 0x18, 0x1000000U, STANDARDFLASH_READY, STANDARDFLASH_QPI),
+	STANDARDFLASH_PART(AT25DL081, 0x45, 0x02, 0x100000U, STANDARDFLASH_READY_DL, STANDARDFLASH_DL),
+	STANDARDFLASH_PART(AT25DL161, 0x46, 0x03, 0x200000U, STANDARDFLASH_READY_DL, STANDARDFLASH_DL),
+	STANDARDFLASH_PART(AT25DF081A, 0x45, 0x01, 0x100000U, STANDARDFLASH_READY_DL, STANDARDFLASH_DL),
+	STANDARDFLASH_PART(AT25DF321A, 0x47, 0x01, 0x400000U, STANDARDFLASH_READY_DL, STANDARDFLASH_DL),
+	STANDARDFLASH_PART(AT25DF641A, 0x48, 0x00, 0x800000U, STANDARDFLASH_READY_DL, STANDARDFLASH_DL),
+	STANDARDFLASH_PART(AT25QL321, 0x42, 0x16, 0x400000U, STANDARDFLASH_READY, STANDARDFLASH_QPI),
+	STANDARDFLASH_PART(AT25QL641, 0x43, 0x17, 0x800000U, STANDARDFLASH_READY, STANDARDFLASH_QPI),
+	STANDARDFLASH_PART(AT25QL128A, 0x42, 0x18, 0x1000000U, STANDARDFLASH_READY, STANDARDFLASH_QPI),
+	STANDARDFLASH_PART(AT25QF641, 0x32, 0x17, 0x800000U, STANDARDFLASH_READY, STANDARDFLASH_QPI)
+};
+
+#if (ALL == 1)
+const FLASH_Part *flashPartSelected = &flashParts[0];
+#endif
+
+const FLASH_Part *flashPartFind(uint32_t partno)
+{
+	if((partno < 1) || (partno > FLASH_NUM_PARTS))
+	{
+		return NULL;
+	}
+	return &flashParts[partno - 1];
+}
+
+uint8_t flashPartMatchesID(const FLASH_Part *part, const uint8_t *id, uint32_t idNumBytes)
+{
+	uint32_t i;
+	if(idNumBytes < part->idNumBytes)
+	{
+		return 0;
+	}
+	for(i = 0; i < part->idNumBytes; i++)
+	{
+		if(id[i] != part->id[i])
+			return 0;
+	}
+	return 1;
+}
+
+const FLASH_Part *flashPartFindByID(const uint8_t *id, uint32_t idNumBytes)
+{
+	uint32_t i;
+	for(i = 0; i < FLASH_NUM_PARTS; i++)
+	{
+		if(flashPartMatchesID(&flashParts[i], id, idNumBytes))
+		{
+			return &flashParts[i];
+		}
+	}
+	return NULL;
+}
+
+const FLASH_PartErase *flashPartSmallestErase(const FLASH_Part *part)
+{
+	return (part->erases[0].numBytes != 0) ? &part->erases[0] : NULL;
+}
@@ -0,0 +1,230 @@
+/*
+ * The Clear BSD License
+ * Copyright (c) 2018 Adesto Technologies Corporation, Inc
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted (subject to the limitations in the disclaimer below) provided
+ *  that the following conditions are met:
+ *
+ * o Redistributions of source code must retain the above copyright notice, this list
+ *   of conditions and the following disclaimer.
+ *
+ * o Redistributions in binary form must reproduce the above copyright notice, this
+ *   list of conditions and the following disclaimer in the documentation and/or
+ *   other materials provided with the distribution.
+ *
+ * o Neither the name of the copyright holder nor the names of its
+ *   contributors may be used to endorse or promote products derived from this
+ *   software without specific prior written permission.
+ *
+ * NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE GRANTED BY THIS LICENSE.
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*!
+ * @ingroup ADESTO_LAYER
+ */
+/**
+ * @file    flash_parts.h
+ * @brief   Descriptors of every supported part.
+ *
+ * Each part has a constant FLASH_Part describing its geometry, identity,
+ * clock limits, program and erase times, status register layout and the
+ * optional commands the drivers support for it. The drivers and the layers
+ * above them look facts up here instead of testing PARTNO, and the
+ * descriptor of the selected part is available at compile time as
+ * @ref FLASH_PART. The table is indexed by part number, so other parts can
+ * be looked up as well (see flashPartFind() and flashPartFindByID()).
+ *
+ * Typical times are the *_US values of cmd_defs.h, so overriding those also
+ * changes the descriptors. Maximum times are the datasheet limits and are
+ * meant for timeouts.
+ */
+#ifndef FLASH_PARTS_H_
+#define FLASH_PARTS_H_
+
+#include "cmd_defs.h"
+#include "spi_driver.h"
+
+//! Number of parts in flashParts[]; the part numbers run from 1 to this value.
+#define FLASH_NUM_PARTS			44U
+//! Maximum number of erase sizes of a part, chip erase excluded.
+#define FLASH_PART_ERASE_TYPES	4U
+//! Maximum number of identification bytes of a part.
+#define FLASH_PART_ID_BYTES		8U
+
+//! FLASH_Part.flags: dual output read (1-1-2) is supported.
+#define FLASH_PART_DUAL_OUTPUT_READ		(1U << 0)
+//! FLASH_Part.flags: dual I/O read (1-2-2) is supported.
+#define FLASH_PART_DUAL_IO_READ			(1U << 1)
+//! FLASH_Part.flags: quad output read (1-1-4) is supported.
+#define FLASH_PART_QUAD_OUTPUT_READ		(1U << 2)
+//! FLASH_Part.flags: quad I/O read (1-4-4) is supported.
+#define FLASH_PART_QUAD_IO_READ			(1U << 3)
+//! FLASH_Part.flags: the part can run every command in QPI mode (4-4-4).
+#define FLASH_PART_QPI					(1U << 4)
+//! FLASH_Part.flags: data can be programmed on 2 IOs.
+#define FLASH_PART_DUAL_PROGRAM			(1U << 5)
+//! FLASH_Part.flags: data can be programmed on 4 IOs.
+#define FLASH_PART_QUAD_PROGRAM			(1U << 6)
+//! FLASH_Part.flags: programs and erases can be suspended.
+#define FLASH_PART_SUSPEND				(1U << 7)
+//! FLASH_Part.flags: sectors are protected individually.
+#define FLASH_PART_SECTOR_PROTECT		(1U << 8)
+//! FLASH_Part.flags: DataFlash with a second SRAM buffer.
+#define FLASH_PART_BUFFER2				(1U << 9)
+//! FLASH_Part.flags: bytes are rewritten without an erase (Moneta).
+#define FLASH_PART_NO_ERASE				(1U << 10)
+//! FLASH_Part.flags: the SFDP table can be read (0x5A).
+#define FLASH_PART_SFDP					(1U << 11)
+
+/*!
+ * @brief Families of parts, each served by one driver.
+ */
+enum flashFamily
+{
+	FLASH_FAMILY_MONETA,		//!< moneta.h
+	FLASH_FAMILY_FUSION,		//!< fusion.h
+	FLASH_FAMILY_DATAFLASH,		//!< dataflash.h
+	FLASH_FAMILY_STANDARDFLASH	//!< standardflash.h
+};
+
+/*!
+ * @brief Typical and maximum duration of an operation.
+ */
+typedef struct
+{
+	//! Typical duration in microseconds.
+	uint32_t typicalUs;
+	//! Maximum duration in microseconds.
+	uint32_t maxUs;
+} FLASH_PartTime;
+
+/*!
+ * @brief One erase size of a part.
+ */
+typedef struct
+{
+	//! Opcode of the erase command.
+	uint8_t opcode;
+	//! Bytes erased. For DataFlash, in power of 2 page mode.
+	uint32_t numBytes;
+	//! Duration of the erase.
+	FLASH_PartTime time;
+} FLASH_PartErase;
+
+/*!
+ * @brief Description of a part.
+ */
+typedef struct
+{
+	//! Part name.
+	const char *name;
+	//! Part number, as used for PARTNO.
+	uint8_t partno;
+	//! Driver family.
+	enum flashFamily family;
+	//! Leading bytes returned by the manufacturer and device ID read (0x9F).
+	uint8_t id[FLASH_PART_ID_BYTES];
+	//! Number of bytes in id.
+	uint8_t idNumBytes;
+	//! Array size in bytes. For DataFlash, in power of 2 page mode; standard
+	//! page size mode adds 1/32.
+	uint32_t capacity;
+	//! Program page size in bytes. For DataFlash, in power of 2 page mode.
+	uint32_t pageSize;
+	//! Number of address bytes sent with array commands.
+	uint8_t addressBytes;
+	//! Erase sizes, smallest first. Unused entries have numBytes 0.
+	FLASH_PartErase erases[FLASH_PART_ERASE_TYPES];
+	//! Duration of a page program.
+	FLASH_PartTime program;
+	//! Duration of a chip erase. 0 if the part has none.
+	FLASH_PartTime chipErase;
+	//! Highest SCK frequency in Hz.
+	uint32_t maxClockHz;
+	//! Highest SCK frequency of the low frequency read array command (0x03) in Hz.
+	uint32_t lowFrequencyClockHz;
+	//! How the drivers wait for the end of a program or erase.
+	SPI_ReadyPoll ready;
+	//! FLASH_PART_* flags.
+	uint32_t flags;
+} FLASH_Part;
+
+/*!
+ * @brief The descriptors of every part, in part number order.
+ */
+extern const FLASH_Part flashParts[FLASH_NUM_PARTS];
+
+#if (ALL == 1)
+/*!
+ * @brief The descriptor used by the drivers when every driver is built
+ * (ALL == 1) and PARTNO selects no part. The application sets it before
+ * using a driver; it defaults to the first part.
+ */
+extern const FLASH_Part *flashPartSelected;
+
+/*!
+ * @brief The descriptor of the part in use.
+ */
+#define FLASH_PART flashPartSelected
+#else
+/*!
+ * @brief The descriptor of the part selected with PARTNO.
+ */
+#define FLASH_PART (&flashParts[PARTNO - 1])
+#endif
+
+/*!
+ * @brief Returns the descriptor of a part.
+ *
+ * @param partno A part number, as used for PARTNO.
+ *
+ * @retval const FLASH_Part* The descriptor, NULL if partno is not a part number.
+ */
+const FLASH_Part *flashPartFind(uint32_t partno);
+
+/*!
+ * @brief Tells whether a part answers the manufacturer and device ID read
+ * with the given bytes.
+ *
+ * @param part The part.
+ * @param id The bytes read with the 0x9F command.
+ * @param idNumBytes The number of bytes in id.
+ *
+ * @retval uint8_t 1 if the leading bytes of id are those of the part.
+ */
+uint8_t flashPartMatchesID(const FLASH_Part *part, const uint8_t *id, uint32_t idNumBytes);
+
+/*!
+ * @brief Finds the part that answers the manufacturer and device ID read
+ * with the given bytes. Parts sharing an ID (such as the AT45DB161E and
+ * AT45DQ161) resolve to the first in part number order.
+ *
+ * @param id The bytes read with the 0x9F command.
+ * @param idNumBytes The number of bytes in id.
+ *
+ * @retval const FLASH_Part* The descriptor, NULL if no part matches.
+ */
+const FLASH_Part *flashPartFindByID(const uint8_t *id, uint32_t idNumBytes);
+
+/*!
+ * @brief Returns the smallest erase of a part.
+ *
+ * @param part The part.
+ *
+ * @retval const FLASH_PartErase* The erase, NULL if the part has none.
+ */
+const FLASH_PartErase *flashPartSmallestErase(const FLASH_Part *part);
+
+#endif /* FLASH_PARTS_H_ */
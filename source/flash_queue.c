@@ -0,0 +1,427 @@
+/*
+ * The Clear BSD License
+ * Copyright (c) 2018 Adesto Technologies Corporation, Inc
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted (subject to the limitations in the disclaimer below) provided
+ *  that the following conditions are met:
+ *
+ * o Redistributions of source code must retain the above copyright notice, this list
+ *   of conditions and the following disclaimer.
+ *
+ * o Redistributions in binary form must reproduce the above copyright notice, this
+ *   list of conditions and the following disclaimer in the documentation and/or
+ *   other materials provided with the distribution.
+ *
+ * o Neither the name of the copyright holder nor the names of its
+ *   contributors may be used to endorse or promote products derived from this
+ *   software without specific prior written permission.
+ *
+ * NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE GRANTED BY THIS LICENSE.
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*!
+ * @ingroup ADESTO_LAYER
+ */
+/**
+ * @file    flash_queue.c
+ * @brief   Definition of the per-device command queue.
+ */
+#include "flash_queue.h"
+#include <string.h>
+
+void flashQueueInit(FLASH_Queue *queue, const FLASH_Device *device)
+{
+	queue->device = device;
+	queue->count = 0;
+	queue->policy.urgentOnly = 0;
+	queue->policy.maxSuspends = FLASH_QUEUE_MAX_SUSPENDS;
+	queue->policy.minRunUs = FLASH_QUEUE_MIN_RUN_US;
+	queue->activeCount = 0;
+}
+
+void flashQueueSetSuspendPolicy(FLASH_Queue *queue, const FLASH_SuspendPolicy *policy)
+{
+	queue->policy = *policy;
+}
+
+void flashCommandInit(FLASH_Command *command,
+					  enum flashCommandType type,
+					  uint32_t address,
+					  uint8_t *buffer,
+					  uint32_t numBytes,
+					  FLASH_CommandCallback callback,
+					  void *userData)
+{
+	command->type = type;
+	command->address = address;
+	command->buffer = buffer;
+	command->numBytes = numBytes;
+	command->callback = callback;
+	command->userData = userData;
+	command->done = 0;
+	command->urgent = 0;
+}
+
+uint8_t flashQueueSubmit(FLASH_Queue *queue, FLASH_Command *command)
+{
+	if(queue->count == FLASH_QUEUE_DEPTH)
+	{
+		return 0;
+	}
+	command->done = 0;
+	queue->commands[queue->count++] = command;
+	return 1;
+}
+
+uint8_t flashCommandDone(const FLASH_Command *command)
+{
+	return command->done;
+}
+
+// Byte range [*start, *end) touched by a command. Erases cover whole units.
+static void commandRange(const FLASH_Queue *queue, const FLASH_Command *command,
+						 uint32_t *start, uint32_t *end)
+{
+	*start = command->address;
+	*end = command->address + command->numBytes;
+	if((command->type == FLASH_COMMAND_ERASE) && (command->numBytes > 0))
+	{
+		uint32_t eraseSize = queue->device->eraseSize;
+		*start -= *start % eraseSize;
+		*end += (eraseSize - (*end % eraseSize)) % eraseSize;
+	}
+}
+
+// A read may run now if no program or erase queued before it touches its range.
+// The contents of a page being programmed are undefined while the program is
+// suspended, so the active commands count as covering whole pages.
+static uint8_t readIsReady(const FLASH_Queue *queue, uint32_t index)
+{
+	uint32_t pageSize = queue->device->pageSize;
+	uint32_t readStart, readEnd, start, end, i;
+	commandRange(queue, queue->commands[index], &readStart, &readEnd);
+	for(i = 0; i < index; i++)
+	{
+		if(queue->commands[i]->type == FLASH_COMMAND_READ)
+			continue;
+		commandRange(queue, queue->commands[i], &start, &end);
+		if((i < queue->activeCount) && (end > start))
+		{
+			start -= start % pageSize;
+			end += (pageSize - (end % pageSize)) % pageSize;
+		}
+		if((start < readEnd) && (readStart < end))
+			return 0;
+	}
+	return 1;
+}
+
+// Removes a command from the queue, marks it done and calls its callback.
+static void completeCommand(FLASH_Queue *queue, FLASH_Command *command)
+{
+	uint32_t i = 0;
+	while(queue->commands[i] != command)
+		i++;
+	queue->count--;
+	for(; i < queue->count; i++)
+		queue->commands[i] = queue->commands[i + 1];
+	command->done = 1;
+	if(command->callback != NULL)
+	{
+		command->callback(command, command->userData);
+	}
+}
+
+// Runs the read at 'first' together with every ready read that extends its
+// range, in one read stream.
+static void runReads(FLASH_Queue *queue, uint32_t first)
+{
+	FLASH_Command *batch[FLASH_QUEUE_DEPTH];
+	uint8_t inBatch[FLASH_QUEUE_DEPTH] = {0};
+	uint32_t numBatch = 1, start, end, i, j;
+	uint8_t extended = 1;
+
+	batch[0] = queue->commands[first];
+	inBatch[first] = 1;
+	commandRange(queue, batch[0], &start, &end);
+	while(extended)
+	{
+		extended = 0;
+		for(i = 0; i < queue->count; i++)
+		{
+			FLASH_Command *command = queue->commands[i];
+			uint32_t commandEnd = command->address + command->numBytes;
+			if(inBatch[i] || (command->type != FLASH_COMMAND_READ) || !readIsReady(queue, i))
+				continue;
+			if((command->address >= end) && (command->address - end <= FLASH_QUEUE_READ_GAP))
+				end = commandEnd;
+			else if((commandEnd <= start) && (start - commandEnd <= FLASH_QUEUE_READ_GAP))
+				start = command->address;
+			else
+				continue;
+			inBatch[i] = 1;
+			batch[numBatch++] = command;
+			extended = 1;
+		}
+	}
+
+	if(numBatch == 1)
+	{
+		flashDeviceRead(queue->device, batch[0]->address, batch[0]->buffer, batch[0]->numBytes);
+	}
+	else
+	{
+		SPI_Stream stream;
+		uint32_t position = start;
+		// Order the batch by address; the ranges do not overlap.
+		for(i = 1; i < numBatch; i++)
+		{
+			FLASH_Command *command = batch[i];
+			for(j = i; (j > 0) && (batch[j - 1]->address > command->address); j--)
+				batch[j] = batch[j - 1];
+			batch[j] = command;
+		}
+		flashDeviceOpenReadStream(queue->device, &stream, start);
+		for(i = 0; i < numBatch; i++)
+		{
+			if(batch[i]->address > position)
+				SPI_StreamRead(&stream, queue->pageBuffer, batch[i]->address - position);
+			SPI_StreamRead(&stream, batch[i]->buffer, batch[i]->numBytes);
+			position = batch[i]->address + batch[i]->numBytes;
+		}
+		SPI_StreamClose(&stream);
+	}
+
+	for(i = 0; i < numBatch; i++)
+	{
+		completeCommand(queue, batch[i]);
+	}
+}
+
+// Number of programs at the head of the queue that continue each other's
+// range. *end receives the end of the merged range.
+static uint32_t programBatch(const FLASH_Queue *queue, uint32_t *end)
+{
+	uint32_t numBatch = 1;
+	*end = queue->commands[0]->address + queue->commands[0]->numBytes;
+	while((numBatch < queue->count) &&
+		  (queue->commands[numBatch]->type == FLASH_COMMAND_PROGRAM) &&
+		  (queue->commands[numBatch]->address == *end))
+	{
+		*end += queue->commands[numBatch]->numBytes;
+		numBatch++;
+	}
+	return numBatch;
+}
+
+// Programs, or starts programming if 'start' is set, the page of the first
+// 'numBatch' commands beginning at 'address'. Returns the number of bytes.
+static uint32_t programPage(FLASH_Queue *queue, uint32_t numBatch, uint32_t address, uint32_t end, uint8_t start)
+{
+	const FLASH_Device *device = queue->device;
+	uint32_t chunk = device->pageSize - (address % device->pageSize);
+	uint8_t *data = NULL;
+	uint32_t i;
+	if(chunk > FLASH_QUEUE_PAGE_BUFFER_SIZE)
+		chunk = FLASH_QUEUE_PAGE_BUFFER_SIZE;
+	if(chunk > end - address)
+		chunk = end - address;
+	// Program straight from the caller's buffer when one command holds the
+	// whole chunk, otherwise assemble it from the commands it spans.
+	for(i = 0; i < numBatch; i++)
+	{
+		FLASH_Command *command = queue->commands[i];
+		if((command->address <= address) && (address + chunk <= command->address + command->numBytes))
+			data = &command->buffer[address - command->address];
+	}
+	if(data == NULL)
+	{
+		for(i = 0; i < numBatch; i++)
+		{
+			FLASH_Command *command = queue->commands[i];
+			uint32_t first = (command->address > address) ? command->address : address;
+			uint32_t last = command->address + command->numBytes;
+			if(last > address + chunk)
+				last = address + chunk;
+			if(first < last)
+				memcpy(&queue->pageBuffer[first - address], &command->buffer[first - command->address], last - first);
+		}
+		data = queue->pageBuffer;
+	}
+	if(start)
+		flashDeviceProgramPageStart(device, address, data, chunk);
+	else
+		flashDeviceProgram(device, address, data, chunk);
+	return chunk;
+}
+
+// Erases every unit covered by the erase at the head of the queue.
+static void runErase(FLASH_Queue *queue)
+{
+	FLASH_Command *command = queue->commands[0];
+	uint32_t start, end, address;
+	commandRange(queue, command, &start, &end);
+	for(address = start; address < end; address += queue->device->eraseSize)
+	{
+		flashDeviceErase(queue->device, address);
+	}
+	completeCommand(queue, command);
+}
+
+// Merges the program at the head of the queue with the programs queued
+// directly behind it that continue its range, and programs the result one
+// page at a time.
+static void runPrograms(FLASH_Queue *queue)
+{
+	uint32_t end, numBatch = programBatch(queue, &end);
+	uint32_t address = queue->commands[0]->address;
+	while(address < end)
+	{
+		address += programPage(queue, numBatch, address, end, 0);
+	}
+	while(numBatch-- > 0)
+	{
+		completeCommand(queue, queue->commands[0]);
+	}
+}
+
+// Starts the next page or erase unit of the active commands, or completes
+// them when none is left.
+static void advanceActive(FLASH_Queue *queue)
+{
+	const FLASH_Device *device = queue->device;
+	if(queue->activeAddress < queue->activeEnd)
+	{
+		if(queue->commands[0]->type == FLASH_COMMAND_ERASE)
+		{
+			flashDeviceEraseStart(device, queue->activeAddress);
+			queue->activeAddress += device->eraseSize;
+		}
+		else
+		{
+			queue->activeAddress += programPage(queue, queue->activeCount, queue->activeAddress, queue->activeEnd, 1);
+		}
+		queue->activeSuspends = 0;
+		queue->activeRunStart = USER_CONFIG_CycleCount();
+		return;
+	}
+	while(queue->activeCount > 0)
+	{
+		queue->activeCount--;
+		completeCommand(queue, queue->commands[0]);
+	}
+}
+
+// Makes the program or erase at the head of the queue the active operation.
+static void startActive(FLASH_Queue *queue)
+{
+	FLASH_Command *command = queue->commands[0];
+	if(command->type == FLASH_COMMAND_ERASE)
+	{
+		queue->activeCount = 1;
+		commandRange(queue, command, &queue->activeAddress, &queue->activeEnd);
+	}
+	else
+	{
+		queue->activeCount = programBatch(queue, &queue->activeEnd);
+		queue->activeAddress = command->address;
+	}
+	advanceActive(queue);
+}
+
+// Index of the first read that is free to run and, while an operation is
+// active, allowed to suspend it. queue->count if there is none.
+static uint32_t firstReadyRead(const FLASH_Queue *queue)
+{
+	uint32_t i;
+	for(i = 0; i < queue->count; i++)
+	{
+		FLASH_Command *command = queue->commands[i];
+		if(command->type != FLASH_COMMAND_READ)
+			continue;
+		if((queue->activeCount > 0) && queue->policy.urgentOnly && !command->urgent)
+			continue;
+		if(readIsReady(queue, i))
+			break;
+	}
+	return i;
+}
+
+// Whether the active operation may be suspended now.
+static uint8_t suspendAllowed(const FLASH_Queue *queue)
+{
+	uint64_t minRunCycles = (uint64_t) queue->policy.minRunUs * USER_CONFIG_CycleCountHz() / 1000000U;
+	if((queue->device->suspend == NULL) || (queue->activeSuspends >= queue->policy.maxSuspends))
+		return 0;
+	return (uint32_t) (USER_CONFIG_CycleCount() - queue->activeRunStart) >= minRunCycles;
+}
+
+uint32_t flashQueueStep(FLASH_Queue *queue)
+{
+	const FLASH_Device *device = queue->device;
+	uint32_t i;
+	if(queue->count == 0)
+	{
+		return 0;
+	}
+	if(queue->activeCount > 0)
+	{
+		if(!flashDeviceIsBusy(device))
+		{
+			advanceActive(queue);
+			return queue->count;
+		}
+		i = firstReadyRead(queue);
+		if((i < queue->count) && suspendAllowed(queue))
+		{
+			flashDeviceSuspend(device);
+			// Reads are accepted once the device reports ready.
+			flashDeviceWaitOnReady(device, FLASH_QUEUE_SUSPEND_US);
+			runReads(queue, i);
+			flashDeviceResume(device);
+			queue->activeSuspends++;
+			queue->activeRunStart = USER_CONFIG_CycleCount();
+		}
+		return queue->count;
+	}
+	// Reads go first, ahead of any earlier program or erase they do not overlap.
+	i = firstReadyRead(queue);
+	if(i < queue->count)
+	{
+		runReads(queue, i);
+	}
+	else if((device->isBusy != NULL) &&
+			(((queue->commands[0]->type == FLASH_COMMAND_ERASE) && (device->eraseStart != NULL)) ||
+			 ((queue->commands[0]->type == FLASH_COMMAND_PROGRAM) && (device->programPageStart != NULL))))
+	{
+		startActive(queue);
+	}
+	else if(queue->commands[0]->type == FLASH_COMMAND_ERASE)
+	{
+		runErase(queue);
+	}
+	else
+	{
+		runPrograms(queue);
+	}
+	return queue->count;
+}
+
+void flashQueueFlush(FLASH_Queue *queue)
+{
+	while(flashQueueStep(queue) > 0)
+	{
+	}
+}
@@ -0,0 +1,275 @@
+/*
+ * The Clear BSD License
+ * Copyright (c) 2018 Adesto Technologies Corporation, Inc
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted (subject to the limitations in the disclaimer below) provided
+ *  that the following conditions are met:
+ *
+ * o Redistributions of source code must retain the above copyright notice, this list
+ *   of conditions and the following disclaimer.
+ *
+ * o Redistributions in binary form must reproduce the above copyright notice, this
+ *   list of conditions and the following disclaimer in the documentation and/or
+ *   other materials provided with the distribution.
+ *
+ * o Neither the name of the copyright holder nor the names of its
+ *   contributors may be used to endorse or promote products derived from this
+ *   software without specific prior written permission.
+ *
+ * NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE GRANTED BY THIS LICENSE.
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*!
+ * @ingroup ADESTO_LAYER
+ */
+/**
+ * @file    flash_queue.h
+ * @brief   Declarations of the per-device command queue.
+ *
+ * Reads, programs and erases are queued as FLASH_Command structures and
+ * carried out by flashQueueStep() or flashQueueFlush() through a
+ * FLASH_Device. On the way the queue
+ * - runs a read ahead of earlier programs and erases it does not overlap,
+ * - joins reads of adjacent (or nearly adjacent) ranges into one continuous
+ *   read stream, so several reads cost one command header,
+ * - merges consecutive programs of sequential ranges and programs them a
+ *   full page at a time.
+ * Commands that overlap keep their submission order, so every read returns
+ * the data written by the commands submitted before it.
+ *
+ * If the device can start programs and erases without waiting for them
+ * (FLASH_Device.programPageStart, eraseStart and isBusy), they run in the
+ * background one page or erase unit at a time and flashQueueStep() returns
+ * while the device is busy. A read that arrives meanwhile is served by
+ * suspending the operation, if the part supports it, and resuming it
+ * afterwards. FLASH_SuspendPolicy bounds how often one operation can be
+ * suspended so that reads cannot starve it.
+ */
+#ifndef FLASH_QUEUE_H_
+#define FLASH_QUEUE_H_
+
+#include "flash_device.h"
+
+//! Maximum number of commands queued at once.
+#ifndef FLASH_QUEUE_DEPTH
+#define FLASH_QUEUE_DEPTH 16U
+#endif
+
+//! Largest gap in bytes between two reads that are still joined; the gap is
+//! read and discarded.
+#ifndef FLASH_QUEUE_READ_GAP
+#define FLASH_QUEUE_READ_GAP 16U
+#endif
+
+//! Size of the buffer in which merged programs are assembled. At least the
+//! largest page size of the supported parts (DataFlash standard pages).
+#ifndef FLASH_QUEUE_PAGE_BUFFER_SIZE
+#define FLASH_QUEUE_PAGE_BUFFER_SIZE 528U
+#endif
+
+//! Default FLASH_SuspendPolicy.maxSuspends.
+#ifndef FLASH_QUEUE_MAX_SUSPENDS
+#define FLASH_QUEUE_MAX_SUSPENDS 4U
+#endif
+
+//! Default FLASH_SuspendPolicy.minRunUs.
+#ifndef FLASH_QUEUE_MIN_RUN_US
+#define FLASH_QUEUE_MIN_RUN_US 500U
+#endif
+
+//! Typical time in microseconds for a device to accept reads after a suspend
+//! command (tSUS), used to pace the wait for it.
+#ifndef FLASH_QUEUE_SUSPEND_US
+#define FLASH_QUEUE_SUSPEND_US 30U
+#endif
+
+#if (FLASH_QUEUE_READ_GAP > FLASH_QUEUE_PAGE_BUFFER_SIZE)
+#error FLASH_QUEUE_READ_GAP must not exceed FLASH_QUEUE_PAGE_BUFFER_SIZE.
+#endif
+
+/*!
+ * @brief Kinds of queued commands.
+ */
+enum flashCommandType
+{
+	FLASH_COMMAND_READ,		//!< Read numBytes bytes into buffer.
+	FLASH_COMMAND_PROGRAM,	//!< Program numBytes bytes from buffer.
+	FLASH_COMMAND_ERASE		//!< Erase the erase units covering numBytes bytes.
+};
+
+typedef struct FLASH_Command FLASH_Command;
+
+/*!
+ * @brief Completion callback, called once per command from flashQueueStep().
+ */
+typedef void (*FLASH_CommandCallback)(FLASH_Command *command, void *userData);
+
+/*!
+ * @brief A queued command. The storage is owned by the caller and, like the
+ * buffer it points to, must stay valid until the command is done.
+ */
+struct FLASH_Command
+{
+	//! What to do.
+	enum flashCommandType type;
+	//! Linear byte address of the first location.
+	uint32_t address;
+	//! Data to program, or where read data is stored. Unused by erases.
+	uint8_t *buffer;
+	//! Number of bytes. Erases are rounded out to whole erase units.
+	uint32_t numBytes;
+	//! Called when the command is done. May be NULL.
+	FLASH_CommandCallback callback;
+	//! Passed to the callback.
+	void *userData;
+	//! Set once the command is done.
+	volatile uint8_t done;
+	//! Set to 1 after flashCommandInit() for a read that should suspend a
+	//! program or erase when the policy only suspends for urgent reads.
+	uint8_t urgent;
+};
+
+/*!
+ * @brief Limits on suspending a background program or erase for reads.
+ */
+typedef struct FLASH_SuspendPolicy
+{
+	//! 1: only reads with FLASH_Command.urgent set suspend an operation.
+	//! 0: any read does.
+	uint8_t urgentOnly;
+	//! Most times one page program or erase unit is suspended. Further reads
+	//! wait for it to complete. 0 never suspends.
+	uint32_t maxSuspends;
+	//! Time in microseconds an operation runs after it starts or resumes before
+	//! it may be suspended again.
+	uint32_t minRunUs;
+} FLASH_SuspendPolicy;
+
+/*!
+ * @brief A command queue in front of one device.
+ */
+typedef struct FLASH_Queue
+{
+	//! The device the commands are carried out on.
+	const FLASH_Device *device;
+	//! Pending commands in submission order.
+	FLASH_Command *commands[FLASH_QUEUE_DEPTH];
+	//! Number of pending commands.
+	uint32_t count;
+	//! Assembles merged programs and receives skipped read gaps.
+	uint8_t pageBuffer[FLASH_QUEUE_PAGE_BUFFER_SIZE];
+	//! When to suspend a background operation.
+	FLASH_SuspendPolicy policy;
+	//! Number of commands at the head of the queue being carried out in the
+	//! background. 0 if the device is idle.
+	uint32_t activeCount;
+	//! Next address of the active commands to be started.
+	uint32_t activeAddress;
+	//! End of the range of the active commands.
+	uint32_t activeEnd;
+	//! Times the page program or erase unit in progress has been suspended.
+	uint32_t activeSuspends;
+	//! USER_CONFIG_CycleCount() when it last started or resumed.
+	uint32_t activeRunStart;
+} FLASH_Queue;
+
+/*!
+ * @brief Prepares an empty queue in front of 'device', with the default
+ * suspend policy (any read, @ref FLASH_QUEUE_MAX_SUSPENDS, @ref FLASH_QUEUE_MIN_RUN_US).
+ *
+ * @param queue The queue.
+ * @param device The device, typically filled in by flashDeviceInit(). Must
+ * stay valid while the queue is used.
+ *
+ * @retval void
+ */
+void flashQueueInit(FLASH_Queue *queue, const FLASH_Device *device);
+
+/*!
+ * @brief Replaces the suspend policy of a queue.
+ *
+ * @param queue The queue.
+ * @param policy The new policy.
+ *
+ * @retval void
+ */
+void flashQueueSetSuspendPolicy(FLASH_Queue *queue, const FLASH_SuspendPolicy *policy);
+
+/*!
+ * @brief Prepares a command for flashQueueSubmit().
+ *
+ * @param command The command.
+ * @param type Read, program or erase.
+ * @param address Linear byte address of the first location.
+ * @param buffer Data to program, or where read data is stored. NULL for erases.
+ * @param numBytes Number of bytes to read, program or erase.
+ * @param callback Called when the command is done. May be NULL.
+ * @param userData Passed to the callback.
+ *
+ * @retval void
+ */
+void flashCommandInit(FLASH_Command *command,
+					  enum flashCommandType type,
+					  uint32_t address,
+					  uint8_t *buffer,
+					  uint32_t numBytes,
+					  FLASH_CommandCallback callback,
+					  void *userData);
+
+/*!
+ * @brief Adds a command to the end of the queue. Nothing is sent to the
+ * device until flashQueueStep() or flashQueueFlush() is called.
+ *
+ * @param queue The queue.
+ * @param command A command prepared with flashCommandInit().
+ *
+ * @retval 1 The command was queued.
+ * @retval 0 The queue is full; run it and submit again.
+ */
+uint8_t flashQueueSubmit(FLASH_Queue *queue, FLASH_Command *command);
+
+/*!
+ * @brief Carries out the next batch of commands: all reads that can be joined
+ * with the first read that is free to run, otherwise the erase or the run of
+ * sequential programs at the head of the queue. While a background operation
+ * is in progress, it either serves reads by suspending it, or starts its next
+ * page or erase unit once the device is ready, or returns at once.
+ *
+ * @param queue The queue.
+ *
+ * @retval uint32_t The number of commands still pending.
+ */
+uint32_t flashQueueStep(FLASH_Queue *queue);
+
+/*!
+ * @brief Calls flashQueueStep() until the queue is empty.
+ *
+ * @param queue The queue.
+ *
+ * @retval void
+ */
+void flashQueueFlush(FLASH_Queue *queue);
+
+/*!
+ * @brief Returns whether a command has been carried out.
+ *
+ * @param command The command.
+ *
+ * @retval 1 The command is done.
+ * @retval 0 The command is still pending.
+ */
+uint8_t flashCommandDone(const FLASH_Command *command);
+
+#endif /* FLASH_QUEUE_H_ */
@@ -0,0 +1,181 @@
+/*
+ * The Clear BSD License
+ * Copyright (c) 2018 Adesto Technologies Corporation, Inc
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted (subject to the limitations in the disclaimer below) provided
+ *  that the following conditions are met:
+ *
+ * o Redistributions of source code must retain the above copyright notice, this list
+ *   of conditions and the following disclaimer.
+ *
+ * o Redistributions in binary form must reproduce the above copyright notice, this
+ *   list of conditions and the following disclaimer in the documentation and/or
+ *   other materials provided with the distribution.
+ *
+ * o Neither the name of the copyright holder nor the names of its
+ *   contributors may be used to endorse or promote products derived from this
+ *   software without specific prior written permission.
+ *
+ * NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE GRANTED BY THIS LICENSE.
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*!
+ * @ingroup ADESTO_LAYER
+ */
+/**
+ * @file    flash_stripe.c
+ * @brief   Definition of the striped (RAID-0) virtual device.
+ */
+#include "flash_stripe.h"
+
+uint8_t flashStripeInit(FLASH_Stripe *stripe, const FLASH_Device *const *devices, uint8_t numDevices)
+{
+	uint8_t i;
+	if((numDevices == 0) || (numDevices > FLASH_STRIPE_MAX_DEVICES))
+	{
+		printf("Stripe of %u chips not supported.\n", numDevices);
+		return 0;
+	}
+	stripe->numDevices = numDevices;
+	stripe->capacity = devices[0]->capacity;
+	stripe->pageSize = devices[0]->pageSize;
+	stripe->eraseSize = devices[0]->eraseSize * numDevices;
+	for(i = 0; i < numDevices; i++)
+	{
+		if((devices[i]->pageSize != stripe->pageSize) ||
+		   (devices[i]->eraseSize != devices[0]->eraseSize) ||
+		   (devices[i]->eraseSize % devices[i]->pageSize))
+		{
+			printf("Stripe chip %u does not match chip 0.\n", i);
+			return 0;
+		}
+		stripe->devices[i] = devices[i];
+		stripe->busy[i] = 0;
+		// Every chip holds the same share; any excess on larger chips is unused.
+		if(devices[i]->capacity < stripe->capacity)
+		{
+			stripe->capacity = devices[i]->capacity;
+		}
+	}
+	stripe->capacity *= numDevices;
+	return 1;
+}
+
+// Maps a stripe address to a chip and an address on it.
+static uint8_t stripeLocate(const FLASH_Stripe *stripe, uint32_t address, uint32_t *chipAddress)
+{
+	uint32_t unit = address / stripe->pageSize;
+	*chipAddress = (unit / stripe->numDevices) * stripe->pageSize + (address % stripe->pageSize);
+	return (uint8_t) (unit % stripe->numDevices);
+}
+
+// Waits for a chip to finish the operation the stripe started on it. The
+// time already spent on other chips is deducted from the expected duration.
+static void stripeWaitChip(FLASH_Stripe *stripe, uint8_t chip)
+{
+	if(!stripe->busy[chip])
+	{
+		return;
+	}
+	flashDeviceWaitOnReadySince(stripe->devices[chip], stripe->busyStart[chip], stripe->busyUs[chip]);
+	stripe->busy[chip] = 0;
+}
+
+static void stripeMarkBusy(FLASH_Stripe *stripe, uint8_t chip, uint32_t expectedUs)
+{
+	stripe->busy[chip] = 1;
+	stripe->busyStart[chip] = USER_CONFIG_CycleCount64();
+	stripe->busyUs[chip] = expectedUs;
+}
+
+void flashStripeRead(FLASH_Stripe *stripe, uint32_t address, uint8_t *rxBuffer, uint32_t rxNumBytes)
+{
+	while(rxNumBytes > 0)
+	{
+		uint32_t chipAddress;
+		uint8_t chip = stripeLocate(stripe, address, &chipAddress);
+		uint32_t chunk = stripe->pageSize - (address % stripe->pageSize);
+		if(chunk > rxNumBytes)
+			chunk = rxNumBytes;
+		stripeWaitChip(stripe, chip);
+		flashDeviceRead(stripe->devices[chip], chipAddress, rxBuffer, chunk);
+		address += chunk;
+		rxBuffer += chunk;
+		rxNumBytes -= chunk;
+	}
+}
+
+void flashStripeProgram(FLASH_Stripe *stripe, uint32_t address, uint8_t *txBuffer, uint32_t txNumBytes)
+{
+	while(txNumBytes > 0)
+	{
+		uint32_t chipAddress;
+		uint8_t chip = stripeLocate(stripe, address, &chipAddress);
+		const FLASH_Device *device = stripe->devices[chip];
+		uint32_t chunk = stripe->pageSize - (address % stripe->pageSize);
+		if(chunk > txNumBytes)
+			chunk = txNumBytes;
+		stripeWaitChip(stripe, chip);
+		if(device->programPageStart != NULL)
+		{
+			flashDeviceProgramPageStart(device, chipAddress, txBuffer, chunk);
+			stripeMarkBusy(stripe, chip, device->part->program.typicalUs);
+		}
+		else
+		{
+			flashDeviceProgram(device, chipAddress, txBuffer, chunk);
+		}
+		address += chunk;
+		txBuffer += chunk;
+		txNumBytes -= chunk;
+	}
+	flashStripeWaitOnReady(stripe);
+}
+
+void flashStripeErase(FLASH_Stripe *stripe, uint32_t address, uint32_t numBytes)
+{
+	uint32_t start = address - (address % stripe->eraseSize);
+	uint32_t end = address + numBytes;
+	uint8_t chip;
+	for(address = start; address < end; address += stripe->eraseSize)
+	{
+		// The stripe erase unit is the same erase unit on every chip.
+		uint32_t chipAddress = (address / stripe->eraseSize) * stripe->devices[0]->eraseSize;
+		for(chip = 0; chip < stripe->numDevices; chip++)
+		{
+			const FLASH_Device *device = stripe->devices[chip];
+			stripeWaitChip(stripe, chip);
+			if(device->eraseStart != NULL)
+			{
+				flashDeviceEraseStart(device, chipAddress);
+				stripeMarkBusy(stripe, chip, flashPartSmallestErase(device->part)->time.typicalUs);
+			}
+			else
+			{
+				flashDeviceErase(device, chipAddress);
+			}
+		}
+	}
+	flashStripeWaitOnReady(stripe);
+}
+
+void flashStripeWaitOnReady(FLASH_Stripe *stripe)
+{
+	uint8_t chip;
+	for(chip = 0; chip < stripe->numDevices; chip++)
+	{
+		stripeWaitChip(stripe, chip);
+	}
+}
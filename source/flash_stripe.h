@@ -0,0 +1,152 @@
+/*
+ * The Clear BSD License
+ * Copyright (c) 2018 Adesto Technologies Corporation, Inc
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted (subject to the limitations in the disclaimer below) provided
+ *  that the following conditions are met:
+ *
+ * o Redistributions of source code must retain the above copyright notice, this list
+ *   of conditions and the following disclaimer.
+ *
+ * o Redistributions in binary form must reproduce the above copyright notice, this
+ *   list of conditions and the following disclaimer in the documentation and/or
+ *   other materials provided with the distribution.
+ *
+ * o Neither the name of the copyright holder nor the names of its
+ *   contributors may be used to endorse or promote products derived from this
+ *   software without specific prior written permission.
+ *
+ * NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE GRANTED BY THIS LICENSE.
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*!
+ * @ingroup ADESTO_LAYER
+ */
+/**
+ * @file    flash_stripe.h
+ * @brief   Declarations of the striped (RAID-0) virtual device.
+ *
+ * A FLASH_Stripe joins several chips of the same part into one linear array.
+ * Consecutive program pages go to consecutive chips, so a long program
+ * starts a page on one chip (xxxProgramPageStart()) and moves on to send the
+ * next page to the next chip while the first is busy for tPP; a chip is only
+ * waited for (xxxWaitOnReadyFor()) when its turn comes round again. With
+ * enough chips the page transfers hide the program time and sequential
+ * writes run close to the bus bandwidth. Erases are started on all chips
+ * together in the same way.
+ *
+ * Each chip is a FLASH_Device opened with flashDeviceOpen() on its own
+ * context (see flash_context.h), reached through its own chip select or bus.
+ * Stripe addresses map to chip addresses as follows, with n chips and page
+ * size P:
+ *
+ *   chip         = (address / P) % n
+ *   chip address = (address / (P * n)) * P + address % P
+ *
+ * so the stripe erase unit is n chip erase units at the same chip address.
+ */
+#ifndef FLASH_STRIPE_H_
+#define FLASH_STRIPE_H_
+
+#include "flash_device.h"
+
+//! Largest number of chips in a stripe.
+#ifndef FLASH_STRIPE_MAX_DEVICES
+#define FLASH_STRIPE_MAX_DEVICES 4U
+#endif
+
+/*!
+ * @brief A striped virtual device.
+ */
+typedef struct
+{
+	//! The chips, in stripe order.
+	const FLASH_Device *devices[FLASH_STRIPE_MAX_DEVICES];
+	//! Number of chips.
+	uint8_t numDevices;
+	//! Array size in bytes, the sum of the chips.
+	uint32_t capacity;
+	//! Stripe unit, the program page size of the chips.
+	uint32_t pageSize;
+	//! Erase unit in bytes, one erase unit on every chip.
+	uint32_t eraseSize;
+	//! 1 while a chip runs a program or erase started by the stripe.
+	uint8_t busy[FLASH_STRIPE_MAX_DEVICES];
+	//! USER_CONFIG_CycleCount64() when the operation on the chip started.
+	uint64_t busyStart[FLASH_STRIPE_MAX_DEVICES];
+	//! Typical duration of that operation in microseconds.
+	uint32_t busyUs[FLASH_STRIPE_MAX_DEVICES];
+} FLASH_Stripe;
+
+/*!
+ * @brief Builds a stripe from chips of the same geometry.
+ *
+ * @param stripe The stripe to fill in.
+ * @param devices The chips, each opened with flashDeviceOpen().
+ * @param numDevices Number of chips, 1 to @ref FLASH_STRIPE_MAX_DEVICES.
+ *
+ * @retval 1 The stripe is ready.
+ * @retval 0 Too many or too few chips, or their page or erase sizes differ.
+ */
+uint8_t flashStripeInit(FLASH_Stripe *stripe, const FLASH_Device *const *devices, uint8_t numDevices);
+
+/*!
+ * @brief Reads from the stripe, one read command per page.
+ *
+ * @param stripe The stripe.
+ * @param address Stripe address of the first byte.
+ * @param rxBuffer Receives the data.
+ * @param rxNumBytes Number of bytes to read.
+ *
+ * @retval void
+ */
+void flashStripeRead(FLASH_Stripe *stripe, uint32_t address, uint8_t *rxBuffer, uint32_t rxNumBytes);
+
+/*!
+ * @brief Programs erased locations of the stripe. Pages are started on the
+ * chips in turn without waiting, and the function returns once all of them
+ * have completed.
+ *
+ * @param stripe The stripe.
+ * @param address Stripe address of the first byte.
+ * @param txBuffer The data.
+ * @param txNumBytes Number of bytes to program.
+ *
+ * @retval void
+ */
+void flashStripeProgram(FLASH_Stripe *stripe, uint32_t address, uint8_t *txBuffer, uint32_t txNumBytes);
+
+/*!
+ * @brief Erases the stripe erase units covering a range. The erases of all
+ * chips run at the same time.
+ *
+ * @param stripe The stripe.
+ * @param address Stripe address of the first byte.
+ * @param numBytes Number of bytes; rounded out to whole stripe erase units.
+ *
+ * @retval void
+ */
+void flashStripeErase(FLASH_Stripe *stripe, uint32_t address, uint32_t numBytes);
+
+/*!
+ * @brief Waits for every chip to finish the operations started by the stripe.
+ *
+ * @param stripe The stripe.
+ *
+ * @retval void
+ */
+void flashStripeWaitOnReady(FLASH_Stripe *stripe);
+
+#endif /* FLASH_STRIPE_H_ */
@@ -40,6 +40,7 @@
  */
 
 #include "fusion.h"
+#include "flash_context.h"
 
 #if	(PARTNO == AT25XE512C)	|| \
 	(PARTNO == AT25XE011)	|| \
@@ -57,22 +58,33 @@
 	(PARTNO == AT25XV041B)	|| \
 	(ALL == 1)
 
-static bool DISPLAY_OUTPUT = 0;
-
-static void debugOn() {DISPLAY_OUTPUT = 1;};
-static void debugOff() {DISPLAY_OUTPUT = 0;};
-
-uint8_t txFusionInternalBuffer[MAXIMUM_TX_BYTES];
+static void debugOn() {flashContext->displayOutput = 1;};
+static void debugOff() {flashContext->displayOutput = 0;};
 
 void fusionWaitOnReady()
 {
-	uint8_t SR[2];
-	do
+	fusionWaitOnReadyFor(0);
+}
+
+void fusionWaitOnReadyFor(uint32_t expectedUs)
+{
+	uint8_t SR[SPI_READY_MAX_STATUS_BYTES];
+	// Parts with the Active Status Interrupt command poll with it (see flash_parts.c).
+	const SPI_ReadyPoll *poll = &flashContextPart()->ready;
+	SPI_WaitReady(poll, expectedUs, SR);
+	if(flashContext->displayOutput)
 	{
-		fusionReadSR(SR);
-		SPI_Delay(10);
+		flashContext->txBuffer[0] = poll->header[0];
+		flashContext->txBuffer[1] = poll->header[1];
+		printSPIExchange(flashContext->txBuffer, poll->headerNumBytes, SR, poll->numBytes);
 	}
-	while(SR[0] & 1);
+}
+
+uint8_t fusionIsBusy()
+{
+	uint8_t SR[2];
+	fusionReadSR(SR);
+	return SR[0] & 1;
 }
 
 void fusionGlobalProtect()
@@ -89,181 +101,223 @@ void fusionGlobalUnprotect()
 
 void fusionReadArray(uint32_t address, uint8_t *rxBuffer, uint32_t rxNumBytes)
 {
-	load4BytesToTxBuffer(txFusionInternalBuffer, CMD_FUSION_READ_ARRAY, address);
-	SPI_Exchange(txFusionInternalBuffer, 4, rxBuffer, rxNumBytes, 1);
-	if(DISPLAY_OUTPUT)
+	load4BytesToTxBuffer(flashContext->txBuffer, CMD_FUSION_READ_ARRAY, address);
+	SPI_Exchange(flashContext->txBuffer, 4, rxBuffer, rxNumBytes, 1);
+	if(flashContext->displayOutput)
 	{
-		printSPIExchange(txFusionInternalBuffer, 4, rxBuffer, rxNumBytes);
+		printSPIExchange(flashContext->txBuffer, 4, rxBuffer, rxNumBytes);
 	}
 }
 
 void fusionReadArrayLF(uint32_t address, uint8_t *rxBuffer, uint32_t rxNumBytes)
 {
-	load4BytesToTxBuffer(txFusionInternalBuffer, CMD_FUSION_READ_ARRAY_LF, address);
-	SPI_Exchange(txFusionInternalBuffer, 4, rxBuffer, rxNumBytes, 0);
-	if(DISPLAY_OUTPUT)
+	load4BytesToTxBuffer(flashContext->txBuffer, CMD_FUSION_READ_ARRAY_LF, address);
+	SPI_Exchange(flashContext->txBuffer, 4, rxBuffer, rxNumBytes, 0);
+	if(flashContext->displayOutput)
 	{
-		printSPIExchange(txFusionInternalBuffer, 4, rxBuffer, rxNumBytes);
+		printSPIExchange(flashContext->txBuffer, 4, rxBuffer, rxNumBytes);
 	}
 }
 
 void fusionDualOutputRead(uint32_t address, uint8_t *rxBuffer, uint32_t rxNumBytes)
 {
-	load4BytesToTxBuffer(txFusionInternalBuffer, CMD_FUSION_DUAL_OUTPUT_READ, address);
-	SPI_DualExchange(4, txFusionInternalBuffer, 4, rxBuffer, rxNumBytes, 1);
-	if(DISPLAY_OUTPUT)
+	load4BytesToTxBuffer(flashContext->txBuffer, CMD_FUSION_DUAL_OUTPUT_READ, address);
+	SPI_DualExchange(4, flashContext->txBuffer, 4, rxBuffer, rxNumBytes, 1);
+	if(flashContext->displayOutput)
 	{
-		printSPIExchange(txFusionInternalBuffer, 4, rxBuffer, rxNumBytes);
+		printSPIExchange(flashContext->txBuffer, 4, rxBuffer, rxNumBytes);
 	}
 }
 
 void fusionPageErase(uint32_t address)
 {
-	load4BytesToTxBuffer(txFusionInternalBuffer, CMD_FUSION_PAGE_ERASE, address);
-	SPI_Exchange(txFusionInternalBuffer, 4, NULL, 0, 0);
-	if(DISPLAY_OUTPUT)
+	load4BytesToTxBuffer(flashContext->txBuffer, CMD_FUSION_PAGE_ERASE, address);
+	SPI_Exchange(flashContext->txBuffer, 4, NULL, 0, 0);
+	if(flashContext->displayOutput)
 	{
-		printSPIExchange(txFusionInternalBuffer, 4, NULL, 0);
+		printSPIExchange(flashContext->txBuffer, 4, NULL, 0);
 	}
 }
 
 void fusionBlockErase4K(uint32_t address)
 {
-	load4BytesToTxBuffer(txFusionInternalBuffer, CMD_FUSION_BLOCK_ERASE_4K, address);
-	SPI_Exchange(txFusionInternalBuffer, 4, NULL, 0, 0);
-	if(DISPLAY_OUTPUT)
+	load4BytesToTxBuffer(flashContext->txBuffer, CMD_FUSION_BLOCK_ERASE_4K, address);
+	SPI_Exchange(flashContext->txBuffer, 4, NULL, 0, 0);
+	if(flashContext->displayOutput)
 	{
-		printSPIExchange(txFusionInternalBuffer, 4, NULL, 0);
+		printSPIExchange(flashContext->txBuffer, 4, NULL, 0);
 	}
 }
 
 void fusionChipErase()
 {
-	txFusionInternalBuffer[0] = CMD_FUSION_CHIP_ERASE;
-	SPI_Exchange(txFusionInternalBuffer, 1, NULL, 0, 0);
-	if(DISPLAY_OUTPUT)
+	flashContext->txBuffer[0] = CMD_FUSION_CHIP_ERASE;
+	SPI_Exchange(flashContext->txBuffer, 1, NULL, 0, 0);
+	if(flashContext->displayOutput)
 	{
-		printSPIExchange(txFusionInternalBuffer, 4, NULL, 0);
+		printSPIExchange(flashContext->txBuffer, 4, NULL, 0);
 	}
 }
 
 void fusionProgramArray(uint32_t address, uint8_t *txBuffer, uint32_t txNumBytes)
 {
-	load4BytesToTxBuffer(txFusionInternalBuffer, CMD_FUSION_PROGRAM_ARRAY, address);
-	// Offset the data bytes by 4; opcode+address takes up the first 4 bytes of a transmission.
-	uint32_t totalBytes = txNumBytes + 4;
-
-	for(uint32_t j = 0; j < txNumBytes; j++)
-	{
-		txFusionInternalBuffer[j+4] = txBuffer[j];
-	}
-	SPI_Exchange(txFusionInternalBuffer, totalBytes, NULL, 0, 0);
-	if(DISPLAY_OUTPUT)
+	load4BytesToTxBuffer(flashContext->txBuffer, CMD_FUSION_PROGRAM_ARRAY, address);
+	SPI_GatherExchange(1, 4, flashContext->txBuffer, 4, txBuffer, txNumBytes);
+	if(flashContext->displayOutput)
 	{
-		printSPIExchange(txFusionInternalBuffer, totalBytes, NULL, 0);
+		printSPIWrite(flashContext->txBuffer, 4, txBuffer, txNumBytes);
 	}
 }
 
 void fusionWriteEnable()
 {
-	txFusionInternalBuffer[0] = CMD_FUSION_WRITE_ENABLE;
-	SPI_Exchange(txFusionInternalBuffer, 1, NULL, 0, 0);
-	if(DISPLAY_OUTPUT)
+	flashContext->txBuffer[0] = CMD_FUSION_WRITE_ENABLE;
+	SPI_Exchange(flashContext->txBuffer, 1, NULL, 0, 0);
+	if(flashContext->displayOutput)
 	{
-		printSPIExchange(txFusionInternalBuffer, 1, NULL, 0);
+		printSPIExchange(flashContext->txBuffer, 1, NULL, 0);
 	}
 }
 
 void fusionWriteDisable()
 {
-	txFusionInternalBuffer[0] = CMD_FUSION_WRITE_DISABLE;
-	SPI_Exchange(txFusionInternalBuffer, 1, NULL, 0, 0);
-	if(DISPLAY_OUTPUT)
+	flashContext->txBuffer[0] = CMD_FUSION_WRITE_DISABLE;
+	SPI_Exchange(flashContext->txBuffer, 1, NULL, 0, 0);
+	if(flashContext->displayOutput)
 	{
-		printSPIExchange(txFusionInternalBuffer, 1, NULL,  0);
+		printSPIExchange(flashContext->txBuffer, 1, NULL,  0);
 	}
 }
 
 void fusionReadSR(uint8_t *rxBuffer)
 {
-	txFusionInternalBuffer[0] = CMD_FUSION_READ_SR;
-	SPI_Exchange(txFusionInternalBuffer, 1, rxBuffer, 2, 0);
-	if(DISPLAY_OUTPUT)
+	flashContext->txBuffer[0] = CMD_FUSION_READ_SR;
+	SPI_Exchange(flashContext->txBuffer, 1, rxBuffer, 2, 0);
+	if(flashContext->displayOutput)
 	{
-		printSPIExchange(txFusionInternalBuffer, 1, rxBuffer, 2);
+		printSPIExchange(flashContext->txBuffer, 1, rxBuffer, 2);
 	}
 }
 
 void fusionWriteSRB1(uint8_t data)
 {
-	txFusionInternalBuffer[0] = CMD_FUSION_WRITE_SRB1;
-	txFusionInternalBuffer[1] = data;
-	SPI_Exchange(txFusionInternalBuffer, 2, NULL, 0, 0);
-	if(DISPLAY_OUTPUT)
+	flashContext->txBuffer[0] = CMD_FUSION_WRITE_SRB1;
+	flashContext->txBuffer[1] = data;
+	SPI_Exchange(flashContext->txBuffer, 2, NULL, 0, 0);
+	if(flashContext->displayOutput)
 	{
-		printSPIExchange(txFusionInternalBuffer, 2, NULL, 0);
+		printSPIExchange(flashContext->txBuffer, 2, NULL, 0);
 	}
 }
 
 void fusionWriteSRB2(uint8_t data)
 {
-	txFusionInternalBuffer[0] = CMD_FUSION_WRITE_SRB2;
-	txFusionInternalBuffer[1] = data;
-	SPI_Exchange(txFusionInternalBuffer, 2, NULL, 0, 0);
-	if(DISPLAY_OUTPUT)
+	flashContext->txBuffer[0] = CMD_FUSION_WRITE_SRB2;
+	flashContext->txBuffer[1] = data;
+	SPI_Exchange(flashContext->txBuffer, 2, NULL, 0, 0);
+	if(flashContext->displayOutput)
 	{
-		printSPIExchange(txFusionInternalBuffer, 2, NULL, 0);
+		printSPIExchange(flashContext->txBuffer, 2, NULL, 0);
 	}
 }
 
 void fusionReset()
 {
-	txFusionInternalBuffer[0] = CMD_FUSION_RESET;
-	txFusionInternalBuffer[1] = CMD_FUSION_RESET_CONFIRMATION;
-	SPI_Exchange(txFusionInternalBuffer, 2, NULL, 0, 0);
-	if(DISPLAY_OUTPUT)
+	flashContext->txBuffer[0] = CMD_FUSION_RESET;
+	flashContext->txBuffer[1] = CMD_FUSION_RESET_CONFIRMATION;
+	SPI_Exchange(flashContext->txBuffer, 2, NULL, 0, 0);
+	if(flashContext->displayOutput)
 	{
-		printSPIExchange(txFusionInternalBuffer, 2, NULL, 0);
+		printSPIExchange(flashContext->txBuffer, 2, NULL, 0);
 	}
 }
 
 void fusionReadMID(uint8_t *rxBuffer)
 {
-	txFusionInternalBuffer[0] = CMD_FUSION_READ_MID;
-	SPI_Exchange(txFusionInternalBuffer, 1, rxBuffer, 4, 0);
-	if(DISPLAY_OUTPUT)
+	flashContext->txBuffer[0] = CMD_FUSION_READ_MID;
+	SPI_Exchange(flashContext->txBuffer, 1, rxBuffer, 4, 0);
+	if(flashContext->displayOutput)
 	{
-		printSPIExchange(txFusionInternalBuffer, 1, rxBuffer, 4);
+		printSPIExchange(flashContext->txBuffer, 1, rxBuffer, 4);
 	}
 }
 
 void fusionDeepPowerDown()
 {
-	txFusionInternalBuffer[0] = CMD_FUSION_DEEP_POWER_DOWN;
-	SPI_Exchange(txFusionInternalBuffer, 1, NULL, 0, 0);
-	if(DISPLAY_OUTPUT)
+	flashContext->txBuffer[0] = CMD_FUSION_DEEP_POWER_DOWN;
+	SPI_Exchange(flashContext->txBuffer, 1, NULL, 0, 0);
+	if(flashContext->displayOutput)
 	{
-		printSPIExchange(txFusionInternalBuffer, 1, NULL, 0);
+		printSPIExchange(flashContext->txBuffer, 1, NULL, 0);
 	}
 }
 
 void fusionResumeFromDeepPowerDown()
 {
-	txFusionInternalBuffer[0] = CMD_FUSION_RESUME_FROM_DPD;
-	SPI_Exchange(txFusionInternalBuffer, 1, NULL, 0, 0);
-	if(DISPLAY_OUTPUT)
+	flashContext->txBuffer[0] = CMD_FUSION_RESUME_FROM_DPD;
+	SPI_Exchange(flashContext->txBuffer, 1, NULL, 0, 0);
+	if(flashContext->displayOutput)
 	{
-		printSPIExchange(txFusionInternalBuffer, 1, NULL, 0);
+		printSPIExchange(flashContext->txBuffer, 1, NULL, 0);
 	}
 }
 
 void fusionUDPDMode()
 {
-	txFusionInternalBuffer[0] = CMD_FUSION_UDPD_MODE;
-	SPI_Exchange(txFusionInternalBuffer, 1, NULL, 0, 0);
-	if(DISPLAY_OUTPUT)
+	flashContext->txBuffer[0] = CMD_FUSION_UDPD_MODE;
+	SPI_Exchange(flashContext->txBuffer, 1, NULL, 0, 0);
+	if(flashContext->displayOutput)
+	{
+		printSPIExchange(flashContext->txBuffer, 1, NULL, 0);
+	}
+}
+
+void fusionProgram(uint32_t address, uint8_t *txBuffer, uint32_t txNumBytes)
+{
+	while(txNumBytes > 0)
+	{
+		// Never cross a page boundary; the address would wrap within the page.
+		uint32_t chunk = FUSION_PAGE_SIZE - (address % FUSION_PAGE_SIZE);
+		if(chunk > txNumBytes)
+			chunk = txNumBytes;
+		fusionProgramPageStart(address, txBuffer, chunk);
+		fusionWaitOnReadyFor(FUSION_TPP_US);
+		address += chunk;
+		txBuffer += chunk;
+		txNumBytes -= chunk;
+	}
+}
+
+void fusionRead(uint32_t address, uint8_t *rxBuffer, uint32_t rxNumBytes)
+{
+	fusionReadArray(address, rxBuffer, rxNumBytes);
+}
+
+void fusionProgramPageStart(uint32_t address, uint8_t *txBuffer, uint32_t txNumBytes)
+{
+	fusionWriteEnable();
+	fusionProgramArray(address, txBuffer, txNumBytes);
+}
+
+void fusionEraseStart(uint32_t address)
+{
+	fusionWriteEnable();
+	fusionPageErase(address - (address % FUSION_ERASE_SIZE));
+}
+
+void fusionErase(uint32_t address)
+{
+	fusionEraseStart(address);
+	fusionWaitOnReadyFor(FUSION_TPE_US);
+}
+
+void fusionOpenReadStream(SPI_Stream *stream, uint32_t address)
+{
+	load4BytesToTxBuffer(flashContext->txBuffer, CMD_FUSION_READ_ARRAY, address);
+	SPI_StreamOpen(stream, 1, 4, flashContext->txBuffer, 4, 1);
+	if(flashContext->displayOutput)
 	{
-		printSPIExchange(txFusionInternalBuffer, 1, NULL, 0);
+		printSPIExchange(flashContext->txBuffer, 4, NULL, 0);
 	}
 }
 
@@ -277,70 +331,63 @@ void fusionUDPDMode()
 	(ALL == 1)
 void fusionSequentialProgramMode(uint8_t txBuffer)
 {
-	txFusionInternalBuffer[0] = CMD_FUSION_SQNTL_PROGRAM_MODE;
-	txFusionInternalBuffer[1] = txBuffer;
-	SPI_Exchange(txFusionInternalBuffer, 2, NULL, 0, 0);
-	if(DISPLAY_OUTPUT)
+	flashContext->txBuffer[0] = CMD_FUSION_SQNTL_PROGRAM_MODE;
+	flashContext->txBuffer[1] = txBuffer;
+	SPI_Exchange(flashContext->txBuffer, 2, NULL, 0, 0);
+	if(flashContext->displayOutput)
 	{
-		printSPIExchange(txFusionInternalBuffer, 2, NULL, 0);
+		printSPIExchange(flashContext->txBuffer, 2, NULL, 0);
 	}
 }
 
 void fusionDualInputProgram(uint32_t address, uint8_t *txBuffer, uint32_t txNumBytes)
 {
-	load4BytesToTxBuffer(txFusionInternalBuffer, CMD_FUSION_DUAL_INPUT_PROGRAM, address);
-	// Offset the data bytes by 4; opcode takes up the first 4 bytes of a transmission.
-	uint32_t totalBytes = txNumBytes + 4;
-
-	for(uint32_t j = 0; j < txNumBytes; j++)
-	{
-		txFusionInternalBuffer[j+4] = txBuffer[j];
-	}
-	SPI_DualExchange(4, txFusionInternalBuffer, totalBytes, NULL, 0, 0);
-	if(DISPLAY_OUTPUT)
+	load4BytesToTxBuffer(flashContext->txBuffer, CMD_FUSION_DUAL_INPUT_PROGRAM, address);
+	SPI_GatherExchange(2, 4, flashContext->txBuffer, 4, txBuffer, txNumBytes);
+	if(flashContext->displayOutput)
 	{
-		printSPIExchange(txFusionInternalBuffer, totalBytes, NULL, 0);
+		printSPIWrite(flashContext->txBuffer, 4, txBuffer, txNumBytes);
 	}
 }
 
 void fusionProtectSector(uint32_t address)
 {
-	load4BytesToTxBuffer(txFusionInternalBuffer, CMD_FUSION_PROTECT_SECTOR, address);
-	SPI_Exchange(txFusionInternalBuffer, 4, NULL, 0, 0);
-	if(DISPLAY_OUTPUT)
+	load4BytesToTxBuffer(flashContext->txBuffer, CMD_FUSION_PROTECT_SECTOR, address);
+	SPI_Exchange(flashContext->txBuffer, 4, NULL, 0, 0);
+	if(flashContext->displayOutput)
 	{
-		printSPIExchange(txFusionInternalBuffer, 4, NULL, 0);
+		printSPIExchange(flashContext->txBuffer, 4, NULL, 0);
 	}
 }
 
 void fusionUnprotectSector(uint32_t address)
 {
-	load4BytesToTxBuffer(txFusionInternalBuffer, CMD_FUSION_UNPROTECT_SECTOR, address);
-	SPI_Exchange(txFusionInternalBuffer, 4, NULL, 0, 0);
-	if(DISPLAY_OUTPUT)
+	load4BytesToTxBuffer(flashContext->txBuffer, CMD_FUSION_UNPROTECT_SECTOR, address);
+	SPI_Exchange(flashContext->txBuffer, 4, NULL, 0, 0);
+	if(flashContext->displayOutput)
 	{
-		printSPIExchange(txFusionInternalBuffer, 4, NULL, 0);
+		printSPIExchange(flashContext->txBuffer, 4, NULL, 0);
 	}
 }
 
 void fusionReadSectorProtectionRegisters(uint32_t address, uint8_t *rxBuffer)
 {
-	load4BytesToTxBuffer(txFusionInternalBuffer, CMD_FUSION_PROTECTION_REGISTER, address);
-	SPI_Exchange(txFusionInternalBuffer, 4, rxBuffer, 1, 0);
-	if(DISPLAY_OUTPUT)
+	load4BytesToTxBuffer(flashContext->txBuffer, CMD_FUSION_PROTECTION_REGISTER, address);
+	SPI_Exchange(flashContext->txBuffer, 4, rxBuffer, 1, 0);
+	if(flashContext->displayOutput)
 	{
-		printSPIExchange(txFusionInternalBuffer, 4, rxBuffer, 1);
+		printSPIExchange(flashContext->txBuffer, 4, rxBuffer, 1);
 	}
 }
 
 void fusionSequentialProgramModeEnable(uint32_t address, uint8_t txBuffer)
 {
-	load4BytesToTxBuffer(txFusionInternalBuffer, CMD_FUSION_SQNTL_PROGRAM_MODE, address);
-	txFusionInternalBuffer[4] = txBuffer;
-	SPI_Exchange(txFusionInternalBuffer, 5, NULL, 0, 0);
-	if(DISPLAY_OUTPUT)
+	load4BytesToTxBuffer(flashContext->txBuffer, CMD_FUSION_SQNTL_PROGRAM_MODE, address);
+	flashContext->txBuffer[4] = txBuffer;
+	SPI_Exchange(flashContext->txBuffer, 5, NULL, 0, 0);
+	if(flashContext->displayOutput)
 	{
-		printSPIExchange(txFusionInternalBuffer, 5, NULL, 0);
+		printSPIExchange(flashContext->txBuffer, 5, NULL, 0);
 	}
 }
 #endif
@@ -64,8 +64,6 @@
 	(PARTNO == AT25XV041B)	|| \
 	(ALL == 1)
 
-extern uint8_t txFusionInternalBuffer[MAXIMUM_TX_BYTES];
-
 /******************************************
  *
  *
@@ -76,11 +74,35 @@ extern uint8_t txFusionInternalBuffer[MAXIMUM_TX_BYTES];
 
 /*!
  * @brief: Wait while Read/Busy Status bit in SRB is 1 (device is busy).
+ * Same as fusionWaitOnReadyFor(0): the first sample is taken right away, for
+ * use when the duration of the last command is not known.
  *
  * @retval void
  */
 void fusionWaitOnReady();
 
+/*!
+ * @brief: Wait while Read/Busy Status bit in SRB is 1 (device is busy), with
+ * CSb held low for the whole wait (SPI_WaitReady()). Parts with the Active
+ * Status Interrupt (OPCODE: 0x25) report the end of the operation on SO, which
+ * the bit-bang transport samples without clocking; the others output the
+ * status register continuously.
+ *
+ * @param expectedUs Typical duration of the operation being waited on, for
+ * example @ref FUSION_TPE_US after a page erase.
+ *
+ * @retval void
+ */
+void fusionWaitOnReadyFor(uint32_t expectedUs);
+
+/*!
+ * @brief Returns the RDY/BSY bit of the status register without waiting.
+ *
+ * @retval 1 The device is busy with a program or erase.
+ * @retval 0 The device is ready.
+ */
+uint8_t fusionIsBusy();
+
 /*!
  * @brief Protects all sectors by issuing a WE, then write of 0x7F to status register
  * byte 1. These 2 write are accomplished with fusionWriteEnable() and fusionWriteSRB1().
@@ -280,6 +302,88 @@ void fusionResumeFromDeepPowerDown();
  * @retval void
  */
 void fusionUDPDMode();
+
+/*!
+ * @brief Programs 'txNumBytes' bytes of any length starting at 'address'. The
+ * data is split on @ref FUSION_PAGE_SIZE boundaries; each part is sent with
+ * fusionWriteEnable() and fusionProgramArray(), then fusionWaitOnReady() is
+ * called. The memory must have been erased and unprotected beforehand.
+ *
+ * @param address The 3 bytes address indicating the first location to be written to.
+ * @param txBuffer Pointer to the tx bytes that will be stored in memory. Must
+ * have a minimum of txNumBytes elements.
+ * @param txNumBytes Number of bytes to be written to the device.
+ *
+ * @retval void
+ */
+void fusionProgram(uint32_t address, uint8_t *txBuffer, uint32_t txNumBytes);
+
+/*!
+ * @brief Reads 'rxNumBytes' bytes of any length starting at 'address' in a
+ * single continuous read (fusionReadArray()).
+ *
+ * @param address 3 byte address starting from which the data in memory will be read.
+ * @param rxBuffer Pointer to the byte array in which the read data will be stored.
+ * Must have at least rxNumBytes elements.
+ * @param rxNumBytes Number of bytes to be read from the memory.
+ *
+ * @retval void
+ */
+void fusionRead(uint32_t address, uint8_t *rxBuffer, uint32_t rxNumBytes);
+
+/*!
+ * @brief OPCODE: 0x0B <br>
+ * Opens a read stream starting at 'address'. The data is then read in any
+ * number of pieces with SPI_StreamRead() while CSb stays low, and the read
+ * ends with SPI_StreamClose().
+ *
+ * @param stream The stream to open.
+ * @param address 3 byte address starting from which the data in memory will be read.
+ *
+ * @retval void
+ */
+void fusionOpenReadStream(SPI_Stream *stream, uint32_t address);
+
+/*!
+ * @brief Erases the @ref FUSION_ERASE_SIZE page containing 'address' with
+ * fusionWriteEnable() and fusionPageErase(), then calls fusionWaitOnReady().
+ * The sector must have been unprotected beforehand.
+ *
+ * @param address Any 3 byte address inside the page to be erased.
+ *
+ * @retval void
+ */
+void fusionErase(uint32_t address);
+
+/*!
+ * @brief Starts programming 'txNumBytes' bytes within one page with
+ * fusionWriteEnable() and fusionProgramArray(), without waiting for the
+ * program to complete (see fusionIsBusy()).
+ *
+ * @param address The 3 bytes address indicating the first location to be written to.
+ * @param txBuffer Pointer to the tx bytes that will be stored in memory.
+ * @param txNumBytes Number of bytes to be written. Must not cross a page boundary.
+ *
+ * @retval void
+ */
+void fusionProgramPageStart(uint32_t address, uint8_t *txBuffer, uint32_t txNumBytes);
+
+/*!
+ * @brief Starts erasing the @ref FUSION_ERASE_SIZE page containing 'address',
+ * without waiting for the erase to complete (see fusionIsBusy()).
+ *
+ * @param address Any 3 byte address inside the page to be erased.
+ *
+ * @retval void
+ */
+void fusionEraseStart(uint32_t address);
+
+/*!
+ * @brief Performs a hardware (JEDEC) reset on the device.
+ *
+ * @retval void
+ */
+void fusionHardwareReset();
 #endif
 
 #if	(PARTNO == AT25XE021A)	|| \
@@ -359,13 +463,6 @@ void fusionReadSectorProtectionRegisters(uint32_t address, uint8_t *rxBuffer);
  */
 void fusionSequentialProgramModeEnable(uint32_t address, uint8_t txBuffer);
 
-/*!
- * @brief Performs a hardware (JEDEC) reset on the device.
- *
- * @retval void
- */
-void fusionHardwareReset();
-
 #endif
 
 #endif /* DATAFLASH_H_ */
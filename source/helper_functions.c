@@ -40,40 +40,182 @@
  */
 
 #include "helper_functions.h"
+#include "user_config.h"
+#include <string.h>
+
+static void printHexLines(const char *title,
+						  const uint8_t *first,
+						  uint32_t firstNumBytes,
+						  const uint8_t *second,
+						  uint32_t secondNumBytes);
 
 void displayByteArray(uint8_t *byteArray, uint32_t numBytes)
 {
-	printSPIExchange(NULL, 0, byteArray, numBytes);
+	// Not subject to the sampling and rate limit of printSPIExchange().
+	printHexLines("\nReceived bytes (0x):", byteArray, numBytes, NULL, 0);
+	fputs("\n", stdout);
+}
+
+// Adds 'step' to every byte of a word, without carries between bytes. Each
+// byte of step must be below 0x80.
+static uint32_t addBytes(uint32_t word, uint32_t step)
+{
+	return ((word & 0x7F7F7F7FU) + step) ^ (word & 0x80808080U);
+}
+
+// Number of non zero bytes in a word.
+static uint32_t nonZeroBytes(uint32_t word)
+{
+	word |= word >> 4;
+	word |= word >> 2;
+	word |= word >> 1;
+	word &= 0x01010101U;
+	return (word * 0x01010101U) >> 24;
+}
+
+// Index of the first difference at or after 'start', numBytes if there is none.
+static uint32_t findMismatch(const uint8_t *arr1, const uint8_t *arr2, uint32_t start, uint32_t numBytes)
+{
+	uint32_t i = start;
+	uint32_t word1;
+	uint32_t word2;
+	for(; i + sizeof(uint32_t) <= numBytes; i += sizeof(uint32_t))
+	{
+		memcpy(&word1, &arr1[i], sizeof(uint32_t));
+		memcpy(&word2, &arr2[i], sizeof(uint32_t));
+		if(word1 != word2)
+			break;
+	}
+	for(; i < numBytes; i++)
+	{
+		if(arr1[i] != arr2[i])
+			break;
+	}
+	return i;
 }
 
 void fillArrayPattern(uint8_t * byteArray, uint32_t numBytes, int seedNumber)
 {
-	for(int i = 0; i < numBytes; i++)
+	uint8_t first[sizeof(uint32_t)];
+	uint32_t word;
+	uint32_t i;
+	for(i = 0; i < sizeof(uint32_t); i++)
 	{
-		byteArray[i] = (uint8_t)(seedNumber+i);
+		first[i] = (uint8_t)(seedNumber + i);
+	}
+	memcpy(&word, first, sizeof(uint32_t));
+	for(i = 0; i + sizeof(uint32_t) <= numBytes; i += sizeof(uint32_t))
+	{
+		memcpy(&byteArray[i], &word, sizeof(uint32_t));
+		word = addBytes(word, 0x04040404U);
+	}
+	for(; i < numBytes; i++)
+	{
+		byteArray[i] = (uint8_t)(seedNumber + i);
 	}
 }
 
 void fillArrayConst(uint8_t * byteArray, uint32_t numBytes, int constantNum)
 {
-	for(int i = 0; i < numBytes; i++)
+	memset(byteArray, (uint8_t) constantNum, numBytes);
+}
+
+uint32_t compareBytes(const uint8_t *arr1, const uint8_t *arr2, uint32_t numBytes, uint32_t *firstMismatch)
+{
+	uint32_t numErrors = 0;
+	uint32_t i = findMismatch(arr1, arr2, 0, numBytes);
+	uint32_t word1;
+	uint32_t word2;
+	if(firstMismatch != NULL)
 	{
-		byteArray[i] = (uint8_t)(constantNum);
+		*firstMismatch = i;
 	}
+	for(; i + sizeof(uint32_t) <= numBytes; i += sizeof(uint32_t))
+	{
+		memcpy(&word1, &arr1[i], sizeof(uint32_t));
+		memcpy(&word2, &arr2[i], sizeof(uint32_t));
+		numErrors += nonZeroBytes(word1 ^ word2);
+	}
+	for(; i < numBytes; i++)
+	{
+		numErrors += (arr1[i] != arr2[i]) ? 1 : 0;
+	}
+	return numErrors;
+}
+
+bool blankCheck(const uint8_t *byteArray, uint32_t numBytes, uint32_t *firstNotBlank)
+{
+	uint32_t i = 0;
+	uint32_t word;
+	for(; i + sizeof(uint32_t) <= numBytes; i += sizeof(uint32_t))
+	{
+		memcpy(&word, &byteArray[i], sizeof(uint32_t));
+		if(word != 0xFFFFFFFFU)
+			break;
+	}
+	for(; i < numBytes; i++)
+	{
+		if(byteArray[i] != 0xFF)
+			break;
+	}
+	if(firstNotBlank != NULL)
+	{
+		*firstNotBlank = i;
+	}
+	return (i == numBytes) ? 1 : 0;
+}
+
+uint32_t crc32(uint32_t crc, const uint8_t *byteArray, uint32_t numBytes)
+{
+	static const uint32_t table[16] =
+	{
+		0x00000000U, 0x1DB71064U, 0x3B6E20C8U, 0x26D930ACU,
+		0x76DC4190U, 0x6B6B51F4U, 0x4DB26158U, 0x5005713CU,
+		0xEDB88320U, 0xF00F9344U, 0xD6D6A3E8U, 0xCB61B38CU,
+		0x9B64C2B0U, 0x86D3D2D4U, 0xA00AE278U, 0xBDBDF21CU
+	};
+	uint32_t i;
+	crc = ~crc;
+	for(i = 0; i < numBytes; i++)
+	{
+		crc ^= byteArray[i];
+		crc = (crc >> 4) ^ table[crc & 0x0F];
+		crc = (crc >> 4) ^ table[crc & 0x0F];
+	}
+	return ~crc;
 }
 
 bool compareByteArrays(uint8_t *arr1, uint8_t *arr2, uint32_t arrLength)
 {
 	uint32_t numErrors = 0;
-	for(int i = 0; i < arrLength; i++)
+	uint32_t numRanges = 0;
+	uint32_t i = findMismatch(arr1, arr2, 0, arrLength);
+	uint32_t end;
+	while(i < arrLength)
 	{
-		if(arr1[i] != arr2[i])
+		end = i + 1;
+		while((end < arrLength) && (arr1[end] != arr2[end]))
+		{
+			end++;
+		}
+		if(numRanges < HELPER_MISMATCH_RANGES)
 		{
-			printf("Mismatch @ index: %d - Array 1: 0x%02X | Array 2: 0x%02X\n", i, arr1[i], arr2[i]);
-			numErrors++;
+			if(end - i == 1)
+				printf("Mismatch @ index: %lu - Array 1: 0x%02X | Array 2: 0x%02X\n",
+					   (unsigned long) i, arr1[i], arr2[i]);
+			else
+				printf("Mismatch @ index: %lu-%lu (%lu bytes) - Array 1: 0x%02X... | Array 2: 0x%02X...\n",
+					   (unsigned long) i, (unsigned long) (end - 1), (unsigned long) (end - i), arr1[i], arr2[i]);
 		}
+		numRanges++;
+		numErrors += end - i;
+		i = findMismatch(arr1, arr2, end, arrLength);
 	}
-	printf("Byte comparison total mismatches: %d\n", numErrors);
+	if(numRanges > HELPER_MISMATCH_RANGES)
+	{
+		printf("... %lu more mismatch ranges\n", (unsigned long) (numRanges - HELPER_MISMATCH_RANGES));
+	}
+	printf("Byte comparison total mismatches: %lu\n", (unsigned long) numErrors);
 	return (numErrors == 0) ? 1 : 0;
 }
 
@@ -85,45 +227,144 @@ void load4BytesToTxBuffer(uint8_t *txBuffer, uint8_t opcode, uint32_t address)
 	txBuffer[3] = (uint8_t) address;
 }
 
-// TODO: Make this faster.
+static const char hexDigits[16] = {'0', '1', '2', '3', '4', '5', '6', '7',
+								   '8', '9', 'A', 'B', 'C', 'D', 'E', 'F'};
+
+// Output budget of the rate limit, in characters.
+static uint32_t printRateLimit = 0;
+// Characters that may be printed now. Negative after an exchange larger than
+// the whole budget, which is then paid back before anything else is printed.
+static int64_t printTokens = 0;
+static uint32_t printLastCycles = 0;
+static uint32_t printSampling = 1;
+static uint32_t printSampleCount = 0;
+static uint32_t printSuppressed = 0;
+
+// Decides whether an exchange of numBytes bytes is printed, applying the
+// sampling interval and the rate limit. Reports skipped exchanges once
+// printing resumes.
+static bool printAllowed(uint32_t numBytes)
+{
+	// Two title lines, then 3 characters per byte.
+	uint32_t cost = 48 + 3 * numBytes;
+	if(printSampling > 1)
+	{
+		printSampleCount++;
+		if(printSampleCount < printSampling)
+		{
+			printSuppressed++;
+			return 0;
+		}
+		printSampleCount = 0;
+	}
+	if(printRateLimit != 0)
+	{
+		uint32_t now = USER_CONFIG_CycleCount();
+		uint32_t hz = USER_CONFIG_CycleCountHz();
+		printTokens += (int64_t) (((uint64_t) (uint32_t) (now - printLastCycles) * printRateLimit) / ((hz > 0) ? hz : 1));
+		printLastCycles = now;
+		if(printTokens > (int64_t) printRateLimit)
+			printTokens = printRateLimit;
+		// An exchange costing more than the whole budget goes out once the
+		// bucket is full, rather than never.
+		if((printTokens < (int64_t) cost) && (printTokens < (int64_t) printRateLimit))
+		{
+			printSuppressed++;
+			return 0;
+		}
+		printTokens -= cost;
+	}
+	if(printSuppressed != 0)
+	{
+		printf("\n[%lu exchanges not printed]", (unsigned long) printSuppressed);
+		printSuppressed = 0;
+	}
+	return 1;
+}
+
+// Prints a title followed by the bytes of two consecutive arrays, 16 to a line.
+// Each line is rendered into a local buffer and written at once.
+static void printHexLines(const char *title,
+						  const uint8_t *first,
+						  uint32_t firstNumBytes,
+						  const uint8_t *second,
+						  uint32_t secondNumBytes)
+{
+	char line[2 + 16 * 3];
+	uint32_t numBytes = firstNumBytes + secondNumBytes;
+	uint32_t i = 0;
+	uint32_t length;
+	fputs(title, stdout);
+	if(((first == NULL) && (firstNumBytes != 0)) || ((second == NULL) && (secondNumBytes != 0)))
+	{
+		printf(" %lu bytes not stored", (unsigned long) numBytes);
+		return;
+	}
+	while(i < numBytes)
+	{
+		line[0] = ' ';
+		line[1] = '\n';
+		length = 2;
+		do
+		{
+			uint8_t byte = (i < firstNumBytes) ? first[i] : second[i - firstNumBytes];
+			if(length > 2)
+				line[length++] = ' ';
+			line[length++] = hexDigits[byte >> 4];
+			line[length++] = hexDigits[byte & 0x0F];
+			i++;
+		} while((i < numBytes) && (i % 16 != 0));
+		fwrite(line, 1, length, stdout);
+	}
+}
+
+void printSPISetSampling(uint32_t interval)
+{
+	printSampling = (interval > 0) ? interval : 1;
+	printSampleCount = 0;
+}
+
+void printSPISetRateLimit(uint32_t charsPerSecond)
+{
+	printRateLimit = charsPerSecond;
+	printTokens = charsPerSecond;
+	printLastCycles = USER_CONFIG_CycleCount();
+}
+
+uint32_t printSPISuppressed()
+{
+	return printSuppressed;
+}
+
+void printSPIWrite(uint8_t *header,
+				   uint32_t headerNumBytes,
+				   uint8_t *payload,
+				   uint32_t payloadNumBytes)
+{
+	if(!printAllowed(headerNumBytes + payloadNumBytes))
+	{
+		return;
+	}
+	printHexLines("\nSent bytes (0x):", header, headerNumBytes, payload, payloadNumBytes);
+	fputs("\n", stdout);
+}
+
 void printSPIExchange(uint8_t *txBuffer,
 							 uint32_t txNumBytes,
 							 uint8_t *rxBuffer,
 							 uint32_t rxNumBytes)
 {
+	if(!printAllowed(txNumBytes + rxNumBytes))
+	{
+		return;
+	}
 	if(txNumBytes != 0)
 	{
-		printf("\nSent bytes (0x):");
-		for(uint32_t i = 0; i < txNumBytes; i++)
-		{
-			// %4 to print every 4 byte word
-			if(i%1 == 0)
-			{
-				printf(" ");
-			}
-			if(i%16 == 0)
-			{
-				printf("\n");
-			}
-			printf("%02X", txBuffer[i]);
-		}
+		printHexLines("\nSent bytes (0x):", txBuffer, txNumBytes, NULL, 0);
 	}
 	if(rxNumBytes != 0)
 	{
-		printf("\nReceived bytes (0x):");
-		for(uint32_t i = 0; i < rxNumBytes; i++)
-		{
-			// %4 to print every word (4 bytes)
-			if(i%1 == 0)
-			{
-				printf(" ");
-			}
-			if(i%16 == 0)
-			{
-				printf("\n");
-			}
-			printf("%02X", rxBuffer[i]);
-		}
+		printHexLines("\nReceived bytes (0x):", rxBuffer, rxNumBytes, NULL, 0);
 	}
-	printf("\n");
+	fputs("\n", stdout);
 }
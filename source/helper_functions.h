@@ -46,9 +46,15 @@
 #include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
+
+//! Largest number of mismatch ranges printed by compareByteArrays().
+#ifndef HELPER_MISMATCH_RANGES
+#define HELPER_MISMATCH_RANGES 8U
+#endif
+
 /*!
- * @brief Helper function to display a byte array/buffer. This function uses the
- * printSPIExchange() function internally, but only displays one byte array.
+ * @brief Helper function to display a byte array/buffer. The bytes are printed in
+ * the format of printSPIExchange(), but are never sampled or rate limited.
  *
  * @param byteArray The byte array to be printed.
  * @param numBytes The number of bytes in the array to be printed.
@@ -82,7 +88,8 @@ void fillArrayConst(uint8_t * byteArray, uint32_t numBytes, int constantNum);
 
 /**
  * @brief Helper function to compare 2 byte arrays and print an error message
- * if they do not match.
+ * if they do not match. Consecutive mismatching bytes are reported as one
+ * range, and at most @ref HELPER_MISMATCH_RANGES ranges are printed.
  *
  * @param arr1 The first of the 2 arrays to be compared.
  * @param arr2 The second array to be compared.
@@ -94,6 +101,38 @@ void fillArrayConst(uint8_t * byteArray, uint32_t numBytes, int constantNum);
  */
 bool compareByteArrays(uint8_t *arr1, uint8_t *arr2, uint32_t arrLength);
 
+/*!
+ * @brief Compares 2 byte arrays a word at a time without printing anything.
+ * @param arr1 The first of the 2 arrays to be compared.
+ * @param arr2 The second array to be compared.
+ * @param numBytes The length of both arrays.
+ * @param firstMismatch Receives the index of the first mismatch, numBytes if
+ * the arrays match. May be NULL.
+ * @retval uint32_t The number of mismatching bytes.
+ */
+uint32_t compareBytes(const uint8_t *arr1, const uint8_t *arr2, uint32_t numBytes, uint32_t *firstMismatch);
+
+/*!
+ * @brief Checks a word at a time that every byte of an array is 0xFF, the
+ * value of erased flash.
+ * @param byteArray The array to be checked.
+ * @param numBytes The number of bytes to be checked.
+ * @param firstNotBlank Receives the index of the first byte that is not 0xFF,
+ * numBytes if there is none. May be NULL.
+ * @retval bool Returns 1 if blank, 0 otherwise.
+ */
+bool blankCheck(const uint8_t *byteArray, uint32_t numBytes, uint32_t *firstNotBlank);
+
+/*!
+ * @brief Computes the CRC-32 (IEEE 802.3) of an array, four bits at a time
+ * from a 16 entry table.
+ * @param crc 0 to start, or the CRC of the preceding data to continue it.
+ * @param byteArray The data.
+ * @param numBytes The number of bytes.
+ * @retval uint32_t The CRC of all data so far.
+ */
+uint32_t crc32(uint32_t crc, const uint8_t *byteArray, uint32_t numBytes);
+
 /*!
  * @brief Loads 1 byte of opcode followed by 3 address bytes into the txBuffer.
  * The data is stored at the first 4 bytes.
@@ -102,9 +141,27 @@ bool compareByteArrays(uint8_t *arr1, uint8_t *arr2, uint32_t arrLength);
  */
 void load4BytesToTxBuffer(uint8_t *txBuffer, uint8_t opcode, uint32_t address);
 
+/*!
+ * @brief Prints the bytes of a write sent with SPI_GatherExchange() in the
+ * same format as printSPIExchange(), as one sequence of sent bytes.
+ *
+ * @param header Pointer to the opcode, address and mode bytes.
+ * @param headerNumBytes The number of header bytes.
+ * @param payload Pointer to the data sent after the header.
+ * @param payloadNumBytes The number of payload bytes.
+ *
+ * @retval void
+ */
+void printSPIWrite(uint8_t *header,
+				   uint32_t headerNumBytes,
+				   uint8_t *payload,
+				   uint32_t payloadNumBytes);
+
 /*!
  * @brief Prints the byte array in hexadecimal with a formatted output.
  * Indicates what bytes were sent, what was received, and outputs the data in a grid.
+ * Each line of 16 bytes is formatted in memory and written with one call.
+ * Exchanges may be skipped, see printSPISetSampling() and printSPISetRateLimit().
  *
  * @param txBuffer Pointer to the txBuffer byte array that will be printed.
  *  Must have at least bytesTx elements.
@@ -122,4 +179,30 @@ void printSPIExchange(uint8_t *txBuffer,
 							 uint8_t *rxBuffer,
 							 uint32_t rxNumBytes);
 
+/*!
+ * @brief Makes printSPIExchange() and printSPIWrite() print only one exchange
+ * in every 'interval', so debug output can stay on during long runs.
+ * @param interval 1 to print every exchange (the default), N to print every Nth.
+ * @retval void
+ */
+void printSPISetSampling(uint32_t interval);
+
+/*!
+ * @brief Limits the output of printSPIExchange() and printSPIWrite() to about
+ * charsPerSecond characters per second, timed with USER_CONFIG_CycleCount().
+ * Exchanges over the budget are skipped rather than delayed, and their number
+ * is printed when printing resumes. An exchange larger than a whole second's
+ * budget is printed when the budget is full, and the excess is paid back first.
+ * @param charsPerSecond The budget, 0 for no limit (the default).
+ * @retval void
+ */
+void printSPISetRateLimit(uint32_t charsPerSecond);
+
+/*!
+ * @brief Returns the number of exchanges skipped by the sampling and rate
+ * limit since the last one printed.
+ * @retval uint32_t The number of skipped exchanges.
+ */
+uint32_t printSPISuppressed();
+
 #endif /* HELPER_FUNCTIONS_H_ */
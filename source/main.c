@@ -41,12 +41,102 @@
 
 // Project file includes.
 #include "test.h"
+#if defined(USER_CONFIG_EMULATOR) || defined(USER_CONFIG_BENCHMARK)
+#include "benchmark.h"
+
+// Largest range used by the benchmarks of the storage layers.
+#define MAIN_BENCHMARK_RANGE 0x20000U
+#endif
+#if defined(USER_CONFIG_EMULATOR)
+#include "spi_transport_emulator.h"
+
+// Memory array of the emulated part.
+static uint8_t emulatorMemory[SPI_EMULATOR_ARRAY_SIZE];
+static SPI_Transport emulatorTransport;
+static SPI_EmulatorContext emulatorContext;
+// A second emulated chip, striped with the first one.
+static uint8_t emulatorStripeMemory[SPI_EMULATOR_ARRAY_SIZE];
+static SPI_Transport emulatorStripeTransport;
+static SPI_EmulatorContext emulatorStripeContext;
+
+// Benchmarks are timed in device time, which includes the emulated bus.
+static uint64_t emulatorClock(void *context)
+{
+	return SPI_EmulatorTimeNs((SPI_EmulatorContext *) context);
+}
+
+// Both chips count the host time; each adds the time of its own transfers.
+static uint64_t emulatorStripeClock(void *context)
+{
+	uint64_t cycles = USER_CONFIG_CycleCount64();
+	uint32_t hz = USER_CONFIG_CycleCountHz();
+	uint64_t hostNs = (cycles / hz) * 1000000000ULL + (cycles % hz) * 1000000000ULL / hz;
+	(void) context;
+	return SPI_EmulatorTimeNs(&emulatorContext) + SPI_EmulatorTimeNs(&emulatorStripeContext) - hostNs;
+}
+
+// Times erases, programs and reads of two emulated chips striped together.
+static int emulatorBenchmarkStripe(uint32_t numBytes)
+{
+	static FLASH_Context contexts[2];
+	static FLASH_Device devices[2];
+	const FLASH_Device *stripe[2] = {&devices[0], &devices[1]};
+	int errors;
+	SPI_EmulatorOpen(&emulatorStripeTransport, &emulatorStripeContext, emulatorStripeMemory);
+	flashContextInit(&contexts[0], "chip 0", &emulatorTransport, NULL);
+	flashContextInit(&contexts[1], "chip 1", &emulatorStripeTransport, NULL);
+	flashDeviceOpen(&devices[0], &contexts[0]);
+	flashDeviceOpen(&devices[1], &contexts[1]);
+	benchmarkSetClock(emulatorStripeClock, NULL);
+	errors = benchmarkStripe(stripe, 2, numBytes);
+	benchmarkSetClock(emulatorClock, &emulatorContext);
+	return errors;
+}
+#endif
+
+#if defined(USER_CONFIG_EMULATOR) || defined(USER_CONFIG_BENCHMARK)
+// Runs the benchmarks of benchmark.h on the selected part.
+static int mainBenchmark()
+{
+	static FLASH_Device device;
+	uint32_t range;
+	int errors = 0;
+
+	flashDeviceInit(&device);
+	range = (device.capacity < MAIN_BENCHMARK_RANGE) ? device.capacity : MAIN_BENCHMARK_RANGE;
+#if !defined(USER_CONFIG_HOST)
+	// The engines only differ on the GPIOs of the board.
+	errors += benchmarkBitBangEngines();
+#endif
+	errors += benchmarkSuite(range);
+	flashDeviceInit(&device);
+	errors += benchmarkKv(&device, 0, range, 100, 1000);
+	errors += benchmarkLog(&device, 0, range, 1000);
+	// Parts that erase single pages do not need the FTL.
+	if(device.eraseSize > device.pageSize)
+	{
+		errors += benchmarkFtl(&device, 0, range, 1000);
+	}
+#if defined(USER_CONFIG_EMULATOR)
+	errors += emulatorBenchmarkStripe(range / 4);
+#endif
+	printf("Total benchmark errors: %d\n", errors);
+	return errors;
+}
+#endif
 
 int main()
 {
 	// Configures the board. Modify when porting to a new board.
 	USER_CONFIG_BoardInit();
 
+#if defined(USER_CONFIG_EMULATOR)
+	// Runs the drivers against a software model of PARTNO instead of the pins.
+	SPI_EmulatorOpen(&emulatorTransport, &emulatorContext, emulatorMemory);
+	SPI_SetTransport(&emulatorTransport);
+	benchmarkSetClock(emulatorClock, &emulatorContext);
+#endif
+
 	// Sets the various pins as inputs and output.
     SPI_ConfigureSingleSPIIOs();
 
@@ -54,5 +144,15 @@ int main()
     // (defaultTest() or test())
     defaultTest();
 
+#if defined(USER_CONFIG_EMULATOR)
+    // The tests may leave the part in a mode of their own, such as continuous
+    // read: the benchmarks start from power up.
+    SPI_EmulatorPowerCycle(&emulatorContext);
+#endif
+#if defined(USER_CONFIG_EMULATOR) || defined(USER_CONFIG_BENCHMARK)
+    // Then measures the part and the storage layers (see benchmark.h).
+    mainBenchmark();
+#endif
+
     return 0;
 }
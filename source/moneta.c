@@ -39,148 +39,186 @@
  * @brief   Definition of Moneta functions.
  */
 #include "moneta.h"
+#include "flash_context.h"
 
 #if (PARTNO == RM331x)	|| \
 	(ALL == 1)
 
-static bool DISPLAY_OUTPUT = 0;
-
-static void debugOn() {DISPLAY_OUTPUT = 1;};
-static void debugOff() {DISPLAY_OUTPUT = 0;};
-
-uint8_t txMonetaInternalBuffer[MAXIMUM_TX_BYTES];
+static void debugOn() {flashContext->displayOutput = 1;};
+static void debugOff() {flashContext->displayOutput = 0;};
 
 void monetaWaitOnReady()
 {
-	uint8_t SR[2];
-	do
+	monetaWaitOnReadyFor(0);
+}
+
+void monetaWaitOnReadyFor(uint32_t expectedUs)
+{
+	uint8_t SR[SPI_READY_MAX_STATUS_BYTES];
+	const SPI_ReadyPoll *poll = &flashContextPart()->ready;
+	SPI_WaitReady(poll, expectedUs, SR);
+	if(flashContext->displayOutput)
 	{
-		monetaReadSR(SR);
-		SPI_Delay(10);
+		flashContext->txBuffer[0] = poll->header[0];
+		printSPIExchange(flashContext->txBuffer, 1, SR, poll->numBytes);
 	}
-	while(SR[0] & 1);
 }
 
 void monetaWriteEnable()
 {
-	txMonetaInternalBuffer[0] = CMD_MONETA_WRITE_ENABLE;
-	SPI_Exchange(txMonetaInternalBuffer, 1, NULL, 0, 0);
-	if(DISPLAY_OUTPUT)
+	flashContext->txBuffer[0] = CMD_MONETA_WRITE_ENABLE;
+	SPI_Exchange(flashContext->txBuffer, 1, NULL, 0, 0);
+	if(flashContext->displayOutput)
 	{
-		printSPIExchange(txMonetaInternalBuffer, 1, NULL, 0);
+		printSPIExchange(flashContext->txBuffer, 1, NULL, 0);
 	}
 }
 
 
 void monetaWriteDisable()
 {
-	txMonetaInternalBuffer[0] = CMD_MONETA_WRITE_DISABLE;
-	SPI_Exchange(txMonetaInternalBuffer, 1, NULL, 0, 0);
-	if(DISPLAY_OUTPUT)
+	flashContext->txBuffer[0] = CMD_MONETA_WRITE_DISABLE;
+	SPI_Exchange(flashContext->txBuffer, 1, NULL, 0, 0);
+	if(flashContext->displayOutput)
 	{
-		printSPIExchange(txMonetaInternalBuffer, 1, NULL,  0);
+		printSPIExchange(flashContext->txBuffer, 1, NULL,  0);
 	}
 }
 
 
 void monetaReadSR(uint8_t *rxBuffer)
 {
-	txMonetaInternalBuffer[0] = CMD_MONETA_READ_SRB1;
-	SPI_Exchange(txMonetaInternalBuffer, 1, rxBuffer, 2, 0);
-	if(DISPLAY_OUTPUT)
+	flashContext->txBuffer[0] = CMD_MONETA_READ_SRB1;
+	SPI_Exchange(flashContext->txBuffer, 1, rxBuffer, 2, 0);
+	if(flashContext->displayOutput)
 	{
-		printSPIExchange(txMonetaInternalBuffer, 1, rxBuffer, 2);
+		printSPIExchange(flashContext->txBuffer, 1, rxBuffer, 2);
 	}
 }
 
 
 void monetaWriteSRB1(uint8_t data)
 {
-	txMonetaInternalBuffer[0] = CMD_MONETA_WRITE_SRB1;
-	txMonetaInternalBuffer[1] = data;
-	SPI_Exchange(txMonetaInternalBuffer, 2, NULL, 0, 0);
-	if(DISPLAY_OUTPUT)
+	flashContext->txBuffer[0] = CMD_MONETA_WRITE_SRB1;
+	flashContext->txBuffer[1] = data;
+	SPI_Exchange(flashContext->txBuffer, 2, NULL, 0, 0);
+	if(flashContext->displayOutput)
 	{
-		printSPIExchange(txMonetaInternalBuffer, 2, NULL, 0);
+		printSPIExchange(flashContext->txBuffer, 2, NULL, 0);
 	}
 }
 
 
 void monetaWriteSRB2(uint8_t data)
 {
-	txMonetaInternalBuffer[0] = CMD_MONETA_WRITE_SRB2;
-	txMonetaInternalBuffer[1] = data;
-	SPI_Exchange(txMonetaInternalBuffer, 2, NULL, 0, 0);
-	if(DISPLAY_OUTPUT)
+	flashContext->txBuffer[0] = CMD_MONETA_WRITE_SRB2;
+	flashContext->txBuffer[1] = data;
+	SPI_Exchange(flashContext->txBuffer, 2, NULL, 0, 0);
+	if(flashContext->displayOutput)
 	{
-		printSPIExchange(txMonetaInternalBuffer, 2, NULL, 0);
+		printSPIExchange(flashContext->txBuffer, 2, NULL, 0);
 	}
 }
 
 
 void monetaReadArray(uint16_t address, uint8_t *rxBuffer, uint32_t rxNumBytes)
 {
-	txMonetaInternalBuffer[0] = CMD_MONETA_READ_ARRAY;
-	txMonetaInternalBuffer[1] = (uint8_t) (address >> 8);
-	txMonetaInternalBuffer[2] = (uint8_t) address;
-	SPI_Exchange(txMonetaInternalBuffer, 3, rxBuffer, rxNumBytes, 0);
-	if(DISPLAY_OUTPUT)
+	flashContext->txBuffer[0] = CMD_MONETA_READ_ARRAY;
+	flashContext->txBuffer[1] = (uint8_t) (address >> 8);
+	flashContext->txBuffer[2] = (uint8_t) address;
+	SPI_Exchange(flashContext->txBuffer, 3, rxBuffer, rxNumBytes, 0);
+	if(flashContext->displayOutput)
 	{
-		printSPIExchange(txMonetaInternalBuffer, 3, rxBuffer, rxNumBytes);
+		printSPIExchange(flashContext->txBuffer, 3, rxBuffer, rxNumBytes);
 	}
 }
 
 
 void monetaWriteArray(uint16_t address, uint8_t *txBuffer, uint32_t txNumBytes)
 {
-	// TODO: Eliminate this copy. I think this needs to be done at the lower level,
-	// possibly by passing in the opcode and data separately.
-	txMonetaInternalBuffer[0] = CMD_MONETA_WRITE_ARRAY;
-	txMonetaInternalBuffer[1] = (uint8_t) (address >> 8);
-	txMonetaInternalBuffer[2] = (uint8_t) address;
-	// Offset the data bytes by 3; opcode+address takes up the first 3 bytes of a transmission.
-	uint32_t totalBytes = txNumBytes + 3;
-	uint32_t i;
-	uint32_t j;
-	for(i = 3, j = 0; i < totalBytes; i++, j++)
-	{
-		txMonetaInternalBuffer[i] = txBuffer[j];
-	}
-	SPI_Exchange(txMonetaInternalBuffer, totalBytes, NULL, 0, 0);
-	if(DISPLAY_OUTPUT)
+	flashContext->txBuffer[0] = CMD_MONETA_WRITE_ARRAY;
+	flashContext->txBuffer[1] = (uint8_t) (address >> 8);
+	flashContext->txBuffer[2] = (uint8_t) address;
+	SPI_GatherExchange(1, 3, flashContext->txBuffer, 3, txBuffer, txNumBytes);
+	if(flashContext->displayOutput)
 	{
-		printSPIExchange(txMonetaInternalBuffer, totalBytes, NULL, 0);
+		printSPIWrite(flashContext->txBuffer, 3, txBuffer, txNumBytes);
 	}
 }
 
 
 void monetaReadMID(uint8_t *rxBuffer)
 {
-	txMonetaInternalBuffer[0] = CMD_MONETA_READ_MID;
-	SPI_Exchange(txMonetaInternalBuffer, 1, rxBuffer, 8, 0);
-	if(DISPLAY_OUTPUT)
+	flashContext->txBuffer[0] = CMD_MONETA_READ_MID;
+	SPI_Exchange(flashContext->txBuffer, 1, rxBuffer, 8, 0);
+	if(flashContext->displayOutput)
 	{
-		printSPIExchange(txMonetaInternalBuffer, 1, rxBuffer, 8);
+		printSPIExchange(flashContext->txBuffer, 1, rxBuffer, 8);
 	}
 }
 
 void monetaUDPDMode1()
 {
-	txMonetaInternalBuffer[0] = CMD_MONETA_UDPD_MODE1;
-	SPI_Exchange(txMonetaInternalBuffer, 1, NULL, 0, 0);
-	if(DISPLAY_OUTPUT)
+	flashContext->txBuffer[0] = CMD_MONETA_UDPD_MODE1;
+	SPI_Exchange(flashContext->txBuffer, 1, NULL, 0, 0);
+	if(flashContext->displayOutput)
 	{
-		printSPIExchange(txMonetaInternalBuffer, 1, NULL, 0);
+		printSPIExchange(flashContext->txBuffer, 1, NULL, 0);
 	}
 }
 
 void monetaHardwareReset()
 {
 	SPI_JEDECReset();
-	if(DISPLAY_OUTPUT)
+	if(flashContext->displayOutput)
 	{
 		printf("\n\n\nPerformed hardware reset.\n");
 	}
 }
 
+void monetaProgram(uint16_t address, uint8_t *txBuffer, uint32_t txNumBytes)
+{
+	while(txNumBytes > 0)
+	{
+		// Never cross a page boundary; the address would wrap within the page.
+		uint32_t chunk = MONETA_PAGE_SIZE - (address % MONETA_PAGE_SIZE);
+		if(chunk > txNumBytes)
+			chunk = txNumBytes;
+		monetaWriteEnable();
+		monetaWriteArray(address, txBuffer, chunk);
+		monetaWaitOnReady();
+		address += chunk;
+		txBuffer += chunk;
+		txNumBytes -= chunk;
+	}
+}
+
+void monetaRead(uint16_t address, uint8_t *rxBuffer, uint32_t rxNumBytes)
+{
+	monetaReadArray(address, rxBuffer, rxNumBytes);
+}
+
+void monetaErase(uint16_t address)
+{
+	uint8_t erased[MONETA_ERASE_SIZE];
+	uint32_t i;
+	for(i = 0; i < MONETA_ERASE_SIZE; i++)
+	{
+		erased[i] = 0xFF;
+	}
+	monetaProgram(address - (address % MONETA_ERASE_SIZE), erased, MONETA_ERASE_SIZE);
+}
+
+void monetaOpenReadStream(SPI_Stream *stream, uint16_t address)
+{
+	flashContext->txBuffer[0] = CMD_MONETA_READ_ARRAY;
+	flashContext->txBuffer[1] = (uint8_t) (address >> 8);
+	flashContext->txBuffer[2] = (uint8_t) address;
+	SPI_StreamOpen(stream, 1, 3, flashContext->txBuffer, 3, 0);
+	if(flashContext->displayOutput)
+	{
+		printSPIExchange(flashContext->txBuffer, 3, NULL, 0);
+	}
+}
+
 #endif
@@ -50,8 +50,6 @@
 #if (PARTNO == RM331x)	|| \
 	(ALL == 1)
 
-extern uint8_t txMonetaInternalBuffer[MAXIMUM_TX_BYTES];
-
 /******************************************
  *
  *
@@ -62,11 +60,23 @@ extern uint8_t txMonetaInternalBuffer[MAXIMUM_TX_BYTES];
 
 /*!
  * @brief: Wait while Read/Busy Status bit in SRB is 1 (device is busy).
+ * Same as monetaWaitOnReadyFor(0): the first sample is taken right away, for
+ * use when the duration of the last command is not known.
  *
  * @retval void
  */
 void monetaWaitOnReady();
 
+/*!
+ * @brief: Wait while Read/Busy Status bit in SRB is 1 (device is busy),
+ * sampling the status register continuously with CSb held low (SPI_WaitReady()).
+ *
+ * @param expectedUs Typical duration of the operation being waited on.
+ *
+ * @retval void
+ */
+void monetaWaitOnReadyFor(uint32_t expectedUs);
+
 /*!
  * @brief OPCODE: 0x06 <br>
  * Sends opcode to enable writing.
@@ -174,6 +184,57 @@ void monetaUDPDMode1();
  */
 void monetaHardwareReset();
 
+/*!
+ * @brief Writes 'txNumBytes' bytes of any length starting at 'address'. The
+ * data is split on @ref MONETA_PAGE_SIZE boundaries; each part is sent with
+ * monetaWriteEnable() and monetaWriteArray(), then monetaWaitOnReady() is called.
+ *
+ * @param address The 2 byte address indicating the first location to be written to.
+ * @param txBuffer Pointer to the tx bytes that will be stored in memory. Must
+ * have a minimum of txNumBytes elements.
+ * @param txNumBytes Number of bytes to be written to the device.
+ *
+ * @retval void
+ */
+void monetaProgram(uint16_t address, uint8_t *txBuffer, uint32_t txNumBytes);
+
+/*!
+ * @brief Reads 'rxNumBytes' bytes of any length starting at 'address' in a
+ * single continuous read (monetaReadArray()).
+ *
+ * @param address The 2 byte address starting from which the data in memory will be read.
+ * @param rxBuffer Pointer to the byte array in which the read data will be stored.
+ * Must have at least rxNumBytes elements.
+ * @param rxNumBytes Number of bytes to be read from the memory.
+ *
+ * @retval void
+ */
+void monetaRead(uint16_t address, uint8_t *rxBuffer, uint32_t rxNumBytes);
+
+/*!
+ * @brief OPCODE: 0x03 <br>
+ * Opens a read stream starting at 'address'. The data is then read in any
+ * number of pieces with SPI_StreamRead() while CSb stays low, and the read
+ * ends with SPI_StreamClose().
+ *
+ * @param stream The stream to open.
+ * @param address The 2 byte address starting from which the data in memory will be read.
+ *
+ * @retval void
+ */
+void monetaOpenReadStream(SPI_Stream *stream, uint16_t address);
+
+/*!
+ * @brief Writes 0xFF over the @ref MONETA_ERASE_SIZE bytes containing 'address'
+ * with monetaProgram(). Moneta does not need an erase before a write; this
+ * gives it the same erased state as the flash families.
+ *
+ * @param address Any 2 byte address inside the range to be cleared.
+ *
+ * @retval void
+ */
+void monetaErase(uint16_t address);
+
 #endif
 
 #endif /* ADESTO_LAYER_H_ */
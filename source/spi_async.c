@@ -0,0 +1,247 @@
+/*
+ * The Clear BSD License
+ * Copyright (c) 2018 Adesto Technologies Corporation, Inc
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted (subject to the limitations in the disclaimer below) provided
+ *  that the following conditions are met:
+ *
+ * o Redistributions of source code must retain the above copyright notice, this list
+ *   of conditions and the following disclaimer.
+ *
+ * o Redistributions in binary form must reproduce the above copyright notice, this
+ *   list of conditions and the following disclaimer in the documentation and/or
+ *   other materials provided with the distribution.
+ *
+ * o Neither the name of the copyright holder nor the names of its
+ *   contributors may be used to endorse or promote products derived from this
+ *   software without specific prior written permission.
+ *
+ * NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE GRANTED BY THIS LICENSE.
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*!
+ * @ingroup SPI_LAYER
+ */
+/**
+ * @file    spi_async.c
+ * @brief   Definitions of the asynchronous SPI request queue.
+ */
+#include "spi_async.h"
+#include "spi_trace.h"
+#include "spi_stats.h"
+
+static SPI_Request *queue[SPI_ASYNC_QUEUE_DEPTH];
+static volatile uint32_t queueHead = 0;
+static volatile uint32_t queueCount = 0;
+static uint32_t sliceBytes = SPI_ASYNC_SLICE_BYTES;
+
+void SPI_RequestInit(SPI_Request *request,
+					 const SPI_Transfer *transfer,
+					 SPI_RequestCallback callback,
+					 void *userData)
+{
+	request->transfer = *transfer;
+	request->callback = callback;
+	request->userData = userData;
+	request->state = SPI_REQUEST_IDLE;
+	request->position = 0;
+}
+
+static uint32_t transferNumBytes(const SPI_Transfer *transfer)
+{
+	return transfer->txNumBytes + transfer->txPayloadNumBytes +
+		   transfer->dummyNumBytes + transfer->rxNumBytes;
+}
+
+// Number of bytes of [start, start + length) that fall in [phaseStart, phaseStart + phaseLength).
+static uint32_t overlap(uint32_t start, uint32_t length, uint32_t phaseStart, uint32_t phaseLength)
+{
+	uint32_t first = (start > phaseStart) ? start : phaseStart;
+	uint32_t end = start + length;
+	uint32_t phaseEnd = phaseStart + phaseLength;
+	uint32_t last = (end < phaseEnd) ? end : phaseEnd;
+	return (last > first) ? last - first : 0;
+}
+
+// Builds the part of 'whole' covering bytes [start, start + length), with the
+// flags needed to hold CSb across the parts.
+static void buildSlice(const SPI_Transfer *whole, uint32_t start, uint32_t length, SPI_Transfer *slice)
+{
+	uint32_t payloadStart = whole->txNumBytes;
+	uint32_t dummyStart = payloadStart + whole->txPayloadNumBytes;
+	uint32_t rxStart = dummyStart + whole->dummyNumBytes;
+	uint32_t txSkip = (start < payloadStart) ? start : payloadStart;
+	uint32_t payloadSkip = (start > payloadStart) ? start - payloadStart : 0;
+	uint32_t rxSkip = (start > rxStart) ? start - rxStart : 0;
+
+	*slice = *whole;
+	slice->txBuffer = (whole->txBuffer != NULL) ? whole->txBuffer + txSkip : NULL;
+	slice->txNumBytes = overlap(start, length, 0, whole->txNumBytes);
+	slice->txSingleNumBytes = overlap(start, length, 0, whole->txSingleNumBytes);
+	slice->txPayload = (whole->txPayload != NULL) ? whole->txPayload + payloadSkip : NULL;
+	slice->txPayloadNumBytes = overlap(start, length, payloadStart, whole->txPayloadNumBytes);
+	slice->dummyNumBytes = overlap(start, length, dummyStart, whole->dummyNumBytes);
+	slice->rxBuffer = (whole->rxBuffer != NULL) ? whole->rxBuffer + rxSkip : NULL;
+	slice->rxNumBytes = overlap(start, length, rxStart, whole->rxNumBytes);
+	slice->flags = 0;
+	if(start > 0)
+		slice->flags |= SPI_TRANSFER_CONTINUE;
+	else
+		slice->flags |= whole->flags & SPI_TRANSFER_CONTINUE;
+	if(start + length < transferNumBytes(whole))
+		slice->flags |= SPI_TRANSFER_HOLD_CS;
+	else
+		slice->flags |= whole->flags & SPI_TRANSFER_HOLD_CS;
+}
+
+// The queue is shared with SPI_AsyncComplete(), which runs from the completion
+// interrupt, so every update of queueHead and queueCount is made in a critical section.
+static void finishHead()
+{
+	uint32_t critical = USER_CONFIG_EnterCritical();
+	SPI_Request *request = queue[queueHead];
+	queueHead = (queueHead + 1) % SPI_ASYNC_QUEUE_DEPTH;
+	queueCount--;
+	USER_CONFIG_ExitCritical(critical);
+	request->state = SPI_REQUEST_DONE;
+	if(request->callback != NULL)
+	{
+		request->callback(request, request->userData);
+	}
+}
+
+static void startHead()
+{
+	const SPI_Transport *transport = SPI_GetTransport();
+	SPI_Request *request;
+	uint32_t critical;
+	if(transport->start == NULL)
+	{
+		return;
+	}
+	// Claim the head so that SPI_Poll() and the completion interrupt never both start it.
+	critical = USER_CONFIG_EnterCritical();
+	request = (queueCount > 0) ? queue[queueHead] : NULL;
+	if((request == NULL) || (request->state != SPI_REQUEST_QUEUED))
+	{
+		USER_CONFIG_ExitCritical(critical);
+		return;
+	}
+	request->state = SPI_REQUEST_ACTIVE;
+	USER_CONFIG_ExitCritical(critical);
+	SPI_TRACE_BEGIN(&request->transfer, SPI_TRACE_ASYNC);
+	SPI_STATS_BEGIN(&request->transfer);
+	transport->start(transport->context, &request->transfer);
+}
+
+uint8_t SPI_Submit(SPI_Request *request)
+{
+	uint32_t critical;
+	uint8_t idle;
+	if((request->state == SPI_REQUEST_QUEUED) ||
+	   (request->state == SPI_REQUEST_ACTIVE))
+	{
+		return 0;
+	}
+	critical = USER_CONFIG_EnterCritical();
+	if(queueCount == SPI_ASYNC_QUEUE_DEPTH)
+	{
+		USER_CONFIG_ExitCritical(critical);
+		return 0;
+	}
+	request->state = SPI_REQUEST_QUEUED;
+	request->position = 0;
+	queue[(queueHead + queueCount) % SPI_ASYNC_QUEUE_DEPTH] = request;
+	queueCount++;
+	idle = (queueCount == 1) ? 1 : 0;
+	USER_CONFIG_ExitCritical(critical);
+	if(idle)
+	{
+		startHead();
+	}
+	return 1;
+}
+
+uint32_t SPI_Poll()
+{
+	const SPI_Transport *transport = SPI_GetTransport();
+	if(queueCount == 0)
+	{
+		return 0;
+	}
+	if(transport->start != NULL)
+	{
+		startHead();
+		return queueCount;
+	}
+
+	// Cooperative mode: clock the next slice of the head request.
+	SPI_Request *request = queue[queueHead];
+	SPI_Transfer slice;
+	uint32_t total = transferNumBytes(&request->transfer);
+	uint32_t length = total - request->position;
+	if(length > sliceBytes)
+		length = sliceBytes;
+	request->state = SPI_REQUEST_ACTIVE;
+	buildSlice(&request->transfer, request->position, length, &slice);
+	SPI_TRACE_BEGIN(&slice, SPI_TRACE_ASYNC);
+	SPI_STATS_BEGIN(&slice);
+	transport->exchange(transport->context, &slice);
+	SPI_STATS_END(&slice);
+	SPI_TRACE_END(&slice);
+	request->position += length;
+	if(request->position >= total)
+	{
+		finishHead();
+	}
+	return queueCount;
+}
+
+uint8_t SPI_RequestDone(const SPI_Request *request)
+{
+	return (request->state == SPI_REQUEST_DONE) ? 1 : 0;
+}
+
+void SPI_Wait(SPI_Request *request)
+{
+	while((request->state == SPI_REQUEST_QUEUED) || (request->state == SPI_REQUEST_ACTIVE))
+	{
+		SPI_Poll();
+	}
+}
+
+void SPI_AsyncFlush()
+{
+	while(SPI_Poll() > 0)
+	{
+	}
+}
+
+void SPI_AsyncComplete()
+{
+	if((queueCount == 0) || (queue[queueHead]->state != SPI_REQUEST_ACTIVE))
+	{
+		return;
+	}
+	SPI_STATS_END(&queue[queueHead]->transfer);
+	SPI_TRACE_END(&queue[queueHead]->transfer);
+	finishHead();
+	startHead();
+}
+
+void SPI_AsyncSetSliceBytes(uint32_t bytes)
+{
+	sliceBytes = (bytes > 0) ? bytes : 1;
+}
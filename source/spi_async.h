@@ -0,0 +1,187 @@
+/*
+ * The Clear BSD License
+ * Copyright (c) 2018 Adesto Technologies Corporation, Inc
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted (subject to the limitations in the disclaimer below) provided
+ *  that the following conditions are met:
+ *
+ * o Redistributions of source code must retain the above copyright notice, this list
+ *   of conditions and the following disclaimer.
+ *
+ * o Redistributions in binary form must reproduce the above copyright notice, this
+ *   list of conditions and the following disclaimer in the documentation and/or
+ *   other materials provided with the distribution.
+ *
+ * o Neither the name of the copyright holder nor the names of its
+ *   contributors may be used to endorse or promote products derived from this
+ *   software without specific prior written permission.
+ *
+ * NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE GRANTED BY THIS LICENSE.
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*!
+ * @ingroup SPI_LAYER
+ */
+/**
+ * @file    spi_async.h
+ * @brief   Declarations of the asynchronous SPI request queue.
+ *
+ * Requests wrap an SPI_Transfer and are queued with SPI_Submit(). They are
+ * carried out in submission order, one at a time, while the caller keeps
+ * running. Completion is reported through an optional callback and can be
+ * polled with SPI_RequestDone().
+ *
+ * If the active transport has a start operation (an interrupt or DMA driven
+ * peripheral), the head request is started in the background and the
+ * transport's completion handler calls SPI_AsyncComplete(). Otherwise the
+ * requests are run cooperatively: every call to SPI_Poll() clocks at most
+ * SPI_ASYNC_SLICE_BYTES bytes of the head request, holding CSb between
+ * slices, so the application can interleave its own work with a transfer.
+ */
+#ifndef SPI_ASYNC_H_
+#define SPI_ASYNC_H_
+
+#include "spi_driver.h"
+
+//! Maximum number of requests queued at once.
+#ifndef SPI_ASYNC_QUEUE_DEPTH
+#define SPI_ASYNC_QUEUE_DEPTH 8U
+#endif
+
+//! Default number of bytes clocked per SPI_Poll() call by a blocking transport.
+#ifndef SPI_ASYNC_SLICE_BYTES
+#define SPI_ASYNC_SLICE_BYTES 32U
+#endif
+
+/*!
+ * @brief States of an SPI_Request.
+ */
+enum spiRequestState
+{
+	SPI_REQUEST_IDLE,		//!< Not submitted, or completed and collected.
+	SPI_REQUEST_QUEUED,		//!< Waiting behind other requests.
+	SPI_REQUEST_ACTIVE,		//!< Being clocked out.
+	SPI_REQUEST_DONE		//!< Finished. The rx data is valid.
+};
+
+typedef struct SPI_Request SPI_Request;
+
+/*!
+ * @brief Completion callback. Called once per request, from SPI_Poll() or
+ * from the transport's completion interrupt through SPI_AsyncComplete().
+ */
+typedef void (*SPI_RequestCallback)(SPI_Request *request, void *userData);
+
+/*!
+ * @brief An asynchronous SPI transaction. The storage is owned by the caller
+ * and, like the buffers it points to, must stay valid until the request is done.
+ */
+struct SPI_Request
+{
+	//! The transaction to be carried out.
+	SPI_Transfer transfer;
+	//! Called when the request is done. May be NULL.
+	SPI_RequestCallback callback;
+	//! Passed to the callback.
+	void *userData;
+	//! Current state. Written by the queue only.
+	volatile enum spiRequestState state;
+	//! Bytes of the transaction clocked so far by cooperative slices.
+	uint32_t position;
+};
+
+/*!
+ * @brief Prepares a request for SPI_Submit().
+ *
+ * @param request The request to be prepared.
+ * @param transfer The transaction. It is copied into the request; the buffers
+ * it points to are not.
+ * @param callback Called when the request is done. May be NULL.
+ * @param userData Passed to the callback.
+ *
+ * @retval void
+ */
+void SPI_RequestInit(SPI_Request *request,
+					 const SPI_Transfer *transfer,
+					 SPI_RequestCallback callback,
+					 void *userData);
+
+/*!
+ * @brief Queues a request behind those already submitted. If the queue was
+ * empty and the transport can run in the background, the request is started.
+ *
+ * @param request A request prepared with SPI_RequestInit().
+ *
+ * @retval 1 The request was queued.
+ * @retval 0 The queue is full or the request is already queued.
+ */
+uint8_t SPI_Submit(SPI_Request *request);
+
+/*!
+ * @brief Advances the queue. With a blocking transport this clocks the next
+ * slice of the head request; with a background transport it only starts the
+ * head request if none is running. Call it from the application main loop.
+ *
+ * @retval uint32_t The number of requests still queued or active.
+ */
+uint32_t SPI_Poll();
+
+/*!
+ * @brief Returns whether a request has finished.
+ *
+ * @param request The request.
+ *
+ * @retval 1 The request is done.
+ * @retval 0 The request is queued or active.
+ */
+uint8_t SPI_RequestDone(const SPI_Request *request);
+
+/*!
+ * @brief Calls SPI_Poll() until the given request is done.
+ *
+ * @param request A submitted request.
+ *
+ * @retval void
+ */
+void SPI_Wait(SPI_Request *request);
+
+/*!
+ * @brief Calls SPI_Poll() until every submitted request is done. The blocking
+ * SPI layer functions do this first, so they never interleave with queued requests.
+ *
+ * @retval void
+ */
+void SPI_AsyncFlush();
+
+/*!
+ * @brief Reports the end of the request started through the transport's start
+ * operation. Marks it done, calls its callback and starts the next request.
+ * Meant to be called from the transport's completion interrupt.
+ *
+ * @retval void
+ */
+void SPI_AsyncComplete();
+
+/*!
+ * @brief Sets the number of bytes clocked per SPI_Poll() call with a blocking
+ * transport. Smaller slices give the application more frequent turns.
+ *
+ * @param sliceBytes Bytes per slice, at least 1.
+ *
+ * @retval void
+ */
+void SPI_AsyncSetSliceBytes(uint32_t sliceBytes);
+
+#endif /* SPI_ASYNC_H_ */
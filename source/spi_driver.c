@@ -39,6 +39,14 @@
  * @brief   Definitions of spi_driver functions.
  */
 #include "spi_driver.h"
+#include "spi_async.h"
+#include "spi_trace.h"
+#include "spi_stats.h"
+#include "cmd_defs.h"
+#include <stdio.h>
+
+// SPI_Delay() iterations per half clock of the transaction in progress.
+static uint32_t sckHalfPeriod = DELAY;
 
 void SPI_PinInit(uint32_t port, uint32_t pin, enum directionIO direction)
 {
@@ -58,6 +66,101 @@ uint32_t SPI_PinRead(uint32_t port, uint32_t pin)
 	return USER_CONFIG_PinRead(port, pin);
 }
 
+/*
+ * Port engine state. Every IO bit pattern is precomputed per byte and per
+ * clock, relative to the lowest data IO pin, so that each clock costs one
+ * clear, one set and at most one read of the port. The port engine is only
+ * available when SCK and the 4 data IOs share a port and the data IOs fit
+ * in an 8-bit window.
+ */
+static bool portEngineAvailable = 0;
+static enum spiBitBangEngine bitBangEngine = SPI_ENGINE_PIN;
+static uint32_t sckMask;
+static uint32_t windowShift;
+static uint32_t singleLineMask;
+static uint32_t dualLineMask;
+static uint32_t quadLineMask;
+static uint8_t singleEncode[256][8];
+static uint8_t dualEncode[256][4];
+static uint8_t quadEncode[256][2];
+static uint8_t singleDecode[256];
+static uint8_t dualDecode[256];
+static uint8_t quadDecode[256];
+
+static void bitbangBuildTables()
+{
+	uint32_t lowest = SPI_MOSI_PIN;
+	uint32_t highest = SPI_MOSI_PIN;
+	uint32_t pins[3] = {SPI_MISO_PIN, SPI_WPB_PIN, SPI_HOLDB_PIN};
+	uint32_t i;
+	uint32_t k;
+
+	for(i = 0; i < 3; i++)
+	{
+		if(pins[i] < lowest)
+			lowest = pins[i];
+		if(pins[i] > highest)
+			highest = pins[i];
+	}
+	portEngineAvailable = (SPI_MOSI_PORT == SPI_SCK_PORT) &&
+						  (SPI_MISO_PORT == SPI_SCK_PORT) &&
+						  (SPI_WPB_PORT == SPI_SCK_PORT) &&
+						  (SPI_HOLDB_PORT == SPI_SCK_PORT) &&
+						  (highest - lowest < 8);
+	if(!portEngineAvailable)
+	{
+		bitBangEngine = SPI_ENGINE_PIN;
+		return;
+	}
+
+	// IO0 = MOSI, IO1 = MISO, IO2 = WPb, IO3 = HOLDb, relative to the window.
+	uint8_t io0 = 1 << (SPI_MOSI_PIN - lowest);
+	uint8_t io1 = 1 << (SPI_MISO_PIN - lowest);
+	uint8_t io2 = 1 << (SPI_WPB_PIN - lowest);
+	uint8_t io3 = 1 << (SPI_HOLDB_PIN - lowest);
+	sckMask = 1U << SPI_SCK_PIN;
+	windowShift = lowest;
+	singleLineMask = (uint32_t) io0 << lowest;
+	dualLineMask = (uint32_t) (io0 | io1) << lowest;
+	quadLineMask = (uint32_t) (io0 | io1 | io2 | io3) << lowest;
+
+	for(i = 0; i < 256; i++)
+	{
+		// Encode: the IO pattern of each clock of byte i, MSB first.
+		for(k = 0; k < 8; k++)
+			singleEncode[i][k] = ((i >> (7 - k)) & 1) ? io0 : 0;
+		for(k = 0; k < 4; k++)
+			dualEncode[i][k] = (((i >> (7 - 2*k)) & 1) ? io1 : 0) |
+							   (((i >> (6 - 2*k)) & 1) ? io0 : 0);
+		for(k = 0; k < 2; k++)
+			quadEncode[i][k] = (((i >> (7 - 4*k)) & 1) ? io3 : 0) |
+							   (((i >> (6 - 4*k)) & 1) ? io2 : 0) |
+							   (((i >> (5 - 4*k)) & 1) ? io1 : 0) |
+							   (((i >> (4 - 4*k)) & 1) ? io0 : 0);
+		// Decode: the bits carried by a sampled window i.
+		singleDecode[i] = (i & io1) ? 1 : 0;
+		dualDecode[i] = ((i & io1) ? 2 : 0) | ((i & io0) ? 1 : 0);
+		quadDecode[i] = ((i & io3) ? 8 : 0) | ((i & io2) ? 4 : 0) |
+						((i & io1) ? 2 : 0) | ((i & io0) ? 1 : 0);
+	}
+	bitBangEngine = SPI_ENGINE_PORT;
+}
+
+uint8_t SPI_SetBitBangEngine(enum spiBitBangEngine engine)
+{
+	if((engine == SPI_ENGINE_PORT) && !portEngineAvailable)
+	{
+		return 0;
+	}
+	bitBangEngine = engine;
+	return 1;
+}
+
+enum spiBitBangEngine SPI_GetBitBangEngine()
+{
+	return bitBangEngine;
+}
+
 void SPI_ConfigureSingleSPIIOs()
 {
 	/* Configure each of the 4 pins needed for testing. */
@@ -80,6 +183,9 @@ void SPI_ConfigureSingleSPIIOs()
 	// Set both WPb and HOLDb to high.
 	SPI_PinSet(SPI_HOLDB_PORT, SPI_HOLDB_PIN);
 	SPI_PinSet(SPI_WPB_PORT, SPI_WPB_PIN);
+	// Precompute the masks and tables of the port engine.
+	bitbangBuildTables();
+	SPI_CalibrateClock();
 }
 
 void SPI_ReturnToSingleSPIIOs()
@@ -146,11 +252,101 @@ void SPI_Delay(uint32_t delayTime)
     }
 }
 
+static SPI_ClockProfile clockProfile =
+{
+	.maxHz = FSCK_MAX_HZ,
+	.lowFrequencyHz = FSCK_LOW_FREQUENCY_HZ,
+	.lowPowerHz = FSCK_LOW_POWER_HZ
+};
+
+void SPI_SetClockProfile(const SPI_ClockProfile *profile)
+{
+	clockProfile = *profile;
+}
+
+uint32_t SPI_CommandClockHz(uint8_t opcode)
+{
+	if(opcode == 0x03)
+		return clockProfile.lowFrequencyHz;
+	if((opcode == 0x01) && (clockProfile.lowPowerHz != 0))
+		return clockProfile.lowPowerHz;
+	return clockProfile.maxHz;
+}
+
+/*
+ * Calibration results. delayCost is the cost of one SPI_Delay() iteration in
+ * 1/1000 cycles, clockCost the cost of one clock of each engine with a delay
+ * of 0 iterations, in cycles.
+ */
+#define CALIBRATION_DELAY_LOOPS 1000U
+#define CALIBRATION_CLOCK_BYTES 8U
+static bool clockCalibrated = 0;
+static uint32_t delayCost;
+static uint32_t clockCost[2];
+
+static void bitbangReceive(uint8_t ioLines, uint8_t *rxBuffer, uint32_t rxNumBytes);
+
+static uint32_t measureDelay(uint32_t loops)
+{
+	uint32_t start = USER_CONFIG_CycleCount();
+	SPI_Delay(loops);
+	return USER_CONFIG_CycleCount() - start;
+}
+
+static uint32_t measureClock(enum spiBitBangEngine engine)
+{
+	enum spiBitBangEngine entryEngine = bitBangEngine;
+	uint32_t start;
+	uint32_t cycles;
+	bitBangEngine = engine;
+	start = USER_CONFIG_CycleCount();
+	bitbangReceive(1, NULL, CALIBRATION_CLOCK_BYTES);
+	cycles = USER_CONFIG_CycleCount() - start;
+	bitBangEngine = entryEngine;
+	return cycles / (CALIBRATION_CLOCK_BYTES * 8);
+}
+
+void SPI_CalibrateClock()
+{
+	uint32_t baseCycles = measureDelay(0);
+	uint32_t loopCycles = measureDelay(CALIBRATION_DELAY_LOOPS);
+	delayCost = (loopCycles > baseCycles) ? loopCycles - baseCycles : 1;
+	// CSb stays high, so the device ignores these clocks.
+	sckHalfPeriod = 0;
+	clockCost[SPI_ENGINE_PIN] = measureClock(SPI_ENGINE_PIN);
+	clockCost[SPI_ENGINE_PORT] = portEngineAvailable ? measureClock(SPI_ENGINE_PORT) : clockCost[SPI_ENGINE_PIN];
+	clockCalibrated = 1;
+	sckHalfPeriod = DELAY;
+}
+
+// Returns the SPI_Delay() iterations per half clock that keep SCK at or below clockHz.
+static uint32_t bitbangHalfPeriod(uint32_t clockHz)
+{
+	if(!clockCalibrated)
+		return DELAY;
+	if(clockHz == 0)
+		return 0;
+	uint32_t halfCycles = (USER_CONFIG_CycleCountHz() + 2*clockHz - 1) / (2*clockHz);
+	uint32_t overhead = clockCost[bitBangEngine] / 2;
+	if(halfCycles <= overhead)
+		return 0;
+	return (uint32_t) ((((uint64_t) (halfCycles - overhead)) * 1000 + delayCost - 1) / delayCost);
+}
+
+uint32_t SPI_BitBangClockHz(uint32_t clockHz)
+{
+	if(!clockCalibrated)
+		return 0;
+	uint64_t periodCycles = clockCost[bitBangEngine] +
+							((uint64_t) 2 * bitbangHalfPeriod(clockHz) * delayCost) / 1000;
+	return (uint32_t) (USER_CONFIG_CycleCountHz() / (periodCycles ? periodCycles : 1));
+}
+
 void SPI_ClockTick()
 {
-	SPI_Delay(DELAY);
+	SPI_Delay(sckHalfPeriod);
 	SPI_PinSet(SPI_SCK_PORT, SPI_SCK_PIN);
-	SPI_Delay(DELAY);
+	SPI_Delay(sckHalfPeriod);
 	SPI_PinClear(SPI_SCK_PORT, SPI_SCK_PIN);
 }
 
@@ -164,7 +360,7 @@ void SPI_SendBit(uint8_t transmittedBit)
 	else
 		SPI_PinClear(SPI_MOSI_PORT, SPI_MOSI_PIN);
 	// Toggle clock
-	SPI_ClockTick(DELAY);
+	SPI_ClockTick();
 }
 
 void SPI_SendByte(uint8_t transmittedByte)
@@ -204,7 +400,7 @@ void SPI_DualSendByte(uint8_t transmittedByte)
 			SPI_PinClear(SPI_MOSI_PORT, SPI_MOSI_PIN);
 
 		// Toggle clock
-		SPI_ClockTick(DELAY);
+		SPI_ClockTick();
 	}
 }
 
@@ -244,7 +440,7 @@ void SPI_QuadSendByte(uint8_t transmittedByte)
 			SPI_PinClear(SPI_MOSI_PORT, SPI_MOSI_PIN);
 
 		// Toggle clock
-		SPI_ClockTick(DELAY);
+		SPI_ClockTick();
 	}
 }
 
@@ -260,7 +456,7 @@ uint8_t SPI_ReceiveByte()
 			input |= (1 << i);
 		else
 			input &= ~(1 << i);
-		SPI_ClockTick(DELAY);
+		SPI_ClockTick();
 	}
 	return input;
 }
@@ -284,7 +480,7 @@ uint8_t SPI_DualReceiveByte()
 		else
 			input &= ~(1 << (i-1));
 
-		SPI_ClockTick(DELAY);
+		SPI_ClockTick();
 	}
 	return input;
 }
@@ -317,217 +513,498 @@ uint8_t SPI_QuadReceiveByte()
 			input |= (1 << (i-3));
 		else
 			input &= ~(1 << (i-3));
-		SPI_ClockTick(DELAY);
+		SPI_ClockTick();
 	}
 	return input;
 }
 
-void SPI_Exchange(uint8_t *txBuffer,
-				  uint32_t txNumBytes,
-				  uint8_t *rxBuffer,
-				  uint32_t rxNumBytes,
-				  uint32_t dummyNumBytes)
+// Drives 'clocks' clocks with the precomputed IO patterns in 'symbols'. SCK
+// is cleared together with the data IOs that go low, so each clock costs
+// 3 port accesses.
+static void portSendSymbols(const uint8_t *symbols, uint32_t clocks, uint32_t lineMask)
 {
-	uint32_t i = 0;
-	// Begin data exchange
-	// Set clock to low
-	SPI_PinClear(SPI_SCK_PORT, SPI_SCK_PIN);
-	// Select chip
-	SPI_PinClear(SPI_CSB_PORT, SPI_CSB_PIN);
+	uint32_t k;
+	for(k = 0; k < clocks; k++)
+	{
+		uint32_t high = (uint32_t) symbols[k] << windowShift;
+		USER_CONFIG_PORT_CLEAR(SPI_SCK_PORT, sckMask | (lineMask & ~high));
+		USER_CONFIG_PORT_SET(SPI_SCK_PORT, high);
+		SPI_Delay(sckHalfPeriod);
+		USER_CONFIG_PORT_SET(SPI_SCK_PORT, sckMask);
+		SPI_Delay(sckHalfPeriod);
+	}
+	USER_CONFIG_PORT_CLEAR(SPI_SCK_PORT, sckMask);
+}
 
-	// Send each byte
-	for(i = 0; i < txNumBytes; i = i+1)
-		SPI_SendByte(txBuffer[i]);
-	// Receive each byte
-	for(i = 0; i < dummyNumBytes; i = i+1)
-		SPI_ReceiveByte();
-	// Receive each byte
-	for(i = 0; i < rxNumBytes; i = i+1)
-		rxBuffer[i] = SPI_ReceiveByte();
+// Samples the IOs once per clock and assembles the byte through 'decode'.
+static uint8_t portReceiveSymbols(const uint8_t *decode, uint32_t clocks, uint32_t bitsPerClock)
+{
+	uint32_t k;
+	uint32_t input = 0;
+	for(k = 0; k < clocks; k++)
+	{
+		input = (input << bitsPerClock) |
+				decode[(USER_CONFIG_PORT_READ(SPI_SCK_PORT) >> windowShift) & 0xFF];
+		SPI_Delay(sckHalfPeriod);
+		USER_CONFIG_PORT_SET(SPI_SCK_PORT, sckMask);
+		SPI_Delay(sckHalfPeriod);
+		USER_CONFIG_PORT_CLEAR(SPI_SCK_PORT, sckMask);
+	}
+	return (uint8_t) input;
+}
 
-	// End data exchange
-	// Set clock to low
-	SPI_PinClear(SPI_SCK_PORT, SPI_SCK_PIN);
-	// Deselect chip
-	SPI_PinSet(SPI_CSB_PORT, SPI_CSB_PIN);
+static void bitbangSend(uint8_t ioLines, const uint8_t *txBuffer, uint32_t txNumBytes)
+{
+	uint32_t i;
+	if(bitBangEngine == SPI_ENGINE_PORT)
+	{
+		if(ioLines == 4)
+			for(i = 0; i < txNumBytes; i++)
+				portSendSymbols(quadEncode[txBuffer[i]], 2, quadLineMask);
+		else if(ioLines == 2)
+			for(i = 0; i < txNumBytes; i++)
+				portSendSymbols(dualEncode[txBuffer[i]], 4, dualLineMask);
+		else
+			for(i = 0; i < txNumBytes; i++)
+				portSendSymbols(singleEncode[txBuffer[i]], 8, singleLineMask);
+	}
+	else
+	{
+		if(ioLines == 4)
+			for(i = 0; i < txNumBytes; i++)
+				SPI_QuadSendByte(txBuffer[i]);
+		else if(ioLines == 2)
+			for(i = 0; i < txNumBytes; i++)
+				SPI_DualSendByte(txBuffer[i]);
+		else
+			for(i = 0; i < txNumBytes; i++)
+				SPI_SendByte(txBuffer[i]);
+	}
 }
 
-void SPI_DualExchange(uint8_t standardSPINumBytes,
-					  uint8_t *txBuffer,
-					  uint32_t txNumBytes,
-					  uint8_t *rxBuffer,
-					  uint32_t rxNumBytes,
-					  uint32_t dummyNumBytes)
+// Receives rxNumBytes bytes. rxBuffer may be NULL to clock dummy bytes.
+static void bitbangReceive(uint8_t ioLines, uint8_t *rxBuffer, uint32_t rxNumBytes)
 {
-	uint32_t i = 0;
-	// Begin data exchange
-	// Set clock to low
-	SPI_PinClear(SPI_SCK_PORT, SPI_SCK_PIN);
-	// Select chip
-	SPI_PinClear(SPI_CSB_PORT, SPI_CSB_PIN);
-
-	// Transmit bytes in standard single SPI
-	for(i = 0; i < standardSPINumBytes; i = i+1)
-		SPI_SendByte(txBuffer[i]);
-	// Transmit dummy bytes in standard single SPI mode
-	for(i = 0; i < dummyNumBytes; i = i+1)
-		SPI_ReceiveByte();
-	// If we're sending data to the flash device then configure for dual tx
-	// and transmit the remaining data in dual SPI mode.
-	if(standardSPINumBytes <= txNumBytes)
-	{
-		SPI_ConfigureDualSPIIOsOutput();
-		for(i = standardSPINumBytes; i < txNumBytes; i = i+1)
+	uint32_t i;
+	uint8_t input;
+	for(i = 0; i < rxNumBytes; i++)
+	{
+		if(bitBangEngine == SPI_ENGINE_PORT)
 		{
-			SPI_DualSendByte(txBuffer[i]);
+			if(ioLines == 4)
+				input = portReceiveSymbols(quadDecode, 2, 4);
+			else if(ioLines == 2)
+				input = portReceiveSymbols(dualDecode, 4, 2);
+			else
+				input = portReceiveSymbols(singleDecode, 8, 1);
 		}
-	}
-	// Receive each byte
-	// If we're receiving at least 1 byte, then configure the outputs for dual rx
-	// and receive the data in dual SPI mode.
-	if(rxNumBytes > 0)
-	{
-		SPI_ConfigureDualSPIIOsInput();
-		for(i = 0; i < rxNumBytes; i = i+1)
+		else
 		{
-			rxBuffer[i] = SPI_DualReceiveByte();
+			if(ioLines == 4)
+				input = SPI_QuadReceiveByte();
+			else if(ioLines == 2)
+				input = SPI_DualReceiveByte();
+			else
+				input = SPI_ReceiveByte();
 		}
+		if(rxBuffer != NULL)
+			rxBuffer[i] = input;
 	}
+}
 
-	// End data exchange
-	// Set clock to low
-	SPI_PinClear(SPI_SCK_PORT, SPI_SCK_PIN);
-	// Deselect chip
-	SPI_PinSet(SPI_CSB_PORT, SPI_CSB_PIN);
-	// Reconfigure device for standard SPI operation
-	SPI_ReturnToSingleSPIIOs();
+// The chip select of a transport from SPI_BitBangOpen(), else the board's.
+static SPI_BitBangContext bitbangChip(void *context)
+{
+	SPI_BitBangContext chip = {SPI_CSB_PORT, SPI_CSB_PIN};
+	if(context != NULL)
+	{
+		chip = *(const SPI_BitBangContext *) context;
+	}
+	return chip;
 }
 
-void SPI_QuadExchange(uint8_t standardSPINumBytes,
-					  uint8_t *txBuffer,
-					  uint32_t txNumBytes,
-					  uint8_t *rxBuffer,
-					  uint32_t rxNumBytes,
-					  uint32_t dummyNumBytes)
+static void bitbangExchange(void *context, const SPI_Transfer *transfer)
 {
-	uint32_t i = 0;
-	// Determines if dummy bytes should be sent in standard SPI, or another mode.
-	uint8_t dummyBytesSSPI = 1;
-	// Begin data exchange
-	// Set clock to low
-	SPI_PinClear(SPI_SCK_PORT, SPI_SCK_PIN);
-	// Select chip
-	SPI_PinClear(SPI_CSB_PORT, SPI_CSB_PIN);
-
-	// Transmit standardSPINumBytes bytes in standard single SPI.
-	// Unless in QPI mode, a transmission will take the 1-4-4 or
-	// 1-1-4 format, the 1 indicating SPI and the 4 indicating Quad.
-	// -- This assumes that the device is configured in single SPI.
-	for(i = 0; i < standardSPINumBytes; i = i+1)
-		SPI_SendByte(txBuffer[i]);
-	// If we're sending data to the flash device then configure for quad tx
-	// and transmit the remaining data in quad SPI mode.
-	if(standardSPINumBytes < txNumBytes)
-	{
-		dummyBytesSSPI = 0;
-		SPI_ConfigureQuadSPIIOsOutput();
-		for(i = standardSPINumBytes; i < txNumBytes; i = i+1)
-		{
-			SPI_QuadSendByte(txBuffer[i]);
-		}
+	const SPI_BitBangContext chip = bitbangChip(context);
+	sckHalfPeriod = bitbangHalfPeriod(transfer->clockHz);
+	// Begin data exchange, unless CSb is still held by the previous transfer.
+	if(!(transfer->flags & SPI_TRANSFER_CONTINUE))
+	{
+		// Set clock to low
+		SPI_PinClear(SPI_SCK_PORT, SPI_SCK_PIN);
+		// Select chip
+		SPI_PinClear(chip.csbPort, chip.csbPin);
+	}
+
+	// Transmit the leading bytes in standard single SPI. Unless in QPI mode,
+	// this is the opcode of a 1-1-4, 1-4-4, 1-1-2 or 1-2-2 transmission.
+	bitbangSend(1, transfer->txBuffer, transfer->txSingleNumBytes);
+	// If there are bytes left to send, configure the IOs for dual or quad tx
+	// and transmit the remaining header and the payload on all of them.
+	if((transfer->txSingleNumBytes < transfer->txNumBytes) || (transfer->txPayloadNumBytes > 0))
+	{
+		if(transfer->ioLines == 4)
+			SPI_ConfigureQuadSPIIOsOutput();
+		else if(transfer->ioLines == 2)
+			SPI_ConfigureDualSPIIOsOutput();
+		bitbangSend(transfer->ioLines, &transfer->txBuffer[transfer->txSingleNumBytes],
+					transfer->txNumBytes - transfer->txSingleNumBytes);
+		bitbangSend(transfer->ioLines, transfer->txPayload, transfer->txPayloadNumBytes);
 	}
 	// Transmit the dummy bytes.
-	if(dummyNumBytes > 0)
-	{
-		// Need this in case it was all standardSPI. This puts the WP, HOLD, SO, SI pins in
-		// a high impedance state which is necessary for quad IO.
-		// Quad output just needs HOLD, WP, and SO to be Hi-Z.
-		// Quad IO needs all 4 to be Hi-Z.
-		SPI_ConfigureQuadSPIIOsInput();
-		if(dummyBytesSSPI == 1)
-		{
-			// Transmit dummy bytes in SSPI. (Really just clock toggling)
-			for(i = 0; i < dummyNumBytes; i = i+1)
-			{
-				SPI_ReceiveByte();
-			}
-		}
-		else
-		{
-			// Transmit dummy bytes in QSPI.
-			for(i = 0; i < dummyNumBytes; i = i+1)
-			{
-				SPI_QuadReceiveByte();
-			}
-		}
+	if(transfer->dummyNumBytes > 0)
+	{
+		// Quad output just needs HOLD, WP, and SO to be Hi-Z, quad IO needs
+		// all 4 to be Hi-Z. This is necessary even if the dummy bytes are
+		// clocked in standard SPI.
+		if(transfer->ioLines == 4)
+			SPI_ConfigureQuadSPIIOsInput();
+		bitbangReceive(transfer->dummyIOLines, NULL, transfer->dummyNumBytes);
 	}
 	// Receive each byte
-	// If we're receiving at least 1 byte, then configure the outputs for quad rx
-	// and receive the data in quad SPI mode.
-	if(rxNumBytes > 0)
+	// If we're receiving at least 1 byte, then configure the IOs for
+	// dual or quad rx and receive the data on all of them.
+	if(transfer->rxNumBytes > 0)
 	{
-		SPI_ConfigureQuadSPIIOsInput();
-		for(i = 0; i < rxNumBytes; i = i+1)
-		{
-			rxBuffer[i] = SPI_QuadReceiveByte();
-		}
+		if(transfer->ioLines == 4)
+			SPI_ConfigureQuadSPIIOsInput();
+		else if(transfer->ioLines == 2)
+			SPI_ConfigureDualSPIIOsInput();
+		bitbangReceive(transfer->ioLines, transfer->rxBuffer, transfer->rxNumBytes);
 	}
 
+	// Keep the IOs as they are while the transaction is held open.
+	if(transfer->flags & SPI_TRANSFER_HOLD_CS)
+		return;
 	// End data exchange
 	// Set clock to low
 	SPI_PinClear(SPI_SCK_PORT, SPI_SCK_PIN);
 	// Deselect chip
-	SPI_PinSet(SPI_CSB_PORT, SPI_CSB_PIN);
+	SPI_PinSet(chip.csbPort, chip.csbPin);
 	// Reconfigure device for standard SPI operation
-	SPI_ReturnToSingleSPIIOs();
-}
-
-void SPI_Trigger()
-{
-	SPI_PinSet(SPI_TRIGGER_PORT, SPI_TRIGGER_PIN);
-	SPI_Delay(DELAY);
-	SPI_PinClear(SPI_TRIGGER_PORT, SPI_TRIGGER_PIN);
+	if(transfer->ioLines != 1)
+		SPI_ReturnToSingleSPIIOs();
 }
 
-void SPI_JEDECReset()
+static void bitbangJEDECReset(void *context)
 {
+	const SPI_BitBangContext chip = bitbangChip(context);
 	// Clear CSb
-	SPI_PinClear(SPI_CSB_PORT, SPI_CSB_PIN);
+	SPI_PinClear(chip.csbPort, chip.csbPin);
 	// Clear MOSI
 	SPI_PinClear(SPI_MOSI_PORT, SPI_MOSI_PIN);
 	SPI_Delay(DELAY);
 
 	// Set CSb
-	SPI_PinSet(SPI_CSB_PORT, SPI_CSB_PIN);
+	SPI_PinSet(chip.csbPort, chip.csbPin);
 	// Set MOSI
 	SPI_PinSet(SPI_MOSI_PORT, SPI_MOSI_PIN);
 	SPI_Delay(DELAY);
 
 	// Clear CSb
-	SPI_PinClear(SPI_CSB_PORT, SPI_CSB_PIN);
+	SPI_PinClear(chip.csbPort, chip.csbPin);
 	SPI_Delay(DELAY);
 
 	// Set CSb
-	SPI_PinSet(SPI_CSB_PORT, SPI_CSB_PIN);
+	SPI_PinSet(chip.csbPort, chip.csbPin);
 	// Clear MOSI
 	SPI_PinClear(SPI_MOSI_PORT, SPI_MOSI_PIN);
 	SPI_Delay(DELAY);
 
 	// Clear CSb
-	SPI_PinClear(SPI_CSB_PORT, SPI_CSB_PIN);
+	SPI_PinClear(chip.csbPort, chip.csbPin);
 	SPI_Delay(DELAY);
 
 	// Set CSb
-	SPI_PinSet(SPI_CSB_PORT, SPI_CSB_PIN);
+	SPI_PinSet(chip.csbPort, chip.csbPin);
 	// Set MOSI
 	SPI_PinSet(SPI_MOSI_PORT, SPI_MOSI_PIN);
 	SPI_Delay(DELAY);
 
 	// Clear CSb
-	SPI_PinClear(SPI_CSB_PORT, SPI_CSB_PIN);
+	SPI_PinClear(chip.csbPort, chip.csbPin);
 	SPI_Delay(DELAY);
 
 	// Set CSb
-	SPI_PinSet(SPI_CSB_PORT, SPI_CSB_PIN);
+	SPI_PinSet(chip.csbPort, chip.csbPin);
 	SPI_Delay(DELAY);
 }
+
+// The IOs are configured by SPI_ConfigureSingleSPIIOs() from main, so there is
+// no init operation; re-running it would glitch CSb.
+const SPI_Transport SPI_BitBangTransport =
+{
+	.name = "bit-bang",
+	.init = NULL,
+	.exchange = bitbangExchange,
+	.jedecReset = bitbangJEDECReset,
+	.start = NULL,
+	.context = NULL
+};
+
+void SPI_BitBangOpen(SPI_Transport *transport, SPI_BitBangContext *context, uint32_t csbPort, uint32_t csbPin)
+{
+	context->csbPort = csbPort;
+	context->csbPin = csbPin;
+	SPI_PinInit(csbPort, csbPin, OUTPUT);
+	SPI_PinSet(csbPort, csbPin);
+
+	*transport = SPI_BitBangTransport;
+	transport->context = context;
+}
+
+static const SPI_Transport *activeTransport = &SPI_BitBangTransport;
+
+void SPI_SetTransport(const SPI_Transport *transport)
+{
+	SPI_AsyncFlush();
+	activeTransport = (transport != NULL) ? transport : &SPI_BitBangTransport;
+	if(activeTransport->init != NULL)
+	{
+		activeTransport->init(activeTransport->context);
+	}
+}
+
+const SPI_Transport *SPI_GetTransport()
+{
+	return activeTransport;
+}
+
+void SPI_Transact(const SPI_Transfer *transfer)
+{
+	// Queued asynchronous requests go first; a continued transfer already owns the bus.
+	if(!(transfer->flags & SPI_TRANSFER_CONTINUE))
+	{
+		SPI_AsyncFlush();
+	}
+	SPI_TRACE_BEGIN(transfer, 0);
+	SPI_STATS_BEGIN(transfer);
+	activeTransport->exchange(activeTransport->context, transfer);
+	SPI_STATS_END(transfer);
+	SPI_TRACE_END(transfer);
+}
+
+void SPI_Exchange(uint8_t *txBuffer,
+				  uint32_t txNumBytes,
+				  uint8_t *rxBuffer,
+				  uint32_t rxNumBytes,
+				  uint32_t dummyNumBytes)
+{
+	SPI_Transfer transfer =
+	{
+		.txBuffer = txBuffer,
+		.txNumBytes = txNumBytes,
+		.txSingleNumBytes = txNumBytes,
+		.dummyNumBytes = dummyNumBytes,
+		.rxBuffer = rxBuffer,
+		.rxNumBytes = rxNumBytes,
+		.ioLines = 1,
+		.dummyIOLines = 1,
+		.clockHz = txNumBytes ? SPI_CommandClockHz(txBuffer[0]) : 0
+	};
+	SPI_Transact(&transfer);
+}
+
+void SPI_DualExchange(uint8_t standardSPINumBytes,
+					  uint8_t *txBuffer,
+					  uint32_t txNumBytes,
+					  uint8_t *rxBuffer,
+					  uint32_t rxNumBytes,
+					  uint32_t dummyNumBytes)
+{
+	// Dummy bytes are always sent in standard single SPI mode.
+	SPI_Transfer transfer =
+	{
+		.txBuffer = txBuffer,
+		.txNumBytes = txNumBytes,
+		.txSingleNumBytes = standardSPINumBytes,
+		.dummyNumBytes = dummyNumBytes,
+		.rxBuffer = rxBuffer,
+		.rxNumBytes = rxNumBytes,
+		.ioLines = 2,
+		.dummyIOLines = 1,
+		.clockHz = txNumBytes ? SPI_CommandClockHz(txBuffer[0]) : 0
+	};
+	SPI_Transact(&transfer);
+}
+
+void SPI_QuadExchange(uint8_t standardSPINumBytes,
+					  uint8_t *txBuffer,
+					  uint32_t txNumBytes,
+					  uint8_t *rxBuffer,
+					  uint32_t rxNumBytes,
+					  uint32_t dummyNumBytes)
+{
+	// Dummy bytes are sent in standard SPI if the whole tx phase was, and on
+	// all 4 IOs otherwise (1-4-4 and 4-4-4 transmissions).
+	SPI_Transfer transfer =
+	{
+		.txBuffer = txBuffer,
+		.txNumBytes = txNumBytes,
+		.txSingleNumBytes = standardSPINumBytes,
+		.dummyNumBytes = dummyNumBytes,
+		.rxBuffer = rxBuffer,
+		.rxNumBytes = rxNumBytes,
+		.ioLines = 4,
+		.dummyIOLines = (standardSPINumBytes < txNumBytes) ? 4 : 1,
+		.clockHz = txNumBytes ? SPI_CommandClockHz(txBuffer[0]) : 0
+	};
+	SPI_Transact(&transfer);
+}
+
+void SPI_GatherExchange(uint8_t ioLines,
+						uint8_t standardSPINumBytes,
+						uint8_t *header,
+						uint32_t headerNumBytes,
+						uint8_t *payload,
+						uint32_t payloadNumBytes)
+{
+	SPI_Transfer transfer =
+	{
+		.txBuffer = header,
+		.txNumBytes = headerNumBytes,
+		.txSingleNumBytes = standardSPINumBytes,
+		.txPayload = payload,
+		.txPayloadNumBytes = payloadNumBytes,
+		.ioLines = ioLines,
+		.dummyIOLines = 1,
+		.clockHz = headerNumBytes ? SPI_CommandClockHz(header[0]) : 0
+	};
+	SPI_Transact(&transfer);
+}
+
+void SPI_StreamOpen(SPI_Stream *stream,
+					uint8_t ioLines,
+					uint8_t standardSPINumBytes,
+					uint8_t *txBuffer,
+					uint32_t txNumBytes,
+					uint32_t dummyNumBytes)
+{
+	// Dummy bytes follow the same rules as SPI_DualExchange() and SPI_QuadExchange().
+	SPI_Transfer transfer =
+	{
+		.txBuffer = txBuffer,
+		.txNumBytes = txNumBytes,
+		.txSingleNumBytes = (ioLines == 1) ? txNumBytes : standardSPINumBytes,
+		.dummyNumBytes = dummyNumBytes,
+		.ioLines = ioLines,
+		.dummyIOLines = ((ioLines == 4) && (standardSPINumBytes < txNumBytes)) ? 4 : 1,
+		.clockHz = txNumBytes ? SPI_CommandClockHz(txBuffer[0]) : 0,
+		.flags = SPI_TRANSFER_HOLD_CS
+	};
+	SPI_Transact(&transfer);
+	stream->ioLines = ioLines;
+	stream->clockHz = transfer.clockHz;
+	stream->numBytesRead = 0;
+	stream->open = 1;
+}
+
+void SPI_StreamRead(SPI_Stream *stream, uint8_t *rxBuffer, uint32_t rxNumBytes)
+{
+	if(!stream->open)
+	{
+		printf("Error with SPI_StreamRead.\n");
+		printf("\t- The stream is not open.\n");
+		return;
+	}
+	SPI_Transfer transfer =
+	{
+		.rxBuffer = rxBuffer,
+		.rxNumBytes = rxNumBytes,
+		.ioLines = stream->ioLines,
+		.dummyIOLines = 1,
+		.clockHz = stream->clockHz,
+		.flags = SPI_TRANSFER_CONTINUE | SPI_TRANSFER_HOLD_CS
+	};
+	SPI_Transact(&transfer);
+	stream->numBytesRead += rxNumBytes;
+}
+
+void SPI_StreamClose(SPI_Stream *stream)
+{
+	if(!stream->open)
+	{
+		return;
+	}
+	SPI_Transfer transfer =
+	{
+		.ioLines = stream->ioLines,
+		.dummyIOLines = 1,
+		.clockHz = stream->clockHz,
+		.flags = SPI_TRANSFER_CONTINUE
+	};
+	SPI_Transact(&transfer);
+	stream->open = 0;
+}
+
+void SPI_DelayUs(uint32_t us)
+{
+	// Wait in steps of at most a second so the cycle count of a step never
+	// reaches the 2^32 wrap of USER_CONFIG_CycleCount().
+	while(us > 0)
+	{
+		uint32_t stepUs = (us < 1000000U) ? us : 1000000U;
+		uint32_t start = USER_CONFIG_CycleCount();
+		uint32_t cycles = (uint32_t) (((uint64_t) stepUs * USER_CONFIG_CycleCountHz()) / 1000000U);
+		while((uint32_t) (USER_CONFIG_CycleCount() - start) < cycles)
+		{
+		}
+		us -= stepUs;
+	}
+}
+
+uint32_t SPI_WaitReady(const SPI_ReadyPoll *poll, uint32_t expectedUs, uint8_t *status)
+{
+	SPI_Stream stream;
+	uint8_t header[2];
+	uint8_t sample[SPI_READY_MAX_STATUS_BYTES] = {0};
+	uint32_t numSamples = 0;
+	uint32_t intervalUs = expectedUs / 32;
+	uint32_t maxIntervalUs = (expectedUs > 0) ? expectedUs / 8 : SPI_READY_MAX_INTERVAL_US;
+	// Only the bit-bang engine, including copies made by SPI_BitBangOpen(), can
+	// look at MISO without clocking it.
+	uint8_t sampleLine = poll->sampleLine && (activeTransport->exchange == bitbangExchange);
+
+	header[0] = poll->header[0];
+	header[1] = poll->header[1];
+	SPI_StreamOpen(&stream, poll->ioLines, 0, header, poll->headerNumBytes, 0);
+	SPI_DelayUs(expectedUs / 2);
+	while(1)
+	{
+		if(sampleLine)
+			sample[poll->byteIndex] = SPI_PinRead(SPI_MISO_PORT, SPI_MISO_PIN) ? 0xFF : 0x00;
+		else
+			SPI_StreamRead(&stream, sample, poll->numBytes);
+		numSamples++;
+		if((sample[poll->byteIndex] & poll->busyMask) != poll->busyValue)
+			break;
+		SPI_DelayUs(intervalUs);
+		intervalUs = (intervalUs > 0) ? intervalUs * 2 : 1;
+		if(intervalUs > maxIntervalUs)
+			intervalUs = maxIntervalUs;
+	}
+	SPI_TRACE_BUSY(numSamples);
+	SPI_STATS_WAIT(numSamples);
+	SPI_StreamClose(&stream);
+	if(status != NULL)
+	{
+		status[0] = sample[0];
+		status[1] = sample[1];
+	}
+	return numSamples;
+}
+
+void SPI_Trigger()
+{
+	SPI_PinSet(SPI_TRIGGER_PORT, SPI_TRIGGER_PIN);
+	SPI_Delay(DELAY);
+	SPI_PinClear(SPI_TRIGGER_PORT, SPI_TRIGGER_PIN);
+}
+
+void SPI_JEDECReset()
+{
+	if(activeTransport->jedecReset != NULL)
+	{
+		activeTransport->jedecReset(activeTransport->context);
+	}
+}
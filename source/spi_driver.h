@@ -46,11 +46,16 @@
  * SPI_ConfigureSingleSPIIOs() function which should be called after
  * the pins have been set as GPIOs but before adesto layer commands
  * are run.
+ *
+ * The exchange functions are routed through the active SPI transport
+ * (see spi_transport.h). The bit-bang functions declared here form the
+ * default transport.
  */
 #ifndef SPI_DRIVER_H_
 #define SPI_DRIVER_H_
 
 #include "user_config.h"
+#include "spi_transport.h"
 
 /*!
  * @brief Base register used for CSb control.
@@ -104,12 +109,33 @@
 #define SPI_WPB_PIN USER_CONFIG_IO2_PIN
 //! Pin number for HOLDb - IO3
 #define SPI_HOLDB_PIN USER_CONFIG_IO3_PIN
-//! Half clock period delay interval
-#define DELAY 5U
 
 #define SPI 0
 #define QPI 1
 
+/*!
+ * @brief SCK limits used to pick the clock of each command. See SPI_CommandClockHz().
+ */
+typedef struct
+{
+	//! fSCK, the limit for every command not listed below, in Hz.
+	uint32_t maxHz;
+	//! Limit of the read array low frequency command (0x03) in Hz.
+	uint32_t lowFrequencyHz;
+	//! Limit of the read array low power command (0x01) in Hz. 0 if the
+	//! part has no such command, in which case 0x01 runs at maxHz.
+	uint32_t lowPowerHz;
+} SPI_ClockProfile;
+
+/*!
+ * @brief Engines available to the bit-bang transport. See SPI_SetBitBangEngine().
+ */
+enum spiBitBangEngine
+{
+	SPI_ENGINE_PIN,		//!< One pin access per IO per clock edge.
+	SPI_ENGINE_PORT		//!< One port access per clock edge through precomputed tables.
+};
+
 /*!
  * @brief Initializes a given pin as either an input or output.
  *
@@ -221,6 +247,156 @@ void SPI_QuadExchange(uint8_t standardSPINumBytes,
 					  uint32_t rxNumBytes,
 					  uint32_t dummyNumBytes);
 
+/*!
+ * @brief Transmits a command header followed by a caller owned payload within
+ * one CSb frame. The payload is clocked straight from the caller's buffer, so
+ * program commands are neither copied nor limited in size by the SPI layer.
+ *
+ * @param ioLines 1, 2 or 4. The number of IOs used for the header bytes that
+ * follow the standard SPI bytes and for the payload.
+ * @param standardSPINumBytes The number of header bytes to be sent in standard single SPI mode.
+ * @param *header A pointer to the opcode, address and mode bytes.
+ * @param headerNumBytes The number of header bytes.
+ * @param *payload A pointer to the data to be transmitted after the header.
+ * @param payloadNumBytes The number of payload bytes.
+ *
+ * @retval void
+ */
+void SPI_GatherExchange(uint8_t ioLines,
+						uint8_t standardSPINumBytes,
+						uint8_t *header,
+						uint32_t headerNumBytes,
+						uint8_t *payload,
+						uint32_t payloadNumBytes);
+
+/*!
+ * @brief A read transaction held open across calls. See SPI_StreamOpen().
+ */
+typedef struct
+{
+	//! Number of IOs the data is received on.
+	uint8_t ioLines;
+	//! SCK limit of the command that opened the stream, in Hz.
+	uint32_t clockHz;
+	//! Number of bytes read since the stream was opened.
+	uint32_t numBytesRead;
+	//! 1 while the stream holds CSb low.
+	uint8_t open;
+} SPI_Stream;
+
+/*!
+ * @brief Asserts CSb, sends a read command and its dummy bytes, and leaves CSb
+ * asserted so that the data can be clocked out incrementally with
+ * SPI_StreamRead(). The command header is paid once, however much is read.
+ *
+ * @param stream The stream to open.
+ * @param ioLines 1, 2 or 4. The number of IOs used for the data, and for the
+ * command bytes that follow the standard SPI bytes.
+ * @param standardSPINumBytes The number of command bytes to be sent in standard
+ * single SPI mode. Ignored when ioLines is 1.
+ * @param *txBuffer A pointer to the opcode, address and mode bytes.
+ * @param txNumBytes The number of command bytes.
+ * @param dummyNumBytes The number of dummy bytes, clocked as in SPI_DualExchange()
+ * and SPI_QuadExchange().
+ *
+ * @retval void
+ *
+ * @warning No other SPI layer transaction may be started until SPI_StreamClose().
+ */
+void SPI_StreamOpen(SPI_Stream *stream,
+					uint8_t ioLines,
+					uint8_t standardSPINumBytes,
+					uint8_t *txBuffer,
+					uint32_t txNumBytes,
+					uint32_t dummyNumBytes);
+
+/*!
+ * @brief Clocks the next rxNumBytes bytes of an open stream into rxBuffer.
+ *
+ * @param stream The stream, opened with SPI_StreamOpen().
+ * @param *rxBuffer A pointer to the rx byte array where received data will be stored.
+ * @param rxNumBytes The number of bytes to be received.
+ *
+ * @retval void
+ */
+void SPI_StreamRead(SPI_Stream *stream, uint8_t *rxBuffer, uint32_t rxNumBytes);
+
+/*!
+ * @brief Deasserts CSb, ending the read, and returns the IOs to standard SPI.
+ * Nothing is done if the stream is not open.
+ *
+ * @param stream The stream to close.
+ *
+ * @retval void
+ */
+void SPI_StreamClose(SPI_Stream *stream);
+
+//! Largest number of status bytes in one SPI_ReadyPoll sample.
+#define SPI_READY_MAX_STATUS_BYTES 2U
+
+//! Largest gap in microseconds between the status samples of SPI_WaitReady()
+//! when the duration of the operation is not known (expectedUs is 0).
+#ifndef SPI_READY_MAX_INTERVAL_US
+#define SPI_READY_MAX_INTERVAL_US 16U
+#endif
+
+/*!
+ * @brief Describes how SPI_WaitReady() watches a device for the end of a
+ * program or erase.
+ */
+typedef struct
+{
+	//! Command after which the device keeps reporting its status while CSb is
+	//! low: a status register read opcode, or an opcode and its argument.
+	uint8_t header[2];
+	//! Number of header bytes.
+	uint8_t headerNumBytes;
+	//! 1, or 4 for a device in QPI mode.
+	uint8_t ioLines;
+	//! Status bytes clocked per sample, at most @ref SPI_READY_MAX_STATUS_BYTES.
+	uint8_t numBytes;
+	//! Sample byte holding the busy bit.
+	uint8_t byteIndex;
+	//! The device is busy while (sample[byteIndex] & busyMask) == busyValue.
+	uint8_t busyMask;
+	//! See busyMask.
+	uint8_t busyValue;
+	//! 1 if the device drives its state on MISO without a clock after the
+	//! header. The bit-bang transport then samples the pin level (0x00 or
+	//! 0xFF) instead of clocking status bytes.
+	uint8_t sampleLine;
+} SPI_ReadyPoll;
+
+/*!
+ * @brief Busy waits for 'us' microseconds, timed with USER_CONFIG_CycleCount().
+ * Waits longer than the wrap of the counter are split into shorter steps.
+ *
+ * @param us The time to wait.
+ *
+ * @retval void
+ */
+void SPI_DelayUs(uint32_t us);
+
+/*!
+ * @brief Waits until a device finishes a program or erase. The header is
+ * sent once and CSb is held low while the status is sampled, so each sample
+ * costs only the status bytes. The first sample is taken after half of
+ * 'expectedUs'; the gaps between later samples start at 1/32 of it and
+ * double up to 1/8 of it, so short operations are caught quickly and long
+ * ones are not sampled more than needed.
+ *
+ * @param poll How to sample the status.
+ * @param expectedUs Typical duration of the operation in microseconds, for
+ * example a tPP, tBE or tCE value from cmd_defs.h. 0 when it is not known:
+ * the first sample is then taken right away and the gaps grow up to
+ * @ref SPI_READY_MAX_INTERVAL_US.
+ * @param status Receives the last sample, @ref SPI_READY_MAX_STATUS_BYTES
+ * bytes. May be NULL.
+ *
+ * @retval uint32_t The number of samples taken.
+ */
+uint32_t SPI_WaitReady(const SPI_ReadyPoll *poll, uint32_t expectedUs, uint8_t *status);
+
 /*!
  * @brief Receives a byte along MISO and returns the value received.
  *
@@ -252,7 +428,8 @@ void SPI_SendByte(uint8_t transmittedByte);
 void SPI_DualSendByte(uint8_t transmittedByte);
 
 /*!
- * @brief Toggles the clock: current_state->high->low
+ * @brief Toggles the clock: current_state->high->low, with the half clock
+ * period of the current transaction.
  *
  * @retval void
  */
@@ -359,6 +536,75 @@ void SPI_QuadSendByte(uint8_t transmittedByte);
  */
 uint8_t SPI_QuadReceiveByte();
 
+/*!
+ * @brief Selects the engine used by the bit-bang transport.
+ *
+ * SPI_ENGINE_PORT drives every clock with one clear and one set of the whole
+ * port (USER_CONFIG_PORT_SET/CLEAR) and samples the IOs with one port read,
+ * using 256-entry encode and decode tables built by SPI_ConfigureSingleSPIIOs().
+ * It requires SCK, MOSI, MISO, WPb and HOLDb to be on the same port with
+ * the 4 data IOs within 8 consecutive pins, and is selected by default when
+ * that is the case. SPI_ENGINE_PIN uses the per-pin functions in this file.
+ *
+ * @param engine SPI_ENGINE_PIN or SPI_ENGINE_PORT.
+ *
+ * @retval 1 The engine is now in use.
+ * @retval 0 The pin layout does not allow the requested engine.
+ */
+uint8_t SPI_SetBitBangEngine(enum spiBitBangEngine engine);
+
+/*!
+ * @brief Returns the engine currently used by the bit-bang transport.
+ *
+ * @retval enum spiBitBangEngine The active engine.
+ */
+enum spiBitBangEngine SPI_GetBitBangEngine();
+
+/*!
+ * @brief Replaces the SCK limits used by SPI_CommandClockHz(). The default
+ * profile is built from FSCK_MAX_HZ, FSCK_LOW_FREQUENCY_HZ and
+ * FSCK_LOW_POWER_HZ in cmd_defs.h.
+ *
+ * @param profile The new limits. They are copied.
+ *
+ * @retval void
+ */
+void SPI_SetClockProfile(const SPI_ClockProfile *profile);
+
+/*!
+ * @brief Returns the highest SCK frequency allowed for a command. The
+ * exchange functions use this to fill SPI_Transfer.clockHz from the opcode.
+ *
+ * @param opcode The first byte of the transaction.
+ *
+ * @retval uint32_t The limit in Hz.
+ */
+uint32_t SPI_CommandClockHz(uint8_t opcode);
+
+/*!
+ * @brief Measures the cost of an SPI_Delay() iteration and of a clock of each
+ * bit-bang engine with USER_CONFIG_CycleCount(). From then on the bit-bang
+ * transport derives the delay of every transaction from its clockHz, so that
+ * commands run as fast as the part allows and only slow commands are delayed.
+ * Until this has run, every clock uses @ref DELAY.
+ *
+ * Called by SPI_ConfigureSingleSPIIOs(). Should be called again if the core
+ * clock changes. SCK is toggled with CSb high during the measurement.
+ *
+ * @retval void
+ */
+void SPI_CalibrateClock();
+
+/*!
+ * @brief Estimates the SCK frequency the bit-bang transport achieves for a
+ * given limit with the active engine, based on the last calibration.
+ *
+ * @param clockHz The limit in Hz, 0 for no limit.
+ *
+ * @retval uint32_t The estimated SCK frequency in Hz, 0 if not calibrated.
+ */
+uint32_t SPI_BitBangClockHz(uint32_t clockHz);
+
 /*!
  * @brief Triggers a falling edge on the SPI_TRIGGER_PORT/PIN output.
  *
@@ -367,7 +613,8 @@ uint8_t SPI_QuadReceiveByte();
 void SPI_Trigger();
 
 /*!
- * @brief Performs a JEDEC reset on the SPI device.
+ * @brief Performs a JEDEC reset on the SPI device through the active transport.
+ * Nothing is done if the transport cannot drive a JEDEC reset.
  *
  * @retval void
  *
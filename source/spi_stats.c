@@ -0,0 +1,243 @@
+/*
+ * The Clear BSD License
+ * Copyright (c) 2018 Adesto Technologies Corporation, Inc
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted (subject to the limitations in the disclaimer below) provided
+ *  that the following conditions are met:
+ *
+ * o Redistributions of source code must retain the above copyright notice, this list
+ *   of conditions and the following disclaimer.
+ *
+ * o Redistributions in binary form must reproduce the above copyright notice, this
+ *   list of conditions and the following disclaimer in the documentation and/or
+ *   other materials provided with the distribution.
+ *
+ * o Neither the name of the copyright holder nor the names of its
+ *   contributors may be used to endorse or promote products derived from this
+ *   software without specific prior written permission.
+ *
+ * NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE GRANTED BY THIS LICENSE.
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*!
+ * @ingroup SPI_LAYER
+ */
+/**
+ * @file    spi_stats.c
+ * @brief   Definitions of the per-opcode SPI performance counters.
+ */
+#include "spi_stats.h"
+#include <stdio.h>
+#include <string.h>
+
+#if (SPI_STATS_ENABLE == 1)
+
+static SPI_OpcodeStats table[SPI_STATS_OPCODES];
+// Index + 1 of each opcode's entry in table, 0 if it has none.
+static uint8_t entryOf[256];
+static uint32_t numOpcodes = 0;
+static uint32_t unattributedFrames = 0;
+
+// The frame in progress.
+static uint8_t frameOpen = 0;
+static uint8_t frameWait = 0;
+static uint8_t frameOpcode;
+static uint8_t frameHasOpcode;
+static uint32_t frameStart;
+static uint32_t frameSamples;
+static uint32_t frameNumBytes;
+
+// Entry of the last counted frame, which is charged for the busy waits that
+// follow it. Its latency enters the histogram once the next frame starts.
+static SPI_OpcodeStats *lastEntry = NULL;
+static uint64_t lastLatency = 0;
+
+static uint32_t bucketOf(uint64_t cycles)
+{
+	uint32_t hz = USER_CONFIG_CycleCountHz();
+	uint64_t us = (hz > 0) ? (cycles * 1000000U) / hz : 0;
+	uint32_t bucket = 0;
+	while((us > 0) && (bucket < SPI_STATS_BUCKETS - 1))
+	{
+		us >>= 1;
+		bucket++;
+	}
+	return bucket;
+}
+
+static void closeLatency()
+{
+	if(lastEntry != NULL)
+	{
+		lastEntry->histogram[bucketOf(lastLatency)]++;
+		lastEntry = NULL;
+	}
+}
+
+static SPI_OpcodeStats *entry(uint8_t opcode)
+{
+	if(entryOf[opcode] != 0)
+	{
+		return &table[entryOf[opcode] - 1];
+	}
+	if(numOpcodes == SPI_STATS_OPCODES)
+	{
+		return NULL;
+	}
+	memset(&table[numOpcodes], 0, sizeof(SPI_OpcodeStats));
+	table[numOpcodes].opcode = opcode;
+	numOpcodes++;
+	entryOf[opcode] = (uint8_t) numOpcodes;
+	return &table[numOpcodes - 1];
+}
+
+void SPI_StatsBegin(const SPI_Transfer *transfer)
+{
+	if(!(transfer->flags & SPI_TRANSFER_CONTINUE))
+	{
+		frameOpen = 1;
+		frameWait = 0;
+		frameSamples = 0;
+		frameNumBytes = 0;
+		frameHasOpcode = (transfer->txNumBytes > 0) ? 1 : 0;
+		frameOpcode = frameHasOpcode ? transfer->txBuffer[0] : 0;
+		frameStart = USER_CONFIG_CycleCount();
+	}
+	else if(!frameOpen)
+	{
+		return;
+	}
+	frameNumBytes += transfer->txPayloadNumBytes + transfer->rxNumBytes;
+}
+
+void SPI_StatsWait(uint32_t samples)
+{
+	frameWait = 1;
+	frameSamples = samples;
+}
+
+void SPI_StatsEnd(const SPI_Transfer *transfer)
+{
+	SPI_OpcodeStats *stats;
+	uint32_t cycles;
+	if(!frameOpen || (transfer->flags & SPI_TRANSFER_HOLD_CS))
+	{
+		return;
+	}
+	cycles = USER_CONFIG_CycleCount() - frameStart;
+	frameOpen = 0;
+
+	if(frameWait)
+	{
+		if(lastEntry == NULL)
+		{
+			unattributedFrames++;
+			return;
+		}
+		lastEntry->busyCycles += cycles;
+		lastEntry->polls += frameSamples;
+		lastLatency += cycles;
+		return;
+	}
+
+	closeLatency();
+	stats = frameHasOpcode ? entry(frameOpcode) : NULL;
+	if(stats == NULL)
+	{
+		unattributedFrames++;
+		return;
+	}
+	stats->count++;
+	stats->numBytes += frameNumBytes;
+	stats->busCycles += cycles;
+	lastEntry = stats;
+	lastLatency = cycles;
+}
+
+void SPI_StatsSnapshot(SPI_Stats *stats)
+{
+	closeLatency();
+	stats->cycleHz = USER_CONFIG_CycleCountHz();
+	stats->numOpcodes = numOpcodes;
+	stats->unattributedFrames = unattributedFrames;
+	memcpy(stats->opcodes, table, numOpcodes * sizeof(SPI_OpcodeStats));
+}
+
+void SPI_StatsReset()
+{
+	memset(entryOf, 0, sizeof(entryOf));
+	numOpcodes = 0;
+	unattributedFrames = 0;
+	lastEntry = NULL;
+}
+
+#else
+
+void SPI_StatsSnapshot(SPI_Stats *stats)
+{
+	memset(stats, 0, sizeof(SPI_Stats));
+}
+
+void SPI_StatsReset()
+{
+}
+
+#endif
+
+const SPI_OpcodeStats *SPI_StatsFind(const SPI_Stats *stats, uint8_t opcode)
+{
+	uint32_t i;
+	for(i = 0; i < stats->numOpcodes; i++)
+	{
+		if(stats->opcodes[i].opcode == opcode)
+		{
+			return &stats->opcodes[i];
+		}
+	}
+	return NULL;
+}
+
+static void printMicroseconds(uint64_t cycles, uint32_t cycleHz)
+{
+	uint64_t us = (cycleHz > 0) ? (cycles / cycleHz) * 1000000U + ((cycles % cycleHz) * 1000000U) / cycleHz : 0;
+	printf(",%lu", (unsigned long) us);
+}
+
+void SPI_StatsPrint(const SPI_Stats *stats)
+{
+	uint32_t i;
+	uint32_t j;
+	printf("opcode,count,bytes,bus_us,busy_us,polls");
+	for(j = 0; j < SPI_STATS_BUCKETS - 1; j++)
+	{
+		printf(",lt_%luus", (unsigned long) (1UL << j));
+	}
+	printf(",more\n");
+	for(i = 0; i < stats->numOpcodes; i++)
+	{
+		const SPI_OpcodeStats *opcode = &stats->opcodes[i];
+		printf("0x%02X,%lu,%lu", opcode->opcode, (unsigned long) opcode->count,
+			   (unsigned long) opcode->numBytes);
+		printMicroseconds(opcode->busCycles, stats->cycleHz);
+		printMicroseconds(opcode->busyCycles, stats->cycleHz);
+		printf(",%lu", (unsigned long) opcode->polls);
+		for(j = 0; j < SPI_STATS_BUCKETS; j++)
+		{
+			printf(",%lu", (unsigned long) opcode->histogram[j]);
+		}
+		printf("\n");
+	}
+	printf("unattributed,%lu\n", (unsigned long) stats->unattributedFrames);
+}
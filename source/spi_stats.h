@@ -0,0 +1,191 @@
+/*
+ * The Clear BSD License
+ * Copyright (c) 2018 Adesto Technologies Corporation, Inc
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted (subject to the limitations in the disclaimer below) provided
+ *  that the following conditions are met:
+ *
+ * o Redistributions of source code must retain the above copyright notice, this list
+ *   of conditions and the following disclaimer.
+ *
+ * o Redistributions in binary form must reproduce the above copyright notice, this
+ *   list of conditions and the following disclaimer in the documentation and/or
+ *   other materials provided with the distribution.
+ *
+ * o Neither the name of the copyright holder nor the names of its
+ *   contributors may be used to endorse or promote products derived from this
+ *   software without specific prior written permission.
+ *
+ * NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE GRANTED BY THIS LICENSE.
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*!
+ * @ingroup SPI_LAYER
+ */
+/**
+ * @file    spi_stats.h
+ * @brief   Declarations of the per-opcode SPI performance counters.
+ *
+ * Every CSb frame carried by the SPI layer is counted against its opcode,
+ * so the counters cover all Adesto layer drivers without code in each
+ * of them. For every opcode seen, up to @ref SPI_STATS_OPCODES of them,
+ * the counters hold the number of frames, the data bytes moved, the time
+ * CSb was held low, the busy time and status samples of the
+ * SPI_WaitReady() calls that followed the frame, and a histogram of the
+ * frame latency (bus time plus the following busy time).
+ *
+ * The counters run from reset. SPI_StatsSnapshot() copies them out and
+ * SPI_StatsReset() clears them. Building with SPI_STATS_ENABLE set to 0
+ * removes the hooks from the SPI layer and the counters from RAM.
+ */
+#ifndef SPI_STATS_H_
+#define SPI_STATS_H_
+
+#include "user_config.h"
+#include "spi_transport.h"
+
+//! 1 to count frames, 0 to compile the counters out.
+#ifndef SPI_STATS_ENABLE
+#define SPI_STATS_ENABLE 1
+#endif
+
+//! Number of distinct opcodes counted. Frames with further opcodes are only
+//! counted in SPI_Stats.unattributedFrames.
+#ifndef SPI_STATS_OPCODES
+#define SPI_STATS_OPCODES 24U
+#endif
+
+//! Number of latency histogram buckets. Bucket 0 counts latencies under 1 us,
+//! bucket i those in [2^(i-1), 2^i) us and the last one everything above.
+#ifndef SPI_STATS_BUCKETS
+#define SPI_STATS_BUCKETS 24U
+#endif
+
+/*!
+ * @brief Counters of one opcode.
+ */
+typedef struct
+{
+	//! The opcode.
+	uint8_t opcode;
+	//! Number of frames.
+	uint32_t count;
+	//! Payload bytes sent after the command header plus bytes received.
+	uint64_t numBytes;
+	//! Cycles CSb was held low, in USER_CONFIG_CycleCount() cycles.
+	uint64_t busCycles;
+	//! Cycles spent in SPI_WaitReady() after frames of this opcode.
+	uint64_t busyCycles;
+	//! Status samples taken by those SPI_WaitReady() calls.
+	uint32_t polls;
+	//! Latency histogram, see @ref SPI_STATS_BUCKETS.
+	uint32_t histogram[SPI_STATS_BUCKETS];
+} SPI_OpcodeStats;
+
+/*!
+ * @brief A copy of all counters, see SPI_StatsSnapshot().
+ */
+typedef struct
+{
+	//! USER_CONFIG_CycleCountHz() when the snapshot was taken.
+	uint32_t cycleHz;
+	//! Number of valid entries in opcodes, in order of first use.
+	uint32_t numOpcodes;
+	//! Frames not counted because the table was full or no opcode was sent.
+	uint32_t unattributedFrames;
+	//! The counters.
+	SPI_OpcodeStats opcodes[SPI_STATS_OPCODES];
+} SPI_Stats;
+
+/*!
+ * @brief Copies the counters. The latency of the last frame is completed
+ * first, so a frame whose busy wait is still to come is counted without it.
+ *
+ * @param stats Receives the counters. All zero if SPI_STATS_ENABLE is 0.
+ *
+ * @retval void
+ */
+void SPI_StatsSnapshot(SPI_Stats *stats);
+
+/*!
+ * @brief Clears every counter.
+ *
+ * @retval void
+ */
+void SPI_StatsReset();
+
+/*!
+ * @brief Finds the counters of an opcode in a snapshot.
+ *
+ * @param stats The snapshot.
+ * @param opcode The opcode.
+ *
+ * @retval const SPI_OpcodeStats* The counters, NULL if the opcode was not seen.
+ */
+const SPI_OpcodeStats *SPI_StatsFind(const SPI_Stats *stats, uint8_t opcode);
+
+/*!
+ * @brief Prints a snapshot as comma separated values, one line per opcode:
+ * opcode, count, bytes, bus time, busy time, polls and the histogram
+ * buckets. Times are in microseconds.
+ *
+ * @param stats The snapshot.
+ *
+ * @retval void
+ */
+void SPI_StatsPrint(const SPI_Stats *stats);
+
+#if (SPI_STATS_ENABLE == 1)
+/*!
+ * @brief Called by the SPI layer before a transfer is handed to the transport.
+ *
+ * @param transfer The transfer.
+ *
+ * @retval void
+ */
+void SPI_StatsBegin(const SPI_Transfer *transfer);
+
+/*!
+ * @brief Called by the SPI layer after a transfer completes.
+ *
+ * @param transfer The transfer.
+ *
+ * @retval void
+ */
+void SPI_StatsEnd(const SPI_Transfer *transfer);
+
+/*!
+ * @brief Called by SPI_WaitReady() before it closes its frame. The frame is
+ * then counted as busy time of the frame before it.
+ *
+ * @param samples The number of status samples taken.
+ *
+ * @retval void
+ */
+void SPI_StatsWait(uint32_t samples);
+
+//! Hook of SPI_StatsBegin(), empty when SPI_STATS_ENABLE is 0.
+#define SPI_STATS_BEGIN(transfer) SPI_StatsBegin(transfer)
+//! Hook of SPI_StatsEnd(), empty when SPI_STATS_ENABLE is 0.
+#define SPI_STATS_END(transfer) SPI_StatsEnd(transfer)
+//! Hook of SPI_StatsWait(), empty when SPI_STATS_ENABLE is 0.
+#define SPI_STATS_WAIT(samples) SPI_StatsWait(samples)
+#else
+#define SPI_STATS_BEGIN(transfer) ((void) 0)
+#define SPI_STATS_END(transfer) ((void) 0)
+#define SPI_STATS_WAIT(samples) ((void) 0)
+#endif
+
+#endif /* SPI_STATS_H_ */
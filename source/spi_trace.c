@@ -0,0 +1,455 @@
+/*
+ * The Clear BSD License
+ * Copyright (c) 2018 Adesto Technologies Corporation, Inc
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted (subject to the limitations in the disclaimer below) provided
+ *  that the following conditions are met:
+ *
+ * o Redistributions of source code must retain the above copyright notice, this list
+ *   of conditions and the following disclaimer.
+ *
+ * o Redistributions in binary form must reproduce the above copyright notice, this
+ *   list of conditions and the following disclaimer in the documentation and/or
+ *   other materials provided with the distribution.
+ *
+ * o Neither the name of the copyright holder nor the names of its
+ *   contributors may be used to endorse or promote products derived from this
+ *   software without specific prior written permission.
+ *
+ * NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE GRANTED BY THIS LICENSE.
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*!
+ * @ingroup SPI_LAYER
+ */
+/**
+ * @file    spi_trace.c
+ * @brief   Definitions of the SPI transaction tracer.
+ */
+#include "spi_trace.h"
+#include <stdio.h>
+
+#define SPI_TRACE_VERSION 1U
+
+// State of the decoder between records.
+typedef struct
+{
+	enum spiTraceFormat format;
+	uint32_t cycleHz;
+	uint32_t previousStart;
+	uint64_t time;
+	uint32_t numRecords;
+} traceDecoder;
+
+#if (SPI_TRACE_ENABLE == 1)
+
+static SPI_TraceRecord ring[SPI_TRACE_RECORDS];
+// Records stored since the last clear; the newest is at (written - 1).
+static uint32_t written = 0;
+static uint8_t enabled = 0;
+// The frame in progress, valid while 'recording' is set.
+static SPI_TraceRecord current;
+static uint8_t recording = 0;
+
+static uint8_t saturate8(uint32_t value)
+{
+	return (value > 0xFF) ? 0xFF : (uint8_t) value;
+}
+
+void SPI_TraceEnable(uint8_t enable)
+{
+	enabled = enable ? 1 : 0;
+	recording = 0;
+}
+
+void SPI_TraceClear()
+{
+	written = 0;
+	recording = 0;
+}
+
+uint32_t SPI_TraceCount()
+{
+	return (written < SPI_TRACE_RECORDS) ? written : SPI_TRACE_RECORDS;
+}
+
+uint32_t SPI_TraceLost()
+{
+	return written - SPI_TraceCount();
+}
+
+uint8_t SPI_TraceGet(uint32_t index, SPI_TraceRecord *record)
+{
+	if(index >= SPI_TraceCount())
+	{
+		return 0;
+	}
+	*record = ring[(written - SPI_TraceCount() + index) & (SPI_TRACE_RECORDS - 1)];
+	return 1;
+}
+
+void SPI_TraceBegin(const SPI_Transfer *transfer, uint8_t flags)
+{
+	uint32_t i;
+	if(!enabled)
+	{
+		return;
+	}
+	if(!(transfer->flags & SPI_TRANSFER_CONTINUE))
+	{
+		current.start = USER_CONFIG_CycleCount();
+		current.duration = 0;
+		current.address = 0;
+		current.txNumBytes = 0;
+		current.rxNumBytes = 0;
+		current.samples = 0;
+		current.dummyNumBytes = 0;
+		current.opcode = 0;
+		current.addressNumBytes = 0;
+		current.singleNumBytes = 0;
+		current.ioLines = transfer->ioLines;
+		current.flags = 0;
+		if(transfer->txNumBytes > 0)
+		{
+			current.opcode = transfer->txBuffer[0];
+			for(i = 1; (i < transfer->txNumBytes) && (i <= 4); i++)
+			{
+				current.address = (current.address << 8) | transfer->txBuffer[i];
+				current.addressNumBytes++;
+			}
+		}
+		else
+		{
+			current.flags |= SPI_TRACE_NO_OPCODE;
+		}
+		recording = 1;
+	}
+	else if(!recording)
+	{
+		// The frame started before recording was enabled.
+		return;
+	}
+	current.txNumBytes += transfer->txNumBytes + transfer->txPayloadNumBytes;
+	current.rxNumBytes += transfer->rxNumBytes;
+	current.dummyNumBytes = saturate8(current.dummyNumBytes + transfer->dummyNumBytes);
+	current.singleNumBytes = saturate8(current.singleNumBytes + transfer->txSingleNumBytes);
+	current.flags |= flags;
+}
+
+void SPI_TraceEnd(const SPI_Transfer *transfer)
+{
+	if(!recording || (transfer->flags & SPI_TRANSFER_HOLD_CS))
+	{
+		return;
+	}
+	current.duration = USER_CONFIG_CycleCount() - current.start;
+	ring[written & (SPI_TRACE_RECORDS - 1)] = current;
+	written++;
+	recording = 0;
+}
+
+void SPI_TraceWait(uint32_t samples)
+{
+	if(!recording)
+	{
+		return;
+	}
+	current.flags |= SPI_TRACE_WAIT;
+	current.samples = (samples > 0xFFFF) ? 0xFFFF : (uint16_t) samples;
+}
+
+#else
+
+void SPI_TraceEnable(uint8_t enable)
+{
+	(void) enable;
+}
+
+void SPI_TraceClear()
+{
+}
+
+uint32_t SPI_TraceCount()
+{
+	return 0;
+}
+
+uint32_t SPI_TraceLost()
+{
+	return 0;
+}
+
+uint8_t SPI_TraceGet(uint32_t index, SPI_TraceRecord *record)
+{
+	(void) index;
+	(void) record;
+	return 0;
+}
+
+#endif
+
+static void put32(uint8_t *buffer, uint32_t value)
+{
+	buffer[0] = (uint8_t) value;
+	buffer[1] = (uint8_t) (value >> 8);
+	buffer[2] = (uint8_t) (value >> 16);
+	buffer[3] = (uint8_t) (value >> 24);
+}
+
+static uint32_t get32(const uint8_t *buffer)
+{
+	return (uint32_t) buffer[0] | ((uint32_t) buffer[1] << 8) |
+		   ((uint32_t) buffer[2] << 16) | ((uint32_t) buffer[3] << 24);
+}
+
+static void packRecord(const SPI_TraceRecord *record, uint8_t *buffer)
+{
+	put32(&buffer[0], record->start);
+	put32(&buffer[4], record->duration);
+	put32(&buffer[8], record->address);
+	put32(&buffer[12], record->txNumBytes);
+	put32(&buffer[16], record->rxNumBytes);
+	buffer[20] = (uint8_t) record->samples;
+	buffer[21] = (uint8_t) (record->samples >> 8);
+	buffer[22] = record->dummyNumBytes;
+	buffer[23] = record->opcode;
+	buffer[24] = record->addressNumBytes;
+	buffer[25] = record->singleNumBytes;
+	buffer[26] = record->ioLines;
+	buffer[27] = record->flags;
+}
+
+static void unpackRecord(const uint8_t *buffer, SPI_TraceRecord *record)
+{
+	record->start = get32(&buffer[0]);
+	record->duration = get32(&buffer[4]);
+	record->address = get32(&buffer[8]);
+	record->txNumBytes = get32(&buffer[12]);
+	record->rxNumBytes = get32(&buffer[16]);
+	record->samples = (uint16_t) (buffer[20] | (buffer[21] << 8));
+	record->dummyNumBytes = buffer[22];
+	record->opcode = buffer[23];
+	record->addressNumBytes = buffer[24];
+	record->singleNumBytes = buffer[25];
+	record->ioLines = buffer[26];
+	record->flags = buffer[27];
+}
+
+uint32_t SPI_TraceDump(uint8_t *buffer, uint32_t bufferNumBytes)
+{
+	uint32_t count = SPI_TraceCount();
+	uint32_t skip = 0;
+	uint32_t i;
+	SPI_TraceRecord record;
+	if(bufferNumBytes < SPI_TRACE_DUMP_HEADER_BYTES)
+	{
+		return 0;
+	}
+	// Keep the newest records if they do not all fit.
+	if(SPI_TRACE_DUMP_BYTES(count) > bufferNumBytes)
+	{
+		skip = count - (bufferNumBytes - SPI_TRACE_DUMP_HEADER_BYTES) / SPI_TRACE_DUMP_RECORD_BYTES;
+	}
+	buffer[0] = 'S';
+	buffer[1] = 'P';
+	buffer[2] = 'I';
+	buffer[3] = 'T';
+	buffer[4] = SPI_TRACE_VERSION;
+	buffer[5] = SPI_TRACE_DUMP_RECORD_BYTES;
+	buffer[6] = 0;
+	buffer[7] = 0;
+	put32(&buffer[8], USER_CONFIG_CycleCountHz());
+	for(i = skip; i < count; i++)
+	{
+		if(!SPI_TraceGet(i, &record))
+		{
+			break;
+		}
+		packRecord(&record, &buffer[SPI_TRACE_DUMP_BYTES(i - skip)]);
+	}
+	put32(&buffer[12], i - skip);
+	put32(&buffer[16], SPI_TraceLost() + skip);
+	return SPI_TRACE_DUMP_BYTES(i - skip);
+}
+
+// Prints cycles as microseconds with 3 decimals.
+static void printMicroseconds(uint64_t cycles, uint32_t cycleHz)
+{
+	uint64_t ns = (cycles / cycleHz) * 1000000000ULL + ((cycles % cycleHz) * 1000000000ULL) / cycleHz;
+	printf("%lu.%03lu", (unsigned long) (ns / 1000), (unsigned long) (ns % 1000));
+}
+
+// Writes the IO mode of the command, address and data phases, e.g. "1-4-4".
+static void formatMode(const SPI_TraceRecord *record, char *mode)
+{
+	uint8_t commandLines = (record->singleNumBytes >= 1) ? 1 : record->ioLines;
+	uint8_t addressLines = (record->singleNumBytes >= 1 + record->addressNumBytes) ? 1 : record->ioLines;
+	mode[0] = (char) ('0' + commandLines);
+	mode[1] = '-';
+	mode[2] = (char) ('0' + addressLines);
+	mode[3] = '-';
+	mode[4] = (char) ('0' + record->ioLines);
+	mode[5] = '\0';
+}
+
+static void decodeBegin(traceDecoder *decoder, uint32_t numRecords, uint32_t lost)
+{
+	decoder->numRecords = 0;
+	decoder->time = 0;
+	if(decoder->format == SPI_TRACE_TEXT)
+	{
+		printf("SPI trace, %lu records, %lu lost, %lu Hz\n", (unsigned long) numRecords,
+			   (unsigned long) lost, (unsigned long) decoder->cycleHz);
+		printf("start us, CSb low us, mode, opcode, address, tx, dummy, rx\n");
+	}
+	else
+	{
+		printf("{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n");
+		printf("{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":1,\"args\":{\"name\":\"SPI frames\"}},\n");
+		printf("{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":2,\"args\":{\"name\":\"Busy waits\"}}");
+	}
+}
+
+static void decodeRecord(traceDecoder *decoder, const SPI_TraceRecord *record)
+{
+	char mode[6];
+	// Start times are 32-bit counts; frames are assumed to be less than a wrap apart.
+	if(decoder->numRecords > 0)
+	{
+		decoder->time += (uint32_t) (record->start - decoder->previousStart);
+	}
+	decoder->previousStart = record->start;
+	decoder->numRecords++;
+	formatMode(record, mode);
+
+	if(decoder->format == SPI_TRACE_TEXT)
+	{
+		printMicroseconds(decoder->time, decoder->cycleHz);
+		printf(", ");
+		printMicroseconds(record->duration, decoder->cycleHz);
+		if(record->flags & SPI_TRACE_NO_OPCODE)
+			printf(", %s, --", mode);
+		else
+			printf(", %s, 0x%02X", mode, record->opcode);
+		if(record->addressNumBytes > 0)
+			printf(", 0x%0*lX", record->addressNumBytes * 2, (unsigned long) record->address);
+		else
+			printf(", --");
+		printf(", %lu, %u, %lu", (unsigned long) record->txNumBytes, record->dummyNumBytes,
+			   (unsigned long) record->rxNumBytes);
+		if(record->flags & SPI_TRACE_WAIT)
+			printf(", busy wait, %u samples", record->samples);
+		if(record->flags & SPI_TRACE_ASYNC)
+			printf(", async");
+		printf("\n");
+	}
+	else
+	{
+		printf(",\n{\"name\":\"");
+		if(record->flags & SPI_TRACE_WAIT)
+			printf("busy ");
+		if(record->flags & SPI_TRACE_NO_OPCODE)
+			printf("frame");
+		else
+			printf("0x%02X", record->opcode);
+		printf("\",\"cat\":\"spi\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":",
+			   (record->flags & SPI_TRACE_WAIT) ? 2 : 1);
+		printMicroseconds(decoder->time, decoder->cycleHz);
+		printf(",\"dur\":");
+		printMicroseconds(record->duration, decoder->cycleHz);
+		printf(",\"args\":{\"mode\":\"%s\"", mode);
+		if(record->addressNumBytes > 0)
+			printf(",\"address\":\"0x%0*lX\"", record->addressNumBytes * 2, (unsigned long) record->address);
+		printf(",\"tx\":%lu,\"dummy\":%u,\"rx\":%lu", (unsigned long) record->txNumBytes,
+			   record->dummyNumBytes, (unsigned long) record->rxNumBytes);
+		if(record->flags & SPI_TRACE_WAIT)
+			printf(",\"samples\":%u", record->samples);
+		if(record->flags & SPI_TRACE_ASYNC)
+			printf(",\"async\":1");
+		printf("}}");
+	}
+}
+
+static void decodeEnd(traceDecoder *decoder)
+{
+	if(decoder->format == SPI_TRACE_CHROME)
+	{
+		printf("\n]}\n");
+	}
+}
+
+uint32_t SPI_TraceDecode(const uint8_t *image, uint32_t imageNumBytes, enum spiTraceFormat format)
+{
+	traceDecoder decoder;
+	SPI_TraceRecord record;
+	uint32_t recordNumBytes;
+	uint32_t numRecords;
+	uint32_t i;
+	if((imageNumBytes < SPI_TRACE_DUMP_HEADER_BYTES) ||
+	   (image[0] != 'S') || (image[1] != 'P') || (image[2] != 'I') || (image[3] != 'T') ||
+	   (image[4] != SPI_TRACE_VERSION) || (image[5] < SPI_TRACE_DUMP_RECORD_BYTES))
+	{
+		printf("Error with SPI_TraceDecode.\n");
+		printf("\t- Not an SPI trace image.\n");
+		return 0;
+	}
+	recordNumBytes = image[5];
+	numRecords = get32(&image[12]);
+	if(numRecords > (imageNumBytes - SPI_TRACE_DUMP_HEADER_BYTES) / recordNumBytes)
+	{
+		printf("Error with SPI_TraceDecode.\n");
+		printf("\t- The image is truncated.\n");
+		return 0;
+	}
+	decoder.format = format;
+	decoder.cycleHz = get32(&image[8]);
+	if(decoder.cycleHz == 0)
+	{
+		decoder.cycleHz = 1;
+	}
+	decodeBegin(&decoder, numRecords, get32(&image[16]));
+	for(i = 0; i < numRecords; i++)
+	{
+		unpackRecord(&image[SPI_TRACE_DUMP_HEADER_BYTES + i * recordNumBytes], &record);
+		decodeRecord(&decoder, &record);
+	}
+	decodeEnd(&decoder);
+	return numRecords;
+}
+
+uint32_t SPI_TracePrint(enum spiTraceFormat format)
+{
+	traceDecoder decoder;
+	SPI_TraceRecord record;
+	uint32_t count = SPI_TraceCount();
+	uint32_t i;
+	decoder.format = format;
+	decoder.cycleHz = USER_CONFIG_CycleCountHz();
+	if(decoder.cycleHz == 0)
+	{
+		decoder.cycleHz = 1;
+	}
+	decodeBegin(&decoder, count, SPI_TraceLost());
+	for(i = 0; i < count; i++)
+	{
+		if(!SPI_TraceGet(i, &record))
+		{
+			break;
+		}
+		decodeRecord(&decoder, &record);
+	}
+	decodeEnd(&decoder);
+	return i;
+}
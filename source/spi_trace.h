@@ -0,0 +1,252 @@
+/*
+ * The Clear BSD License
+ * Copyright (c) 2018 Adesto Technologies Corporation, Inc
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted (subject to the limitations in the disclaimer below) provided
+ *  that the following conditions are met:
+ *
+ * o Redistributions of source code must retain the above copyright notice, this list
+ *   of conditions and the following disclaimer.
+ *
+ * o Redistributions in binary form must reproduce the above copyright notice, this
+ *   list of conditions and the following disclaimer in the documentation and/or
+ *   other materials provided with the distribution.
+ *
+ * o Neither the name of the copyright holder nor the names of its
+ *   contributors may be used to endorse or promote products derived from this
+ *   software without specific prior written permission.
+ *
+ * NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE GRANTED BY THIS LICENSE.
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*!
+ * @ingroup SPI_LAYER
+ */
+/**
+ * @file    spi_trace.h
+ * @brief   Declarations of the SPI transaction tracer.
+ *
+ * The tracer records one fixed-size binary record per CSb frame into a
+ * ring buffer: the opcode, the bytes after it, the byte counts of each
+ * phase, the IO mode, the time CSb was held low and, for the frames of
+ * SPI_WaitReady(), the number of status samples. Recording costs a few
+ * stores per transaction, so it can be left running on the target.
+ *
+ * SPI_TraceDump() copies the ring into a portable byte image that can be
+ * read out with a debugger or written to a file. SPI_TraceDecode() turns
+ * such an image back into a readable log or a Chrome trace JSON timeline
+ * (chrome://tracing, ui.perfetto.dev). The decoder only uses the image and
+ * printf(), so it can equally run on the target or in a host program.
+ * Building with SPI_TRACE_ENABLE set to 0 removes the hooks from the SPI
+ * layer and the ring from RAM.
+ */
+#ifndef SPI_TRACE_H_
+#define SPI_TRACE_H_
+
+#include "user_config.h"
+#include "spi_transport.h"
+
+//! Set to 0 to remove the tracer hooks from the SPI layer and the ring from RAM.
+#ifndef SPI_TRACE_ENABLE
+#define SPI_TRACE_ENABLE 1
+#endif
+
+//! Number of records kept by the ring buffer. Must be a power of 2.
+#ifndef SPI_TRACE_RECORDS
+#define SPI_TRACE_RECORDS 256U
+#endif
+
+#if (SPI_TRACE_RECORDS & (SPI_TRACE_RECORDS - 1)) != 0
+#error "SPI_TRACE_RECORDS must be a power of 2."
+#endif
+
+//! Size of the image header written by SPI_TraceDump().
+#define SPI_TRACE_DUMP_HEADER_BYTES 20U
+//! Size of each record in the image written by SPI_TraceDump().
+#define SPI_TRACE_DUMP_RECORD_BYTES 28U
+//! Size of an image holding numRecords records.
+#define SPI_TRACE_DUMP_BYTES(numRecords) \
+	(SPI_TRACE_DUMP_HEADER_BYTES + (numRecords) * SPI_TRACE_DUMP_RECORD_BYTES)
+
+//! SPI_TraceRecord.flags: the frame is the status poll of SPI_WaitReady().
+#define SPI_TRACE_WAIT		(1U << 0)
+//! SPI_TraceRecord.flags: the frame was run by the asynchronous request queue.
+#define SPI_TRACE_ASYNC		(1U << 1)
+//! SPI_TraceRecord.flags: the frame sent no command byte.
+#define SPI_TRACE_NO_OPCODE	(1U << 2)
+
+/*!
+ * @brief One CSb frame, from the falling to the rising edge of CSb.
+ */
+typedef struct
+{
+	//! USER_CONFIG_CycleCount() when the frame started.
+	uint32_t start;
+	//! Cycles CSb was held low. For a SPI_TRACE_WAIT frame this is the busy time.
+	uint32_t duration;
+	//! Up to 4 bytes sent after the opcode (address, then mode bits), first byte
+	//! most significant.
+	uint32_t address;
+	//! Command and payload bytes sent, including the opcode.
+	uint32_t txNumBytes;
+	//! Bytes received.
+	uint32_t rxNumBytes;
+	//! Status samples taken by SPI_WaitReady(), 0 for other frames.
+	uint16_t samples;
+	//! Dummy bytes clocked, saturated at 255.
+	uint8_t dummyNumBytes;
+	//! First byte sent.
+	uint8_t opcode;
+	//! Number of bytes held in address.
+	uint8_t addressNumBytes;
+	//! Leading bytes sent on MOSI alone, saturated at 255.
+	uint8_t singleNumBytes;
+	//! IOs (1, 2 or 4) used for the remaining bytes.
+	uint8_t ioLines;
+	//! SPI_TRACE_WAIT, SPI_TRACE_ASYNC and SPI_TRACE_NO_OPCODE.
+	uint8_t flags;
+} SPI_TraceRecord;
+
+/*!
+ * @brief Output formats of SPI_TraceDecode().
+ */
+enum spiTraceFormat
+{
+	SPI_TRACE_TEXT,		//!< One line per frame.
+	SPI_TRACE_CHROME	//!< Chrome trace event JSON.
+};
+
+/*!
+ * @brief Starts or stops recording. Recording is off after reset.
+ *
+ * @param enable 1 to record every following frame, 0 to stop.
+ *
+ * @retval void
+ */
+void SPI_TraceEnable(uint8_t enable);
+
+/*!
+ * @brief Discards every record and clears the overwritten count.
+ *
+ * @retval void
+ */
+void SPI_TraceClear();
+
+/*!
+ * @brief Returns the number of records held, at most @ref SPI_TRACE_RECORDS.
+ *
+ * @retval uint32_t The number of records.
+ */
+uint32_t SPI_TraceCount();
+
+/*!
+ * @brief Returns the number of records overwritten because the ring was full.
+ *
+ * @retval uint32_t The number of lost records.
+ */
+uint32_t SPI_TraceLost();
+
+/*!
+ * @brief Copies a record out of the ring.
+ *
+ * @param index 0 for the oldest record, SPI_TraceCount() - 1 for the newest.
+ * @param record Receives the record.
+ *
+ * @retval 1 The record was copied.
+ * @retval 0 index is out of range.
+ */
+uint8_t SPI_TraceGet(uint32_t index, SPI_TraceRecord *record);
+
+/*!
+ * @brief Writes the records into a little endian byte image that does not
+ * depend on the compiler's structure layout. The image starts with the magic
+ * "SPIT", a version, the record size, USER_CONFIG_CycleCountHz(), the number
+ * of records and the lost count. If the buffer is too small, the newest
+ * records that fit are written.
+ *
+ * @param buffer Receives the image.
+ * @param bufferNumBytes Size of buffer, see SPI_TRACE_DUMP_BYTES().
+ *
+ * @retval uint32_t The number of bytes written, 0 if the header does not fit.
+ */
+uint32_t SPI_TraceDump(uint8_t *buffer, uint32_t bufferNumBytes);
+
+/*!
+ * @brief Prints an image written by SPI_TraceDump(). Times are shown in
+ * microseconds from the first record.
+ *
+ * @param image The image.
+ * @param imageNumBytes Size of the image.
+ * @param format SPI_TRACE_TEXT or SPI_TRACE_CHROME.
+ *
+ * @retval uint32_t The number of records decoded, 0 if the image is not valid.
+ */
+uint32_t SPI_TraceDecode(const uint8_t *image, uint32_t imageNumBytes, enum spiTraceFormat format);
+
+/*!
+ * @brief Prints the records in the ring, as SPI_TraceDecode() would print
+ * their image.
+ *
+ * @param format SPI_TRACE_TEXT or SPI_TRACE_CHROME.
+ *
+ * @retval uint32_t The number of records printed.
+ */
+uint32_t SPI_TracePrint(enum spiTraceFormat format);
+
+#if (SPI_TRACE_ENABLE == 1)
+/*!
+ * @brief Called by the SPI layer before a transfer is handed to the transport.
+ * Opens a record if the transfer starts a frame and adds its byte counts.
+ *
+ * @param transfer The transfer.
+ * @param flags SPI_TRACE_ASYNC for transfers of the request queue, otherwise 0.
+ *
+ * @retval void
+ */
+void SPI_TraceBegin(const SPI_Transfer *transfer, uint8_t flags);
+
+/*!
+ * @brief Called by the SPI layer after a transfer completes. Stores the record
+ * if the transfer ended the frame.
+ *
+ * @param transfer The transfer.
+ *
+ * @retval void
+ */
+void SPI_TraceEnd(const SPI_Transfer *transfer);
+
+/*!
+ * @brief Called by SPI_WaitReady() before it closes its frame. Marks the
+ * record as a busy wait.
+ *
+ * @param samples The number of status samples taken.
+ *
+ * @retval void
+ */
+void SPI_TraceWait(uint32_t samples);
+
+//! Hook of SPI_TraceBegin(), empty when SPI_TRACE_ENABLE is 0.
+#define SPI_TRACE_BEGIN(transfer, flags) SPI_TraceBegin(transfer, flags)
+//! Hook of SPI_TraceEnd(), empty when SPI_TRACE_ENABLE is 0.
+#define SPI_TRACE_END(transfer) SPI_TraceEnd(transfer)
+//! Hook of SPI_TraceWait(), empty when SPI_TRACE_ENABLE is 0.
+#define SPI_TRACE_BUSY(samples) SPI_TraceWait(samples)
+#else
+#define SPI_TRACE_BEGIN(transfer, flags) ((void) 0)
+#define SPI_TRACE_END(transfer) ((void) 0)
+#define SPI_TRACE_BUSY(samples) ((void) 0)
+#endif
+
+#endif /* SPI_TRACE_H_ */
@@ -0,0 +1,192 @@
+/*
+ * The Clear BSD License
+ * Copyright (c) 2018 Adesto Technologies Corporation, Inc
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted (subject to the limitations in the disclaimer below) provided
+ *  that the following conditions are met:
+ *
+ * o Redistributions of source code must retain the above copyright notice, this list
+ *   of conditions and the following disclaimer.
+ *
+ * o Redistributions in binary form must reproduce the above copyright notice, this
+ *   list of conditions and the following disclaimer in the documentation and/or
+ *   other materials provided with the distribution.
+ *
+ * o Neither the name of the copyright holder nor the names of its
+ *   contributors may be used to endorse or promote products derived from this
+ *   software without specific prior written permission.
+ *
+ * NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE GRANTED BY THIS LICENSE.
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*!
+ * @ingroup SPI_LAYER
+ */
+/**
+ * @file    spi_transport.h
+ * @brief   Declarations of the SPI transport interface.
+ *
+ * A transport is the backend that physically carries an SPI transaction
+ * to the flash device. SPI_Exchange(), SPI_DualExchange() and
+ * SPI_QuadExchange() describe the transaction with an SPI_Transfer and
+ * hand it to the active transport. The GPIO bit-bang driver in
+ * spi_driver.c is the default transport; a hardware SPI/QSPI peripheral,
+ * a Linux spidev file descriptor or a software model of the flash can
+ * be selected instead with SPI_SetTransport().
+ */
+#ifndef SPI_TRANSPORT_H_
+#define SPI_TRANSPORT_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+//! SPI_Transfer.flags: leave CSb asserted when the transfer ends.
+#define SPI_TRANSFER_HOLD_CS	(1U << 0)
+//! SPI_Transfer.flags: CSb is still asserted by the previous transfer, which
+//! had SPI_TRANSFER_HOLD_CS set. The phases continue the same transaction.
+#define SPI_TRANSFER_CONTINUE	(1U << 1)
+
+/*!
+ * @brief Description of a single chip select framed SPI transaction.
+ *
+ * The phases are clocked in the following order, all while CSb is low:
+ * -# txSingleNumBytes bytes from txBuffer on MOSI alone.
+ * -# The remaining (txNumBytes - txSingleNumBytes) bytes from txBuffer on ioLines IOs.
+ * -# txPayloadNumBytes bytes from txPayload on ioLines IOs.
+ * -# dummyNumBytes dummy bytes on dummyIOLines IOs.
+ * -# rxNumBytes bytes into rxBuffer on ioLines IOs.
+ *
+ * SPI_TRANSFER_HOLD_CS and SPI_TRANSFER_CONTINUE in flags let one transaction
+ * be split over several transfers (see SPI_StreamOpen()).
+ */
+typedef struct
+{
+	//! Bytes to be transmitted. May be NULL if txNumBytes is 0.
+	uint8_t *txBuffer;
+	//! Total number of bytes to be transmitted.
+	uint32_t txNumBytes;
+	//! Number of leading tx bytes always sent in standard single SPI.
+	uint32_t txSingleNumBytes;
+	//! Caller owned data sent right after txBuffer, without being copied.
+	//! May be NULL if txPayloadNumBytes is 0.
+	uint8_t *txPayload;
+	//! Number of bytes in txPayload.
+	uint32_t txPayloadNumBytes;
+	//! Number of dummy bytes clocked between the tx and rx phases.
+	uint32_t dummyNumBytes;
+	//! Storage for received bytes. May be NULL if rxNumBytes is 0.
+	uint8_t *rxBuffer;
+	//! Number of bytes to be received.
+	uint32_t rxNumBytes;
+	//! Number of IOs (1, 2 or 4) used for the wide tx bytes and the rx bytes.
+	uint8_t ioLines;
+	//! Number of IOs (1, 2 or 4) used for the dummy bytes.
+	uint8_t dummyIOLines;
+	//! Highest SCK frequency allowed for this transaction in Hz, 0 for no limit.
+	//! See SPI_CommandClockHz().
+	uint32_t clockHz;
+	//! SPI_TRANSFER_HOLD_CS and/or SPI_TRANSFER_CONTINUE, 0 for a complete transaction.
+	uint8_t flags;
+} SPI_Transfer;
+
+/*!
+ * @brief Operations implemented by an SPI backend.
+ *
+ * Every operation receives the context pointer stored in the transport so
+ * that one implementation can serve several peripherals or file descriptors.
+ */
+typedef struct
+{
+	//! Short human readable name of the backend.
+	const char *name;
+	//! Prepares the backend for use. May be NULL.
+	void (*init)(void *context);
+	//! Carries out one transaction framed by CSb. Must not be NULL.
+	void (*exchange)(void *context, const SPI_Transfer *transfer);
+	//! Performs a JEDEC hardware reset. NULL if the backend cannot drive one.
+	void (*jedecReset)(void *context);
+	//! Starts a transaction in the background (interrupt or DMA driven) and
+	//! returns immediately. The backend reports the end of the transaction by
+	//! calling SPI_AsyncComplete(). NULL if the backend is blocking only, in
+	//! which case asynchronous requests are run cooperatively (see spi_async.h).
+	void (*start)(void *context, const SPI_Transfer *transfer);
+	//! Backend specific state passed to each operation.
+	void *context;
+} SPI_Transport;
+
+/*!
+ * @brief The GPIO bit-bang transport defined in spi_driver.c. This is
+ * the transport in use until SPI_SetTransport() is called.
+ */
+extern const SPI_Transport SPI_BitBangTransport;
+
+/*!
+ * @brief Chip select of a flash chip driven by the bit-bang transport. SCK
+ * and the IOs are shared by all chips on the bus.
+ */
+typedef struct
+{
+	//! GPIO port of CSb.
+	uint32_t csbPort;
+	//! GPIO pin of CSb.
+	uint32_t csbPin;
+} SPI_BitBangContext;
+
+/*!
+ * @brief Fills in a bit-bang transport for a chip with its own CSb, for
+ * boards with several chips on one bus. The pin is configured as an output
+ * and driven high. @ref SPI_BitBangTransport uses SPI_CSB_PORT and SPI_CSB_PIN.
+ *
+ * @param transport The transport to fill in.
+ * @param context Holds the chip select; must remain valid while the
+ * transport is in use.
+ * @param csbPort GPIO port of CSb.
+ * @param csbPin GPIO pin of CSb.
+ *
+ * @retval void
+ */
+void SPI_BitBangOpen(SPI_Transport *transport, SPI_BitBangContext *context, uint32_t csbPort, uint32_t csbPin);
+
+/*!
+ * @brief Selects the transport used by all subsequent SPI layer transactions
+ * and calls its init operation.
+ *
+ * @param transport The transport to be used. Passing NULL restores the
+ * bit-bang transport. The structure must remain valid while it is selected.
+ *
+ * @retval void
+ */
+void SPI_SetTransport(const SPI_Transport *transport);
+
+/*!
+ * @brief Returns the transport currently used by the SPI layer.
+ *
+ * @retval const SPI_Transport* The active transport.
+ */
+const SPI_Transport *SPI_GetTransport();
+
+/*!
+ * @brief Hands a fully described transaction to the active transport.
+ * SPI_Exchange(), SPI_DualExchange() and SPI_QuadExchange() are thin
+ * wrappers around this function. Requests queued with SPI_Submit() are
+ * completed before the transaction starts.
+ *
+ * @param transfer The transaction to be carried out.
+ *
+ * @retval void
+ */
+void SPI_Transact(const SPI_Transfer *transfer);
+
+#endif /* SPI_TRANSPORT_H_ */
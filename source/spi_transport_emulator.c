@@ -0,0 +1,1809 @@
+/*
+ * The Clear BSD License
+ * Copyright (c) 2018 Adesto Technologies Corporation, Inc
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted (subject to the limitations in the disclaimer below) provided
+ *  that the following conditions are met:
+ *
+ * o Redistributions of source code must retain the above copyright notice, this list
+ *   of conditions and the following disclaimer.
+ *
+ * o Redistributions in binary form must reproduce the above copyright notice, this
+ *   list of conditions and the following disclaimer in the documentation and/or
+ *   other materials provided with the distribution.
+ *
+ * o Neither the name of the copyright holder nor the names of its
+ *   contributors may be used to endorse or promote products derived from this
+ *   software without specific prior written permission.
+ *
+ * NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE GRANTED BY THIS LICENSE.
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*!
+ * @ingroup SPI_LAYER
+ */
+/**
+ * @file    spi_transport_emulator.c
+ * @brief   Definitions of the flash emulator SPI transport.
+ */
+#include "spi_transport_emulator.h"
+#include "user_config.h"
+#include "flash_parts.h"
+#include <string.h>
+
+// Attributes of a command.
+#define EMULATOR_READ			0x01	// The device drives the data phase.
+#define EMULATOR_WRITE			0x02	// The device takes the data phase.
+#define EMULATOR_BUSY_OK		0x04	// Accepted while busy.
+#define EMULATOR_WEL			0x08	// Needs the write enable latch.
+#define EMULATOR_MODIFY			0x10	// Programs or erases; refused while suspended.
+#define EMULATOR_QE				0x20	// Needs quad enable.
+#define EMULATOR_POWER_DOWN_OK	0x40	// Accepted in deep power down.
+
+// Why the device stopped listening to the current frame.
+enum emulatorIgnore
+{
+	IGNORE_NONE = 0,
+	IGNORE_REFUSED,
+	IGNORE_UNSUPPORTED,
+	IGNORE_WIRE_ERROR
+};
+
+// Kind of the running or suspended operation.
+enum emulatorOperation
+{
+	OPERATION_NONE = 0,
+	OPERATION_PROGRAM,
+	OPERATION_PROGRAM_BUFFER2,
+	OPERATION_ERASE,
+	OPERATION_OTHER
+};
+
+enum emulatorAction
+{
+	ACTION_NOP,
+	ACTION_READ_CONSTANT,
+	ACTION_READ_ID,
+	ACTION_WRITE_ENABLE,
+	ACTION_WRITE_DISABLE,
+	ACTION_VOLATILE_WRITE_ENABLE,
+	ACTION_READ_STATUS,
+	ACTION_WRITE_STATUS,
+	ACTION_WRITE_STATUS2,
+	ACTION_WRITE_STATUS_REGISTERS,
+	ACTION_READ_ARRAY,
+	ACTION_PROGRAM,
+	ACTION_SEQUENTIAL_PROGRAM,
+	ACTION_ERASE,
+	ACTION_DEEP_POWER_DOWN,
+	ACTION_RESUME,
+	ACTION_ULTRA_DEEP_POWER_DOWN,
+	ACTION_SUSPEND,
+	ACTION_RESUME_OPERATION,
+	ACTION_ENABLE_RESET,
+	ACTION_RESET,
+	ACTION_ENABLE_QPI,
+	ACTION_DISABLE_QPI,
+	ACTION_PROTECT_SECTOR,
+	ACTION_UNPROTECT_SECTOR,
+	ACTION_READ_PROTECTION,
+	ACTION_STATUS_INTERRUPT,
+	ACTION_READ_SECURITY,
+	ACTION_PROGRAM_SECURITY,
+	ACTION_ERASE_SECURITY,
+	ACTION_READ_PAGE,
+	ACTION_READ_BUFFER,
+	ACTION_WRITE_BUFFER,
+	ACTION_BUFFER_TO_PAGE,
+	ACTION_BUFFER_TO_PAGE_NO_ERASE,
+	ACTION_PROGRAM_THROUGH_BUFFER,
+	ACTION_PROGRAM_THROUGH_BUFFER_NO_ERASE,
+	ACTION_READ_MODIFY_WRITE,
+	ACTION_PAGE_TO_BUFFER,
+	ACTION_COMPARE,
+	ACTION_SEQUENCE,
+	ACTION_READ_CONFIG,
+	ACTION_READ_SFDP
+};
+
+typedef struct
+{
+	uint8_t opcode;
+	uint8_t action;
+	// ACTION_ERASE: log2 of the erase size, 0 for the chip (DataFlash: pages, 0 for a sector).
+	// DataFlash buffer commands: buffer index. ACTION_READ_CONSTANT: the value.
+	uint8_t parameter;
+	uint8_t headerNumBytes;
+	// IO lines of the header and of the data, 0 for those of the opcode.
+	uint8_t addressLines;
+	uint8_t dataLines;
+	uint8_t attributes;
+} emulatorCommand;
+
+#if defined(CMD_FUSION_PROTECT_SECTOR) || defined(CMD_STANDARDFLASH_PROTECT_SECTOR)
+// Individual sector protection, all sectors protected at power up.
+#define EMULATOR_SECTOR_SIZE	0x10000U
+#define EMULATOR_NUM_SECTORS	(SPI_EMULATOR_ARRAY_SIZE / EMULATOR_SECTOR_SIZE)
+#endif
+
+/******************************************************************************
+ * Helpers shared by the models
+ *****************************************************************************/
+
+static const emulatorCommand *emulatorFindCommand(const emulatorCommand *table, uint32_t numCommands, uint8_t opcode)
+{
+	uint32_t i;
+	for(i = 0; i < numCommands; i++)
+	{
+		if(table[i].opcode == opcode)
+			return &table[i];
+	}
+	return NULL;
+}
+
+static uint8_t emulatorNoise(SPI_EmulatorState *state)
+{
+	// xorshift32: a floating SO reads neither as all 0s nor as all 1s.
+	state->noise ^= state->noise << 13;
+	state->noise ^= state->noise >> 17;
+	state->noise ^= state->noise << 5;
+	return (uint8_t) state->noise;
+}
+
+static void emulatorUpdateTime(SPI_EmulatorContext *context)
+{
+	SPI_EmulatorState *state = &context->state;
+	uint32_t now = USER_CONFIG_CycleCount();
+	uint32_t hz = USER_CONFIG_CycleCountHz();
+	uint32_t elapsed = now - state->lastCycleCount;
+
+	state->lastCycleCount = now;
+	// Converted through ns to stay within 64 bits at any counter rate.
+	state->timePs += (((uint64_t) (elapsed / hz) * 1000000000ULL) +
+					  ((uint64_t) (elapsed % hz) * 1000000000ULL / hz)) * 1000ULL;
+}
+
+static uint8_t emulatorBusy(const SPI_EmulatorState *state)
+{
+	return state->timePs < state->busyUntilPs;
+}
+
+// Starts an operation that takes 'us' at the typical rate.
+static void emulatorStartOperation(SPI_EmulatorContext *context, uint32_t us, uint8_t operation)
+{
+	uint64_t ps = (uint64_t) us * context->busyScalePercent * 10000ULL;
+	context->state.busyUntilPs = context->state.timePs + ps;
+	context->state.operation = operation;
+	context->stats.busyNs += ps / 1000U;
+	context->stats.operations++;
+}
+
+#if !defined(DATAFLASH_DEVICE)
+// Program time of 'numBytes' when a full page of 'pageSize' bytes takes 'pageUs'.
+static uint32_t emulatorProgramUs(uint32_t pageUs, uint32_t numBytes, uint32_t pageSize)
+{
+	return (uint32_t) (((uint64_t) pageUs * numBytes + pageSize - 1) / pageSize);
+}
+#endif
+
+static uint32_t emulatorHeaderAddress(const SPI_EmulatorState *state, uint8_t numBytes)
+{
+	uint32_t address = 0;
+	uint8_t i;
+	for(i = 0; i < numBytes; i++)
+	{
+		address = (address << 8) | state->header[i];
+	}
+	return address;
+}
+
+static void emulatorProgramByte(SPI_EmulatorContext *context, uint32_t index, uint8_t value)
+{
+	uint8_t *cell = &context->memory[index % SPI_EMULATOR_ARRAY_SIZE];
+#if defined(MONETA_DEVICE)
+	*cell = value;
+#else
+	if(value & (uint8_t) ~*cell)
+	{
+		context->stats.unerasedBytes++;
+	}
+	*cell &= value;
+#endif
+}
+
+// Data clocked in by a page program wraps within the page of state->address.
+static void emulatorLatchByte(SPI_EmulatorState *state, uint8_t *latch, uint32_t pageSize, uint8_t value)
+{
+	latch[((state->address % pageSize) + state->dataCount) % pageSize] = value;
+}
+
+// Programs the bytes latched by emulatorLatchByte() into the page at array
+// index 'base', and returns their number.
+static uint32_t emulatorProgramLatch(SPI_EmulatorContext *context, const uint8_t *latch, uint32_t base, uint32_t pageSize)
+{
+	SPI_EmulatorState *state = &context->state;
+	uint32_t numBytes = (state->dataCount < pageSize) ? state->dataCount : pageSize;
+	uint32_t offset = state->address % pageSize;
+	uint32_t i;
+
+	for(i = 0; i < numBytes; i++)
+	{
+		emulatorProgramByte(context, base + offset, latch[offset]);
+		offset = (offset + 1) % pageSize;
+	}
+	return numBytes;
+}
+
+#if defined(EMULATOR_SECTOR_SIZE)
+static uint8_t emulatorProtected(const SPI_EmulatorState *state, uint32_t address, uint32_t numBytes)
+{
+	uint32_t sector;
+	for(sector = address / EMULATOR_SECTOR_SIZE; sector <= (address + numBytes - 1) / EMULATOR_SECTOR_SIZE; sector++)
+	{
+		if(state->protection[sector] != 0x00)
+			return 1;
+	}
+	return 0;
+}
+
+// Software protection status (SWP) bits of status register byte 1.
+static uint8_t emulatorProtectionStatus(const SPI_EmulatorState *state)
+{
+	uint32_t numProtected = 0;
+	uint32_t sector;
+	for(sector = 0; sector < EMULATOR_NUM_SECTORS; sector++)
+	{
+		numProtected += (state->protection[sector] != 0x00);
+	}
+	if(numProtected == 0)
+		return 0x00;
+	return (numProtected == EMULATOR_NUM_SECTORS) ? 0x0C : 0x04;
+}
+
+// Write status register byte 1: global protect or unprotect, and SPRL.
+static void emulatorWriteProtectionStatus(SPI_EmulatorState *state, uint8_t value)
+{
+	if((value & 0x3C) == 0x3C)
+		memset(state->protection, 0xFF, EMULATOR_NUM_SECTORS);
+	else if((value & 0x3C) == 0x00)
+		memset(state->protection, 0x00, EMULATOR_NUM_SECTORS);
+	state->status[0] = (state->status[0] & ~0x80) | (value & 0x80);
+}
+
+// Status register byte 1 of the parts with individual sector protection.
+static uint8_t emulatorProtectionStatusByte(const SPI_EmulatorState *state)
+{
+	// WP is not modelled and reads as deasserted (WPP = 1).
+	return emulatorBusy(state) | (state->wel << 1) | emulatorProtectionStatus(state) | 0x10 |
+		   (state->eraseProgramError << 5) | (state->status[0] & 0x80);
+}
+#endif
+
+static void emulatorSuspend(SPI_EmulatorState *state)
+{
+	if(!state->suspended && emulatorBusy(state))
+	{
+		state->suspendedPs = state->busyUntilPs - state->timePs;
+		state->busyUntilPs = state->timePs;
+		state->suspended = 1;
+	}
+}
+
+static void emulatorResume(SPI_EmulatorState *state)
+{
+	if(state->suspended)
+	{
+		state->busyUntilPs = state->timePs + state->suspendedPs;
+		state->suspended = 0;
+	}
+}
+
+// Software reset: aborts the running operation and clears the volatile modes.
+static void emulatorSoftReset(SPI_EmulatorState *state)
+{
+	state->busyUntilPs = state->timePs;
+	state->suspended = 0;
+	state->operation = OPERATION_NONE;
+	state->eraseProgramError = 0;
+	state->powerDown = 0;
+	state->wel = 0;
+	state->qpi = 0;
+	state->continuousRead = 0;
+	state->resetEnabled = 0;
+	state->volatileWel = 0;
+	state->sequentialProgram = 0;
+}
+
+/******************************************************************************
+ * Moneta
+ *****************************************************************************/
+#if defined(MONETA_DEVICE)
+
+static const emulatorCommand modelCommands[] =
+{
+	{CMD_MONETA_WRITE_ENABLE,	ACTION_WRITE_ENABLE,			0, 0, 0, 0, 0},
+	{CMD_MONETA_WRITE_DISABLE,	ACTION_WRITE_DISABLE,			0, 0, 0, 0, 0},
+	{CMD_MONETA_READ_SRB1,		ACTION_READ_STATUS,				0, 0, 0, 0, EMULATOR_READ | EMULATOR_BUSY_OK},
+	{CMD_MONETA_WRITE_SRB1,		ACTION_WRITE_STATUS,			0, 1, 0, 0, EMULATOR_WEL},
+	{CMD_MONETA_WRITE_SRB2,		ACTION_WRITE_STATUS2,			0, 1, 0, 0, EMULATOR_WEL},
+	{CMD_MONETA_READ_ARRAY,		ACTION_READ_ARRAY,				0, 2, 0, 0, EMULATOR_READ},
+	{CMD_MONETA_WRITE_ARRAY,	ACTION_PROGRAM,					0, 2, 0, 0, EMULATOR_WRITE | EMULATOR_WEL | EMULATOR_MODIFY},
+	{CMD_MONETA_READ_MID,		ACTION_READ_ID,					0, 0, 0, 0, EMULATOR_READ},
+	{CMD_MONETA_UDPD_MODE1,		ACTION_ULTRA_DEEP_POWER_DOWN,	0, 0, 0, 0, 0}
+};
+
+static const uint8_t modelID[] = {0x7F, 0x7F, 0x7F, 0x7F, 0x7F, 0x7F, 0x7F, 0x43};
+
+static const emulatorCommand *modelFind(SPI_EmulatorContext *context, uint8_t opcode)
+{
+	(void) context;
+	return emulatorFindCommand(modelCommands, sizeof(modelCommands) / sizeof(modelCommands[0]), opcode);
+}
+
+static uint8_t modelQuadEnabled(const SPI_EmulatorState *state)
+{
+	(void) state;
+	return 0;
+}
+
+static void modelOpen(SPI_EmulatorContext *context)
+{
+	(void) context;
+}
+
+static void modelPowerUp(SPI_EmulatorContext *context)
+{
+	context->state.status[0] = 0x00;
+	context->state.status[1] = 0x00;
+}
+
+static uint8_t modelBegin(SPI_EmulatorContext *context, const emulatorCommand *command)
+{
+	(void) command;
+	context->state.address = emulatorHeaderAddress(&context->state, 2);
+	return 1;
+}
+
+static void modelIn(SPI_EmulatorContext *context, const emulatorCommand *command, uint8_t value)
+{
+	(void) command;
+	emulatorLatchByte(&context->state, context->state.latch, MONETA_PAGE_SIZE, value);
+}
+
+static uint8_t modelOut(SPI_EmulatorContext *context, const emulatorCommand *command)
+{
+	SPI_EmulatorState *state = &context->state;
+	uint8_t value;
+
+	if(command->action == ACTION_READ_STATUS)
+	{
+		if(state->dataCount & 1)
+			return state->status[1];
+		return (state->status[0] & 0xFC) | (state->wel << 1) | emulatorBusy(state);
+	}
+	value = context->memory[state->address];
+	state->address = (state->address + 1) % SPI_EMULATOR_ARRAY_SIZE;
+	return value;
+}
+
+static void modelEnd(SPI_EmulatorContext *context, const emulatorCommand *command)
+{
+	SPI_EmulatorState *state = &context->state;
+	uint32_t numBytes;
+
+	switch(command->action)
+	{
+		case ACTION_WRITE_STATUS:
+			state->status[0] = state->header[0] & 0xFC;
+			state->wel = 0;
+			break;
+		case ACTION_WRITE_STATUS2:
+			state->status[1] = state->header[0];
+			state->wel = 0;
+			break;
+		case ACTION_PROGRAM:
+			numBytes = emulatorProgramLatch(context, state->latch, state->address - (state->address % MONETA_PAGE_SIZE), MONETA_PAGE_SIZE);
+			emulatorStartOperation(context, emulatorProgramUs(MONETA_TPP_US, numBytes, MONETA_PAGE_SIZE), OPERATION_PROGRAM);
+			state->wel = 0;
+			break;
+		default:
+			break;
+	}
+}
+
+/******************************************************************************
+ * Fusion
+ *****************************************************************************/
+#elif defined(FUSION_DEVICE)
+
+static const emulatorCommand modelCommands[] =
+{
+	{CMD_FUSION_WRITE_ENABLE,			ACTION_WRITE_ENABLE,			0,	0, 0, 0, 0},
+	{CMD_FUSION_WRITE_DISABLE,			ACTION_WRITE_DISABLE,			0,	0, 0, 0, 0},
+	{CMD_FUSION_READ_SR,				ACTION_READ_STATUS,				0,	0, 0, 0, EMULATOR_READ | EMULATOR_BUSY_OK},
+	{CMD_FUSION_WRITE_SRB1,				ACTION_WRITE_STATUS,			0,	1, 0, 0, EMULATOR_WEL},
+	{CMD_FUSION_WRITE_SRB2,				ACTION_WRITE_STATUS2,			0,	1, 0, 0, EMULATOR_WEL},
+	{CMD_FUSION_READ_ARRAY,				ACTION_READ_ARRAY,				0,	3, 0, 0, EMULATOR_READ},
+	{CMD_FUSION_READ_ARRAY_LF,			ACTION_READ_ARRAY,				0,	3, 0, 0, EMULATOR_READ},
+	{CMD_FUSION_DUAL_OUTPUT_READ,		ACTION_READ_ARRAY,				0,	3, 0, 2, EMULATOR_READ},
+	{CMD_FUSION_PAGE_ERASE,				ACTION_ERASE,					8,	3, 0, 0, EMULATOR_WEL | EMULATOR_MODIFY},
+	{CMD_FUSION_BLOCK_ERASE_4K,			ACTION_ERASE,					12,	3, 0, 0, EMULATOR_WEL | EMULATOR_MODIFY},
+	{CMD_FUSION_BLOCK_ERASE_32K,		ACTION_ERASE,					15,	3, 0, 0, EMULATOR_WEL | EMULATOR_MODIFY},
+	{CMD_FUSION_CHIP_ERASE,				ACTION_ERASE,					0,	0, 0, 0, EMULATOR_WEL | EMULATOR_MODIFY},
+	{CMD_FUSION_PROGRAM_ARRAY,			ACTION_PROGRAM,					0,	3, 0, 0, EMULATOR_WRITE | EMULATOR_WEL | EMULATOR_MODIFY},
+	{CMD_FUSION_PROGRAM_OTP_REGISTER,	ACTION_NOP,						0,	0, 0, 0, 0},
+	{CMD_FUSION_READ_OTP_REGISTER,		ACTION_READ_CONSTANT,			0xFF, 0, 0, 0, EMULATOR_READ},
+	{CMD_FUSION_RESET,					ACTION_RESET,					0,	1, 0, 0, EMULATOR_BUSY_OK},
+	{CMD_FUSION_READ_MID,				ACTION_READ_ID,					0,	0, 0, 0, EMULATOR_READ},
+	{CMD_FUSION_DEEP_POWER_DOWN,		ACTION_DEEP_POWER_DOWN,			0,	0, 0, 0, 0},
+	{CMD_FUSION_RESUME_FROM_DPD,		ACTION_RESUME,					0,	0, 0, 0, EMULATOR_POWER_DOWN_OK},
+	{CMD_FUSION_UDPD_MODE,				ACTION_ULTRA_DEEP_POWER_DOWN,	0,	0, 0, 0, 0},
+#if defined(CMD_FUSION_SQNTL_PROGRAM_MODE)
+	{CMD_FUSION_DUAL_INPUT_PROGRAM,		ACTION_PROGRAM,					0,	3, 0, 2, EMULATOR_WRITE | EMULATOR_WEL | EMULATOR_MODIFY},
+	{CMD_FUSION_PROTECT_SECTOR,			ACTION_PROTECT_SECTOR,			0,	3, 0, 0, EMULATOR_WEL},
+	{CMD_FUSION_UNPROTECT_SECTOR,		ACTION_UNPROTECT_SECTOR,		0,	3, 0, 0, EMULATOR_WEL},
+	{CMD_FUSION_PROTECTION_REGISTER,	ACTION_READ_PROTECTION,			0,	3, 0, 0, EMULATOR_READ},
+	{CMD_FUSION_ACTIVE_STATUS_INTERRUPT, ACTION_STATUS_INTERRUPT,		0,	1, 0, 0, EMULATOR_READ | EMULATOR_BUSY_OK},
+#endif
+};
+
+#if defined(CMD_FUSION_SQNTL_PROGRAM_MODE)
+// Sequential program mode: the first command carries the address, the next ones only data.
+static const emulatorCommand modelSequentialProgramFirst =
+	{CMD_FUSION_SQNTL_PROGRAM_MODE,	ACTION_SEQUENTIAL_PROGRAM, 0, 3, 0, 0, EMULATOR_WRITE | EMULATOR_WEL | EMULATOR_MODIFY};
+static const emulatorCommand modelSequentialProgramNext =
+	{CMD_FUSION_SQNTL_PROGRAM_MODE,	ACTION_SEQUENTIAL_PROGRAM, 0, 0, 0, 0, EMULATOR_WRITE | EMULATOR_WEL | EMULATOR_MODIFY};
+#endif
+
+#if (PARTNO == AT25XE512C) || (PARTNO == AT25DN512C)
+static const uint8_t modelID[] = {0x1F, 0x65, 0x01, 0x00};
+#elif (PARTNO == AT25DF512C)
+static const uint8_t modelID[] = {0x1F, 0x64, 0x01, 0x00};
+#elif (PARTNO == AT25XE011) || (PARTNO == AT25DN011) || (PARTNO == AT25DF011)
+static const uint8_t modelID[] = {0x1F, 0x42, 0x00, 0x00};
+#elif (PARTNO == AT25XE021A) || (PARTNO == AT25DF021A) || (PARTNO == AT25XV021A)
+static const uint8_t modelID[] = {0x1F, 0x43, 0x01, 0x00};
+#elif (PARTNO == AT25XE041B) || (PARTNO == AT25DF041B) || (PARTNO == AT25XV041B)
+static const uint8_t modelID[] = {0x1F, 0x44, 0x02, 0x00};
+#elif (PARTNO == AT25DN256) || (PARTNO == AT25DF256)
+static const uint8_t modelID[] = {0x1F, 0x40, 0x00, 0x00};
+#endif
+
+static const emulatorCommand *modelFind(SPI_EmulatorContext *context, uint8_t opcode)
+{
+#if defined(CMD_FUSION_SQNTL_PROGRAM_MODE)
+	if(opcode == CMD_FUSION_SQNTL_PROGRAM_MODE)
+	{
+		return context->state.sequentialProgram ? &modelSequentialProgramNext : &modelSequentialProgramFirst;
+	}
+#else
+	(void) context;
+#endif
+	return emulatorFindCommand(modelCommands, sizeof(modelCommands) / sizeof(modelCommands[0]), opcode);
+}
+
+static uint8_t modelQuadEnabled(const SPI_EmulatorState *state)
+{
+	(void) state;
+	return 0;
+}
+
+static void modelOpen(SPI_EmulatorContext *context)
+{
+	(void) context;
+}
+
+static void modelPowerUp(SPI_EmulatorContext *context)
+{
+	SPI_EmulatorState *state = &context->state;
+	state->status[0] = 0x00;
+	state->status[1] = 0x00;
+#if defined(EMULATOR_SECTOR_SIZE)
+	memset(state->protection, 0xFF, EMULATOR_NUM_SECTORS);
+#endif
+}
+
+static uint8_t modelBegin(SPI_EmulatorContext *context, const emulatorCommand *command)
+{
+	SPI_EmulatorState *state = &context->state;
+
+	if(command->headerNumBytes == 3)
+	{
+		state->address = emulatorHeaderAddress(state, 3) % SPI_EMULATOR_ARRAY_SIZE;
+	}
+	return 1;
+}
+
+static void modelIn(SPI_EmulatorContext *context, const emulatorCommand *command, uint8_t value)
+{
+	SPI_EmulatorState *state = &context->state;
+
+	if(command->action == ACTION_SEQUENTIAL_PROGRAM)
+	{
+		// One byte per command; the address then moves on by itself.
+		if(state->dataCount == 0)
+			state->latch[0] = value;
+		return;
+	}
+	emulatorLatchByte(state, state->latch, FUSION_PAGE_SIZE, value);
+}
+
+static uint8_t modelOut(SPI_EmulatorContext *context, const emulatorCommand *command)
+{
+	SPI_EmulatorState *state = &context->state;
+	uint8_t value = 0x00;
+
+	switch(command->action)
+	{
+		case ACTION_READ_STATUS:
+			if(state->dataCount & 1)
+				return emulatorBusy(state) | (state->status[1] & 0x10);
+#if defined(EMULATOR_SECTOR_SIZE)
+			return emulatorProtectionStatusByte(state);
+#else
+			return emulatorBusy(state) | (state->wel << 1) | 0x10 | (state->eraseProgramError << 5) | (state->status[0] & 0x80);
+#endif
+		case ACTION_READ_ARRAY:
+			value = context->memory[state->address];
+			state->address = (state->address + 1) % SPI_EMULATOR_ARRAY_SIZE;
+			break;
+#if defined(EMULATOR_SECTOR_SIZE)
+		case ACTION_READ_PROTECTION:
+			value = state->protection[state->address / EMULATOR_SECTOR_SIZE];
+			break;
+		case ACTION_STATUS_INTERRUPT:
+			value = emulatorBusy(state) ? 0x00 : 0xFF;
+			break;
+#endif
+		default:
+			break;
+	}
+	return value;
+}
+
+static uint8_t modelProtected(const SPI_EmulatorState *state, uint32_t address, uint32_t numBytes)
+{
+#if defined(EMULATOR_SECTOR_SIZE)
+	return emulatorProtected(state, address, numBytes);
+#else
+	(void) state;
+	(void) address;
+	(void) numBytes;
+	return 0;
+#endif
+}
+
+static void modelEnd(SPI_EmulatorContext *context, const emulatorCommand *command)
+{
+	SPI_EmulatorState *state = &context->state;
+	uint32_t size = 1U << command->parameter;
+	uint32_t numBytes;
+	uint32_t us;
+
+	switch(command->action)
+	{
+		case ACTION_WRITE_STATUS:
+#if defined(EMULATOR_SECTOR_SIZE)
+			emulatorWriteProtectionStatus(state, state->header[0]);
+#else
+			state->status[0] = state->header[0] & 0x80;
+#endif
+			state->wel = 0;
+			break;
+		case ACTION_WRITE_STATUS2:
+			// Only RSTE is writable.
+			state->status[1] = state->header[0] & 0x10;
+			state->wel = 0;
+			break;
+		case ACTION_RESET:
+			if((state->header[0] == CMD_FUSION_RESET_CONFIRMATION) && (state->status[1] & 0x10))
+				emulatorSoftReset(state);
+			break;
+		case ACTION_ERASE:
+			state->wel = 0;
+			if(command->parameter == 0)
+			{
+				size = SPI_EMULATOR_ARRAY_SIZE;
+				us = FUSION_TCE_US;
+			}
+			else
+			{
+				us = (command->parameter == 8) ? FUSION_TPE_US : FUSION_TBE_US;
+			}
+			state->address -= state->address % size;
+			state->eraseProgramError = modelProtected(state, state->address, size);
+			if(!state->eraseProgramError)
+			{
+				memset(&context->memory[state->address], 0xFF, size);
+				emulatorStartOperation(context, us, OPERATION_ERASE);
+			}
+			break;
+		case ACTION_PROGRAM:
+			state->wel = 0;
+			state->eraseProgramError = modelProtected(state, state->address, 1);
+			if(!state->eraseProgramError)
+			{
+				numBytes = emulatorProgramLatch(context, state->latch, state->address - (state->address % FUSION_PAGE_SIZE), FUSION_PAGE_SIZE);
+				emulatorStartOperation(context, emulatorProgramUs(FUSION_TPP_US, numBytes, FUSION_PAGE_SIZE), OPERATION_PROGRAM);
+			}
+			break;
+#if defined(EMULATOR_SECTOR_SIZE)
+		case ACTION_SEQUENTIAL_PROGRAM:
+			if(state->dataCount == 0)
+				break;
+			state->eraseProgramError = modelProtected(state, state->address, 1);
+			if(state->eraseProgramError)
+			{
+				state->sequentialProgram = 0;
+				state->wel = 0;
+				break;
+			}
+			emulatorProgramByte(context, state->address, state->latch[0]);
+			emulatorStartOperation(context, emulatorProgramUs(FUSION_TPP_US, 1, FUSION_PAGE_SIZE), OPERATION_PROGRAM);
+			state->address = (state->address + 1) % SPI_EMULATOR_ARRAY_SIZE;
+			// The mode ends at the top of the array.
+			state->sequentialProgram = (state->address != 0);
+			state->wel = state->sequentialProgram;
+			break;
+		case ACTION_PROTECT_SECTOR:
+			state->protection[state->address / EMULATOR_SECTOR_SIZE] = 0xFF;
+			state->wel = 0;
+			break;
+		case ACTION_UNPROTECT_SECTOR:
+			state->protection[state->address / EMULATOR_SECTOR_SIZE] = 0x00;
+			state->wel = 0;
+			break;
+#endif
+		default:
+			break;
+	}
+}
+
+/******************************************************************************
+ * DataFlash
+ *****************************************************************************/
+#elif defined(DATAFLASH_DEVICE)
+
+// Main memory to buffer transfer and compare time.
+#define MODEL_TXFR_US		200U
+#define MODEL_NUM_PAGES		(SPI_EMULATOR_ARRAY_SIZE / DATAFLASH_PAGE_SIZE_STD)
+
+#if (PARTNO == AT45DB021E) || (PARTNO == AT25PE20)
+#define MODEL_DENSITY			0x14
+#define MODEL_SECTOR_PAGES		128U
+static const uint8_t modelID[] = {0x1F, 0x23, 0x00, 0x01, 0x00};
+#elif (PARTNO == AT45DB041E) || (PARTNO == AT25PE40)
+#define MODEL_DENSITY			0x1C
+#define MODEL_SECTOR_PAGES		256U
+static const uint8_t modelID[] = {0x1F, 0x24, 0x00, 0x01, 0x00};
+#elif (PARTNO == AT45DB081E) || (PARTNO == AT25PE80)
+#define MODEL_DENSITY			0x24
+#define MODEL_SECTOR_PAGES		256U
+static const uint8_t modelID[] = {0x1F, 0x25, 0x00, 0x01, 0x00};
+#elif (PARTNO == AT45DB161E) || (PARTNO == AT45DQ161) || (PARTNO == AT25PE16)
+#define MODEL_DENSITY			0x2C
+#define MODEL_SECTOR_PAGES		256U
+static const uint8_t modelID[] = {0x1F, 0x26, 0x00, 0x01, 0x00};
+#elif (PARTNO == AT45DB321E) || (PARTNO == AT45DQ321)
+#define MODEL_DENSITY			0x34
+#define MODEL_SECTOR_PAGES		128U
+static const uint8_t modelID[] = {0x1F, 0x27, 0x01, 0x01, 0x00};
+#elif (PARTNO == AT45DB641E)
+#define MODEL_DENSITY			0x3C
+#define MODEL_SECTOR_PAGES		1024U
+static const uint8_t modelID[] = {0x1F, 0x28, 0x00, 0x01, 0x00};
+#endif
+// Sector 0 is split into 0a (the first block) and 0b.
+#define MODEL_NUM_SECTORS		(MODEL_NUM_PAGES / MODEL_SECTOR_PAGES + 1U)
+
+static const emulatorCommand modelCommands[] =
+{
+	{CMD_DATAFLASH_MEM_PAGE_READ,			ACTION_READ_PAGE,						0, 3, 0, 0, EMULATOR_READ},
+	{CMD_DATAFLASH_ARRAY_READ_LP,			ACTION_READ_ARRAY,						0, 3, 0, 0, EMULATOR_READ},
+	{CMD_DATAFLASH_ARRAY_READ_LF,			ACTION_READ_ARRAY,						0, 3, 0, 0, EMULATOR_READ},
+	{CMD_DATAFLASH_ARRAY_READ_HF0,			ACTION_READ_ARRAY,						0, 3, 0, 0, EMULATOR_READ},
+	{CMD_DATAFLASH_ARRAY_READ_HF1,			ACTION_READ_ARRAY,						0, 3, 0, 0, EMULATOR_READ},
+	{CMD_DATAFLASH_ARRAY_READ_LEG,			ACTION_READ_ARRAY,						0, 3, 0, 0, EMULATOR_READ},
+	{CMD_DATAFLASH_CONTINUOUS_ARRAY_READ_LEG, ACTION_READ_ARRAY,					0, 3, 0, 0, EMULATOR_READ},
+	{CMD_DATAFLASH_MEM_PAGE_READ_LEG,		ACTION_READ_PAGE,						0, 3, 0, 0, EMULATOR_READ},
+	{CMD_DATAFLASH_BUFFER1_READ_LF,			ACTION_READ_BUFFER,						0, 3, 0, 0, EMULATOR_READ | EMULATOR_BUSY_OK},
+	{CMD_DATAFLASH_BUFFER1_READ_HF,			ACTION_READ_BUFFER,						0, 3, 0, 0, EMULATOR_READ | EMULATOR_BUSY_OK},
+	{CMD_DATAFLASH_BUF1_READ_LEG,			ACTION_READ_BUFFER,						0, 3, 0, 0, EMULATOR_READ | EMULATOR_BUSY_OK},
+	{CMD_DATAFLASH_BUFFER1_WRITE,			ACTION_WRITE_BUFFER,					0, 3, 0, 0, EMULATOR_WRITE},
+	{CMD_DATAFLASH_BUF1_2MEM_W_ERASE,		ACTION_BUFFER_TO_PAGE,					0, 3, 0, 0, EMULATOR_MODIFY},
+	{CMD_DATAFLASH_BUF1_2MEM_WO_ERASE,		ACTION_BUFFER_TO_PAGE_NO_ERASE,			0, 3, 0, 0, EMULATOR_MODIFY},
+	{CMD_DATAFLASH_MEM_PRGM_BUF1_W_ERASE,	ACTION_PROGRAM_THROUGH_BUFFER,			0, 3, 0, 0, EMULATOR_WRITE | EMULATOR_MODIFY},
+	{CMD_DATAFLASH_MEM_PRGM_BUF1_WO_ERASE,	ACTION_PROGRAM_THROUGH_BUFFER_NO_ERASE,	0, 3, 0, 0, EMULATOR_WRITE | EMULATOR_MODIFY},
+	{CMD_DATAFLASH_RD_MOD_WR_THRU_BUF1,		ACTION_READ_MODIFY_WRITE,				0, 3, 0, 0, EMULATOR_WRITE | EMULATOR_MODIFY},
+	{CMD_DATAFLASH_MEM_BUF1_TRANSFER,		ACTION_PAGE_TO_BUFFER,					0, 3, 0, 0, 0},
+	{CMD_DATAFLASH_MEM_BUF1_COMPARE,		ACTION_COMPARE,							0, 3, 0, 0, 0},
+	{CMD_DATAFLASH_PAGE_ERASE,				ACTION_ERASE,							1, 3, 0, 0, EMULATOR_MODIFY},
+	{CMD_DATAFLASH_BLOCK_ERASE,				ACTION_ERASE,							8, 3, 0, 0, EMULATOR_MODIFY},
+	{CMD_DATAFLASH_SECTOR_ERASE,			ACTION_ERASE,							0, 3, 0, 0, EMULATOR_MODIFY},
+	{CMD_DATAFLASH_CHIP_ERASE >> 24,		ACTION_SEQUENCE,						0, 3, 0, 0, EMULATOR_MODIFY},
+	{CMD_DATAFLASH_ENABLE_SECT_PROTECTION >> 24, ACTION_SEQUENCE,					0, 3, 0, 0, EMULATOR_WRITE},
+	{CMD_DATAFLASH_SOFTWARE_RESET >> 24,	ACTION_SEQUENCE,						0, 3, 0, 0, EMULATOR_BUSY_OK},
+	{CMD_DATAFLASH_READ_SECT_PROT_REG,		ACTION_READ_PROTECTION,					0, 0, 0, 0, EMULATOR_READ},
+	{CMD_DATAFLASH_READ_SECURITY_REG,		ACTION_READ_CONSTANT,					0xFF, 0, 0, 0, EMULATOR_READ},
+	{CMD_DATAFLASH_DEEP_POWER_DOWN,			ACTION_DEEP_POWER_DOWN,					0, 0, 0, 0, 0},
+	{CMD_DATAFLASH_RESUME_FROM_DPD,			ACTION_RESUME,							0, 0, 0, 0, EMULATOR_POWER_DOWN_OK},
+	{CMD_DATAFLASH_UDPD_MODE,				ACTION_ULTRA_DEEP_POWER_DOWN,			0, 0, 0, 0, 0},
+	{CMD_DATAFLASH_READ_SR,					ACTION_READ_STATUS,						0, 0, 0, 0, EMULATOR_READ | EMULATOR_BUSY_OK},
+	{CMD_DATAFLASH_SR_READ_LEG,				ACTION_READ_STATUS,						0, 0, 0, 0, EMULATOR_READ | EMULATOR_BUSY_OK},
+	{CMD_DATAFLASH_READ_MID,				ACTION_READ_ID,							0, 0, 0, 0, EMULATOR_READ},
+#if defined(CMD_DATAFLASH_QUAD_ENABLE)
+	{CMD_DATAFLASH_DUAL_OUTPUT_READ_ARRAY,	ACTION_READ_ARRAY,						0, 3, 0, 2, EMULATOR_READ},
+	{CMD_DATAFLASH_QUAD_OUTPUT_READ_ARRAY,	ACTION_READ_ARRAY,						0, 3, 0, 4, EMULATOR_READ | EMULATOR_QE},
+	{CMD_DATAFLASH_DUAL_INPUT_BUFFER1_WRITE, ACTION_WRITE_BUFFER,					0, 3, 0, 2, EMULATOR_WRITE},
+	{CMD_DATAFLASH_DUAL_INPUT_BUFFER2_WRITE, ACTION_WRITE_BUFFER,					1, 3, 0, 2, EMULATOR_WRITE},
+	{CMD_DATAFLASH_QUAD_INPUT_BUFFER1_WRITE, ACTION_WRITE_BUFFER,					0, 3, 0, 4, EMULATOR_WRITE | EMULATOR_QE},
+	{CMD_DATAFLASH_QUAD_INPUT_BUFFER2_WRITE, ACTION_WRITE_BUFFER,					1, 3, 0, 4, EMULATOR_WRITE | EMULATOR_QE},
+	{CMD_DATAFLASH_READ_CONFIG_REGISTER,	ACTION_READ_CONFIG,						0, 0, 0, 0, EMULATOR_READ},
+#endif
+#if defined(CMD_DATAFLASH_PROGRAM_ERASE_SUSPEND)
+	{CMD_DATAFLASH_PROGRAM_ERASE_SUSPEND,	ACTION_SUSPEND,							0, 0, 0, 0, EMULATOR_BUSY_OK},
+	{CMD_DATAFLASH_PROGRAM_ERASE_RESUME,	ACTION_RESUME_OPERATION,				0, 0, 0, 0, EMULATOR_BUSY_OK},
+	{CMD_DATAFLASH_READ_SECT_LOCK_REG,		ACTION_READ_CONSTANT,					0x00, 0, 0, 0, EMULATOR_READ},
+	{CMD_DATAFLASH_FREEZE_SECTOR_LOCKDOWN >> 24, ACTION_SEQUENCE,					0, 3, 0, 0, 0},
+	{CMD_DATAFLASH_PROGRAM_SECURITY_REG >> 24, ACTION_SEQUENCE,						0, 3, 0, 0, EMULATOR_WRITE},
+#endif
+#if defined(CMD_DATAFLASH_BUFFER2_WRITE)
+	{CMD_DATAFLASH_BUFFER2_READ_LF,			ACTION_READ_BUFFER,						1, 3, 0, 0, EMULATOR_READ | EMULATOR_BUSY_OK},
+	{CMD_DATAFLASH_BUFFER2_READ_HF,			ACTION_READ_BUFFER,						1, 3, 0, 0, EMULATOR_READ | EMULATOR_BUSY_OK},
+	{CMD_DATAFLASH_BUF2_READ_LEG,			ACTION_READ_BUFFER,						1, 3, 0, 0, EMULATOR_READ | EMULATOR_BUSY_OK},
+	{CMD_DATAFLASH_BUFFER2_WRITE,			ACTION_WRITE_BUFFER,					1, 3, 0, 0, EMULATOR_WRITE},
+	{CMD_DATAFLASH_BUF2_2MEM_W_ERASE,		ACTION_BUFFER_TO_PAGE,					1, 3, 0, 0, EMULATOR_MODIFY},
+	{CMD_DATAFLASH_BUF2_2MEM_WO_ERASE,		ACTION_BUFFER_TO_PAGE_NO_ERASE,			1, 3, 0, 0, EMULATOR_MODIFY},
+	{CMD_DATAFLASH_MEM_PRGM_BUF2_W_ERASE,	ACTION_PROGRAM_THROUGH_BUFFER,			1, 3, 0, 0, EMULATOR_WRITE | EMULATOR_MODIFY},
+	{CMD_DATAFLASH_RD_MOD_WR_THRU_BUF2,		ACTION_READ_MODIFY_WRITE,				1, 3, 0, 0, EMULATOR_WRITE | EMULATOR_MODIFY},
+	{CMD_DATAFLASH_MEM_BUF2_TRANSFER,		ACTION_PAGE_TO_BUFFER,					1, 3, 0, 0, 0},
+	{CMD_DATAFLASH_MEM_BUF2_COMPARE,		ACTION_COMPARE,							1, 3, 0, 0, 0},
+#endif
+};
+
+static const emulatorCommand *modelFind(SPI_EmulatorContext *context, uint8_t opcode)
+{
+	(void) context;
+	return emulatorFindCommand(modelCommands, sizeof(modelCommands) / sizeof(modelCommands[0]), opcode);
+}
+
+static uint8_t modelQuadEnabled(const SPI_EmulatorState *state)
+{
+	return (state->config & 0x80) != 0;
+}
+
+static uint32_t modelPageSize(const SPI_EmulatorState *state)
+{
+	return state->pageSizeP2 ? DATAFLASH_PAGE_SIZE_P2 : DATAFLASH_PAGE_SIZE_STD;
+}
+
+// Array index of a linear address counted in pages of modelPageSize().
+static uint32_t modelIndex(const SPI_EmulatorState *state, uint32_t address)
+{
+	uint32_t pageSize = modelPageSize(state);
+	return (address / pageSize) * DATAFLASH_PAGE_SIZE_STD + (address % pageSize);
+}
+
+static uint8_t modelProtected(const SPI_EmulatorState *state, uint32_t page, uint32_t numPages)
+{
+	uint32_t last = page + numPages - 1;
+	uint32_t sector;
+
+	if(!state->protectionEnabled)
+		return 0;
+	for(; page <= last; page++)
+	{
+		if(page < 8)
+			sector = 0;
+		else if(page < MODEL_SECTOR_PAGES)
+			sector = 1;
+		else
+			sector = page / MODEL_SECTOR_PAGES + 1;
+		if(state->protection[sector] == 0xFF)
+			return 1;
+	}
+	return 0;
+}
+
+static void modelOpen(SPI_EmulatorContext *context)
+{
+	// Factory state: standard page size, protection register erased.
+	context->state.pageSizeP2 = 0;
+	context->state.config = 0x00;
+	memset(context->state.protection, 0xFF, MODEL_NUM_SECTORS);
+}
+
+static void modelPowerUp(SPI_EmulatorContext *context)
+{
+	SPI_EmulatorState *state = &context->state;
+	state->compareMismatch = 0;
+	state->protectionEnabled = 0;
+	memset(state->buffer, 0xFF, sizeof(state->buffer));
+}
+
+static uint8_t modelBegin(SPI_EmulatorContext *context, const emulatorCommand *command)
+{
+	SPI_EmulatorState *state = &context->state;
+	uint32_t address = emulatorHeaderAddress(state, 3);
+	uint32_t pageSize = modelPageSize(state);
+	uint32_t page;
+	uint32_t offset;
+
+	if(command->action == ACTION_SEQUENCE)
+	{
+		// Of the 0x3D commands, only those of the sector protection and configuration groups exist.
+		return (state->opcode != 0x3D) ||
+			   ((state->header[0] == 0x2A) && (state->header[1] >= 0x7F) && (state->header[1] <= 0x81));
+	}
+	if(state->pageSizeP2)
+	{
+		page = address / DATAFLASH_PAGE_SIZE_P2;
+		offset = address % DATAFLASH_PAGE_SIZE_P2;
+	}
+	else
+	{
+		page = address >> DATAFLASH_PAGE_OFFSET_BITS;
+		offset = (address & ((1U << DATAFLASH_PAGE_OFFSET_BITS) - 1)) % DATAFLASH_PAGE_SIZE_STD;
+	}
+	state->address = (page % MODEL_NUM_PAGES) * pageSize + offset;
+	if(command->action == ACTION_READ_MODIFY_WRITE)
+	{
+		// The page is read into the buffer before the data is clocked in.
+		page = state->address / pageSize;
+		memcpy(state->buffer[command->parameter], &context->memory[page * DATAFLASH_PAGE_SIZE_STD], pageSize);
+	}
+	return 1;
+}
+
+static void modelIn(SPI_EmulatorContext *context, const emulatorCommand *command, uint8_t value)
+{
+	SPI_EmulatorState *state = &context->state;
+	uint32_t pageSize = modelPageSize(state);
+
+	switch(command->action)
+	{
+		case ACTION_SEQUENCE:
+			// Sector protection register data.
+			if(state->dataCount < MODEL_NUM_SECTORS)
+				state->latch[state->dataCount] = value;
+			break;
+		case ACTION_PROGRAM_THROUGH_BUFFER_NO_ERASE:
+			emulatorLatchByte(state, state->latch, pageSize, value);
+			// The data also goes to buffer 1.
+			// Fall through
+		default:
+			emulatorLatchByte(state, state->buffer[command->parameter], pageSize, value);
+			break;
+	}
+}
+
+static uint8_t modelStatus(const SPI_EmulatorState *state, uint32_t index)
+{
+	uint8_t ready = !emulatorBusy(state);
+	uint8_t suspend = 0;
+
+	if(index == 0)
+	{
+		return (ready << 7) | (state->compareMismatch << 6) | MODEL_DENSITY |
+			   (state->protectionEnabled << 1) | state->pageSizeP2;
+	}
+	if(state->suspended)
+	{
+		if(state->operation == OPERATION_ERASE)
+			suspend = 0x01;
+		else if(state->operation == OPERATION_PROGRAM)
+			suspend = 0x02;
+		else if(state->operation == OPERATION_PROGRAM_BUFFER2)
+			suspend = 0x04;
+	}
+	return (ready << 7) | (state->eraseProgramError << 5) | suspend;
+}
+
+static uint8_t modelOut(SPI_EmulatorContext *context, const emulatorCommand *command)
+{
+	SPI_EmulatorState *state = &context->state;
+	uint32_t pageSize = modelPageSize(state);
+	uint8_t value = 0x00;
+
+	switch(command->action)
+	{
+		case ACTION_READ_STATUS:
+			value = modelStatus(state, state->dataCount & 1);
+			break;
+		case ACTION_READ_ARRAY:
+			value = context->memory[modelIndex(state, state->address)];
+			state->address = (state->address + 1) % (MODEL_NUM_PAGES * pageSize);
+			break;
+		case ACTION_READ_PAGE:
+			value = context->memory[modelIndex(state, state->address)];
+			state->address = state->address - (state->address % pageSize) + ((state->address + 1) % pageSize);
+			break;
+		case ACTION_READ_BUFFER:
+			value = state->buffer[command->parameter][(state->address + state->dataCount) % pageSize];
+			break;
+		case ACTION_READ_PROTECTION:
+			value = (state->dataCount < MODEL_NUM_SECTORS) ? state->protection[state->dataCount] : 0x00;
+			break;
+		case ACTION_READ_CONFIG:
+			value = state->config;
+			break;
+		default:
+			break;
+	}
+	return value;
+}
+
+// Commands starting with 0x3D, 0xC7, 0xF0, 0x34 and 0x9B, identified by four bytes.
+static void modelSequence(SPI_EmulatorContext *context)
+{
+	SPI_EmulatorState *state = &context->state;
+	uint32_t sequence = ((uint32_t) state->opcode << 24) | emulatorHeaderAddress(state, 3);
+	uint32_t i;
+
+	switch(sequence)
+	{
+		case CMD_DATAFLASH_CHIP_ERASE:
+			state->eraseProgramError = modelProtected(state, 0, MODEL_NUM_PAGES);
+			if(!state->eraseProgramError)
+			{
+				memset(context->memory, 0xFF, SPI_EMULATOR_ARRAY_SIZE);
+				emulatorStartOperation(context, DATAFLASH_TCE_US, OPERATION_ERASE);
+			}
+			break;
+		case CMD_DATAFLASH_ENABLE_SECT_PROTECTION:
+			state->protectionEnabled = 1;
+			break;
+		case CMD_DATAFLASH_DISABLE_SECT_PROTECTION:
+			state->protectionEnabled = 0;
+			break;
+		case CMD_DATAFLASH_ERASE_SECT_PROT_REG:
+			memset(state->protection, 0xFF, MODEL_NUM_SECTORS);
+			emulatorStartOperation(context, DATAFLASH_TPE_US, OPERATION_OTHER);
+			break;
+		case CMD_DATAFLASH_PROGRAM_SECT_PROT_REG:
+			for(i = 0; (i < state->dataCount) && (i < MODEL_NUM_SECTORS); i++)
+			{
+				state->protection[i] &= state->latch[i];
+			}
+			emulatorStartOperation(context, DATAFLASH_TEP_US - DATAFLASH_TPE_US, OPERATION_OTHER);
+			break;
+		case CMD_DATAFLASH_CONFIGURE_P2_PG_SIZE:
+		case CMD_DATAFLASH_CONFIGURE_STD_PG_SIZE:
+			state->pageSizeP2 = (sequence == CMD_DATAFLASH_CONFIGURE_P2_PG_SIZE);
+			emulatorStartOperation(context, DATAFLASH_TEP_US, OPERATION_OTHER);
+			break;
+		case CMD_DATAFLASH_SOFTWARE_RESET:
+			emulatorSoftReset(state);
+			break;
+#if defined(CMD_DATAFLASH_QUAD_ENABLE)
+		case CMD_DATAFLASH_QUAD_ENABLE:
+		case CMD_DATAFLASH_QUAD_DISABLE:
+			state->config = (sequence == CMD_DATAFLASH_QUAD_ENABLE) ? (state->config | 0x80) : (state->config & ~0x80);
+			emulatorStartOperation(context, DATAFLASH_TEP_US, OPERATION_OTHER);
+			break;
+#endif
+		default:
+			// Sector lockdown, freeze and security register programming have no effect.
+			break;
+	}
+}
+
+static void modelEnd(SPI_EmulatorContext *context, const emulatorCommand *command)
+{
+	SPI_EmulatorState *state = &context->state;
+	uint32_t pageSize = modelPageSize(state);
+	uint32_t page = state->address / pageSize;
+	uint8_t *memory = &context->memory[page * DATAFLASH_PAGE_SIZE_STD];
+	uint8_t *buffer = state->buffer[command->parameter];
+	uint8_t operation = (command->parameter == 1) ? OPERATION_PROGRAM_BUFFER2 : OPERATION_PROGRAM;
+	uint32_t numPages;
+	uint32_t i;
+
+	switch(command->action)
+	{
+		case ACTION_SEQUENCE:
+			modelSequence(context);
+			break;
+		case ACTION_PAGE_TO_BUFFER:
+			memcpy(buffer, memory, pageSize);
+			emulatorStartOperation(context, MODEL_TXFR_US, OPERATION_OTHER);
+			break;
+		case ACTION_COMPARE:
+			state->compareMismatch = (memcmp(buffer, memory, pageSize) != 0);
+			emulatorStartOperation(context, MODEL_TXFR_US, OPERATION_OTHER);
+			break;
+		case ACTION_ERASE:
+			numPages = (command->parameter != 0) ? command->parameter : MODEL_SECTOR_PAGES;
+			// Sectors 0a and 0b are erased separately.
+			if((command->parameter == 0) && (page < MODEL_SECTOR_PAGES))
+			{
+				numPages = (page < 8) ? 8 : MODEL_SECTOR_PAGES - 8;
+				page = (page < 8) ? 0 : 8;
+			}
+			else
+			{
+				page -= page % numPages;
+			}
+			state->eraseProgramError = modelProtected(state, page, numPages);
+			if(state->eraseProgramError)
+				break;
+			memset(&context->memory[page * DATAFLASH_PAGE_SIZE_STD], 0xFF, numPages * DATAFLASH_PAGE_SIZE_STD);
+			if(numPages == 1)
+				emulatorStartOperation(context, DATAFLASH_TPE_US, OPERATION_ERASE);
+			else
+				emulatorStartOperation(context, DATAFLASH_TBE_US * (numPages / 8), OPERATION_ERASE);
+			break;
+		case ACTION_BUFFER_TO_PAGE:
+		case ACTION_PROGRAM_THROUGH_BUFFER:
+		case ACTION_READ_MODIFY_WRITE:
+			state->eraseProgramError = modelProtected(state, page, 1);
+			if(state->eraseProgramError)
+				break;
+			memcpy(memory, buffer, pageSize);
+			emulatorStartOperation(context, DATAFLASH_TEP_US, operation);
+			break;
+		case ACTION_BUFFER_TO_PAGE_NO_ERASE:
+			state->eraseProgramError = modelProtected(state, page, 1);
+			if(state->eraseProgramError)
+				break;
+			for(i = 0; i < pageSize; i++)
+			{
+				emulatorProgramByte(context, page * DATAFLASH_PAGE_SIZE_STD + i, buffer[i]);
+			}
+			emulatorStartOperation(context, DATAFLASH_TEP_US - DATAFLASH_TPE_US, operation);
+			break;
+		case ACTION_PROGRAM_THROUGH_BUFFER_NO_ERASE:
+			state->eraseProgramError = modelProtected(state, page, 1);
+			if(state->eraseProgramError)
+				break;
+			// Only the bytes clocked in are programmed.
+			emulatorProgramLatch(context, state->latch, page * DATAFLASH_PAGE_SIZE_STD, pageSize);
+			emulatorStartOperation(context, DATAFLASH_TEP_US - DATAFLASH_TPE_US, operation);
+			break;
+		default:
+			break;
+	}
+}
+
+/******************************************************************************
+ * Standard flash
+ *****************************************************************************/
+#elif defined(STANDARDFLASH_DEVICE)
+
+// Status register write time.
+#define MODEL_TW_US		5000U
+
+static const emulatorCommand modelCommands[] =
+{
+	{CMD_STANDARDFLASH_WRITE_ENABLE,			ACTION_WRITE_ENABLE,			0,	0, 0, 0, 0},
+	{CMD_STANDARDFLASH_WRITE_DISABLE,			ACTION_WRITE_DISABLE,			0,	0, 0, 0, 0},
+	{CMD_STANDARDFLASH_READ_ARRAY_LF,			ACTION_READ_ARRAY,				0,	3, 0, 0, EMULATOR_READ},
+	{CMD_STANDARDFLASH_READ_ARRAY_HF,			ACTION_READ_ARRAY,				0,	3, 0, 0, EMULATOR_READ},
+	{CMD_STANDARDFLASH_BYTE_PAGE_PROGRAM,		ACTION_PROGRAM,					0,	3, 0, 0, EMULATOR_WRITE | EMULATOR_WEL | EMULATOR_MODIFY},
+	{CMD_STANDARDFLASH_BLOCK_ERASE_4K,			ACTION_ERASE,					12,	3, 0, 0, EMULATOR_WEL | EMULATOR_MODIFY},
+	{CMD_STANDARDFLASH_BLOCK_ERASE_32K,			ACTION_ERASE,					15,	3, 0, 0, EMULATOR_WEL | EMULATOR_MODIFY},
+	{CMD_STANDARDFLASH_BLOCK_ERASE_64K,			ACTION_ERASE,					16,	3, 0, 0, EMULATOR_WEL | EMULATOR_MODIFY},
+	{CMD_STANDARDFLASH_CHIP_ERASE1,				ACTION_ERASE,					0,	0, 0, 0, EMULATOR_WEL | EMULATOR_MODIFY},
+	{CMD_STANDARDFLASH_CHIP_ERASE2,				ACTION_ERASE,					0,	0, 0, 0, EMULATOR_WEL | EMULATOR_MODIFY},
+	{CMD_STANDARDFLASH_DEEP_POWER_DOWN,			ACTION_DEEP_POWER_DOWN,			0,	0, 0, 0, 0},
+	{CMD_STANDARDFLASH_READ_MID,				ACTION_READ_ID,					0,	0, 0, 0, EMULATOR_READ},
+#if defined(CMD_STANDARDFLASH_READ_SRB2)
+	{CMD_STANDARDFLASH_RESUME_FROM_DPD_READ_ID,	ACTION_RESUME,					0,	0, 0, 0, EMULATOR_READ | EMULATOR_POWER_DOWN_OK},
+	{CMD_STANDARDFLASH_WE_FOR_VOLATILE_SR,		ACTION_VOLATILE_WRITE_ENABLE,	0,	0, 0, 0, 0},
+	{CMD_STANDARDFLASH_WRITE_SR,				ACTION_WRITE_STATUS_REGISTERS,	0,	0, 0, 0, EMULATOR_WRITE},
+	{CMD_STANDARDFLASH_READ_SRB1,				ACTION_READ_STATUS,				0,	0, 0, 0, EMULATOR_READ | EMULATOR_BUSY_OK},
+	{CMD_STANDARDFLASH_READ_SRB2,				ACTION_READ_STATUS,				1,	0, 0, 0, EMULATOR_READ | EMULATOR_BUSY_OK},
+	{CMD_STANDARDFLASH_DUAL_OUTPUT_READ,		ACTION_READ_ARRAY,				0,	3, 0, 2, EMULATOR_READ},
+	{CMD_STANDARDFLASH_DUAL_IO_READ,			ACTION_READ_ARRAY,				1,	4, 2, 2, EMULATOR_READ},
+	{CMD_STANDARDFLASH_QUAD_OUTPUT_READ,		ACTION_READ_ARRAY,				0,	3, 0, 4, EMULATOR_READ | EMULATOR_QE},
+	{CMD_STANDARDFLASH_QUAD_IO_READ,			ACTION_READ_ARRAY,				1,	4, 4, 4, EMULATOR_READ | EMULATOR_QE},
+	{CMD_STANDARDFLASH_QUAD_PAGE_PROGRAM,		ACTION_PROGRAM,					0,	3, 4, 4, EMULATOR_WRITE | EMULATOR_WEL | EMULATOR_MODIFY | EMULATOR_QE},
+	{CMD_STANDARDFLASH_ERASE_SECURTIY_REG_PAGE,	ACTION_ERASE_SECURITY,			0,	3, 0, 0, EMULATOR_WEL | EMULATOR_MODIFY},
+	{CMD_STANDARDFLASH_PROGRAM_SECURITY_REG_PAGE, ACTION_PROGRAM_SECURITY,		0,	3, 0, 0, EMULATOR_WRITE | EMULATOR_WEL | EMULATOR_MODIFY},
+	{CMD_STANDARDFLASH_READ_SECURITY_REG_PAGE,	ACTION_READ_SECURITY,			0,	3, 0, 0, EMULATOR_READ},
+	{0x5A,										ACTION_READ_SFDP,				0,	3, 0, 0, EMULATOR_READ},
+#else
+	{CMD_STANDARDFLASH_RESUME_FROM_DPD,			ACTION_RESUME,					0,	0, 0, 0, EMULATOR_POWER_DOWN_OK},
+#endif
+#if defined(CMD_STANDARDFLASH_WRITE_SRB2)
+	{CMD_STANDARDFLASH_WRITE_SRB2,				ACTION_WRITE_STATUS2,			0,	1, 0, 0, 0},
+#endif
+#if defined(CMD_STANDARDFLASH_ERASE_PROGRAM_SUSPEND)
+	{CMD_STANDARDFLASH_ERASE_PROGRAM_SUSPEND,	ACTION_SUSPEND,					0,	0, 0, 0, EMULATOR_BUSY_OK},
+	{CMD_STANDARDFLASH_ERASE_PROGRAM_RESUME,	ACTION_RESUME_OPERATION,		0,	0, 0, 0, EMULATOR_BUSY_OK},
+#endif
+#if defined(CMD_STANDARDFLASH_ENABLE_QPI)
+	{CMD_STANDARDFLASH_ENABLE_QPI,				ACTION_ENABLE_QPI,				0,	0, 0, 0, EMULATOR_QE},
+	{CMD_STANDARDFLASH_DISABLE_QPI,				ACTION_DISABLE_QPI,				0,	0, 0, 0, 0},
+	{CMD_STANDARDFLASH_ENABLE_RESET,			ACTION_ENABLE_RESET,			0,	0, 0, 0, EMULATOR_BUSY_OK},
+	{CMD_STANDARDFLASH_RESET,					ACTION_RESET,					0,	0, 0, 0, EMULATOR_BUSY_OK},
+	{CMD_STANDARDFLASH_ENTER_SECURED_OTP,		ACTION_NOP,						0,	0, 0, 0, 0},
+	{CMD_STANDARDFLASH_EXIT_SECURED_OTP,		ACTION_NOP,						0,	0, 0, 0, 0},
+#endif
+#if defined(CMD_STANDARDFLASH_PROTECT_SECTOR)
+	{CMD_STANDARDFLASH_READ_SR,					ACTION_READ_STATUS,				0,	0, 0, 0, EMULATOR_READ | EMULATOR_BUSY_OK},
+	{CMD_STANDARDFLASH_WRITE_SRB1,				ACTION_WRITE_STATUS,			0,	1, 0, 0, EMULATOR_WEL},
+	{CMD_STANDARDFLASH_DUAL_BYTE_PAGE_PROGRAM,	ACTION_PROGRAM,					0,	3, 0, 2, EMULATOR_WRITE | EMULATOR_WEL | EMULATOR_MODIFY},
+	{CMD_STANDARDFLASH_PROGRAM_ERASE_SUSPEND,	ACTION_SUSPEND,					0,	0, 0, 0, EMULATOR_BUSY_OK},
+	{CMD_STANDARDFLASH_PROGRAM_ERASE_RESUME,	ACTION_RESUME_OPERATION,		0,	0, 0, 0, EMULATOR_BUSY_OK},
+	{CMD_STANDARDFLASH_PROTECT_SECTOR,			ACTION_PROTECT_SECTOR,			0,	3, 0, 0, EMULATOR_WEL},
+	{CMD_STANDARDFLASH_UNPROTECT_SECTOR,		ACTION_UNPROTECT_SECTOR,		0,	3, 0, 0, EMULATOR_WEL},
+	{CMD_STANDARDFLASH_READ_SECT_PROT_REG,		ACTION_READ_PROTECTION,			0,	3, 0, 0, EMULATOR_READ},
+	{CMD_STANDARDFLASH_FREEZE_LOCKDOWN_STATE,	ACTION_NOP,						0,	0, 0, 0, 0},
+	{CMD_STANDARDFLASH_READ_LOCKDOWN_REG,		ACTION_READ_CONSTANT,			0x00, 0, 0, 0, EMULATOR_READ},
+	{CMD_STANDARDFLASH_PROGRAM_OTP_REG,			ACTION_NOP,						0,	0, 0, 0, 0},
+#endif
+};
+
+#if (PARTNO == AT25SF641) || (PARTNO == AT25QF641)
+static const uint8_t modelID[] = {0x1F, 0x32, 0x17};
+#elif (PARTNO == AT25SF321)
+static const uint8_t modelID[] = {0x1F, 0x87, 0x01};
+#elif (PARTNO == AT25SF161)
+static const uint8_t modelID[] = {0x1F, 0x86, 0x01};
+#elif (PARTNO == AT25SF081)
+static const uint8_t modelID[] = {0x1F, 0x85, 0x01};
+#elif (PARTNO == AT25SF041)
+static const uint8_t modelID[] = {0x1F, 0x84, 0x01};
+#elif (PARTNO == AT25SL321) || (PARTNO == AT25QL321)
+static const uint8_t modelID[] = {0x1F, 0x42, 0x16};
+#elif (PARTNO == AT25SL641) || (PARTNO == AT25QL641)
+static const uint8_t modelID[] = {0x1F, 0x43, 0x17};
+#elif (PARTNO == AT25SL128A) || (PARTNO == AT25QL128A)
+static const uint8_t modelID[] = {0x1F, 0x42, 0x18};
+#elif (PARTNO == AT25DL081)
+static const uint8_t modelID[] = {0x1F, 0x45, 0x02};
+#elif (PARTNO == AT25DL161)
+static const uint8_t modelID[] = {0x1F, 0x46, 0x03};
+#elif (PARTNO == AT25DF081A)
+static const uint8_t modelID[] = {0x1F, 0x45, 0x01};
+#elif (PARTNO == AT25DF321A)
+static const uint8_t modelID[] = {0x1F, 0x47, 0x01};
+#elif (PARTNO == AT25DF641A)
+static const uint8_t modelID[] = {0x1F, 0x48, 0x00};
+#endif
+
+static const emulatorCommand *modelFind(SPI_EmulatorContext *context, uint8_t opcode)
+{
+	(void) context;
+	return emulatorFindCommand(modelCommands, sizeof(modelCommands) / sizeof(modelCommands[0]), opcode);
+}
+
+static uint8_t modelQuadEnabled(const SPI_EmulatorState *state)
+{
+#if defined(CMD_STANDARDFLASH_READ_SRB2)
+	return (state->status[1] & 0x02) != 0;
+#else
+	(void) state;
+	return 0;
+#endif
+}
+
+static void modelOpen(SPI_EmulatorContext *context)
+{
+	context->state.status[0] = 0x00;
+	context->state.status[1] = 0x00;
+}
+
+static void modelPowerUp(SPI_EmulatorContext *context)
+{
+#if defined(EMULATOR_SECTOR_SIZE)
+	context->state.status[0] = 0x00;
+	memset(context->state.protection, 0xFF, EMULATOR_NUM_SECTORS);
+#else
+	(void) context;
+#endif
+}
+
+static uint8_t modelBegin(SPI_EmulatorContext *context, const emulatorCommand *command)
+{
+	SPI_EmulatorState *state = &context->state;
+
+	if(command->headerNumBytes >= 3)
+	{
+		state->address = emulatorHeaderAddress(state, 3) % SPI_EMULATOR_ARRAY_SIZE;
+	}
+	switch(command->action)
+	{
+		case ACTION_READ_ARRAY:
+			// Mode bits 5:4 = 10b keep the next read going without its opcode.
+			if(command->parameter)
+				state->continuousRead = ((state->header[3] & 0x30) == 0x20) ? command->opcode : 0;
+			break;
+#if defined(CMD_STANDARDFLASH_READ_SRB2)
+		case ACTION_WRITE_STATUS_REGISTERS:
+		case ACTION_WRITE_STATUS2:
+			return state->wel || state->volatileWel;
+		case ACTION_ERASE_SECURITY:
+		case ACTION_PROGRAM_SECURITY:
+		case ACTION_READ_SECURITY:
+			// Security registers 1 to 3 are at 0x001000, 0x002000 and 0x003000.
+			return ((state->address >> 12) & 0x3) != 0;
+#endif
+		default:
+			break;
+	}
+	return 1;
+}
+
+static void modelIn(SPI_EmulatorContext *context, const emulatorCommand *command, uint8_t value)
+{
+	SPI_EmulatorState *state = &context->state;
+
+	if(command->action == ACTION_WRITE_STATUS_REGISTERS)
+	{
+		if(state->dataCount < 2)
+			state->latch[state->dataCount] = value;
+		return;
+	}
+	emulatorLatchByte(state, state->latch, STANDARDFLASH_PAGE_SIZE, value);
+}
+
+#if !defined(EMULATOR_SECTOR_SIZE)
+// Device ID returned by the resume from deep power down command: log2 of the size in bytes, minus 1.
+static uint8_t modelDeviceID(void)
+{
+	uint32_t size;
+	uint8_t id = 0;
+	for(size = SPI_EMULATOR_ARRAY_SIZE; size > 2; size >>= 1)
+	{
+		id++;
+	}
+	return id;
+}
+
+// Programs the latch into the addressed security register; returns the number of bytes.
+static uint32_t modelProgramSecurity(SPI_EmulatorState *state)
+{
+	uint8_t *reg = state->security[(state->address >> 12) & 0x3];
+	uint32_t numBytes = (state->dataCount < 256) ? state->dataCount : 256;
+	uint32_t i;
+	for(i = 0; i < numBytes; i++)
+	{
+		reg[(state->address + i) & 0xFF] &= state->latch[(state->address + i) & 0xFF];
+	}
+	return numBytes;
+}
+#endif
+
+#if defined(CMD_STANDARDFLASH_READ_SRB2)
+/*
+ * SFDP (JESD216B): the header, one parameter header and a 16 DWORD Basic
+ * Flash Parameter Table at 0x30, describing the 1-1-2, 1-2-2, 1-1-4 and
+ * 1-4-4 reads, the 4, 32 and 64 KB erases, 256 byte pages and QE in bit 1
+ * of status register 2. Bytes past the table read as 0xFF.
+ */
+static uint8_t modelSFDP(uint32_t address)
+{
+	static const uint8_t header[16] =
+	{
+		'S', 'F', 'D', 'P', 0x06, 0x01, 0x00, 0xFF,
+		0x00, 0x06, 0x01, 16, 0x30, 0x00, 0x00, 0xFF
+	};
+	uint32_t dword;
+
+	if(address < sizeof(header))
+	{
+		return header[address];
+	}
+	if((address < 0x30) || (address >= 0x30 + 16 * 4))
+	{
+		return 0xFF;
+	}
+	switch((address - 0x30) / 4)
+	{
+		// 4 KB erase 0x20, 1-1-2, 1-2-2, 1-4-4 and 1-1-4 reads, 3 byte addresses.
+		case 0:		dword = 0xFFF12005U; break;
+		case 1:		dword = FLASH_PART->capacity * 8U - 1U; break;
+		// 1-4-4: 0xEB, 2 mode and 4 dummy clocks. 1-1-4: 0x6B, 8 dummy clocks.
+		case 2:		dword = 0x6B08EB44U; break;
+		// 1-1-2: 0x3B, 8 dummy clocks. 1-2-2: 0xBB, 4 mode clocks.
+		case 3:		dword = 0xBB803B08U; break;
+		case 4:		dword = 0xFFFFFFEEU | ((FLASH_PART->flags & FLASH_PART_QPI) ? 0x10U : 0x00U); break;
+		case 5:
+		case 6:		dword = 0x0000FFFFU; break;
+		// Erase types 4 KB 0x20, 32 KB 0x52 and 64 KB 0xD8.
+		case 7:		dword = 0x520F200CU; break;
+		case 8:		dword = 0x0000D810U; break;
+		// 256 byte pages.
+		case 10:	dword = 0x00000080U; break;
+		// QER 100b.
+		case 14:	dword = 0x00400000U; break;
+		default:	dword = 0x00000000U; break;
+	}
+	return (uint8_t) (dword >> (8 * ((address - 0x30) % 4)));
+}
+#endif
+
+static uint8_t modelOut(SPI_EmulatorContext *context, const emulatorCommand *command)
+{
+	SPI_EmulatorState *state = &context->state;
+	uint8_t value = 0x00;
+
+	switch(command->action)
+	{
+		case ACTION_READ_ARRAY:
+			value = context->memory[state->address];
+			state->address = (state->address + 1) % SPI_EMULATOR_ARRAY_SIZE;
+			break;
+#if defined(EMULATOR_SECTOR_SIZE)
+		case ACTION_READ_STATUS:
+			if(!(state->dataCount & 1))
+				return emulatorProtectionStatusByte(state);
+			value = emulatorBusy(state) | (state->status[1] & 0x10);
+			if(state->suspended)
+				value |= (state->operation == OPERATION_ERASE) ? 0x02 : 0x04;
+			break;
+		case ACTION_READ_PROTECTION:
+			value = state->protection[state->address / EMULATOR_SECTOR_SIZE];
+			break;
+#else
+		case ACTION_READ_STATUS:
+			if(command->parameter == 0)
+				value = (state->status[0] & 0xFC) | (state->wel << 1) | emulatorBusy(state);
+			else
+				value = (state->status[1] & 0x7F) | (state->suspended << 7);
+			break;
+		case ACTION_READ_SECURITY:
+			value = state->security[(state->address >> 12) & 0x3][(state->address + state->dataCount) & 0xFF];
+			break;
+		case ACTION_RESUME:
+			value = modelDeviceID();
+			break;
+		case ACTION_READ_SFDP:
+			value = modelSFDP(state->address++);
+			break;
+#endif
+		default:
+			break;
+	}
+	return value;
+}
+
+static uint8_t modelProtected(const SPI_EmulatorState *state, uint32_t address, uint32_t numBytes)
+{
+#if defined(EMULATOR_SECTOR_SIZE)
+	return emulatorProtected(state, address, numBytes);
+#else
+	(void) state;
+	(void) address;
+	(void) numBytes;
+	return 0;
+#endif
+}
+
+static void modelEnd(SPI_EmulatorContext *context, const emulatorCommand *command)
+{
+	SPI_EmulatorState *state = &context->state;
+	uint32_t size = 1U << command->parameter;
+	uint32_t numBytes;
+	uint32_t us;
+
+	switch(command->action)
+	{
+		case ACTION_VOLATILE_WRITE_ENABLE:
+			state->volatileWel = 1;
+			break;
+#if defined(EMULATOR_SECTOR_SIZE)
+		case ACTION_WRITE_STATUS:
+			emulatorWriteProtectionStatus(state, state->header[0]);
+			state->wel = 0;
+			break;
+		case ACTION_WRITE_STATUS2:
+			// Only RSTE is writable.
+			state->status[1] = state->header[0] & 0x10;
+			state->wel = 0;
+			break;
+		case ACTION_PROTECT_SECTOR:
+			state->protection[state->address / EMULATOR_SECTOR_SIZE] = 0xFF;
+			state->wel = 0;
+			break;
+		case ACTION_UNPROTECT_SECTOR:
+			state->protection[state->address / EMULATOR_SECTOR_SIZE] = 0x00;
+			state->wel = 0;
+			break;
+#else
+		case ACTION_WRITE_STATUS_REGISTERS:
+		case ACTION_WRITE_STATUS2:
+			if(command->action == ACTION_WRITE_STATUS2)
+				state->status[1] = state->header[0] & 0x7F;
+			else if(state->dataCount > 0)
+				state->status[0] = state->latch[0] & 0xFC;
+			if((command->action == ACTION_WRITE_STATUS_REGISTERS) && (state->dataCount > 1))
+				state->status[1] = state->latch[1] & 0x7F;
+			// Volatile writes take effect immediately.
+			if(!state->volatileWel)
+				emulatorStartOperation(context, MODEL_TW_US, OPERATION_OTHER);
+			state->wel = 0;
+			state->volatileWel = 0;
+			break;
+		case ACTION_ERASE_SECURITY:
+			state->wel = 0;
+			memset(state->security[(state->address >> 12) & 0x3], 0xFF, 256);
+			emulatorStartOperation(context, STANDARDFLASH_TBE4K_US, OPERATION_ERASE);
+			break;
+		case ACTION_PROGRAM_SECURITY:
+			state->wel = 0;
+			numBytes = modelProgramSecurity(state);
+			emulatorStartOperation(context, emulatorProgramUs(STANDARDFLASH_TPP_US, numBytes, 256), OPERATION_PROGRAM);
+			break;
+		case ACTION_ENABLE_QPI:
+			state->qpi = 1;
+			break;
+		case ACTION_DISABLE_QPI:
+			state->qpi = 0;
+			break;
+		case ACTION_RESET:
+			if(state->resetEnabled)
+				emulatorSoftReset(state);
+			break;
+#endif
+		case ACTION_ERASE:
+			state->wel = 0;
+			if(command->parameter == 0)
+			{
+				size = SPI_EMULATOR_ARRAY_SIZE;
+				us = STANDARDFLASH_TCE_US;
+			}
+			else
+			{
+				us = (command->parameter == 12) ? STANDARDFLASH_TBE4K_US : STANDARDFLASH_TBE64K_US;
+			}
+			state->address -= state->address % size;
+			state->eraseProgramError = modelProtected(state, state->address, size);
+			if(!state->eraseProgramError)
+			{
+				memset(&context->memory[state->address], 0xFF, size);
+				emulatorStartOperation(context, us, OPERATION_ERASE);
+			}
+			break;
+		case ACTION_PROGRAM:
+			state->wel = 0;
+			state->eraseProgramError = modelProtected(state, state->address, 1);
+			if(!state->eraseProgramError)
+			{
+				numBytes = emulatorProgramLatch(context, state->latch, state->address - (state->address % STANDARDFLASH_PAGE_SIZE), STANDARDFLASH_PAGE_SIZE);
+				emulatorStartOperation(context, emulatorProgramUs(STANDARDFLASH_TPP_US, numBytes, STANDARDFLASH_PAGE_SIZE), OPERATION_PROGRAM);
+			}
+			break;
+		default:
+			break;
+	}
+}
+
+#endif
+
+/******************************************************************************
+ * Frame decoding
+ *****************************************************************************/
+
+static uint8_t emulatorOpcodeLines(const SPI_EmulatorState *state)
+{
+	return state->qpi ? 4 : 1;
+}
+
+static uint8_t emulatorLines(const SPI_EmulatorState *state, uint8_t lines)
+{
+	return (lines != 0) ? lines : emulatorOpcodeLines(state);
+}
+
+static void emulatorClock(SPI_EmulatorContext *context, uint8_t ioLines)
+{
+	uint32_t clocks = 8U / ioLines;
+	context->stats.sckCycles += clocks;
+	context->state.timePs += clocks * context->state.psPerClock;
+}
+
+static void emulatorFrameStart(SPI_EmulatorContext *context)
+{
+	SPI_EmulatorState *state = &context->state;
+	const emulatorCommand *command;
+
+	state->command = NULL;
+	state->headerNumBytes = 0;
+	state->headerCount = 0;
+	state->ignore = IGNORE_NONE;
+	state->allOnes = 1;
+	state->continued = 0;
+	state->dataCount = 0;
+	context->stats.frames++;
+	if(state->powerDown == 2)
+	{
+		// CSb wakes the device from ultra deep power down, which misses the frame.
+		state->powerDown = 0;
+		state->ignore = IGNORE_REFUSED;
+	}
+	else if(state->continuousRead != 0)
+	{
+		// The frame starts with the address of the read.
+		command = modelFind(context, state->continuousRead);
+		state->command = command;
+		state->opcode = command->opcode;
+		state->headerNumBytes = command->headerNumBytes;
+		state->continued = 1;
+	}
+}
+
+static void emulatorHeaderDone(SPI_EmulatorContext *context)
+{
+	if(!modelBegin(context, (const emulatorCommand *) context->state.command))
+	{
+		context->state.ignore = IGNORE_REFUSED;
+	}
+}
+
+static void emulatorOpcode(SPI_EmulatorContext *context, uint8_t opcode)
+{
+	SPI_EmulatorState *state = &context->state;
+	const emulatorCommand *command = modelFind(context, opcode);
+
+	state->opcode = opcode;
+	if(command == NULL)
+	{
+		state->ignore = IGNORE_UNSUPPORTED;
+		return;
+	}
+	if(((state->powerDown != 0) && !(command->attributes & EMULATOR_POWER_DOWN_OK)) ||
+	   (emulatorBusy(state) && !(command->attributes & EMULATOR_BUSY_OK)) ||
+	   (state->suspended && (command->attributes & EMULATOR_MODIFY)) ||
+	   ((command->attributes & EMULATOR_WEL) && !state->wel) ||
+	   ((command->attributes & EMULATOR_QE) && !modelQuadEnabled(state)))
+	{
+		state->ignore = IGNORE_REFUSED;
+		return;
+	}
+	state->command = command;
+	state->headerNumBytes = command->headerNumBytes;
+	if(state->headerNumBytes == 0)
+	{
+		emulatorHeaderDone(context);
+	}
+}
+
+// A byte clocked from the host to the device.
+static void emulatorIn(SPI_EmulatorContext *context, uint8_t value, uint8_t ioLines)
+{
+	SPI_EmulatorState *state = &context->state;
+	const emulatorCommand *command = (const emulatorCommand *) state->command;
+
+	emulatorClock(context, ioLines);
+	if(value != 0xFF)
+	{
+		state->allOnes = 0;
+	}
+	if(state->ignore != IGNORE_NONE)
+	{
+		return;
+	}
+	if(command == NULL)
+	{
+		if(ioLines != emulatorOpcodeLines(state))
+			state->ignore = IGNORE_WIRE_ERROR;
+		else
+			emulatorOpcode(context, value);
+	}
+	else if(state->headerCount < state->headerNumBytes)
+	{
+		if(ioLines != emulatorLines(state, command->addressLines))
+		{
+			state->ignore = IGNORE_WIRE_ERROR;
+			return;
+		}
+		state->header[state->headerCount++] = value;
+		if(state->headerCount == state->headerNumBytes)
+		{
+			emulatorHeaderDone(context);
+		}
+	}
+	else if(command->attributes & EMULATOR_WRITE)
+	{
+		if(ioLines != emulatorLines(state, command->dataLines))
+		{
+			state->ignore = IGNORE_WIRE_ERROR;
+			return;
+		}
+		modelIn(context, command, value);
+		state->dataCount++;
+	}
+}
+
+// A byte clocked from the device to the host.
+static uint8_t emulatorOut(SPI_EmulatorContext *context, uint8_t ioLines)
+{
+	SPI_EmulatorState *state = &context->state;
+	const emulatorCommand *command = (const emulatorCommand *) state->command;
+	uint8_t value;
+
+	emulatorClock(context, ioLines);
+	if((state->ignore != IGNORE_NONE) || (command == NULL) ||
+	   (state->headerCount < state->headerNumBytes) || !(command->attributes & EMULATOR_READ))
+	{
+		return emulatorNoise(state);
+	}
+	if(ioLines != emulatorLines(state, command->dataLines))
+	{
+		state->ignore = IGNORE_WIRE_ERROR;
+		return emulatorNoise(state);
+	}
+	switch(command->action)
+	{
+		case ACTION_READ_CONSTANT:
+			value = command->parameter;
+			break;
+		case ACTION_READ_ID:
+			value = (state->dataCount < sizeof(modelID)) ? modelID[state->dataCount] : 0x00;
+			break;
+		default:
+			value = modelOut(context, command);
+			break;
+	}
+	state->dataCount++;
+	return value;
+}
+
+static void emulatorEnd(SPI_EmulatorContext *context, const emulatorCommand *command)
+{
+	SPI_EmulatorState *state = &context->state;
+
+	switch(command->action)
+	{
+		case ACTION_WRITE_ENABLE:
+			state->wel = 1;
+			break;
+		case ACTION_WRITE_DISABLE:
+			state->wel = 0;
+			state->sequentialProgram = 0;
+			break;
+		case ACTION_DEEP_POWER_DOWN:
+			state->powerDown = 1;
+			break;
+		case ACTION_RESUME:
+			state->powerDown = 0;
+			break;
+		case ACTION_ULTRA_DEEP_POWER_DOWN:
+			state->powerDown = 2;
+			break;
+		case ACTION_SUSPEND:
+			emulatorSuspend(state);
+			break;
+		case ACTION_RESUME_OPERATION:
+			emulatorResume(state);
+			break;
+		default:
+			modelEnd(context, command);
+			break;
+	}
+	// The reset enable only holds up to the next command.
+	state->resetEnabled = (command->action == ACTION_ENABLE_RESET);
+}
+
+static void emulatorFrameEnd(SPI_EmulatorContext *context)
+{
+	SPI_EmulatorState *state = &context->state;
+	const emulatorCommand *command = (const emulatorCommand *) state->command;
+
+	if(state->continued && state->allOnes && (state->headerCount < state->headerNumBytes))
+	{
+		// Mode bit reset: 0xFF clocked in place of the address ends the continuous read.
+		state->continuousRead = 0;
+		return;
+	}
+	switch(state->ignore)
+	{
+		case IGNORE_NONE:
+			if(command == NULL)
+				break;
+			if(state->headerCount < state->headerNumBytes)
+				context->stats.ignoredFrames++;
+			else
+				emulatorEnd(context, command);
+			break;
+		case IGNORE_REFUSED:
+			context->stats.ignoredFrames++;
+			break;
+		case IGNORE_UNSUPPORTED:
+			context->stats.unsupportedFrames++;
+			break;
+		default:
+			context->stats.wireErrors++;
+			break;
+	}
+}
+
+static void emulatorExchange(void *context, const SPI_Transfer *transfer)
+{
+	SPI_EmulatorContext *emulator = (SPI_EmulatorContext *) context;
+	uint32_t sckHz = emulator->sckHz;
+	uint32_t i;
+	uint8_t value;
+
+	if((transfer->clockHz != 0) && (transfer->clockHz < sckHz))
+	{
+		sckHz = transfer->clockHz;
+	}
+	emulatorUpdateTime(emulator);
+	emulator->state.psPerClock = 1000000000000ULL / sckHz;
+	if(!(transfer->flags & SPI_TRANSFER_CONTINUE))
+	{
+		emulatorFrameStart(emulator);
+	}
+	for(i = 0; i < transfer->txNumBytes; i++)
+	{
+		emulatorIn(emulator, transfer->txBuffer[i], (i < transfer->txSingleNumBytes) ? 1 : transfer->ioLines);
+	}
+	for(i = 0; i < transfer->txPayloadNumBytes; i++)
+	{
+		emulatorIn(emulator, transfer->txPayload[i], transfer->ioLines);
+	}
+	for(i = 0; i < transfer->dummyNumBytes; i++)
+	{
+		// The device does not look at dummy clocks.
+		emulatorClock(emulator, transfer->dummyIOLines);
+		emulator->state.allOnes = 0;
+	}
+	for(i = 0; i < transfer->rxNumBytes; i++)
+	{
+		value = emulatorOut(emulator, transfer->ioLines);
+		if(transfer->rxBuffer != NULL)
+		{
+			transfer->rxBuffer[i] = value;
+		}
+	}
+	if(!(transfer->flags & SPI_TRANSFER_HOLD_CS))
+	{
+		emulatorFrameEnd(emulator);
+	}
+}
+
+static void emulatorJEDECReset(void *context)
+{
+	SPI_EmulatorContext *emulator = (SPI_EmulatorContext *) context;
+	emulatorUpdateTime(emulator);
+	emulatorSoftReset(&emulator->state);
+}
+
+void SPI_EmulatorOpen(SPI_Transport *transport, SPI_EmulatorContext *context, uint8_t *memory)
+{
+	memset(context, 0, sizeof(*context));
+	context->memory = memory;
+	context->busyScalePercent = 100;
+	context->sckHz = SPI_EMULATOR_SCK_HZ;
+	context->state.noise = 0x2545F491U;
+	context->state.lastCycleCount = USER_CONFIG_CycleCount();
+	memset(memory, 0xFF, SPI_EMULATOR_ARRAY_SIZE);
+	modelOpen(context);
+	SPI_EmulatorPowerCycle(context);
+
+	transport->name = "emulator";
+	transport->init = NULL;
+	transport->exchange = emulatorExchange;
+	transport->jedecReset = emulatorJEDECReset;
+	transport->start = NULL;
+	transport->context = context;
+}
+
+void SPI_EmulatorPowerCycle(SPI_EmulatorContext *context)
+{
+	emulatorUpdateTime(context);
+	emulatorSoftReset(&context->state);
+	modelPowerUp(context);
+}
+
+uint64_t SPI_EmulatorTimeNs(SPI_EmulatorContext *context)
+{
+	emulatorUpdateTime(context);
+	return context->state.timePs / 1000U;
+}
+
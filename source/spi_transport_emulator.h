@@ -0,0 +1,292 @@
+/*
+ * The Clear BSD License
+ * Copyright (c) 2018 Adesto Technologies Corporation, Inc
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted (subject to the limitations in the disclaimer below) provided
+ *  that the following conditions are met:
+ *
+ * o Redistributions of source code must retain the above copyright notice, this list
+ *   of conditions and the following disclaimer.
+ *
+ * o Redistributions in binary form must reproduce the above copyright notice, this
+ *   list of conditions and the following disclaimer in the documentation and/or
+ *   other materials provided with the distribution.
+ *
+ * o Neither the name of the copyright holder nor the names of its
+ *   contributors may be used to endorse or promote products derived from this
+ *   software without specific prior written permission.
+ *
+ * NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE GRANTED BY THIS LICENSE.
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*!
+ * @ingroup SPI_LAYER
+ */
+/**
+ * @file    spi_transport_emulator.h
+ * @brief   Declarations of the flash emulator SPI transport.
+ *
+ * This transport is a software model of the part selected with PARTNO. It
+ * decodes the bytes of every SPI_Transfer as the device would see them on
+ * its pins, so the Adesto layer, test.c and the benchmarks run unchanged on
+ * a host with no hardware attached.
+ *
+ * The model keeps the memory array and enforces erase before program:
+ * programming can only clear bits (Moneta, being byte alterable, is the
+ * exception). Programs and erases keep the device busy for the typical
+ * times of cmd_defs.h, during which it only answers status reads, suspend
+ * and reset, exactly like the part. Device time is the host time plus the
+ * time taken by the emulated bus, which is charged per clock at the lower of
+ * SPI_EmulatorContext.sckHz and the transfer's clockHz. Phases clocked on the
+ * wrong number of IOs, commands missing their write enable and commands sent
+ * while busy are ignored by the device and counted in SPI_EmulatorStats.
+ *
+ * Modelled per family:
+ * - Moneta: byte alterable array, status register, UDPD.
+ * - Fusion: reads, dual output and dual input, page/block/chip erase,
+ *   sequential program mode, sector protection, Active Status Interrupt,
+ *   DPD and UDPD.
+ * - DataFlash: both SRAM buffers, buffer to main memory with and without
+ *   erase, read-modify-write, compare, standard and power of 2 page sizes,
+ *   page/block/sector/chip erase, sector protection, suspend, quad enable.
+ * - Standard flash: dual and quad output and IO reads with continuous read
+ *   mode, QPI, status registers with the QE bit, security registers,
+ *   suspend, reset, and for the AT25DL/DF-A parts sector protection.
+ *
+ * OTP registers, sector lockdown and the block protect bits of the status
+ * registers are accepted but have no effect.
+ */
+#ifndef SPI_TRANSPORT_EMULATOR_H_
+#define SPI_TRANSPORT_EMULATOR_H_
+
+#include "spi_transport.h"
+#include "cmd_defs.h"
+
+/*!
+ * @brief Default SCK of the emulated bus in Hz. 1 MHz is in the range the
+ * bit-bang transport reaches on the K82, so sequences written for the board
+ * without status polling (e.g. Fusion sequential program mode) behave the
+ * same on the emulator.
+ */
+#ifndef SPI_EMULATOR_SCK_HZ
+#define SPI_EMULATOR_SCK_HZ 1000000U
+#endif
+
+//! Number of address, mode and argument bytes kept per command.
+#define SPI_EMULATOR_HEADER_BYTES 4
+//! Size of the program latch and of each DataFlash buffer.
+#define SPI_EMULATOR_LATCH_BYTES 528
+//! Maximum number of protection sectors.
+#define SPI_EMULATOR_MAX_SECTORS 256
+
+/*!
+ * @brief Size in bytes of the array of the selected part, which is the size
+ * of the memory passed to SPI_EmulatorOpen(). DataFlash arrays are stored as
+ * standard size pages (DATAFLASH_PAGE_SIZE_STD bytes each).
+ */
+#if defined(MONETA_DEVICE)
+// The whole 16-bit address space.
+#define SPI_EMULATOR_ARRAY_SIZE		0x10000U
+#elif (PARTNO == AT25DN256) || (PARTNO == AT25DF256)
+#define SPI_EMULATOR_ARRAY_SIZE		0x8000U
+#elif (PARTNO == AT25XE512C) || (PARTNO == AT25DN512C) || (PARTNO == AT25DF512C)
+#define SPI_EMULATOR_ARRAY_SIZE		0x10000U
+#elif (PARTNO == AT25XE011) || (PARTNO == AT25DN011) || (PARTNO == AT25DF011)
+#define SPI_EMULATOR_ARRAY_SIZE		0x20000U
+#elif (PARTNO == AT25XE021A) || (PARTNO == AT25DF021A) || (PARTNO == AT25XV021A)
+#define SPI_EMULATOR_ARRAY_SIZE		0x40000U
+#elif (PARTNO == AT25XE041B) || (PARTNO == AT25DF041B) || (PARTNO == AT25XV041B)
+#define SPI_EMULATOR_ARRAY_SIZE		0x80000U
+#elif (PARTNO == AT45DB021E) || (PARTNO == AT25PE20)
+#define SPI_EMULATOR_ARRAY_SIZE		(1024U * DATAFLASH_PAGE_SIZE_STD)
+#elif (PARTNO == AT45DB041E) || (PARTNO == AT25PE40)
+#define SPI_EMULATOR_ARRAY_SIZE		(2048U * DATAFLASH_PAGE_SIZE_STD)
+#elif (PARTNO == AT45DB081E) || (PARTNO == AT25PE80) || \
+	(PARTNO == AT45DB161E) || (PARTNO == AT45DQ161) || (PARTNO == AT25PE16)
+#define SPI_EMULATOR_ARRAY_SIZE		(4096U * DATAFLASH_PAGE_SIZE_STD)
+#elif (PARTNO == AT45DB321E) || (PARTNO == AT45DQ321)
+#define SPI_EMULATOR_ARRAY_SIZE		(8192U * DATAFLASH_PAGE_SIZE_STD)
+#elif (PARTNO == AT45DB641E)
+#define SPI_EMULATOR_ARRAY_SIZE		(32768U * DATAFLASH_PAGE_SIZE_STD)
+#elif (PARTNO == AT25SF041)
+#define SPI_EMULATOR_ARRAY_SIZE		0x80000U
+#elif (PARTNO == AT25SF081) || (PARTNO == AT25DL081) || (PARTNO == AT25DF081A)
+#define SPI_EMULATOR_ARRAY_SIZE		0x100000U
+#elif (PARTNO == AT25SF161) || (PARTNO == AT25DL161)
+#define SPI_EMULATOR_ARRAY_SIZE		0x200000U
+#elif (PARTNO == AT25SF321) || (PARTNO == AT25SL321) || (PARTNO == AT25DF321A) || (PARTNO == AT25QL321)
+#define SPI_EMULATOR_ARRAY_SIZE		0x400000U
+#elif (PARTNO == AT25SF641) || (PARTNO == AT25SL641) || (PARTNO == AT25DF641A) || \
+	(PARTNO == AT25QL641) || (PARTNO == AT25QF641)
+#define SPI_EMULATOR_ARRAY_SIZE		0x800000U
+#elif (PARTNO == AT25SL128A) || (PARTNO == AT25QL128A)
+#define SPI_EMULATOR_ARRAY_SIZE		0x1000000U
+#endif
+
+/*!
+ * @brief Counters kept by the emulator. They show what the device did with
+ * the traffic it received, and how long it spent doing it.
+ */
+typedef struct
+{
+	//! Number of CSb framed transactions.
+	uint32_t frames;
+	//! Frames the device did not act on: sent while busy or powered down,
+	//! missing the write enable, quad enable or reset enable, or cut short.
+	uint32_t ignoredFrames;
+	//! Frames starting with an opcode the model does not implement.
+	uint32_t unsupportedFrames;
+	//! Frames with a phase clocked on the wrong number of IOs.
+	uint32_t wireErrors;
+	//! Bytes programmed over bits that were not erased.
+	uint32_t unerasedBytes;
+	//! Program, erase and status register write operations started.
+	uint32_t operations;
+	//! SCK cycles clocked.
+	uint64_t sckCycles;
+	//! Time spent busy in ns, including time still to come.
+	uint64_t busyNs;
+} SPI_EmulatorStats;
+
+/*!
+ * @brief State of the emulated device. Managed by the emulator.
+ */
+typedef struct
+{
+	//! Device time in ps.
+	uint64_t timePs;
+	//! USER_CONFIG_CycleCount() at the last update of timePs.
+	uint32_t lastCycleCount;
+	//! Time at which the running operation ends, in ps.
+	uint64_t busyUntilPs;
+	//! Time left to the suspended operation, in ps.
+	uint64_t suspendedPs;
+	//! 1 while an operation is suspended.
+	uint8_t suspended;
+	//! Kind of the running or suspended operation.
+	uint8_t operation;
+	//! 1 after a program or erase failed on a protected sector.
+	uint8_t eraseProgramError;
+	//! 1 if the last DataFlash compare found a mismatch.
+	uint8_t compareMismatch;
+	//! 0 when active, 1 in deep power down, 2 in ultra deep power down.
+	uint8_t powerDown;
+	//! Write enable latch.
+	uint8_t wel;
+	//! Status register bytes.
+	uint8_t status[2];
+	//! 1 in QPI mode.
+	uint8_t qpi;
+	//! Opcode of the read running in continuous read mode, 0 if none.
+	uint8_t continuousRead;
+	//! 1 once the reset enable command has been received.
+	uint8_t resetEnabled;
+	//! 1 after the write enable for volatile status register command.
+	uint8_t volatileWel;
+	//! 1 in Fusion sequential program mode.
+	uint8_t sequentialProgram;
+	//! DataFlash configuration register.
+	uint8_t config;
+	//! 1 if DataFlash pages are DATAFLASH_PAGE_SIZE_P2 bytes.
+	uint8_t pageSizeP2;
+	//! 1 if DataFlash sector protection is enabled.
+	uint8_t protectionEnabled;
+	//! Protection of each sector, 0xFF if protected.
+	uint8_t protection[SPI_EMULATOR_MAX_SECTORS];
+	//! DataFlash buffers 1 and 2.
+	uint8_t buffer[2][SPI_EMULATOR_LATCH_BYTES];
+	//! Data clocked in by the current program command.
+	uint8_t latch[SPI_EMULATOR_LATCH_BYTES];
+	//! Standard flash security registers 1 to 3 (index 0 is unused).
+	uint8_t security[4][256];
+	//! Current frame: command descriptor, NULL before the opcode.
+	const void *command;
+	//! Current frame: opcode.
+	uint8_t opcode;
+	//! Current frame: address, mode and argument bytes.
+	uint8_t header[SPI_EMULATOR_HEADER_BYTES];
+	//! Current frame: number of header bytes expected and received.
+	uint8_t headerNumBytes;
+	//! See headerNumBytes.
+	uint8_t headerCount;
+	//! Current frame: non-zero, with the reason, once the device stopped listening.
+	uint8_t ignore;
+	//! Current frame: 1 while every byte clocked in was 0xFF.
+	uint8_t allOnes;
+	//! Current frame: 1 if it started in continuous read mode.
+	uint8_t continued;
+	//! Current frame: number of data bytes clocked in or out.
+	uint32_t dataCount;
+	//! Current frame: array, buffer or register offset of the next data byte.
+	uint32_t address;
+	//! Current transfer: duration of one SCK cycle in ps.
+	uint64_t psPerClock;
+	//! State of the generator of the levels of a floating SO.
+	uint32_t noise;
+} SPI_EmulatorState;
+
+/*!
+ * @brief Emulated device.
+ */
+typedef struct
+{
+	//! The array, SPI_EMULATOR_ARRAY_SIZE bytes.
+	uint8_t *memory;
+	//! Busy times in percent of the typical times of cmd_defs.h.
+	//! 100 by default, 0 for a device that is never busy.
+	uint32_t busyScalePercent;
+	//! SCK of the emulated bus in Hz, @ref SPI_EMULATOR_SCK_HZ by default.
+	uint32_t sckHz;
+	//! Counters. May be cleared at any time.
+	SPI_EmulatorStats stats;
+	//! Device state.
+	SPI_EmulatorState state;
+} SPI_EmulatorContext;
+
+/*!
+ * @brief Fills in a transport that emulates the selected part, erases the
+ * array and powers the device up. Select the transport afterwards with
+ * SPI_SetTransport().
+ *
+ * @param transport The transport to be filled in.
+ * @param context Storage for the device. Must remain valid while the
+ * transport is in use.
+ * @param memory The array, SPI_EMULATOR_ARRAY_SIZE bytes.
+ *
+ * @retval void
+ */
+void SPI_EmulatorOpen(SPI_Transport *transport, SPI_EmulatorContext *context, uint8_t *memory);
+
+/*!
+ * @brief Removes and restores power. The array and the non-volatile settings
+ * (QE bit, DataFlash page size and configuration) are kept; an operation in
+ * progress is lost and the volatile state returns to its power up value.
+ *
+ * @param context The device.
+ *
+ * @retval void
+ */
+void SPI_EmulatorPowerCycle(SPI_EmulatorContext *context);
+
+/*!
+ * @brief Returns the device time.
+ *
+ * @param context The device.
+ *
+ * @retval uint64_t Time since SPI_EmulatorOpen() in ns.
+ */
+uint64_t SPI_EmulatorTimeNs(SPI_EmulatorContext *context);
+
+#endif /* SPI_TRANSPORT_EMULATOR_H_ */
@@ -0,0 +1,227 @@
+/*
+ * The Clear BSD License
+ * Copyright (c) 2018 Adesto Technologies Corporation, Inc
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted (subject to the limitations in the disclaimer below) provided
+ *  that the following conditions are met:
+ *
+ * o Redistributions of source code must retain the above copyright notice, this list
+ *   of conditions and the following disclaimer.
+ *
+ * o Redistributions in binary form must reproduce the above copyright notice, this
+ *   list of conditions and the following disclaimer in the documentation and/or
+ *   other materials provided with the distribution.
+ *
+ * o Neither the name of the copyright holder nor the names of its
+ *   contributors may be used to endorse or promote products derived from this
+ *   software without specific prior written permission.
+ *
+ * NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE GRANTED BY THIS LICENSE.
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*!
+ * @ingroup SPI_LAYER
+ */
+/**
+ * @file    spi_transport_spidev.c
+ * @brief   Definitions of the Linux spidev SPI transport.
+ */
+#include "spi_transport_spidev.h"
+
+#if defined(__linux__)
+
+#include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <linux/spi/spidev.h>
+
+// Default spidev buffer size (see the bufsiz module parameter).
+#define SPIDEV_DEFAULT_CHUNK_BYTES 4096
+// Number of spi_ioc_transfers sent with one SPI_IOC_MESSAGE ioctl.
+#define SPIDEV_MAX_SEGMENTS 64
+
+typedef struct
+{
+	SPI_SpidevContext *context;
+	struct spi_ioc_transfer segments[SPIDEV_MAX_SEGMENTS];
+	uint32_t numSegments;
+	uint32_t txBytes;
+	uint32_t rxBytes;
+	uint32_t speedHz;
+	int status;
+} spidevMessage;
+
+static void spidevFlush(spidevMessage *message, uint8_t lastMessage)
+{
+	if(message->numSegments == 0)
+	{
+		return;
+	}
+	// Keep CSb asserted between messages that belong to the same transaction.
+	message->segments[message->numSegments-1].cs_change = lastMessage ? 0 : 1;
+	if(ioctl(message->context->fd, SPI_IOC_MESSAGE(message->numSegments), message->segments) < 0)
+	{
+		message->status = -1;
+	}
+	message->numSegments = 0;
+	message->txBytes = 0;
+	message->rxBytes = 0;
+}
+
+static void spidevAppend(spidevMessage *message,
+						 uint8_t *txBuffer,
+						 uint8_t *rxBuffer,
+						 uint32_t numBytes,
+						 uint8_t ioLines)
+{
+	while(numBytes > 0)
+	{
+		uint32_t limit = message->context->maxChunkBytes;
+		uint32_t used = 0;
+		uint32_t chunk;
+		struct spi_ioc_transfer *segment;
+		// spidev rejects a message whose tx or rx bytes add up to more than
+		// bufsiz, so flush with CSb held before either total would overflow.
+		if(txBuffer != NULL)
+			used = message->txBytes;
+		if((rxBuffer != NULL) && (message->rxBytes > used))
+			used = message->rxBytes;
+		if((message->numSegments == SPIDEV_MAX_SEGMENTS) || (used >= limit))
+		{
+			spidevFlush(message, 0);
+			used = 0;
+		}
+		chunk = (numBytes < (limit - used)) ? numBytes : (limit - used);
+		segment = &message->segments[message->numSegments++];
+		memset(segment, 0, sizeof(*segment));
+		segment->tx_buf = (unsigned long) txBuffer;
+		segment->rx_buf = (unsigned long) rxBuffer;
+		segment->len = chunk;
+		segment->speed_hz = message->speedHz;
+		segment->bits_per_word = 8;
+		segment->tx_nbits = ioLines;
+		segment->rx_nbits = ioLines;
+		if(txBuffer != NULL)
+		{
+			txBuffer += chunk;
+			message->txBytes += chunk;
+		}
+		if(rxBuffer != NULL)
+		{
+			rxBuffer += chunk;
+			message->rxBytes += chunk;
+		}
+		numBytes -= chunk;
+	}
+}
+
+static void spidevExchange(void *context, const SPI_Transfer *transfer)
+{
+	spidevMessage message;
+	message.context = (SPI_SpidevContext *) context;
+	message.numSegments = 0;
+	message.txBytes = 0;
+	message.rxBytes = 0;
+	message.status = 0;
+	// Never exceed the limit of the command, nor the speed the device was opened at.
+	message.speedHz = message.context->speedHz;
+	if((transfer->clockHz != 0) && (transfer->clockHz < message.speedHz))
+		message.speedHz = transfer->clockHz;
+
+	spidevAppend(&message, transfer->txBuffer, NULL, transfer->txSingleNumBytes, 1);
+	if(transfer->txSingleNumBytes < transfer->txNumBytes)
+	{
+		spidevAppend(&message,
+					 transfer->txBuffer + transfer->txSingleNumBytes,
+					 NULL,
+					 transfer->txNumBytes - transfer->txSingleNumBytes,
+					 transfer->ioLines);
+	}
+	spidevAppend(&message, transfer->txPayload, NULL, transfer->txPayloadNumBytes, transfer->ioLines);
+	spidevAppend(&message, NULL, NULL, transfer->dummyNumBytes, transfer->dummyIOLines);
+	spidevAppend(&message, NULL, transfer->rxBuffer, transfer->rxNumBytes, transfer->ioLines);
+	// An empty transfer that ends a held transaction still needs a segment
+	// for the driver to release CSb.
+	if((message.numSegments == 0) && (transfer->flags & SPI_TRANSFER_CONTINUE))
+	{
+		memset(&message.segments[0], 0, sizeof(message.segments[0]));
+		message.segments[0].speed_hz = message.speedHz;
+		message.numSegments = 1;
+	}
+	spidevFlush(&message, !(transfer->flags & SPI_TRANSFER_HOLD_CS));
+
+	if(message.status != 0)
+	{
+		printf("Error with spidevExchange.\n");
+		printf("\t- SPI_IOC_MESSAGE failed.\n");
+	}
+}
+
+int SPI_SpidevOpen(SPI_Transport *transport,
+				   SPI_SpidevContext *context,
+				   const char *path,
+				   uint32_t speedHz,
+				   uint8_t quadCapable)
+{
+	uint32_t mode = SPI_MODE_0;
+	uint8_t bits = 8;
+
+	if(quadCapable)
+	{
+		mode |= SPI_TX_DUAL | SPI_RX_DUAL | SPI_TX_QUAD | SPI_RX_QUAD;
+	}
+
+	context->fd = open(path, O_RDWR);
+	if(context->fd < 0)
+	{
+		printf("Error with SPI_SpidevOpen.\n");
+		printf("\t- Unable to open %s.\n", path);
+		return -1;
+	}
+	if((ioctl(context->fd, SPI_IOC_WR_MODE32, &mode) < 0) ||
+	   (ioctl(context->fd, SPI_IOC_WR_BITS_PER_WORD, &bits) < 0) ||
+	   (ioctl(context->fd, SPI_IOC_WR_MAX_SPEED_HZ, &speedHz) < 0))
+	{
+		printf("Error with SPI_SpidevOpen.\n");
+		printf("\t- Unable to configure %s.\n", path);
+		close(context->fd);
+		context->fd = -1;
+		return -1;
+	}
+	context->speedHz = speedHz;
+	context->maxChunkBytes = SPIDEV_DEFAULT_CHUNK_BYTES;
+
+	transport->name = "spidev";
+	transport->init = NULL;
+	transport->exchange = spidevExchange;
+	// CSb and MOSI cannot be toggled independently through spidev.
+	transport->jedecReset = NULL;
+	transport->start = NULL;
+	transport->context = context;
+	return 0;
+}
+
+void SPI_SpidevClose(SPI_SpidevContext *context)
+{
+	if(context->fd >= 0)
+	{
+		close(context->fd);
+		context->fd = -1;
+	}
+}
+
+#endif
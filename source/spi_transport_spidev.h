@@ -0,0 +1,98 @@
+/*
+ * The Clear BSD License
+ * Copyright (c) 2018 Adesto Technologies Corporation, Inc
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted (subject to the limitations in the disclaimer below) provided
+ *  that the following conditions are met:
+ *
+ * o Redistributions of source code must retain the above copyright notice, this list
+ *   of conditions and the following disclaimer.
+ *
+ * o Redistributions in binary form must reproduce the above copyright notice, this
+ *   list of conditions and the following disclaimer in the documentation and/or
+ *   other materials provided with the distribution.
+ *
+ * o Neither the name of the copyright holder nor the names of its
+ *   contributors may be used to endorse or promote products derived from this
+ *   software without specific prior written permission.
+ *
+ * NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE GRANTED BY THIS LICENSE.
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*!
+ * @ingroup SPI_LAYER
+ */
+/**
+ * @file    spi_transport_spidev.h
+ * @brief   Declarations of the Linux spidev SPI transport.
+ *
+ * This transport carries SPI layer transactions over a Linux spidev
+ * character device (/dev/spidevB.C), so the drivers can run on a Linux
+ * host with the flash attached to a hardware SPI controller. Dual and
+ * quad transactions use the tx_nbits/rx_nbits fields of the spidev
+ * interface and therefore require a controller that supports them.
+ */
+#ifndef SPI_TRANSPORT_SPIDEV_H_
+#define SPI_TRANSPORT_SPIDEV_H_
+
+#include "spi_transport.h"
+
+#if defined(__linux__)
+
+/*!
+ * @brief State of an open spidev transport.
+ */
+typedef struct
+{
+	//! File descriptor of the spidev device, -1 when closed.
+	int fd;
+	//! SCK frequency used for every transfer.
+	uint32_t speedHz;
+	//! Largest number of tx or rx bytes placed in a single SPI_IOC_MESSAGE.
+	uint32_t maxChunkBytes;
+} SPI_SpidevContext;
+
+/*!
+ * @brief Opens a spidev device and fills in a transport that uses it.
+ * Select the transport afterwards with SPI_SetTransport().
+ *
+ * @param transport The transport to be filled in.
+ * @param context Storage for the backend state. Must remain valid while the
+ * transport is in use.
+ * @param path Path of the spidev device, e.g. "/dev/spidev0.0".
+ * @param speedHz The SCK frequency in Hz.
+ * @param quadCapable Set to 1 if the controller and wiring support dual and
+ * quad transfers, 0 to only request standard SPI from the controller.
+ *
+ * @retval int 0 on success, -1 if the device could not be opened or configured.
+ */
+int SPI_SpidevOpen(SPI_Transport *transport,
+				   SPI_SpidevContext *context,
+				   const char *path,
+				   uint32_t speedHz,
+				   uint8_t quadCapable);
+
+/*!
+ * @brief Closes the spidev device opened by SPI_SpidevOpen().
+ *
+ * @param context The backend state passed to SPI_SpidevOpen().
+ *
+ * @retval void
+ */
+void SPI_SpidevClose(SPI_SpidevContext *context);
+
+#endif
+
+#endif /* SPI_TRANSPORT_SPIDEV_H_ */
@@ -40,6 +40,7 @@
  */
 	
 #include <standardflash.h>
+#include "flash_context.h"
 
 #if (PARTNO == AT25SF641) 	|| \
 	(PARTNO == AT25SF321)	|| \
@@ -59,41 +60,42 @@
 	(PARTNO == AT25QL321) 	|| \
 	(PARTNO == AT25QF641)	|| \
 	(ALL == 1)
-/*!
- * @brief Communication mode byte. This byte is changed when various commands are executed.
- * See standardflashEnableQPI(), and standardflashDisableQPI().<br>
- * - 0: SPI
- * - 1: QUAD
- */
-static uint8_t MCU_SPI_MODE = 0;
-
-static bool DISPLAY_OUTPUT = 0;
-
-static void debugOn() {DISPLAY_OUTPUT = 1;};
-static void debugOff() {DISPLAY_OUTPUT = 0;};
-
-uint8_t txStandardflashInternalBuffer[MAXIMUM_TX_BYTES];
+static void debugOn() {flashContext->displayOutput = 1;};
+static void debugOff() {flashContext->displayOutput = 0;};
 
 void standardflashWaitOnReady()
 {
-	uint8_t SRArray[2] = {0, 0};
-	do
+	standardflashWaitOnReadyFor(0);
+}
+
+void standardflashWaitOnReadyFor(uint32_t expectedUs)
+{
+	uint8_t SRArray[SPI_READY_MAX_STATUS_BYTES];
+	// The AT25DL/AT25DF081A group reports RDY/BSY in the second status byte.
+	SPI_ReadyPoll poll = flashContextPart()->ready;
+	poll.ioLines = (flashContext->spiMode == SPI) ? 1 : 4;
+	SPI_WaitReady(&poll, expectedUs, SRArray);
+	if(flashContext->displayOutput)
 	{
-#if (PARTNO == AT25DL081) 	|| \
-	(PARTNO == AT25DL161) 	|| \
-	(PARTNO == AT25DF081A)  || \
-	(PARTNO == AT25DF321A)  || \
-	(PARTNO == AT25DF641A)
-		standardflashReadSR(SRArray);
-		SPI_Delay(10);
+		flashContext->txBuffer[0] = poll.header[0];
+		printSPIExchange(flashContext->txBuffer, 1, SRArray, poll.numBytes);
 	}
-	while(SRArray[1] & (1<<0));
-#else
-		SRArray[0] = standardflashReadSRB1();
-		SPI_Delay(10);
+}
+
+uint8_t standardflashIsBusy()
+{
+	const SPI_ReadyPoll *poll = &flashContextPart()->ready;
+	uint8_t SRArray[SPI_READY_MAX_STATUS_BYTES] = {0};
+	flashContext->txBuffer[0] = poll->header[0];
+	if(flashContext->spiMode == SPI)
+		SPI_Exchange(flashContext->txBuffer, 1, SRArray, poll->numBytes, 0);
+	else
+		SPI_QuadExchange(0, flashContext->txBuffer, 1, SRArray, poll->numBytes, 0);
+	if(flashContext->displayOutput)
+	{
+		printSPIExchange(flashContext->txBuffer, 1, SRArray, poll->numBytes);
 	}
-	while(SRArray[0] & (1<<0));
-#endif
+	return (SRArray[poll->byteIndex] & poll->busyMask) == poll->busyValue;
 }
 
 void standardflashSetQEBit()
@@ -126,9 +128,9 @@ void standardflashSetQEBit()
 #else
 	standardflashWriteSR(SRArray, 2);
 #endif
-	if(DISPLAY_OUTPUT)
+	if(flashContext->displayOutput)
 	{
-		printSPIExchange(txStandardflashInternalBuffer, 3, NULL, 0);
+		printSPIExchange(flashContext->txBuffer, 3, NULL, 0);
 	}
 }
 
@@ -162,196 +164,240 @@ void standardflashClearQEBit()
 #else
 	standardflashWriteSR(SRArray, 2);
 #endif
-	if(DISPLAY_OUTPUT)
+	if(flashContext->displayOutput)
 	{
-		printSPIExchange(txStandardflashInternalBuffer, 3, NULL, 0);
+		printSPIExchange(flashContext->txBuffer, 3, NULL, 0);
 	}
 }
 
 void standardflashWriteEnable()
 {
-	txStandardflashInternalBuffer[0] = CMD_STANDARDFLASH_WRITE_ENABLE;
-	if(MCU_SPI_MODE == SPI)
-		SPI_Exchange(txStandardflashInternalBuffer, 1, NULL, 0, 0);
+	flashContext->txBuffer[0] = CMD_STANDARDFLASH_WRITE_ENABLE;
+	if(flashContext->spiMode == SPI)
+		SPI_Exchange(flashContext->txBuffer, 1, NULL, 0, 0);
 	else
-		SPI_QuadExchange(0, txStandardflashInternalBuffer, 1, NULL, 0, 0);
-	if(DISPLAY_OUTPUT)
+		SPI_QuadExchange(0, flashContext->txBuffer, 1, NULL, 0, 0);
+	if(flashContext->displayOutput)
 	{
-		printSPIExchange(txStandardflashInternalBuffer, 1, NULL, 0);
+		printSPIExchange(flashContext->txBuffer, 1, NULL, 0);
 	}
 }
 
 void standardflashWriteDisable()
 {
-	txStandardflashInternalBuffer[0] = CMD_STANDARDFLASH_WRITE_DISABLE;
-	if(MCU_SPI_MODE == SPI)
-		SPI_Exchange(txStandardflashInternalBuffer, 1, NULL, 0, 0);
+	flashContext->txBuffer[0] = CMD_STANDARDFLASH_WRITE_DISABLE;
+	if(flashContext->spiMode == SPI)
+		SPI_Exchange(flashContext->txBuffer, 1, NULL, 0, 0);
 	else
-		SPI_QuadExchange(0, txStandardflashInternalBuffer, 1, NULL, 0, 0);
-	if(DISPLAY_OUTPUT)
+		SPI_QuadExchange(0, flashContext->txBuffer, 1, NULL, 0, 0);
+	if(flashContext->displayOutput)
 	{
-		printSPIExchange(txStandardflashInternalBuffer, 1, NULL,  0);
+		printSPIExchange(flashContext->txBuffer, 1, NULL,  0);
 	}
 }
 
 void standardflashReadArrayLowFreq(uint32_t address, uint8_t *rxBuffer, uint32_t rxNumBytes)
 {
-	load4BytesToTxBuffer(txStandardflashInternalBuffer, CMD_STANDARDFLASH_READ_ARRAY_LF, address);
-	SPI_Exchange(txStandardflashInternalBuffer, 4, rxBuffer, rxNumBytes, 0);
-	if(DISPLAY_OUTPUT)
+	load4BytesToTxBuffer(flashContext->txBuffer, CMD_STANDARDFLASH_READ_ARRAY_LF, address);
+	SPI_Exchange(flashContext->txBuffer, 4, rxBuffer, rxNumBytes, 0);
+	if(flashContext->displayOutput)
 	{
-		printSPIExchange(txStandardflashInternalBuffer, 4, rxBuffer, rxNumBytes);
+		printSPIExchange(flashContext->txBuffer, 4, rxBuffer, rxNumBytes);
 	}
 }
 
 void standardflashReadArrayHighFreq(uint32_t address, uint8_t *rxBuffer, uint32_t rxNumBytes)
 {
-	load4BytesToTxBuffer(txStandardflashInternalBuffer, CMD_STANDARDFLASH_READ_ARRAY_HF, address);
-	if(MCU_SPI_MODE == SPI)
-		SPI_Exchange(txStandardflashInternalBuffer, 4, rxBuffer, rxNumBytes, 1);
+	load4BytesToTxBuffer(flashContext->txBuffer, CMD_STANDARDFLASH_READ_ARRAY_HF, address);
+	if(flashContext->spiMode == SPI)
+		SPI_Exchange(flashContext->txBuffer, 4, rxBuffer, rxNumBytes, 1);
 	else
-		SPI_QuadExchange(0, txStandardflashInternalBuffer, 4, rxBuffer, rxNumBytes, 2);
-	if(DISPLAY_OUTPUT)
+		SPI_QuadExchange(0, flashContext->txBuffer, 4, rxBuffer, rxNumBytes, 2);
+	if(flashContext->displayOutput)
 	{
-		printSPIExchange(txStandardflashInternalBuffer, 4, rxBuffer, rxNumBytes);
+		printSPIExchange(flashContext->txBuffer, 4, rxBuffer, rxNumBytes);
 	}
 }
 
 void standardflashBytePageProgram(uint32_t address, uint8_t *txBuffer, uint32_t txNumBytes)
 {
-	load4BytesToTxBuffer(txStandardflashInternalBuffer, CMD_STANDARDFLASH_BYTE_PAGE_PROGRAM, address);
-	// Offset the data bytes by 4; opcode+address takes up the first 4 bytes of a transmission.
-	uint32_t totalBytes = txNumBytes + 4;
-
-	for(uint32_t j = 0; j < txNumBytes; j++)
-	{
-		txStandardflashInternalBuffer[j+4] = txBuffer[j];
-	}
-
-	if(MCU_SPI_MODE == SPI)
-		SPI_Exchange(txStandardflashInternalBuffer, totalBytes, NULL, 0, 0);
+	load4BytesToTxBuffer(flashContext->txBuffer, CMD_STANDARDFLASH_BYTE_PAGE_PROGRAM, address);
+	if(flashContext->spiMode == SPI)
+		SPI_GatherExchange(1, 4, flashContext->txBuffer, 4, txBuffer, txNumBytes);
 	else
-		SPI_QuadExchange(0, txStandardflashInternalBuffer, totalBytes, NULL, 0, 0);
-	if(DISPLAY_OUTPUT)
+		SPI_GatherExchange(4, 0, flashContext->txBuffer, 4, txBuffer, txNumBytes);
+	if(flashContext->displayOutput)
 	{
-		printSPIExchange(txStandardflashInternalBuffer, totalBytes, NULL, 0);
+		printSPIWrite(flashContext->txBuffer, 4, txBuffer, txNumBytes);
 	}
 }
 
 void standardflashBlockErase4K(uint32_t address)
 {
-	load4BytesToTxBuffer(txStandardflashInternalBuffer, CMD_STANDARDFLASH_BLOCK_ERASE_4K, address);
-	if(MCU_SPI_MODE == SPI)
-		SPI_Exchange(txStandardflashInternalBuffer, 4, NULL, 0, 0);
+	load4BytesToTxBuffer(flashContext->txBuffer, CMD_STANDARDFLASH_BLOCK_ERASE_4K, address);
+	if(flashContext->spiMode == SPI)
+		SPI_Exchange(flashContext->txBuffer, 4, NULL, 0, 0);
 	else
-		SPI_QuadExchange(0, txStandardflashInternalBuffer, 4, NULL, 0, 0);
-	if(DISPLAY_OUTPUT)
+		SPI_QuadExchange(0, flashContext->txBuffer, 4, NULL, 0, 0);
+	if(flashContext->displayOutput)
 	{
-		printSPIExchange(txStandardflashInternalBuffer, 4, NULL, 0);
+		printSPIExchange(flashContext->txBuffer, 4, NULL, 0);
 	}
 }
 
 void standardflashBlockErase32K(uint32_t address)
 {
-	load4BytesToTxBuffer(txStandardflashInternalBuffer, CMD_STANDARDFLASH_BLOCK_ERASE_32K, address);
-	if(MCU_SPI_MODE == SPI)
-		SPI_Exchange(txStandardflashInternalBuffer, 4, NULL, 0, 0);
+	load4BytesToTxBuffer(flashContext->txBuffer, CMD_STANDARDFLASH_BLOCK_ERASE_32K, address);
+	if(flashContext->spiMode == SPI)
+		SPI_Exchange(flashContext->txBuffer, 4, NULL, 0, 0);
 	else
-		SPI_QuadExchange(0, txStandardflashInternalBuffer, 4, NULL, 0, 0);
-	if(DISPLAY_OUTPUT)
+		SPI_QuadExchange(0, flashContext->txBuffer, 4, NULL, 0, 0);
+	if(flashContext->displayOutput)
 	{
-		printSPIExchange(txStandardflashInternalBuffer, 4, NULL, 0);
+		printSPIExchange(flashContext->txBuffer, 4, NULL, 0);
 	}
 }
 
 void standardflashBlockErase64K(uint32_t address)
 {
-	load4BytesToTxBuffer(txStandardflashInternalBuffer, CMD_STANDARDFLASH_BLOCK_ERASE_64K, address);
-	if(MCU_SPI_MODE == SPI)
-		SPI_Exchange(txStandardflashInternalBuffer, 4, NULL, 0, 0);
+	load4BytesToTxBuffer(flashContext->txBuffer, CMD_STANDARDFLASH_BLOCK_ERASE_64K, address);
+	if(flashContext->spiMode == SPI)
+		SPI_Exchange(flashContext->txBuffer, 4, NULL, 0, 0);
 	else
-		SPI_QuadExchange(0, txStandardflashInternalBuffer, 4, NULL, 0, 0);
-	if(DISPLAY_OUTPUT)
+		SPI_QuadExchange(0, flashContext->txBuffer, 4, NULL, 0, 0);
+	if(flashContext->displayOutput)
 	{
-		printSPIExchange(txStandardflashInternalBuffer, 4, NULL, 0);
+		printSPIExchange(flashContext->txBuffer, 4, NULL, 0);
 	}
 }
 
 void standardflashChipErase1()
 {
-	txStandardflashInternalBuffer[0] = CMD_STANDARDFLASH_CHIP_ERASE1;
-	if(MCU_SPI_MODE == SPI)
-		SPI_Exchange(txStandardflashInternalBuffer, 1, NULL, 0, 0);
+	flashContext->txBuffer[0] = CMD_STANDARDFLASH_CHIP_ERASE1;
+	if(flashContext->spiMode == SPI)
+		SPI_Exchange(flashContext->txBuffer, 1, NULL, 0, 0);
 	else
-		SPI_QuadExchange(0, txStandardflashInternalBuffer, 1, NULL, 0, 0);
-	if(DISPLAY_OUTPUT)
+		SPI_QuadExchange(0, flashContext->txBuffer, 1, NULL, 0, 0);
+	if(flashContext->displayOutput)
 	{
-		printSPIExchange(txStandardflashInternalBuffer, 1, NULL, 0);
+		printSPIExchange(flashContext->txBuffer, 1, NULL, 0);
 	}
 }
 
 void standardflashChipErase2()
 {
-	txStandardflashInternalBuffer[0] = CMD_STANDARDFLASH_CHIP_ERASE2;
-	if(MCU_SPI_MODE == SPI)
-		SPI_Exchange(txStandardflashInternalBuffer, 1, NULL, 0, 0);
+	flashContext->txBuffer[0] = CMD_STANDARDFLASH_CHIP_ERASE2;
+	if(flashContext->spiMode == SPI)
+		SPI_Exchange(flashContext->txBuffer, 1, NULL, 0, 0);
 	else
-		SPI_QuadExchange(0, txStandardflashInternalBuffer, 1, NULL, 0, 0);
-	if(DISPLAY_OUTPUT)
+		SPI_QuadExchange(0, flashContext->txBuffer, 1, NULL, 0, 0);
+	if(flashContext->displayOutput)
 	{
-		printSPIExchange(txStandardflashInternalBuffer, 1, NULL, 0);
+		printSPIExchange(flashContext->txBuffer, 1, NULL, 0);
 	}
 }
 
 void standardflashDPD()
 {
-	txStandardflashInternalBuffer[0] = CMD_STANDARDFLASH_DEEP_POWER_DOWN;
-	if(MCU_SPI_MODE == SPI)
-		SPI_Exchange(txStandardflashInternalBuffer, 1, NULL, 0, 0);
+	flashContext->txBuffer[0] = CMD_STANDARDFLASH_DEEP_POWER_DOWN;
+	if(flashContext->spiMode == SPI)
+		SPI_Exchange(flashContext->txBuffer, 1, NULL, 0, 0);
 	else
-		SPI_QuadExchange(0, txStandardflashInternalBuffer, 1, NULL, 0, 0);
-	if(DISPLAY_OUTPUT)
+		SPI_QuadExchange(0, flashContext->txBuffer, 1, NULL, 0, 0);
+	if(flashContext->displayOutput)
 	{
-		printSPIExchange(txStandardflashInternalBuffer, 1, NULL, 0);
+		printSPIExchange(flashContext->txBuffer, 1, NULL, 0);
 	}
 }
 
 void standardflashResumeFromDPD()
 {
-	txStandardflashInternalBuffer[0] = CMD_STANDARDFLASH_RESUME_FROM_DPD;
-	if(MCU_SPI_MODE == SPI)
-		SPI_Exchange(txStandardflashInternalBuffer, 1, NULL, 0, 0);
+	flashContext->txBuffer[0] = CMD_STANDARDFLASH_RESUME_FROM_DPD;
+	if(flashContext->spiMode == SPI)
+		SPI_Exchange(flashContext->txBuffer, 1, NULL, 0, 0);
 	else
-		SPI_QuadExchange(0, txStandardflashInternalBuffer, 1, NULL, 0, 0);
-	if(DISPLAY_OUTPUT)
+		SPI_QuadExchange(0, flashContext->txBuffer, 1, NULL, 0, 0);
+	if(flashContext->displayOutput)
 	{
-		printSPIExchange(txStandardflashInternalBuffer, 1, NULL, 0);
+		printSPIExchange(flashContext->txBuffer, 1, NULL, 0);
 	}
 }
 
 void standardflashReadID(uint8_t *rxBuffer)
 {
-	txStandardflashInternalBuffer[0] = CMD_STANDARDFLASH_READ_ID;
-	if(MCU_SPI_MODE == SPI)
-		SPI_Exchange(txStandardflashInternalBuffer, 1, rxBuffer, 2, 3);
+	flashContext->txBuffer[0] = CMD_STANDARDFLASH_READ_ID;
+	if(flashContext->spiMode == SPI)
+		SPI_Exchange(flashContext->txBuffer, 1, rxBuffer, 2, 3);
 	else
-		SPI_QuadExchange(0, txStandardflashInternalBuffer, 1, rxBuffer, 2, 3);
-	if(DISPLAY_OUTPUT)
+		SPI_QuadExchange(0, flashContext->txBuffer, 1, rxBuffer, 2, 3);
+	if(flashContext->displayOutput)
 	{
-		printSPIExchange(txStandardflashInternalBuffer, 1, rxBuffer, 2);
+		printSPIExchange(flashContext->txBuffer, 1, rxBuffer, 2);
 	}
 }
 
 void standardflashReadMID(uint8_t *rxBuffer)
 {
-	txStandardflashInternalBuffer[0] = CMD_STANDARDFLASH_READ_MID;
-	if(MCU_SPI_MODE == SPI)
-		SPI_Exchange(txStandardflashInternalBuffer, 1, rxBuffer, 3, 0);
+	flashContext->txBuffer[0] = CMD_STANDARDFLASH_READ_MID;
+	if(flashContext->spiMode == SPI)
+		SPI_Exchange(flashContext->txBuffer, 1, rxBuffer, 3, 0);
+	else
+		SPI_QuadExchange(0, flashContext->txBuffer, 1, rxBuffer, 3, 0);
+	if(flashContext->displayOutput)
+	{
+		printSPIExchange(flashContext->txBuffer, 1, rxBuffer, 3);
+	}
+}
+
+void standardflashProgram(uint32_t address, uint8_t *txBuffer, uint32_t txNumBytes)
+{
+	while(txNumBytes > 0)
+	{
+		// Never cross a page boundary; the address would wrap within the page.
+		uint32_t chunk = STANDARDFLASH_PAGE_SIZE - (address % STANDARDFLASH_PAGE_SIZE);
+		if(chunk > txNumBytes)
+			chunk = txNumBytes;
+		standardflashProgramPageStart(address, txBuffer, chunk);
+		standardflashWaitOnReadyFor(STANDARDFLASH_TPP_US);
+		address += chunk;
+		txBuffer += chunk;
+		txNumBytes -= chunk;
+	}
+}
+
+void standardflashRead(uint32_t address, uint8_t *rxBuffer, uint32_t rxNumBytes)
+{
+	standardflashReadArrayHighFreq(address, rxBuffer, rxNumBytes);
+}
+
+void standardflashProgramPageStart(uint32_t address, uint8_t *txBuffer, uint32_t txNumBytes)
+{
+	standardflashWriteEnable();
+	standardflashBytePageProgram(address, txBuffer, txNumBytes);
+}
+
+void standardflashEraseStart(uint32_t address)
+{
+	standardflashWriteEnable();
+	standardflashBlockErase4K(address - (address % STANDARDFLASH_ERASE_SIZE));
+}
+
+void standardflashErase(uint32_t address)
+{
+	standardflashEraseStart(address);
+	standardflashWaitOnReadyFor(STANDARDFLASH_TBE4K_US);
+}
+
+void standardflashOpenReadStream(SPI_Stream *stream, uint32_t address)
+{
+	load4BytesToTxBuffer(flashContext->txBuffer, CMD_STANDARDFLASH_READ_ARRAY_HF, address);
+	if(flashContext->spiMode == SPI)
+		SPI_StreamOpen(stream, 1, 4, flashContext->txBuffer, 4, 1);
 	else
-		SPI_QuadExchange(0, txStandardflashInternalBuffer, 1, rxBuffer, 3, 0);
-	if(DISPLAY_OUTPUT)
+		SPI_StreamOpen(stream, 4, 0, flashContext->txBuffer, 4, 2);
+	if(flashContext->displayOutput)
 	{
-		printSPIExchange(txStandardflashInternalBuffer, 1, rxBuffer, 3);
+		printSPIExchange(flashContext->txBuffer, 4, NULL, 0);
 	}
 }
 #endif
@@ -371,19 +417,19 @@ void standardflashReadMID(uint8_t *rxBuffer)
 
 void standardflashWriteSR(uint8_t *txBuffer, uint8_t txNumBytes)
 {
-	txStandardflashInternalBuffer[0] = CMD_STANDARDFLASH_WRITE_SR;
-	txStandardflashInternalBuffer[1] = txBuffer[0];
+	flashContext->txBuffer[0] = CMD_STANDARDFLASH_WRITE_SR;
+	flashContext->txBuffer[1] = txBuffer[0];
 	if(txNumBytes > 1)
 	{
-		txStandardflashInternalBuffer[2] = txBuffer[1];
+		flashContext->txBuffer[2] = txBuffer[1];
 	}
-	if(MCU_SPI_MODE == SPI)
-		SPI_Exchange(txStandardflashInternalBuffer, txNumBytes+1, NULL, 0, 0);
+	if(flashContext->spiMode == SPI)
+		SPI_Exchange(flashContext->txBuffer, txNumBytes+1, NULL, 0, 0);
 	else
-		SPI_QuadExchange(0, txStandardflashInternalBuffer, txNumBytes+1, NULL, 0, 0);
-	if(DISPLAY_OUTPUT)
+		SPI_QuadExchange(0, flashContext->txBuffer, txNumBytes+1, NULL, 0, 0);
+	if(flashContext->displayOutput)
 	{
-		printSPIExchange(txStandardflashInternalBuffer, txNumBytes+1, NULL, 0);
+		printSPIExchange(flashContext->txBuffer, txNumBytes+1, NULL, 0);
 	}
 }
 #endif
@@ -405,29 +451,29 @@ void standardflashWriteSR(uint8_t *txBuffer, uint8_t txNumBytes)
 
 void standardflashWriteSRB1(uint8_t regVal)
 {
-	txStandardflashInternalBuffer[0] = CMD_STANDARDFLASH_WRITE_SRB1;
-	txStandardflashInternalBuffer[1] = regVal;
-	if(MCU_SPI_MODE == SPI)
-		SPI_Exchange(txStandardflashInternalBuffer, 2, NULL, 0, 0);
+	flashContext->txBuffer[0] = CMD_STANDARDFLASH_WRITE_SRB1;
+	flashContext->txBuffer[1] = regVal;
+	if(flashContext->spiMode == SPI)
+		SPI_Exchange(flashContext->txBuffer, 2, NULL, 0, 0);
 	else
-		SPI_QuadExchange(0, txStandardflashInternalBuffer, 2, NULL, 0, 0);
-	if(DISPLAY_OUTPUT)
+		SPI_QuadExchange(0, flashContext->txBuffer, 2, NULL, 0, 0);
+	if(flashContext->displayOutput)
 	{
-		printSPIExchange(txStandardflashInternalBuffer, 2, NULL, 0);
+		printSPIExchange(flashContext->txBuffer, 2, NULL, 0);
 	}
 }
 
 void standardflashWriteSRB2(uint8_t regVal)
 {
-	txStandardflashInternalBuffer[0] = CMD_STANDARDFLASH_WRITE_SRB2;
-	txStandardflashInternalBuffer[1] = regVal;
-	if(MCU_SPI_MODE == SPI)
-		SPI_Exchange(txStandardflashInternalBuffer, 2, NULL, 0, 0);
+	flashContext->txBuffer[0] = CMD_STANDARDFLASH_WRITE_SRB2;
+	flashContext->txBuffer[1] = regVal;
+	if(flashContext->spiMode == SPI)
+		SPI_Exchange(flashContext->txBuffer, 2, NULL, 0, 0);
 	else
-		SPI_QuadExchange(0, txStandardflashInternalBuffer, 2, NULL, 0, 0);
-	if(DISPLAY_OUTPUT)
+		SPI_QuadExchange(0, flashContext->txBuffer, 2, NULL, 0, 0);
+	if(flashContext->displayOutput)
 	{
-		printSPIExchange(txStandardflashInternalBuffer, 2, NULL, 0);
+		printSPIExchange(flashContext->txBuffer, 2, NULL, 0);
 	}
 }
 #endif
@@ -447,28 +493,28 @@ void standardflashWriteSRB2(uint8_t regVal)
 	(ALL == 1)
 void standardflashWriteEnableVolatileSR()
 {
-	txStandardflashInternalBuffer[0] = CMD_STANDARDFLASH_WE_FOR_VOLATILE_SR;
-	if(MCU_SPI_MODE == SPI)
-		SPI_Exchange(txStandardflashInternalBuffer, 1, NULL, 0, 0);
+	flashContext->txBuffer[0] = CMD_STANDARDFLASH_WE_FOR_VOLATILE_SR;
+	if(flashContext->spiMode == SPI)
+		SPI_Exchange(flashContext->txBuffer, 1, NULL, 0, 0);
 	else
-		SPI_QuadExchange(0, txStandardflashInternalBuffer, 1, NULL, 0, 0);
-	if(DISPLAY_OUTPUT)
+		SPI_QuadExchange(0, flashContext->txBuffer, 1, NULL, 0, 0);
+	if(flashContext->displayOutput)
 	{
-		printSPIExchange(txStandardflashInternalBuffer, 1, NULL, 0);
+		printSPIExchange(flashContext->txBuffer, 1, NULL, 0);
 	}
 }
 
 uint8_t standardflashReadSRB1()
 {
 	uint8_t regVal = 0;
-	txStandardflashInternalBuffer[0] = CMD_STANDARDFLASH_READ_SRB1;
-	if(MCU_SPI_MODE == SPI)
-		SPI_Exchange(txStandardflashInternalBuffer, 1, &regVal, 1, 0);
+	flashContext->txBuffer[0] = CMD_STANDARDFLASH_READ_SRB1;
+	if(flashContext->spiMode == SPI)
+		SPI_Exchange(flashContext->txBuffer, 1, &regVal, 1, 0);
 	else
-		SPI_QuadExchange(0, txStandardflashInternalBuffer, 1, &regVal, 1, 0);
-	if(DISPLAY_OUTPUT)
+		SPI_QuadExchange(0, flashContext->txBuffer, 1, &regVal, 1, 0);
+	if(flashContext->displayOutput)
 	{
-		printSPIExchange(txStandardflashInternalBuffer, 1, &regVal, 1);
+		printSPIExchange(flashContext->txBuffer, 1, &regVal, 1);
 	}
 	return regVal;
 }
@@ -476,25 +522,25 @@ uint8_t standardflashReadSRB1()
 uint8_t standardflashReadSRB2()
 {
 	uint8_t regVal = 0;
-	txStandardflashInternalBuffer[0] = CMD_STANDARDFLASH_READ_SRB2;
-	if(MCU_SPI_MODE == SPI)
-		SPI_Exchange(txStandardflashInternalBuffer, 1, &regVal, 1, 0);
+	flashContext->txBuffer[0] = CMD_STANDARDFLASH_READ_SRB2;
+	if(flashContext->spiMode == SPI)
+		SPI_Exchange(flashContext->txBuffer, 1, &regVal, 1, 0);
 	else
-		SPI_QuadExchange(0, txStandardflashInternalBuffer, 1, &regVal, 1, 0);
-	if(DISPLAY_OUTPUT)
+		SPI_QuadExchange(0, flashContext->txBuffer, 1, &regVal, 1, 0);
+	if(flashContext->displayOutput)
 	{
-		printSPIExchange(txStandardflashInternalBuffer, 1, &regVal, 1);
+		printSPIExchange(flashContext->txBuffer, 1, &regVal, 1);
 	}
 	return regVal;
 }
 
 void standardflashDualOutputRead(uint32_t address, uint8_t *rxBuffer, uint32_t rxNumBytes)
 {
-	load4BytesToTxBuffer(txStandardflashInternalBuffer, CMD_STANDARDFLASH_DUAL_OUTPUT_READ, address);
-	SPI_DualExchange(4, txStandardflashInternalBuffer, 4, rxBuffer, rxNumBytes, 1);
-	if(DISPLAY_OUTPUT)
+	load4BytesToTxBuffer(flashContext->txBuffer, CMD_STANDARDFLASH_DUAL_OUTPUT_READ, address);
+	SPI_DualExchange(4, flashContext->txBuffer, 4, rxBuffer, rxNumBytes, 1);
+	if(flashContext->displayOutput)
 	{
-		printSPIExchange(txStandardflashInternalBuffer, 4, rxBuffer, rxNumBytes);
+		printSPIExchange(flashContext->txBuffer, 4, rxBuffer, rxNumBytes);
 	}
 }
 
@@ -506,30 +552,30 @@ void standardflashDualIORead(uint32_t address, uint8_t *rxBuffer, uint32_t rxNum
 	{
 		// Single Dual Read
 		case 0:
-			load4BytesToTxBuffer(txStandardflashInternalBuffer, CMD_STANDARDFLASH_DUAL_IO_READ, address);
-			txStandardflashInternalBuffer[4] = 0x00;
+			load4BytesToTxBuffer(flashContext->txBuffer, CMD_STANDARDFLASH_DUAL_IO_READ, address);
+			flashContext->txBuffer[4] = 0x00;
 			transmissionSelect = 0x00;
 			break;
 		// Start Continuous Dual Read
 		case 1:
-			load4BytesToTxBuffer(txStandardflashInternalBuffer, CMD_STANDARDFLASH_DUAL_IO_READ, address);
-			txStandardflashInternalBuffer[4] = modeByteValue;
+			load4BytesToTxBuffer(flashContext->txBuffer, CMD_STANDARDFLASH_DUAL_IO_READ, address);
+			flashContext->txBuffer[4] = modeByteValue;
 			transmissionSelect = 0x00;
 			break;
 		// Continue Continuous Dual Read
 		case 2:
-			txStandardflashInternalBuffer[0] = (uint8_t) (address >> 16);
-			txStandardflashInternalBuffer[1] = (uint8_t) (address >> 8);
-			txStandardflashInternalBuffer[2] = (uint8_t) address;
-			txStandardflashInternalBuffer[3] = modeByteValue;
+			flashContext->txBuffer[0] = (uint8_t) (address >> 16);
+			flashContext->txBuffer[1] = (uint8_t) (address >> 8);
+			flashContext->txBuffer[2] = (uint8_t) address;
+			flashContext->txBuffer[3] = modeByteValue;
 			transmissionSelect = 0x01;
 			break;
 		// End Continuous Dual Read
 		case 3:
-			txStandardflashInternalBuffer[0] = (uint8_t) (address >> 16);
-			txStandardflashInternalBuffer[1] = (uint8_t) (address >> 8);
-			txStandardflashInternalBuffer[2] = (uint8_t) address;
-			txStandardflashInternalBuffer[3] = 0x00;
+			flashContext->txBuffer[0] = (uint8_t) (address >> 16);
+			flashContext->txBuffer[1] = (uint8_t) (address >> 8);
+			flashContext->txBuffer[2] = (uint8_t) address;
+			flashContext->txBuffer[3] = 0x00;
 			transmissionSelect = 0x01;
 			break;
 		default:
@@ -541,29 +587,29 @@ void standardflashDualIORead(uint32_t address, uint8_t *rxBuffer, uint32_t rxNum
 
 	if(transmissionSelect == 0x00)
 	{
-		SPI_DualExchange(1, txStandardflashInternalBuffer, 5, rxBuffer, rxNumBytes, 0);
-		if(DISPLAY_OUTPUT)
+		SPI_DualExchange(1, flashContext->txBuffer, 5, rxBuffer, rxNumBytes, 0);
+		if(flashContext->displayOutput)
 		{
-			printSPIExchange(txStandardflashInternalBuffer, 5, rxBuffer, rxNumBytes);
+			printSPIExchange(flashContext->txBuffer, 5, rxBuffer, rxNumBytes);
 		}
 	}
 	else if(transmissionSelect == 0x01)
 	{
-		SPI_DualExchange(0, txStandardflashInternalBuffer, 4, rxBuffer, rxNumBytes, 0);
-		if(DISPLAY_OUTPUT)
+		SPI_DualExchange(0, flashContext->txBuffer, 4, rxBuffer, rxNumBytes, 0);
+		if(flashContext->displayOutput)
 		{
-			printSPIExchange(txStandardflashInternalBuffer, 4, rxBuffer, rxNumBytes);
+			printSPIExchange(flashContext->txBuffer, 4, rxBuffer, rxNumBytes);
 		}
 	}
 }
 
 void standardflashQuadOutputRead(uint32_t address, uint8_t *rxBuffer, uint32_t rxNumBytes)
 {
-	load4BytesToTxBuffer(txStandardflashInternalBuffer, CMD_STANDARDFLASH_QUAD_OUTPUT_READ, address);
-	SPI_QuadExchange(4, txStandardflashInternalBuffer, 4, rxBuffer, rxNumBytes, 1);
-	if(DISPLAY_OUTPUT)
+	load4BytesToTxBuffer(flashContext->txBuffer, CMD_STANDARDFLASH_QUAD_OUTPUT_READ, address);
+	SPI_QuadExchange(4, flashContext->txBuffer, 4, rxBuffer, rxNumBytes, 1);
+	if(flashContext->displayOutput)
 	{
-		printSPIExchange(txStandardflashInternalBuffer, 4, rxBuffer, rxNumBytes);
+		printSPIExchange(flashContext->txBuffer, 4, rxBuffer, rxNumBytes);
 	}
 }
 
@@ -575,30 +621,30 @@ void standardflashQuadIORead(uint32_t address, uint8_t *rxBuffer, uint32_t rxNum
 	{
 		// Single Quad Read
 		case 0:
-			load4BytesToTxBuffer(txStandardflashInternalBuffer, CMD_STANDARDFLASH_QUAD_IO_READ, address);
-			txStandardflashInternalBuffer[4] = 0x00;
+			load4BytesToTxBuffer(flashContext->txBuffer, CMD_STANDARDFLASH_QUAD_IO_READ, address);
+			flashContext->txBuffer[4] = 0x00;
 			transmissionSelect = 0x00;
 			break;
 		// Start Continuous Quad Read
 		case 1:
-			load4BytesToTxBuffer(txStandardflashInternalBuffer, CMD_STANDARDFLASH_QUAD_IO_READ, address);
-			txStandardflashInternalBuffer[4] = modeByteValue;
+			load4BytesToTxBuffer(flashContext->txBuffer, CMD_STANDARDFLASH_QUAD_IO_READ, address);
+			flashContext->txBuffer[4] = modeByteValue;
 			transmissionSelect = 0x00;
 			break;
 		// Continue Continuous Quad Read
 		case 2:
-			txStandardflashInternalBuffer[0] = (uint8_t) (address >> 16);
-			txStandardflashInternalBuffer[1] = (uint8_t) (address >> 8);
-			txStandardflashInternalBuffer[2] = (uint8_t) address;
-			txStandardflashInternalBuffer[3] = modeByteValue;
+			flashContext->txBuffer[0] = (uint8_t) (address >> 16);
+			flashContext->txBuffer[1] = (uint8_t) (address >> 8);
+			flashContext->txBuffer[2] = (uint8_t) address;
+			flashContext->txBuffer[3] = modeByteValue;
 			transmissionSelect = 0x01;
 			break;
 		// End Continuous Quad Read
 		case 3:
-			txStandardflashInternalBuffer[0] = (uint8_t) (address >> 16);
-			txStandardflashInternalBuffer[1] = (uint8_t) (address >> 8);
-			txStandardflashInternalBuffer[2] = (uint8_t) address;
-			txStandardflashInternalBuffer[3] = modeByteValue;
+			flashContext->txBuffer[0] = (uint8_t) (address >> 16);
+			flashContext->txBuffer[1] = (uint8_t) (address >> 8);
+			flashContext->txBuffer[2] = (uint8_t) address;
+			flashContext->txBuffer[3] = modeByteValue;
 			transmissionSelect = 0x01;
 			break;
 		default:
@@ -610,121 +656,105 @@ void standardflashQuadIORead(uint32_t address, uint8_t *rxBuffer, uint32_t rxNum
 
 	if(transmissionSelect == 0x00)
 	{
-		if(MCU_SPI_MODE == SPI)
-			SPI_QuadExchange(1, txStandardflashInternalBuffer, 5, rxBuffer, rxNumBytes, 2);
+		if(flashContext->spiMode == SPI)
+			SPI_QuadExchange(1, flashContext->txBuffer, 5, rxBuffer, rxNumBytes, 2);
 		else
-			SPI_QuadExchange(0, txStandardflashInternalBuffer, 5, rxBuffer, rxNumBytes, 1);
-		if(DISPLAY_OUTPUT)
+			SPI_QuadExchange(0, flashContext->txBuffer, 5, rxBuffer, rxNumBytes, 1);
+		if(flashContext->displayOutput)
 		{
-			printSPIExchange(txStandardflashInternalBuffer, 5, rxBuffer, rxNumBytes);
+			printSPIExchange(flashContext->txBuffer, 5, rxBuffer, rxNumBytes);
 		}
 	}
 	else if(transmissionSelect == 0x01)
 	{
-		if(MCU_SPI_MODE == SPI)
-			SPI_QuadExchange(0, txStandardflashInternalBuffer, 4, rxBuffer, rxNumBytes, 2);
+		if(flashContext->spiMode == SPI)
+			SPI_QuadExchange(0, flashContext->txBuffer, 4, rxBuffer, rxNumBytes, 2);
 		else
-			SPI_QuadExchange(0, txStandardflashInternalBuffer, 4, rxBuffer, rxNumBytes, 1);
-		if(DISPLAY_OUTPUT)
+			SPI_QuadExchange(0, flashContext->txBuffer, 4, rxBuffer, rxNumBytes, 1);
+		if(flashContext->displayOutput)
 		{
-			printSPIExchange(txStandardflashInternalBuffer, 4, rxBuffer, rxNumBytes);
+			printSPIExchange(flashContext->txBuffer, 4, rxBuffer, rxNumBytes);
 		}
 	}
 }
 
 void standardflashContinuousReadModeDualReset()
 {
-	txStandardflashInternalBuffer[0] = (uint8_t) (CMD_STANDARDFLASH_CONT_READ_MODE_RST_DUAL >> 8);
-	txStandardflashInternalBuffer[1] = (uint8_t) CMD_STANDARDFLASH_CONT_READ_MODE_RST_DUAL;
-	SPI_Exchange(txStandardflashInternalBuffer, 2, NULL, 0, 0);
-	if(DISPLAY_OUTPUT)
+	flashContext->txBuffer[0] = (uint8_t) (CMD_STANDARDFLASH_CONT_READ_MODE_RST_DUAL >> 8);
+	flashContext->txBuffer[1] = (uint8_t) CMD_STANDARDFLASH_CONT_READ_MODE_RST_DUAL;
+	SPI_Exchange(flashContext->txBuffer, 2, NULL, 0, 0);
+	if(flashContext->displayOutput)
 	{
-		printSPIExchange(txStandardflashInternalBuffer, 2, NULL, 0);
+		printSPIExchange(flashContext->txBuffer, 2, NULL, 0);
 	}
 }
 
 void standardflashContinuousReadModeQuadReset()
 {
-	txStandardflashInternalBuffer[0] = (uint8_t) CMD_STANDARDFLASH_CONT_READ_MODE_RST_QUAD;
-	if(MCU_SPI_MODE == SPI)
-		SPI_Exchange(txStandardflashInternalBuffer, 1, NULL, 0, 0);
+	flashContext->txBuffer[0] = (uint8_t) CMD_STANDARDFLASH_CONT_READ_MODE_RST_QUAD;
+	if(flashContext->spiMode == SPI)
+		SPI_Exchange(flashContext->txBuffer, 1, NULL, 0, 0);
 	else
-		SPI_QuadExchange(0, txStandardflashInternalBuffer, 1, NULL, 0, 0);
-	if(DISPLAY_OUTPUT)
+		SPI_QuadExchange(0, flashContext->txBuffer, 1, NULL, 0, 0);
+	if(flashContext->displayOutput)
 	{
-		printSPIExchange(txStandardflashInternalBuffer, 1, NULL, 0);
+		printSPIExchange(flashContext->txBuffer, 1, NULL, 0);
 	}
 }
 
 void standardflashEraseSecurityRegister(uint32_t address)
 {
-	load4BytesToTxBuffer(txStandardflashInternalBuffer, CMD_STANDARDFLASH_ERASE_SECURTIY_REG_PAGE, address);
-	SPI_Exchange(txStandardflashInternalBuffer, 4, NULL, 0, 0);
-	if(DISPLAY_OUTPUT)
+	load4BytesToTxBuffer(flashContext->txBuffer, CMD_STANDARDFLASH_ERASE_SECURTIY_REG_PAGE, address);
+	SPI_Exchange(flashContext->txBuffer, 4, NULL, 0, 0);
+	if(flashContext->displayOutput)
 	{
-		printSPIExchange(txStandardflashInternalBuffer, 4, NULL, 0);
+		printSPIExchange(flashContext->txBuffer, 4, NULL, 0);
 	}
 }
 
 void standardflashProgramSecurityRegisters(uint32_t address, uint8_t *txBuffer, uint32_t txNumBytes)
 {
-	load4BytesToTxBuffer(txStandardflashInternalBuffer, CMD_STANDARDFLASH_PROGRAM_SECURITY_REG_PAGE, address);
-	// Offset the data bytes by 4; opcode+address takes up the first 4 bytes of a transmission.
-	uint32_t totalBytes = txNumBytes + 4;
-
-	for(uint32_t j = 0; j < txNumBytes; j++)
-	{
-		txStandardflashInternalBuffer[j+4] = txBuffer[j];
-	}
-
-	SPI_Exchange(txStandardflashInternalBuffer, totalBytes, NULL, 0, 0);
-	if(DISPLAY_OUTPUT)
+	load4BytesToTxBuffer(flashContext->txBuffer, CMD_STANDARDFLASH_PROGRAM_SECURITY_REG_PAGE, address);
+	SPI_GatherExchange(1, 4, flashContext->txBuffer, 4, txBuffer, txNumBytes);
+	if(flashContext->displayOutput)
 	{
-		printSPIExchange(txStandardflashInternalBuffer, totalBytes, NULL, 0);
+		printSPIWrite(flashContext->txBuffer, 4, txBuffer, txNumBytes);
 	}
 }
 
 void standardflashReadSecurityRegisters(uint32_t address, uint8_t *rxBuffer, uint32_t rxNumBytes)
 {
-	load4BytesToTxBuffer(txStandardflashInternalBuffer, CMD_STANDARDFLASH_READ_SECURITY_REG_PAGE, address);
-	SPI_Exchange(txStandardflashInternalBuffer, 4, rxBuffer, rxNumBytes, 1);
-	if(DISPLAY_OUTPUT)
+	load4BytesToTxBuffer(flashContext->txBuffer, CMD_STANDARDFLASH_READ_SECURITY_REG_PAGE, address);
+	SPI_Exchange(flashContext->txBuffer, 4, rxBuffer, rxNumBytes, 1);
+	if(flashContext->displayOutput)
 	{
-		printSPIExchange(txStandardflashInternalBuffer, 4, rxBuffer, rxNumBytes);
+		printSPIExchange(flashContext->txBuffer, 4, rxBuffer, rxNumBytes);
 	}
 }
 
 void standardflashResumeFromDPDReadID(uint8_t *rxBuffer)
 {
-	txStandardflashInternalBuffer[0] = CMD_STANDARDFLASH_RESUME_FROM_DPD;
-	if(MCU_SPI_MODE == SPI)
-		SPI_Exchange(txStandardflashInternalBuffer, 1, rxBuffer, 1, 3);
+	flashContext->txBuffer[0] = CMD_STANDARDFLASH_RESUME_FROM_DPD;
+	if(flashContext->spiMode == SPI)
+		SPI_Exchange(flashContext->txBuffer, 1, rxBuffer, 1, 3);
 	else
-		SPI_QuadExchange(0, txStandardflashInternalBuffer, 1, rxBuffer, 1, 3);
-	if(DISPLAY_OUTPUT)
+		SPI_QuadExchange(0, flashContext->txBuffer, 1, rxBuffer, 1, 3);
+	if(flashContext->displayOutput)
 	{
-		printSPIExchange(txStandardflashInternalBuffer, 1, rxBuffer, 1);
+		printSPIExchange(flashContext->txBuffer, 1, rxBuffer, 1);
 	}
 }
 
 void standardflashQuadPageProgram(uint32_t address, uint8_t *txBuffer, uint32_t txNumBytes, uint8_t mode)
 {
-	load4BytesToTxBuffer(txStandardflashInternalBuffer, CMD_STANDARDFLASH_QUAD_PAGE_PROGRAM, address);
-	// Offset the data bytes by 4; opcode+address takes up the first 4 bytes of a transmission.
-	uint32_t totalBytes = txNumBytes + 4;
-
-	for(uint32_t j = 0; j < txNumBytes; j++)
-	{
-		txStandardflashInternalBuffer[j+4] = txBuffer[j];
-	}
-
-	if(MCU_SPI_MODE == SPI)
-		SPI_QuadExchange(1, txStandardflashInternalBuffer, totalBytes, NULL, 0, 0);
+	load4BytesToTxBuffer(flashContext->txBuffer, CMD_STANDARDFLASH_QUAD_PAGE_PROGRAM, address);
+	if(flashContext->spiMode == SPI)
+		SPI_GatherExchange(4, 1, flashContext->txBuffer, 4, txBuffer, txNumBytes);
 	else
-		SPI_QuadExchange(0, txStandardflashInternalBuffer, totalBytes, NULL, 0, 0);
-	if(DISPLAY_OUTPUT)
+		SPI_GatherExchange(4, 0, flashContext->txBuffer, 4, txBuffer, txNumBytes);
+	if(flashContext->displayOutput)
 	{
-		printSPIExchange(txStandardflashInternalBuffer, totalBytes, NULL, 0);
+		printSPIWrite(flashContext->txBuffer, 4, txBuffer, txNumBytes);
 	}
 }
 #endif
@@ -744,27 +774,27 @@ void standardflashQuadPageProgram(uint32_t address, uint8_t *txBuffer, uint32_t
 
 void standardflashEraseProgramSuspend()
 {
-	txStandardflashInternalBuffer[0] = (uint8_t) CMD_STANDARDFLASH_ERASE_PROGRAM_SUSPEND;
-	if(MCU_SPI_MODE == SPI)
-		SPI_Exchange(txStandardflashInternalBuffer, 1, NULL, 0, 0);
+	flashContext->txBuffer[0] = (uint8_t) CMD_STANDARDFLASH_ERASE_PROGRAM_SUSPEND;
+	if(flashContext->spiMode == SPI)
+		SPI_Exchange(flashContext->txBuffer, 1, NULL, 0, 0);
 	else
-		SPI_QuadExchange(0, txStandardflashInternalBuffer, 1, NULL, 0, 0);
-	if(DISPLAY_OUTPUT)
+		SPI_QuadExchange(0, flashContext->txBuffer, 1, NULL, 0, 0);
+	if(flashContext->displayOutput)
 	{
-		printSPIExchange(txStandardflashInternalBuffer, 1, NULL, 0);
+		printSPIExchange(flashContext->txBuffer, 1, NULL, 0);
 	}
 }
 
 void standardflashEraseProgramResume()
 {
-	txStandardflashInternalBuffer[0] = (uint8_t) CMD_STANDARDFLASH_ERASE_PROGRAM_RESUME;
-	if(MCU_SPI_MODE == SPI)
-		SPI_Exchange(txStandardflashInternalBuffer, 1, NULL, 0, 0);
+	flashContext->txBuffer[0] = (uint8_t) CMD_STANDARDFLASH_ERASE_PROGRAM_RESUME;
+	if(flashContext->spiMode == SPI)
+		SPI_Exchange(flashContext->txBuffer, 1, NULL, 0, 0);
 	else
-		SPI_QuadExchange(0, txStandardflashInternalBuffer, 1, NULL, 0, 0);
-	if(DISPLAY_OUTPUT)
+		SPI_QuadExchange(0, flashContext->txBuffer, 1, NULL, 0, 0);
+	if(flashContext->displayOutput)
 	{
-		printSPIExchange(txStandardflashInternalBuffer, 1, NULL, 0);
+		printSPIExchange(flashContext->txBuffer, 1, NULL, 0);
 	}
 }
 
@@ -783,77 +813,77 @@ void standardflashEraseProgramResume()
 
 void standardflashEnableQPI()
 {
-	txStandardflashInternalBuffer[0] = (uint8_t) CMD_STANDARDFLASH_ENABLE_QPI;
-	SPI_Exchange(txStandardflashInternalBuffer, 1, NULL, 0, 0);
-	if(DISPLAY_OUTPUT)
+	flashContext->txBuffer[0] = (uint8_t) CMD_STANDARDFLASH_ENABLE_QPI;
+	SPI_Exchange(flashContext->txBuffer, 1, NULL, 0, 0);
+	if(flashContext->displayOutput)
 	{
-		printSPIExchange(txStandardflashInternalBuffer, 1, NULL, 0);
+		printSPIExchange(flashContext->txBuffer, 1, NULL, 0);
 	}
-	// Set the MCU_SPI_MODE byte to QPI.
-	MCU_SPI_MODE = QPI;
+	// Set the flashContext->spiMode byte to QPI.
+	flashContext->spiMode = QPI;
 }
 
 void standardflashDisableQPI()
 {
-	txStandardflashInternalBuffer[0] = (uint8_t) CMD_STANDARDFLASH_DISABLE_QPI;
-	SPI_QuadExchange(0, txStandardflashInternalBuffer, 1, NULL, 0, 0);
-	if(DISPLAY_OUTPUT)
+	flashContext->txBuffer[0] = (uint8_t) CMD_STANDARDFLASH_DISABLE_QPI;
+	SPI_QuadExchange(0, flashContext->txBuffer, 1, NULL, 0, 0);
+	if(flashContext->displayOutput)
 	{
-		printSPIExchange(txStandardflashInternalBuffer, 1, NULL, 0);
+		printSPIExchange(flashContext->txBuffer, 1, NULL, 0);
 	}
-	// Set the MCU_SPI_MODE byte to SPI.
-	MCU_SPI_MODE = SPI;
+	// Set the flashContext->spiMode byte to SPI.
+	flashContext->spiMode = SPI;
 }
 
 void standardflashEnableReset()
 {
-	txStandardflashInternalBuffer[0] = (uint8_t) CMD_STANDARDFLASH_ENABLE_RESET;
-	if(MCU_SPI_MODE == SPI)
-		SPI_Exchange(txStandardflashInternalBuffer, 1, NULL, 0, 0);
+	flashContext->txBuffer[0] = (uint8_t) CMD_STANDARDFLASH_ENABLE_RESET;
+	if(flashContext->spiMode == SPI)
+		SPI_Exchange(flashContext->txBuffer, 1, NULL, 0, 0);
 	else
-		SPI_QuadExchange(0, txStandardflashInternalBuffer, 1, NULL, 0, 0);
-	if(DISPLAY_OUTPUT)
+		SPI_QuadExchange(0, flashContext->txBuffer, 1, NULL, 0, 0);
+	if(flashContext->displayOutput)
 	{
-		printSPIExchange(txStandardflashInternalBuffer, 1, NULL, 0);
+		printSPIExchange(flashContext->txBuffer, 1, NULL, 0);
 	}
 }
 
 void standardflashReset()
 {
-	txStandardflashInternalBuffer[0] = (uint8_t) CMD_STANDARDFLASH_RESET;
-	if(MCU_SPI_MODE == SPI)
-		SPI_Exchange(txStandardflashInternalBuffer, 1, NULL, 0, 0);
+	flashContext->txBuffer[0] = (uint8_t) CMD_STANDARDFLASH_RESET;
+	if(flashContext->spiMode == SPI)
+		SPI_Exchange(flashContext->txBuffer, 1, NULL, 0, 0);
 	else
-		SPI_QuadExchange(0, txStandardflashInternalBuffer, 1, NULL, 0, 0);
-	if(DISPLAY_OUTPUT)
+		SPI_QuadExchange(0, flashContext->txBuffer, 1, NULL, 0, 0);
+	if(flashContext->displayOutput)
 	{
-		printSPIExchange(txStandardflashInternalBuffer, 1, NULL, 0);
+		printSPIExchange(flashContext->txBuffer, 1, NULL, 0);
 	}
 }
 
 void standardflashEnterSecureOTP()
 {
-	txStandardflashInternalBuffer[0] = (uint8_t) CMD_STANDARDFLASH_ENTER_SECURED_OTP;
-	if(MCU_SPI_MODE == SPI)
-		SPI_Exchange(txStandardflashInternalBuffer, 1, NULL, 0, 0);
+	flashContext->txBuffer[0] = (uint8_t) CMD_STANDARDFLASH_ENTER_SECURED_OTP;
+	if(flashContext->spiMode == SPI)
+		SPI_Exchange(flashContext->txBuffer, 1, NULL, 0, 0);
 	else
-		SPI_QuadExchange(0, txStandardflashInternalBuffer, 1, NULL, 0, 0);
-	if(DISPLAY_OUTPUT)
+		SPI_QuadExchange(0, flashContext->txBuffer, 1, NULL, 0, 0);
+	if(flashContext->displayOutput)
 	{
-		printSPIExchange(txStandardflashInternalBuffer, 1, NULL, 0);
+		printSPIExchange(flashContext->txBuffer, 1, NULL, 0);
 	}
 }
 
 void standardflashExitSecuredOTP()
 {
-	txStandardflashInternalBuffer[0] = (uint8_t) CMD_STANDARDFLASH_EXIT_SECURED_OTP;
-	if(MCU_SPI_MODE == SPI)
-		SPI_Exchange(txStandardflashInternalBuffer, 1, NULL, 0, 0);
+	flashContext->txBuffer[0] = (uint8_t) CMD_STANDARDFLASH_EXIT_SECURED_OTP;
+	if(flashContext->spiMode == SPI)
+		SPI_Exchange(flashContext->txBuffer, 1, NULL, 0, 0);
 	else
-		SPI_QuadExchange(0, txStandardflashInternalBuffer, 1, NULL, 0, 0);
-	if(DISPLAY_OUTPUT)
+		SPI_QuadExchange(0, flashContext->txBuffer, 1, NULL, 0, 0);
+	if(flashContext->displayOutput)
 	{
-		printSPIExchange(txStandardflashInternalBuffer, 1, NULL, 0);
+		printSPIExchange(flashContext->txBuffer, 1, NULL, 0);
 	}
 }
 
@@ -869,124 +899,108 @@ void standardflashExitSecuredOTP()
 
 void standardflashReadSR(uint8_t *rxBuffer)
 {
-	txStandardflashInternalBuffer[0] = CMD_STANDARDFLASH_READ_SR;
-	if(MCU_SPI_MODE == SPI)
-		SPI_Exchange(txStandardflashInternalBuffer, 1, rxBuffer, 2, 0);
+	flashContext->txBuffer[0] = CMD_STANDARDFLASH_READ_SR;
+	if(flashContext->spiMode == SPI)
+		SPI_Exchange(flashContext->txBuffer, 1, rxBuffer, 2, 0);
 	else
-		SPI_QuadExchange(0, txStandardflashInternalBuffer, 1, rxBuffer, 2, 0);
-	if(DISPLAY_OUTPUT)
+		SPI_QuadExchange(0, flashContext->txBuffer, 1, rxBuffer, 2, 0);
+	if(flashContext->displayOutput)
 	{
-		printSPIExchange(txStandardflashInternalBuffer, 1, rxBuffer, 2);
+		printSPIExchange(flashContext->txBuffer, 1, rxBuffer, 2);
 	}
 }
 
 void standardflashDualInputBytePageProgram(uint32_t address, uint8_t *txBuffer, uint32_t txNumBytes)
 {
-	load4BytesToTxBuffer(txStandardflashInternalBuffer, CMD_STANDARDFLASH_DUAL_BYTE_PAGE_PROGRAM, address);
-	// Offset the data bytes by 4; opcode+address takes up the first 4 bytes of a transmission.
-	uint32_t totalBytes = txNumBytes + 4;
-
-	for(uint32_t j = 0; j < txNumBytes; j++)
-	{
-		txStandardflashInternalBuffer[j+4] = txBuffer[j];
-	}
-
-	SPI_DualExchange(4, txStandardflashInternalBuffer, totalBytes, NULL, 0, 0);
-	if(DISPLAY_OUTPUT)
+	load4BytesToTxBuffer(flashContext->txBuffer, CMD_STANDARDFLASH_DUAL_BYTE_PAGE_PROGRAM, address);
+	SPI_GatherExchange(2, 4, flashContext->txBuffer, 4, txBuffer, txNumBytes);
+	if(flashContext->displayOutput)
 	{
-		printSPIExchange(txStandardflashInternalBuffer, totalBytes, NULL, 0);
+		printSPIWrite(flashContext->txBuffer, 4, txBuffer, txNumBytes);
 	}
 }
 
 void standardflashProgramEraseSuspend()
 {
-	txStandardflashInternalBuffer[0] = (uint8_t) CMD_STANDARDFLASH_PROGRAM_ERASE_SUSPEND;
-	SPI_Exchange(txStandardflashInternalBuffer, 1, NULL, 0, 0);
-	if(DISPLAY_OUTPUT)
+	flashContext->txBuffer[0] = (uint8_t) CMD_STANDARDFLASH_PROGRAM_ERASE_SUSPEND;
+	SPI_Exchange(flashContext->txBuffer, 1, NULL, 0, 0);
+	if(flashContext->displayOutput)
 	{
-		printSPIExchange(txStandardflashInternalBuffer, 1, NULL, 0);
+		printSPIExchange(flashContext->txBuffer, 1, NULL, 0);
 	}
 }
 
 void standardflashProgramEraseResume()
 {
-	txStandardflashInternalBuffer[0] = (uint8_t) CMD_STANDARDFLASH_PROGRAM_ERASE_RESUME;
-	SPI_Exchange(txStandardflashInternalBuffer, 1, NULL, 0, 0);
-	if(DISPLAY_OUTPUT)
+	flashContext->txBuffer[0] = (uint8_t) CMD_STANDARDFLASH_PROGRAM_ERASE_RESUME;
+	SPI_Exchange(flashContext->txBuffer, 1, NULL, 0, 0);
+	if(flashContext->displayOutput)
 	{
-		printSPIExchange(txStandardflashInternalBuffer, 1, NULL, 0);
+		printSPIExchange(flashContext->txBuffer, 1, NULL, 0);
 	}
 }
 
 void standardflashProtectSector(uint32_t address)
 {
-	load4BytesToTxBuffer(txStandardflashInternalBuffer, CMD_STANDARDFLASH_PROTECT_SECTOR, address);
-	SPI_Exchange(txStandardflashInternalBuffer, 4, NULL, 0, 0);
-	if(DISPLAY_OUTPUT)
+	load4BytesToTxBuffer(flashContext->txBuffer, CMD_STANDARDFLASH_PROTECT_SECTOR, address);
+	SPI_Exchange(flashContext->txBuffer, 4, NULL, 0, 0);
+	if(flashContext->displayOutput)
 	{
-		printSPIExchange(txStandardflashInternalBuffer, 4, NULL, 0);
+		printSPIExchange(flashContext->txBuffer, 4, NULL, 0);
 	}
 }
 void standardflashUnprotectSector(uint32_t address)
 {
-	load4BytesToTxBuffer(txStandardflashInternalBuffer, CMD_STANDARDFLASH_UNPROTECT_SECTOR, address);
-	SPI_Exchange(txStandardflashInternalBuffer, 4, NULL, 0, 0);
-	if(DISPLAY_OUTPUT)
+	load4BytesToTxBuffer(flashContext->txBuffer, CMD_STANDARDFLASH_UNPROTECT_SECTOR, address);
+	SPI_Exchange(flashContext->txBuffer, 4, NULL, 0, 0);
+	if(flashContext->displayOutput)
 	{
-		printSPIExchange(txStandardflashInternalBuffer, 4, NULL, 0);
+		printSPIExchange(flashContext->txBuffer, 4, NULL, 0);
 	}
 }
 
 uint8_t standardflashReadSectorProtectionReg(uint32_t address)
 {
 	uint8_t registerVal = 0;
-	load4BytesToTxBuffer(txStandardflashInternalBuffer, CMD_STANDARDFLASH_READ_SECT_PROT_REG, address);
-	SPI_Exchange(txStandardflashInternalBuffer, 4, &registerVal, 1, 0);
-	if(DISPLAY_OUTPUT)
+	load4BytesToTxBuffer(flashContext->txBuffer, CMD_STANDARDFLASH_READ_SECT_PROT_REG, address);
+	SPI_Exchange(flashContext->txBuffer, 4, &registerVal, 1, 0);
+	if(flashContext->displayOutput)
 	{
-		printSPIExchange(txStandardflashInternalBuffer, 4, &registerVal, 1);
+		printSPIExchange(flashContext->txBuffer, 4, &registerVal, 1);
 	}
 	return registerVal;
 }
 
 void standardflashFreezeLockdownState()
 {
-	load4BytesToTxBuffer(txStandardflashInternalBuffer, CMD_STANDARDFLASH_FREEZE_LOCKDOWN_STATE, (uint32_t) 0x0055AA40);
-	txStandardflashInternalBuffer[4] = 0xD0;
-	SPI_Exchange(txStandardflashInternalBuffer, 5, NULL, 0, 0);
-	if(DISPLAY_OUTPUT)
+	load4BytesToTxBuffer(flashContext->txBuffer, CMD_STANDARDFLASH_FREEZE_LOCKDOWN_STATE, (uint32_t) 0x0055AA40);
+	flashContext->txBuffer[4] = 0xD0;
+	SPI_Exchange(flashContext->txBuffer, 5, NULL, 0, 0);
+	if(flashContext->displayOutput)
 	{
-		printSPIExchange(txStandardflashInternalBuffer, 5, NULL, 0);
+		printSPIExchange(flashContext->txBuffer, 5, NULL, 0);
 	}
 }
 
 uint8_t standardflashReadLockdownReg(uint32_t address)
 {
 	uint8_t registerVal = 0;
-	load4BytesToTxBuffer(txStandardflashInternalBuffer, CMD_STANDARDFLASH_READ_LOCKDOWN_REG, address);
-	SPI_Exchange(txStandardflashInternalBuffer, 4, &registerVal, 1, 1);
-	if(DISPLAY_OUTPUT)
+	load4BytesToTxBuffer(flashContext->txBuffer, CMD_STANDARDFLASH_READ_LOCKDOWN_REG, address);
+	SPI_Exchange(flashContext->txBuffer, 4, &registerVal, 1, 1);
+	if(flashContext->displayOutput)
 	{
-		printSPIExchange(txStandardflashInternalBuffer, 4, &registerVal, 1);
+		printSPIExchange(flashContext->txBuffer, 4, &registerVal, 1);
 	}
 	return registerVal;
 }
 
 void standardflashProgramOTPReg(uint32_t address, uint8_t *txBuffer, uint32_t txNumBytes)
 {
-	load4BytesToTxBuffer(txStandardflashInternalBuffer, CMD_STANDARDFLASH_PROGRAM_OTP_REG, address);
-	// Offset the data bytes by 4; opcode+address takes up the first 4 bytes of a transmission.
-	uint32_t totalBytes = txNumBytes + 4;
-
-	for(uint32_t j = 0; j < txNumBytes; j++)
-	{
-		txStandardflashInternalBuffer[j+4] = txBuffer[j];
-	}
-
-	SPI_Exchange(txStandardflashInternalBuffer, totalBytes, NULL, 0, 0);
-	if(DISPLAY_OUTPUT)
+	load4BytesToTxBuffer(flashContext->txBuffer, CMD_STANDARDFLASH_PROGRAM_OTP_REG, address);
+	SPI_GatherExchange(1, 4, flashContext->txBuffer, 4, txBuffer, txNumBytes);
+	if(flashContext->displayOutput)
 	{
-		printSPIExchange(txStandardflashInternalBuffer, totalBytes, NULL, 0);
+		printSPIWrite(flashContext->txBuffer, 4, txBuffer, txNumBytes);
 	}
 }
 #endif
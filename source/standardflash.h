@@ -67,8 +67,6 @@
 	(PARTNO == AT25QF641)	|| \
 	(ALL == 1)
 
-extern uint8_t txStandardflashInternalBuffer[MAXIMUM_TX_BYTES];
-
 /******************************************
  *
  *
@@ -79,8 +77,8 @@ extern uint8_t txStandardflashInternalBuffer[MAXIMUM_TX_BYTES];
 
 /*!
  * @brief: Wait while Read/Busy Status bit in SRB is 1 (device is busy).
- * This is accomplished by reading the first status register and delaying
- * while the BSY bit is 1.
+ * Same as standardflashWaitOnReadyFor(0): the first sample is taken right away, for
+ * use when the duration of the last command is not known.
  *
  * This is a 'derived' command which uses multiple single commands to accomplish
  * a set task.
@@ -89,6 +87,26 @@ extern uint8_t txStandardflashInternalBuffer[MAXIMUM_TX_BYTES];
  */
 void standardflashWaitOnReady();
 
+/*!
+ * @brief: Wait while Read/Busy Status bit in SRB is 1 (device is busy). The
+ * read status register command is sent once and the status is sampled while
+ * CSb is held low (SPI_WaitReady()), in SPI or QPI mode.
+ *
+ * @param expectedUs Typical duration of the operation being waited on, for
+ * example @ref STANDARDFLASH_TBE4K_US after a 4K block erase.
+ *
+ * @retval void
+ */
+void standardflashWaitOnReadyFor(uint32_t expectedUs);
+
+/*!
+ * @brief Returns the BSY bit of the status register without waiting.
+ *
+ * @retval 1 The device is busy with a program or erase.
+ * @retval 0 The device is ready.
+ */
+uint8_t standardflashIsBusy();
+
 /*!
  * @brief: Sets the QE bit in status register byte 2. Does not modify any other bits.
  * This is accomplished by first reading both bytes, performing a write enable, then
@@ -260,6 +278,82 @@ void standardflashReadID(uint8_t *rxBuffer);
  * @retval void
  */
 void standardflashReadMID(uint8_t *rxBuffer);
+
+/*!
+ * @brief Programs 'txNumBytes' bytes of any length starting at 'address'. The
+ * data is split on @ref STANDARDFLASH_PAGE_SIZE boundaries; each part is sent
+ * with standardflashWriteEnable() and standardflashBytePageProgram(), then
+ * standardflashWaitOnReady() is called. The memory must have been erased and
+ * unprotected beforehand.
+ *
+ * @param address The 3 bytes address indicating the first location to be written to.
+ * @param txBuffer Pointer to the tx bytes that will be stored in memory. Must
+ * have a minimum of txNumBytes elements.
+ * @param txNumBytes Number of bytes to be written to the device.
+ *
+ * @retval void
+ */
+void standardflashProgram(uint32_t address, uint8_t *txBuffer, uint32_t txNumBytes);
+
+/*!
+ * @brief Reads 'rxNumBytes' bytes of any length starting at 'address' in a
+ * single continuous read (standardflashReadArrayHighFreq()).
+ *
+ * @param address 3 byte address starting from which the data in memory will be read.
+ * @param rxBuffer Pointer to the byte array in which the read data will be stored.
+ * Must have at least rxNumBytes elements.
+ * @param rxNumBytes Number of bytes to be read from the memory.
+ *
+ * @retval void
+ */
+void standardflashRead(uint32_t address, uint8_t *rxBuffer, uint32_t rxNumBytes);
+
+/*!
+ * @brief OPCODE: 0x0B <br>
+ * Opens a read stream starting at 'address'. The data is then read in any
+ * number of pieces with SPI_StreamRead() while CSb stays low, and the read
+ * ends with SPI_StreamClose(). Works in both SPI and QPI mode.
+ *
+ * @param stream The stream to open.
+ * @param address 3 byte address starting from which the data in memory will be read.
+ *
+ * @retval void
+ */
+void standardflashOpenReadStream(SPI_Stream *stream, uint32_t address);
+
+/*!
+ * @brief Erases the @ref STANDARDFLASH_ERASE_SIZE block containing 'address'
+ * with standardflashWriteEnable() and standardflashBlockErase4K(), then calls
+ * standardflashWaitOnReady().
+ *
+ * @param address Any 3 byte address inside the block to be erased.
+ *
+ * @retval void
+ */
+void standardflashErase(uint32_t address);
+
+/*!
+ * @brief Starts programming 'txNumBytes' bytes within one page with
+ * standardflashWriteEnable() and standardflashBytePageProgram(), without
+ * waiting for the program to complete (see standardflashIsBusy()).
+ *
+ * @param address The 3 bytes address indicating the first location to be written to.
+ * @param txBuffer Pointer to the tx bytes that will be stored in memory.
+ * @param txNumBytes Number of bytes to be written. Must not cross a page boundary.
+ *
+ * @retval void
+ */
+void standardflashProgramPageStart(uint32_t address, uint8_t *txBuffer, uint32_t txNumBytes);
+
+/*!
+ * @brief Starts erasing the @ref STANDARDFLASH_ERASE_SIZE block containing
+ * 'address', without waiting for the erase to complete (see standardflashIsBusy()).
+ *
+ * @param address Any 3 byte address inside the block to be erased.
+ *
+ * @retval void
+ */
+void standardflashEraseStart(uint32_t address);
 #endif
 #if (PARTNO == AT25SF641) 	|| \
 	(PARTNO == AT25SF321)	|| \
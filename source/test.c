@@ -518,11 +518,22 @@ uint32_t fusionTest()
 	// state and the data will be unpredictable. We test for this by reading the device and confirming
 	// that the output doesn't match the stored data. The probability that it will is infinitesimal.
 	// If any errors are output, the device is in DPD Mode and the test passes.
+
+	// First, program known data to the device. Parts without the dual mode tests
+	// still hold the sequential program data at this point.
+	fusionWriteEnable();
+	fusionBlockErase4K(0);
+	fusionWaitOnReadyFor(FUSION_TBE_US);
+	fusionWriteEnable();
+	fusionProgramArray(0, dataWrite, 100);
+	fusionWaitOnReady();
+
+	// Send the device to deep power down mode.
 	fusionDeepPowerDown();
 	// Attempt to read from the device. Note, this should not work in DPD Mode.
 	fusionReadArray(0, dataRead, 100);
 	// Compare the data as stated above. There should me a data mismatch in DPD mode.
-	if(!compareByteArrays(dataRead, dataTest, 25))
+	if(!compareByteArrays(dataRead, dataWrite, 25))
 	{
 		printf("DEVICE IS IN DPD MODE. DATA MISMATCH EXPECTED. TEST PASSED.\n");
 	}
@@ -623,7 +634,7 @@ uint32_t fusionTest()
 	// Attempt to read from the device. Note, this should not work in DPD Mode.
 	fusionReadArray(0, dataRead, 100);
 	// Compare the data as stated above. There should me a data mismatch in DPD mode.
-	if(!compareByteArrays(dataRead, dataTest, 25))
+	if(!compareByteArrays(dataRead, dataWrite, 25))
 	{
 		printf("DEVICE IS IN UDPD MODE. DATA MISMATCH EXPECTED. TEST PASSED.\n");
 	}
@@ -870,6 +881,8 @@ uint32_t dataflashTest()
 	dataflashBuffer1Write(0, dataWrite, 100);
 	// Write the data to main memory from buffer 1 without erase
 	dataflashBuffer1ToMainMemoryWithoutErase(0);
+	// Wait for the page program to finish.
+	dataflashWaitOnReady();
 	// Read back and compare
 	dataflashArrayReadLowFreq(0, dataRead, 100);
 	if(!compareByteArrays(dataRead, dataWrite, 100))
@@ -901,6 +914,8 @@ uint32_t dataflashTest()
 	dataflashBuffer2Write(100, dataWrite, 100);
 	// Write the data to main memory from buffer 1 without erase
 	dataflashBuffer2ToMainMemoryWithoutErase(0);
+	// Wait for the page program to finish.
+	dataflashWaitOnReady();
 	// Read back and compare
 	dataflashArrayReadLowFreq(100, dataRead, 100);
 	if(!compareByteArrays(dataRead, dataWrite, 100))
@@ -1920,7 +1935,7 @@ uint32_t standardflashTest()
 	standardflashQuadIORead(40, &(dataRead[40]), 10, 3, modeByteValue);
 	// For the purpose of this test, return the flash device to QPI mode.
 	// If one wishes to continue in SPI, call standardflashDisableQPI() to return
-	// the MCU_SPI_MODE variable (part of the driver) to 0.
+	// the spiMode of the driver context (see flash_context.h) to 0.
 	standardflashEnableQPI();
 	if(!compareByteArrays(dataRead, dataWrite, 50))
 	{
@@ -39,8 +39,16 @@
  * @brief   Project definitions exist here.
  */
 
+#if defined(USER_CONFIG_HOST)
+// clock_gettime() is POSIX rather than C99.
+#define _POSIX_C_SOURCE 199309L
+#endif
 #include "user_config.h"
+#if defined(USER_CONFIG_HOST)
+#include <time.h>
+#endif
 
+#if !defined(USER_CONFIG_HOST)
 void USER_CONFIG_PinInit(uint32_t port, uint32_t pin, enum directionIO direction)
 {
 	if(direction == OUTPUT)
@@ -79,4 +87,103 @@ void USER_CONFIG_BoardInit()
     BOARD_InitBootPeripherals();
   	/* Init FSL debug console. */
     BOARD_InitDebugConsole();
+	/* Enable the DWT cycle counter used by USER_CONFIG_CycleCount(). */
+	CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+	DWT->CYCCNT = 0;
+	DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
 }
+
+uint32_t USER_CONFIG_CycleCount()
+{
+	return DWT->CYCCNT;
+}
+
+uint64_t USER_CONFIG_CycleCount64()
+{
+	static uint32_t last = 0;
+	static uint32_t high = 0;
+	uint32_t critical = USER_CONFIG_EnterCritical();
+	uint32_t now = DWT->CYCCNT;
+	if(now < last)
+	{
+		high++;
+	}
+	last = now;
+	USER_CONFIG_ExitCritical(critical);
+	return ((uint64_t) high << 32) | now;
+}
+
+uint32_t USER_CONFIG_CycleCountHz()
+{
+	return SystemCoreClock;
+}
+
+uint32_t USER_CONFIG_EnterCritical()
+{
+	uint32_t state = __get_PRIMASK();
+	__disable_irq();
+	return state;
+}
+
+void USER_CONFIG_ExitCritical(uint32_t state)
+{
+	__set_PRIMASK(state);
+}
+#else
+void USER_CONFIG_PinInit(uint32_t port, uint32_t pin, enum directionIO direction)
+{
+	(void) port;
+	(void) pin;
+	(void) direction;
+}
+
+void USER_CONFIG_PinClear(uint32_t port, uint32_t pin)
+{
+	(void) port;
+	(void) pin;
+}
+
+void USER_CONFIG_PinSet(uint32_t port, uint32_t pin)
+{
+	(void) port;
+	(void) pin;
+}
+
+uint8_t USER_CONFIG_PinRead(uint32_t port, uint32_t pin)
+{
+	(void) port;
+	(void) pin;
+	return 0;
+}
+
+void USER_CONFIG_BoardInit()
+{
+}
+
+uint32_t USER_CONFIG_CycleCount()
+{
+	return (uint32_t) USER_CONFIG_CycleCount64();
+}
+
+uint64_t USER_CONFIG_CycleCount64()
+{
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (uint64_t) now.tv_sec * 1000000000ULL + (uint64_t) now.tv_nsec;
+}
+
+uint32_t USER_CONFIG_CycleCountHz()
+{
+	return 1000000000U;
+}
+
+uint32_t USER_CONFIG_EnterCritical()
+{
+	return 0;
+}
+
+void USER_CONFIG_ExitCritical(uint32_t state)
+{
+	(void) state;
+}
+#endif
@@ -67,6 +67,19 @@
  * @@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@
  */
 
+/*!
+ * @brief Define USER_CONFIG_HOST (for example with -DUSER_CONFIG_HOST) to build
+ * the drivers for a Linux/POSIX host instead of the MCU. No GPIOs are available
+ * in that case, so a transport other than the bit-bang driver must be selected
+ * with SPI_SetTransport() (see spi_transport.h).
+ *
+ * Define USER_CONFIG_EMULATOR as well to have main() select the flash
+ * emulator transport (see spi_transport_emulator.h), which runs the drivers
+ * and tests against a software model of PARTNO. main() then also runs the
+ * benchmarks of benchmark.h, which on the board are run by defining
+ * USER_CONFIG_BENCHMARK.
+ */
+#if !defined(USER_CONFIG_HOST)
 // Included for board initialization (see USER_CONFIG_BoardInit()).
 #include "board.h"
 // Included for board initialization (see USER_CONFIG_BoardInit()).
@@ -75,6 +88,13 @@
 #include "pin_mux.h"
 // Included for GPIO library function calls (see USER_CONFIG_BoardInit()).
 #include "fsl_gpio.h"
+#else
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+// There is no GPIO block on a host; the pin functions are no-ops.
+#define GPIO3_BASE 0U
+#endif
 
 /*
  * @@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@
@@ -187,7 +207,8 @@
 #define USER_CONFIG_IO2_PIN 10U
 //! Pin number for IO3
 #define USER_CONFIG_IO3_PIN 11U
-//! Half clock period delay interval
+//! Delay interval, in SPI_Delay() iterations, used for the JEDEC reset and
+//! trigger pulses, and as the SCK half clock period until SPI_CalibrateClock() has run.
 #define DELAY 5U
 
 
@@ -246,6 +267,78 @@ void USER_CONFIG_PinSet(uint32_t port, uint32_t pin);
  */
 uint8_t USER_CONFIG_PinRead(uint32_t port, uint32_t pin);
 
+/*
+ * The following macros give the bit-bang driver whole-port access so that
+ * all SPI IOs can be driven or sampled with one register access per clock
+ * edge. They are only used when SCK, MOSI, MISO, IO2 and IO3 share a port
+ * (see SPI_SetBitBangEngine()). When porting, map them onto the set, clear
+ * and input data registers of the GPIO block.
+ */
+#if !defined(USER_CONFIG_HOST)
+/*!
+ * @brief Drives HIGH every pin of 'port' whose bit is set in 'mask'.
+ */
+#define USER_CONFIG_PORT_SET(port, mask) GPIO_PortSet((GPIO_Type *)(port), (mask))
+/*!
+ * @brief Drives LOW every pin of 'port' whose bit is set in 'mask'.
+ */
+#define USER_CONFIG_PORT_CLEAR(port, mask) GPIO_PortClear((GPIO_Type *)(port), (mask))
+/*!
+ * @brief Reads the input level of every pin of 'port' as one 32-bit word.
+ */
+#define USER_CONFIG_PORT_READ(port) (((GPIO_Type *)(port))->PDIR)
+#else
+#define USER_CONFIG_PORT_SET(port, mask) ((void) (port), (void) (mask))
+#define USER_CONFIG_PORT_CLEAR(port, mask) ((void) (port), (void) (mask))
+#define USER_CONFIG_PORT_READ(port) ((void) (port), 0U)
+#endif
+
+/*!
+ * @brief Returns a free running cycle counter. Used to benchmark the drivers.
+ * On the K82 this is the DWT cycle counter enabled in USER_CONFIG_BoardInit(),
+ * on a host it is a monotonic nanosecond clock.
+ *
+ * @retval uint32_t The current counter value. The counter wraps at 2^32.
+ */
+uint32_t USER_CONFIG_CycleCount();
+
+/*!
+ * @brief Returns the same count as USER_CONFIG_CycleCount() without the 2^32
+ * wrap, for timing operations that may outlast it. On the K82 the high word
+ * is kept in software, so the function must be called at least once per wrap
+ * of the DWT counter (about 28 s at 150 MHz).
+ *
+ * @retval uint64_t The current counter value.
+ */
+uint64_t USER_CONFIG_CycleCount64();
+
+/*!
+ * @brief Returns the rate of USER_CONFIG_CycleCount() in counts per second.
+ * On the K82 this is the core clock, on a host it is 1 GHz.
+ *
+ * @retval uint32_t Counts per second.
+ */
+uint32_t USER_CONFIG_CycleCountHz();
+
+/*!
+ * @brief Masks the interrupts that may call back into the drivers (for
+ * example a transport's completion interrupt calling SPI_AsyncComplete()),
+ * so that state shared with them can be updated atomically. Calls may nest.
+ * On the K82 this sets PRIMASK, on a host it does nothing.
+ *
+ * @retval uint32_t The previous interrupt state, to be passed to USER_CONFIG_ExitCritical().
+ */
+uint32_t USER_CONFIG_EnterCritical();
+
+/*!
+ * @brief Restores the interrupt state saved by USER_CONFIG_EnterCritical().
+ *
+ * @param state The value returned by the matching USER_CONFIG_EnterCritical().
+ *
+ * @retval void
+ */
+void USER_CONFIG_ExitCritical(uint32_t state);
+
 
 /*
  * @@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@